@@ -5,9 +5,12 @@
 // Michael Quinlan
 // $Id$
 
+#ifndef __FILTERED_POLYGON_H__
+#define __FILTERED_POLYGON_H__
+
 #include <art_msgs/ArtQuadrilateral.h>
 #include <art_map/KF.h>
-#include <art_map/Matrix.h>
+#include <art_map/FixedMatrix.h>
 #include <art_map/PolyOps.h>
 
 #define NUM_POINTS 4
@@ -21,10 +24,10 @@ class FilteredPolygon
   void SetPoint(int pointID, float x, float y);
   void UpdatePoint(int pointID, float visionDistance, float visionAngle,
                    float confidence,float rx, float ry, float rori);
-  Matrix GetDistanceJacobian(float xb, float yb, float x, float y);
-  Matrix GetAngleJacobian(float xb, float yb, float x, float y);
+  FixedMatrix<1,2> GetDistanceJacobian(float xb, float yb, float x, float y);
+  FixedMatrix<1,2> GetAngleJacobian(float xb, float yb, float x, float y);
  
-  KF point[NUM_POINTS];
+  KF<2> point[NUM_POINTS];
   KFStruct distStruct;
   KFStruct angleStruct;
 
@@ -32,7 +35,16 @@ class FilteredPolygon
   poly GetPolygon();
   art_msgs::ArtQuadrilateral GetQuad();
 
+  // what GetPolygon() returns right after SetPolygon(p), without
+  // starting any filters
+  static poly InitialPolygon(const poly &p);
+
+  // quadrilateral message for a polygon, as GetQuad() makes it
+  static art_msgs::ArtQuadrilateral MakeQuad(const poly &p);
+
  private:
   poly polygon_;
   PolyOps ops_;
 };
+
+#endif // __FILTERED_POLYGON_H__
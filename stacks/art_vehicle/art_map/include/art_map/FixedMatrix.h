@@ -0,0 +1,137 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     C++ interface for fixed-size matrices.
+
+     FixedMatrix<M,N> has the same interface as Matrix, but its
+     dimensions are template parameters and its elements live inside
+     the object, so temporaries never touch the heap and dimension
+     mismatches fail to compile.  The operators do their arithmetic
+     in the same order as the Matrix ones, giving identical results.
+
+ */
+
+#ifndef _FixedMatrix_h_DEFINED
+#define _FixedMatrix_h_DEFINED
+
+template <int M, int N>
+class FixedMatrix
+{
+public:
+  float		X[M*N];			// elements, in row order
+
+  /** constructor
+   *
+   * @param I true for an identity matrix, otherwise all zeros
+   */
+  explicit FixedMatrix(bool I=false)
+  {
+    for (int i = 0; i < M; i++)
+      for (int j = 0; j < N; j++)
+	X[i*N+j] = (I && i == j)? 1: 0;
+  };
+
+  static int	getm()	{ return M; }	// return number  of rows
+  static int	getn()	{ return N; }	// return number  of columns
+
+  /** @return pointer to the ith row */
+  float *operator[](int i) { return &X[i*N]; }
+  const float *operator[](int i) const { return &X[i*N]; }
+
+  FixedMatrix<N,M> transp() const	// Matrix Transpose
+  {
+    FixedMatrix<N,M> transpAns;
+    for (int i = 0; i < M; i++)
+      for (int j = 0; j < N; j++)
+	transpAns[j][i] = (*this)[i][j];
+    return transpAns;
+  };
+};
+
+template <int M, int N>
+FixedMatrix<M,N> operator + (const FixedMatrix<M,N> &a,
+			     const FixedMatrix<M,N> &b)
+{
+  FixedMatrix<M,N> addAns;
+  for (int i = 0; i < M*N; i++)
+    addAns.X[i] = a.X[i] + b.X[i];
+  return addAns;
+}
+
+template <int M, int N>
+FixedMatrix<M,N> operator - (const FixedMatrix<M,N> &a,
+			     const FixedMatrix<M,N> &b)
+{
+  FixedMatrix<M,N> subAns;
+  for (int i = 0; i < M*N; i++)
+    subAns.X[i] = a.X[i] - b.X[i];
+  return subAns;
+}
+
+template <int M, int K, int N>
+FixedMatrix<M,N> operator * (const FixedMatrix<M,K> &a,
+			     const FixedMatrix<K,N> &b)
+{
+  FixedMatrix<M,N> multAns;
+  for (int i = 0; i < M; i++)
+    for (int j = 0; j < N; j++)
+      {
+	float temp = 0;
+	for (int k = 0; k < K; k++)
+	  temp += a[i][k] * b[k][j];
+	multAns[i][j] = temp;
+      }
+  return multAns;
+}
+
+template <int M, int N>
+FixedMatrix<M,N> operator * (const float &a, const FixedMatrix<M,N> &b)
+{
+  FixedMatrix<M,N> multAns;
+  for (int i = 0; i < M*N; i++)
+    multAns.X[i] = b.X[i] * a;
+  return multAns;
+}
+
+template <int M, int N>
+FixedMatrix<M,N> operator * (const FixedMatrix<M,N> &a, const float &b)
+{
+  FixedMatrix<M,N> multAns;
+  for (int i = 0; i < M*N; i++)
+    multAns.X[i] = a.X[i] * b;
+  return multAns;
+}
+
+template <int M, int N>
+FixedMatrix<M,N> operator / (const FixedMatrix<M,N> &a, const float &b)
+{
+  FixedMatrix<M,N> divAns;
+  for (int i = 0; i < M*N; i++)
+    divAns.X[i] = a.X[i] / b;
+  return divAns;
+}
+
+// 2x2 Matrix Inversion
+inline FixedMatrix<2,2> Invert22(const FixedMatrix<2,2> &a)
+{
+  FixedMatrix<2,2> invertAns;
+  invertAns[0][0] = a[1][1];
+  invertAns[0][1] = -a[0][1];
+  invertAns[1][0] = -a[1][0];
+  invertAns[1][1] = a[0][0];
+  float divisor = a[0][0]*a[1][1] - a[0][1]*a[1][0];
+  return invertAns / divisor;
+}
+
+// Convert 1x1 matrix to Double
+inline float convDble(const FixedMatrix<1,1> &a) { return a[0][0]; }
+
+#endif // _FixedMatrix_h_DEFINED
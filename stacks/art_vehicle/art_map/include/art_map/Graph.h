@@ -24,6 +24,7 @@
 #include <cstdlib>
 
 #include <art_map/coordinates.h>
+#include <art_map/KDTree.h>
 #include <art_map/types.h>
 
 typedef std::vector<WayPointEdge> WayPointEdgeList;
@@ -40,6 +41,7 @@ class Graph{
     edges_size = 0;
     nodes=NULL;
     edges.clear();
+    max_lane_width_ = 0.0;
   };
 
   Graph(uint num_nodes, uint num_edges, 
@@ -54,6 +56,7 @@ class Graph{
     edges.clear();
    for (uint i=0; i< num_edges; i++)
      edges.push_back(nedges[i]);
+   index_nodes();
   };
   
   Graph(Graph& that){
@@ -64,6 +67,7 @@ class Graph{
     
     this->edges_size=that.edges_size;
     this->edges=that.edges;
+    index_nodes();
   };
 
 
@@ -123,6 +127,17 @@ class Graph{
   WayPointNode* get_closest_node(const MapXY &p) const;
   WayPointNode* get_closest_node_within_radius(const MapXY &p) const;
 
+  /** Rebuild the spatial index of node positions.
+   *
+   *  find_mapxy(), xy_rndf() and load() do this.  Code that moves
+   *  nodes some other way must call it again.  The index only
+   *  notices a new nodes array or node count, so until then closest
+   *  node queries silently use the old positions and may return the
+   *  wrong node.  They scan every node only when there is no index
+   *  for this array.
+   */
+  void index_nodes(void);
+
   WayPointNode* nodes;
   std::vector<WayPointEdge> edges;
   uint32_t nodes_size;
@@ -130,6 +145,19 @@ class Graph{
   bool passing_allowed(int index, int index2, bool left);
 
   bool lanes_in_same_direction(int index1,int index2, bool& left_lane);
+
+ private:
+  // lookup tables for find_implicit_edges()
+  struct NodeLookup;
+  int find_node_index(const ElementID &id, const NodeLookup *lookup) const;
+  bool passing_allowed(int index, int index2, bool left,
+		       const NodeLookup *lookup);
+  bool lanes_in_same_direction(int index1,int index2, bool& left_lane,
+			       const NodeLookup *lookup);
+  int closest_in_lane(int index, int lane, const NodeLookup *lookup) const;
+
+  KDTree node_tree_;                  ///< nodes by map position
+  float max_lane_width_;              ///< of all nodes in node_tree_
 };
 	
 int parse_integer(std::string line, std::string token, 
@@ -0,0 +1,135 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     C++ interface for a 2-d tree of way-point graph nodes.
+
+     The tree holds array indexes of WayPointNode objects, ordered by
+     their MapXY positions.  Nearest neighbor searches measure the
+     same Euclidean::DistanceTo() the linear scans they replace did,
+     and break ties in favor of the lowest array index, so results
+     are identical.
+
+ */
+
+#ifndef __KDTREE_H__
+#define __KDTREE_H__
+
+#include <float.h>
+#include <math.h>
+#include <vector>
+
+#include <art_map/euclidean_distance.h>
+#include <art_map/types.h>
+
+class KDTree
+{
+public:
+  KDTree(): nodes_(NULL) {};
+
+  /** build tree for current positions of an array of nodes */
+  void build(const WayPointNode nodes[], unsigned nnodes);
+
+  void clear()
+  {
+    entries_.clear();
+    nodes_ = NULL;
+  };
+
+  /** @return true if tree was built for this array and size; it
+   *          cannot tell whether the nodes moved since
+   */
+  bool indexes(const WayPointNode nodes[], unsigned nnodes) const
+  {
+    return (nodes == nodes_ && nnodes == entries_.size() && nnodes > 0);
+  };
+
+  /** find the nearest acceptable node
+   *
+   * @param p point to search from
+   * @param accept predicate, called as accept(index, distance)
+   * @param radius ignore nodes at this distance or farther
+   * @return array index of nearest node accepted, -1 if none
+   */
+  template <class Accept>
+  int nearest(const MapXY &p, Accept &accept, float radius=FLT_MAX) const
+  {
+    Search<Accept> s(p, accept, radius);
+    search(0, entries_.size(), 0, s);
+    return s.best;
+  };
+
+private:
+
+  struct Entry
+  {
+    float x;
+    float y;
+    unsigned index;
+  };
+
+  template <class Accept>
+  struct Search
+  {
+    const MapXY &p;
+    Accept &accept;
+    float radius;
+    int best;
+    float best_dist;
+    Search(const MapXY &_p, Accept &_accept, float _radius):
+      p(_p), accept(_accept), radius(_radius), best(-1),
+      best_dist(FLT_MAX) {};
+  };
+
+  void build(unsigned lo, unsigned hi, int depth);
+
+  template <class Accept>
+  void search(unsigned lo, unsigned hi, int depth, Search<Accept> &s) const
+  {
+    if (lo >= hi)
+      return;
+
+    unsigned mid = (lo + hi) / 2;
+    const Entry &e = entries_[mid];
+    float dist = Euclidean::DistanceTo(s.p, nodes_[e.index].map);
+    if (dist < s.radius
+	&& (dist < s.best_dist
+	    || (dist == s.best_dist && (int) e.index < s.best))
+	&& s.accept(e.index, dist))
+      {
+	s.best = e.index;
+	s.best_dist = dist;
+      }
+
+    // Search the side containing p first.  Only visit the other side
+    // if it could hold something as close as the best found so far
+    // (allowing for float rounding in the distance, because ties
+    // must still be seen).
+    double diff = (depth & 1)? s.p.y - e.y: s.p.x - e.x;
+    if (diff < 0.0)
+      search(lo, mid, depth+1, s);
+    else
+      search(mid+1, hi, depth+1, s);
+
+    double limit = (s.best_dist < s.radius? s.best_dist: s.radius);
+    if (fabs(diff) <= limit * (1.0 + 1e-5) + 1e-5)
+      {
+	if (diff < 0.0)
+	  search(mid+1, hi, depth+1, s);
+	else
+	  search(lo, mid, depth+1, s);
+      }
+  };
+
+  std::vector<Entry> entries_;
+  const WayPointNode *nodes_;
+};
+
+#endif // __KDTREE_H__
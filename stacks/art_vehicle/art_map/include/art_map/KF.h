@@ -8,7 +8,7 @@
 //#define DEBUGFILTER
 
 #include <stdio.h>
-#include <art_map/Matrix.h>
+#include <art_map/FixedMatrix.h>
 #include <art_map/MQMath.h>
 
 #define KF_CRASH 0 // Matrix dimensions error, check your code!
@@ -33,51 +33,77 @@ struct KFStruct {
   bool changeAlpha;
 };
 
+/** Kalman filter with S states.
+ *
+ *  The matrix dimensions are template parameters, so every update
+ *  runs on the stack.  The member functions are defined in KF.cc,
+ *  which instantiates the sizes in use.
+ */
+template <int S>
 class KF 
 {
   public:
+    typedef FixedMatrix<S,1> StateVector;
+    typedef FixedMatrix<S,S> ErrorMatrix;
+    typedef FixedMatrix<1,S> MeasurementMatrix;
+
     KF();
     ~KF() {};
         
-    bool Start(short numStates, Matrix& uncert, Matrix& intStates);
+    bool Start(const ErrorMatrix& uncert, const StateVector& intStates);
     bool Restart();
-    bool TimeUpdate(Matrix& A, Matrix& B, Matrix& U, Matrix& Q,
-                    bool mainFilterUpdate);
-    bool TimeUpdateExtended(Matrix& A, Matrix& Xbar, Matrix& Q);
-    int MeasurementUpdate(Matrix& C, float R, float Y, bool rejectOutliers,
-                          float outlierError, bool mainFilterAngleUpdate);
-    int MeasurementUpdateExtended(Matrix& C, float R, float Y, float Ybar,
+
+    template <int U>
+    bool TimeUpdate(const ErrorMatrix& A, const FixedMatrix<S,U>& B,
+                    const FixedMatrix<U,1>& U_, const ErrorMatrix& Q,
+                    bool mainFilterUpdate)
+    {
+      X = A*X + B*U_;
+      if (mainFilterUpdate) X[2][0] = Normalise_PI(X[2][0]);
+      P = A*P*A.transp() + Q;
+      Xchange = StateVector();
+      return true;
+    }
+
+    bool TimeUpdateExtended(const ErrorMatrix& A, const StateVector& Xbar,
+                            const ErrorMatrix& Q);
+    int MeasurementUpdate(const MeasurementMatrix& C, float R, float Y,
+                          bool rejectOutliers, float outlierError,
+                          bool mainFilterAngleUpdate);
+    int MeasurementUpdateExtended(const MeasurementMatrix& C, float R,
+                                  float Y, float Ybar,
                                   bool rejectOutliers, float outlierError,
                                   bool mainFilterAngleUpdate,
                                   bool ignoreLongRangeUpdate,
                                   float deadzoneSize, float dist,
                                   bool ambigObject, bool changeAlpha);
 
-    int MeasurementUpdateExtended(Matrix &C,KFStruct s);
+    int MeasurementUpdateExtended(const MeasurementMatrix &C,
+                                  const KFStruct &s);
 
     void Reset();
-    Matrix GetStates();
-    void SetStates(Matrix Xbar);
-    float GetState(short n);
-    void SetState(short n, float x);
+    StateVector GetStates() const { return X; }
+    void SetStates(const StateVector &Xbar) { X = Xbar; }
+    float GetState(short n) const { return X[n][0]; }
+    void SetState(short n, float x) { X[n][0] = x; }
     void NormaliseState(short n);
-    Matrix GetErrorMatrix();
-    void SetErrorMatrix(Matrix Pbar);
-    float GetCovariance(short m, short n);
-    float GetVariance(short n);
-    Matrix GetXchanges();
-    float GetXchange(short n);
+    ErrorMatrix GetErrorMatrix() const { return P; }
+    void SetErrorMatrix(const ErrorMatrix &Pbar) { P = Pbar; }
+    float GetCovariance(short m, short n) const { return P[m][n]; }
+    float GetVariance(short n) const { return P[n][n]; }
+    StateVector GetXchanges() const { return Xchange; }
+    float GetXchange(short n) const { return Xchange[n][0]; }
     void CompilerError(const char* str);
     
     void Deadzone(float* R, float* innovation, float CPC, float eps);
 
-    short numStates;
-    Matrix I;
-    Matrix initX;
-    Matrix initP;
-    Matrix X;
-    Matrix P;
-    Matrix Xchange;
+    static const short numStates = S;
+    ErrorMatrix I;
+    StateVector initX;
+    ErrorMatrix initP;
+    StateVector X;
+    ErrorMatrix P;
+    StateVector Xchange;
   
     // ------ New Stuff for multiple models
 
@@ -0,0 +1,108 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     C++ interface for delta encoding of local road map lanes.
+
+     LanesDeltaEncoder turns each new local map into an ArtLanesDelta
+     message listing the polygons that entered and left it, keyed by
+     poly_id, with a periodic keyframe holding the whole map.
+     LanesDeltaDecoder applies those messages, rebuilding the same
+     local map a subscriber to the full roadmap_local topic gets.
+
+ */
+
+#ifndef __LANES_DELTA_H__
+#define __LANES_DELTA_H__
+
+#include <vector>
+
+#include <art_msgs/ArtLanes.h>
+#include <art_msgs/ArtLanesDelta.h>
+
+class LanesDeltaEncoder
+{
+public:
+  /** @param keyframe_interval messages from one keyframe to the next */
+  LanesDeltaEncoder(unsigned keyframe_interval=10):
+    interval_(1), count_(0), sequence_(0)
+  {
+    setKeyframeInterval(keyframe_interval);
+  };
+
+  /** @param n messages from one keyframe to the next, 1 means
+   *         every message is a keyframe
+   */
+  void setKeyframeInterval(unsigned n)
+  {
+    interval_ = (n > 0? n: 1);
+  };
+
+  /** make the next message a keyframe */
+  void reset()
+  {
+    count_ = 0;
+  };
+
+  /** encode changes since the previous local map.
+   *
+   * @param lanes new local map, its polygons in poly_id order
+   * @param delta returns message to publish
+   */
+  void encode(const art_msgs::ArtLanes &lanes,
+	      art_msgs::ArtLanesDelta &delta);
+
+  /** @return true if two versions of a polygon have the same shape,
+   *          so encode() would not send it again.
+   */
+  static bool sameShape(const art_msgs::ArtQuadrilateral &a,
+			const art_msgs::ArtQuadrilateral &b);
+
+private:
+  unsigned interval_;			// messages per keyframe
+  unsigned count_;			// messages since last keyframe
+  uint32_t sequence_;			// next sequence number
+  std::vector<art_msgs::ArtQuadrilateral> prev_; // previous local map
+};
+
+class LanesDeltaDecoder
+{
+public:
+  LanesDeltaDecoder(): synced_(false), sequence_(0) {};
+
+  /** apply a delta message to the local map.
+   *
+   * After a lost message, the map stays out of date until the next
+   * keyframe arrives.
+   *
+   * @return true if lanes() is now current.
+   */
+  bool update(const art_msgs::ArtLanesDelta &delta);
+
+  /** @return true if lanes() is current */
+  bool synced() const
+  {
+    return synced_;
+  };
+
+  /** @return reconstructed local map, like a roadmap_local message */
+  const art_msgs::ArtLanes &lanes() const
+  {
+    return lanes_;
+  };
+
+private:
+  bool synced_;				// lanes_ is current
+  uint32_t sequence_;			// last sequence applied
+  art_msgs::ArtLanes lanes_;
+  std::vector<art_msgs::ArtQuadrilateral> next_; // scratch for update()
+};
+
+#endif // __LANES_DELTA_H__
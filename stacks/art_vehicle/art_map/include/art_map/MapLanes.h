@@ -22,6 +22,8 @@
 #include <vector>
 #include <stdio.h>
 
+#include <boost/thread/mutex.hpp>
+
 #include <art/UTM.h>
 #include <art/error.h>
 #include <art/conversions.h>
@@ -30,7 +32,9 @@
 #include <art_map/FilteredPolygon.h>
 #include <art_map/DrawLanes.h>
 #include <art_map/Graph.h>
+#include <art_map/PointGrid.h>
 #include <art_map/PolyOps.h>
+#include <art_map/PolyTiles.h>
 #include <art_map/RNDF.h>
 #include <art_map/SmoothCurve.h>
 #include <art_map/types.h>
@@ -48,6 +52,12 @@ public:
     range = r;
     transition=false;
     trans_index=-1;
+    nthreads=0;
+    reuse_distance=0.0;
+    tile_size=0.0;
+    max_tiles=0;
+    local_dirty=true;
+    local_valid=false;
   };
   ~MapLanes()
   {
@@ -68,6 +78,49 @@ public:
     cY=centerY;
   }
 
+  /** Set number of threads used for building lane polygons.
+   *
+   *  @param n thread count, 0 means one per hardware core
+   */
+  void SetThreads(unsigned n)
+  {
+    nthreads=n;
+  }
+
+  /** Set how far the vehicle may move before getLanes() searches
+   *  the map again.
+   *
+   *  Until then, it only checks the polygons found last time, which
+   *  were within range plus this distance.  The lanes returned are
+   *  the same either way.
+   *
+   *  @param d distance (m), 0 means search on every call
+   */
+  void SetReuseDistance(float d)
+  {
+    reuse_distance=fmaxf(d, 0.0);
+    local_valid=false;
+  }
+
+  /** Store filtered polygons in geographic tiles, paged in around
+   *  the vehicle by a background thread.  Takes effect when the map
+   *  is next built.
+   *
+   *  @param size tile width (m), 0 keeps all polygons in memory
+   *  @param max resident tile budget, 0 means no limit
+   */
+  void SetTiles(float size, unsigned max)
+  {
+    tile_size=fmaxf(size, 0.0);
+    max_tiles=max;
+  }
+
+  /** @return number of filtered polygon tiles in memory */
+  unsigned ResidentTiles()
+  {
+    return filtPolys.resident();
+  }
+
   void SetRobotPos(MapPose pose)
   {
     rX = pose.map.x;
@@ -85,12 +138,27 @@ public:
 private:
   int32_t poly_id_counter;
   std::vector<poly> allPolys;
-  std::vector<FilteredPolygon> filtPolys;
+  PolyTiles filtPolys;
+  float tile_size;                // filtPolys tile width, 0 for none
+  unsigned max_tiles;             // filtPolys tile budget, 0 for none
 
   float max_poly_size;
 
   float range;
 
+  unsigned nthreads;              // polygon build threads, 0 = all cores
+
+  // local lanes cache used by getLanes()
+  float reuse_distance;           // search again after moving this far
+  bool local_dirty;               // filtPolys changed since indexed
+  PointGrid local_grid;           // filtPolys midpoints
+  bool local_valid;               // local_ids and local_quads usable
+  MapXY local_center;             // where local_ids were found
+  std::vector<unsigned> local_ids; // filtPolys near local_center
+  std::vector<art_msgs::ArtQuadrilateral> local_quads; // their quads
+
+  void FindLocalPolys(MapXY here);
+
   bool transition;
   int trans_index;
 
@@ -98,14 +166,49 @@ private:
 
   float rX,rY,rOri;
 
+  /** Way-points of one lane or transition, queued by MakePolygons().
+   *
+   *  Lanes are independent of each other until polygon IDs are
+   *  assigned, so their curves and polygons are built in parallel
+   *  with batch-local IDs, then merged into allPolys in graph order.
+   */
+  struct LaneBatch
+  {
+    bool is_transition;
+    int base_ind;                 // index of transition start in lane
+    bool find_edges;              // look up edge linking each pair
+    WayPointEdge e;               // edge being visited when queued
+    std::vector<WayPointNode> lane;
+    std::vector<Point2f> lane_pt;
+    std::vector<int> lane_map;
+    std::vector<WayPointEdge> edges; // edge linking lane[i] to lane[i+1]
+    SmoothCurve c;
+    std::vector<poly> polys;      // lane polygons, IDs relative to batch
+  };
+
   void MakePolygons();
 
+  void QueueLane(std::vector<LaneBatch> &batches,
+                 std::vector<WayPointNode> &lane,
+                 std::vector<Point2f> &lane_pt,
+                 std::vector<int> &lane_map,
+                 const WayPointEdge &e,
+                 bool is_transition, int base_ind, bool find_edges);
+
+  void BuildLaneBatches(std::vector<LaneBatch> *batches,
+                        unsigned *next_batch, boost::mutex *next_lock);
+
+  void BuildLaneBatch(LaneBatch &b);
+
+  void MakeLanePolys(LaneBatch &b, std::vector<poly> &polys);
+
   poly build_waypoint_poly(const WayPointNode& w1, const WayPointEdge &e,
 			   const Point2f& _pt,
 			   float time,
 			   SmoothCurve& c);
 
-  void MakeLanePolygon(WayPointNode w1, WayPointNode w2, WayPointEdge e,
+  void MakeLanePolygon(std::vector<poly> &polys,
+		       WayPointNode w1, WayPointNode w2, WayPointEdge e,
 		       float time1, float time2,
 		       SmoothCurve& c,
 		       bool new_edge,
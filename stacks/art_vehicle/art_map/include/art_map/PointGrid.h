@@ -0,0 +1,88 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     C++ interface for a uniform grid of map points.
+
+     The grid holds array indexes of MapXY points, bucketed by square
+     cells.  Range queries only visit the cells overlapping the search
+     circle, then measure the same Euclidean::DistanceTo() a linear
+     scan would, returning indexes in ascending order, so results are
+     identical to the scan.
+
+ */
+
+#ifndef __POINTGRID_H__
+#define __POINTGRID_H__
+
+#include <vector>
+
+#include <art_map/euclidean_distance.h>
+#include <art_map/types.h>
+
+class PointGrid
+{
+public:
+  PointGrid(): min_x_(0.0), min_y_(0.0), cell_(1.0), nx_(0), ny_(0) {};
+
+  /** build grid for an array of points
+   *
+   * @param points positions to index
+   * @param cell_size preferred cell width (m), made larger if needed
+   *        to keep the number of cells proportional to the points
+   */
+  void build(const std::vector<MapXY> &points, float cell_size);
+
+  void clear()
+  {
+    points_.clear();
+    start_.clear();
+    entries_.clear();
+    nx_ = ny_ = 0;
+  };
+
+  unsigned size() const
+  {
+    return points_.size();
+  };
+
+  /** find all points within a radius
+   *
+   * @param p point to search from
+   * @param radius include points at this distance or closer
+   * @param result returns indexes of those points, in ascending order
+   */
+  void within(const MapXY &p, float radius,
+	      std::vector<unsigned> &result) const;
+
+private:
+
+  /** @return cell column or row containing a coordinate, clamped */
+  int cell(float v, float min, int n) const
+  {
+    float c = (v - min) / cell_;
+    if (!(c > 0.0))			// also catches NaN
+      return 0;
+    if (c >= n)
+      return n - 1;
+    return (int) c;
+  };
+
+  std::vector<MapXY> points_;
+  std::vector<unsigned> start_;		// first entry of each cell
+  std::vector<unsigned> entries_;	// point indexes, grouped by cell
+  float min_x_;
+  float min_y_;
+  float cell_;
+  int nx_;
+  int ny_;
+};
+
+#endif // __POINTGRID_H__
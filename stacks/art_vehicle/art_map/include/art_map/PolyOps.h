@@ -20,6 +20,7 @@
 #define __POLYOPS_H__
 
 
+#include <algorithm>
 #include <utility>
 #include <math.h>
 #include <vector>
@@ -133,6 +134,280 @@ typedef struct polyUpdate
 } lanes_poly_vision_t;
 
 
+/** Lane and way-point index of a polygon list.
+ *
+ *  Holds the list positions of the lane polygons in each segment and
+ *  lane, and of the polygons leading from each way-point to the next,
+ *  in list order.  Rebuild it whenever the list changes.  The PolyOps
+ *  methods that take an index scan the list instead if it was built
+ *  for some other list, or the size changed.
+ */
+class PolyIndex
+{
+ public:
+  typedef std::vector<int>::const_iterator const_iterator;
+  typedef std::pair<const_iterator, const_iterator> range_t;
+
+  PolyIndex(): polys_(NULL), size_(0) {};
+
+  void build(const poly_list_t &polys);
+  void clear();
+
+  /** @return true if index was built for this list and size */
+  bool indexes(const poly_list_t &polys) const
+  {
+    return (&polys == polys_ && polys.size() == size_);
+  };
+
+  /** @return positions of lane polygons in the lane of @a id */
+  range_t lane(const ElementID &id) const;
+
+  /** @return positions of polygons from @a from_id to @a to_id */
+  range_t waypts(const ElementID &from_id, const ElementID &to_id) const;
+
+  /** @return lane IDs of all polygons (with pt zero) */
+  const std::set<ElementID> &lane_ids() const { return lane_ids_; };
+
+ private:
+
+  // sort keys, parallel to the position vectors
+  typedef std::pair<ElementID, ElementID> way_key_t;
+  std::vector<ElementID> lane_keys_;
+  std::vector<int> lane_pos_;
+  std::vector<way_key_t> way_keys_;
+  std::vector<int> way_pos_;
+  std::set<ElementID> lane_ids_;
+
+  const poly_list_t *polys_;
+  size_t size_;
+};
+
+/** Arc length along a polygon sequence.
+ *
+ *  Holds the total length of every prefix of a list of lane
+ *  polygons, so the length of any run of them is one subtraction.
+ *  Rebuild it whenever the list changes.  The PolyOps methods that
+ *  take one sum the lengths instead if it was built for some other
+ *  list, or the size or end polygons changed.
+ */
+class LaneLengths
+{
+ public:
+  LaneLengths(): polys_(NULL), first_id_(-1), last_id_(-1) {};
+  explicit LaneLengths(const poly_list_t &polys) { build(polys); };
+  explicit LaneLengths(const art_msgs::ArtLanes &lanes) { build(lanes); };
+
+  void build(const poly_list_t &polys);
+  void build(const art_msgs::ArtLanes &lanes);
+  void clear();
+
+  /** @return true if built for this list, as it is now */
+  bool indexes(const poly_list_t &polys) const
+  {
+    return (&polys == polys_
+	    && polys.size() + 1 == sum_.size()
+	    && (polys.empty()
+		|| (polys.front().poly_id == first_id_
+		    && polys.back().poly_id == last_id_)));
+  };
+
+  /** @return total length of polygons @a first through @a last - 1,
+   *          ignoring any outside the list
+   */
+  float length(int first, int last) const
+  {
+    int n = sum_.size() - 1;
+    first = std::min(std::max(0, first), n);
+    last = std::min(std::max(0, last), n);
+    if (first >= last)
+      return 0.0;
+    return sum_[last] - sum_[first];
+  };
+
+ private:
+  std::vector<double> sum_;		// length of polygons before [i]
+  const poly_list_t *polys_;		// list built from, if any
+  poly_id_t first_id_;
+  poly_id_t last_id_;
+};
+
+/** Precomputed geometry of a quadrilateral list.
+ *
+ *  Holds what the point-in-polygon and distance tests would otherwise
+ *  derive from the four corners on every call: bounding box, edge
+ *  vectors, squared and plain edge lengths, midpoint, and an inner
+ *  quad shrunk across the lane by a ratio.  Each value is kept in its
+ *  own array, one entry per quad, so a scan over many quads for one
+ *  point reads only the arrays it needs.
+ *
+ *  The tests do exactly the same float operations the PolyOps and
+ *  quad_ops versions do, so they give identical answers.  The inner
+ *  quad is shrunk the way quad_ops::quickPointInPolyRatio() does it,
+ *  measuring the right corners from the already moved left ones.
+ *
+ *  Rebuild it whenever the list changes.  The PolyOps methods that
+ *  take one test the polygon directly instead if it was built for
+ *  some other list, or the size or end polygons changed.
+ */
+class QuadGeometry
+{
+ public:
+  QuadGeometry(): polys_(NULL), lanes_(NULL), first_id_(-1),
+    last_id_(-1), ratio_(0.6) {};
+  explicit QuadGeometry(const poly_list_t &polys, float ratio=0.6)
+  {
+    build(polys, ratio);
+  };
+  explicit QuadGeometry(const art_msgs::ArtLanes &lanes, float ratio=0.6)
+  {
+    build(lanes, ratio);
+  };
+
+  void build(const poly_list_t &polys, float ratio=0.6);
+  void build(const art_msgs::ArtLanes &lanes, float ratio=0.6);
+  void clear();
+
+  /** @return number of quads */
+  unsigned size() const { return mid_x_.size(); };
+
+  /** @return inner quad ratio */
+  float ratio() const { return ratio_; };
+
+  /** @return true if built for this list, as it is now */
+  bool indexes(const poly_list_t &polys) const
+  {
+    return (&polys == polys_
+	    && polys.size() == size()
+	    && (polys.empty()
+		|| (polys.front().poly_id == first_id_
+		    && polys.back().poly_id == last_id_)));
+  };
+  bool indexes(const art_msgs::ArtLanes &lanes) const
+  {
+    return (&lanes == lanes_
+	    && lanes.polygons.size() == size()
+	    && (lanes.polygons.empty()
+		|| (lanes.polygons.front().poly_id == first_id_
+		    && lanes.polygons.back().poly_id == last_id_)));
+  };
+
+  /** @return corner @a k (0 through 3 for p1 through p4) of quad @a i */
+  MapXY vertex(unsigned i, int k) const
+  {
+    return MapXY(outer_.x[k][i], outer_.y[k][i]);
+  };
+
+  /** @return squared distance from (x, y) to midpoint of quad @a i */
+  float midpointDist2(unsigned i, float x, float y) const
+  {
+    return ((mid_x_[i]-x)*(mid_x_[i]-x) + (mid_y_[i]-y)*(mid_y_[i]-y));
+  };
+
+  /** @return true if (x, y) is within the bounding box of quad @a i */
+  bool pointInHull(unsigned i, float x, float y) const
+  {
+    return outer_.inHull(i, x, y);
+  };
+
+  /** @return true if (x, y) is inside quad @a i, not counting
+   *          points exactly on its edges
+   */
+  bool pointInside(unsigned i, float x, float y) const
+  {
+    return outer_.inHull(i, x, y) && outer_.crossings(i, x, y);
+  };
+
+  /** @return true if (x, y) is inside the inner quad of @a i */
+  bool pointInsideInner(unsigned i, float x, float y) const
+  {
+    return inner_.inHull(i, x, y) && inner_.crossings(i, x, y);
+  };
+
+  /** @return shortest distance from (x, y) to an edge of quad @a i */
+  float edgeDistance(unsigned i, float x, float y) const;
+
+  /** Test many points against quad @a i.
+   *
+   *  Gives the same answers as pointInside() or pointInsideInner()
+   *  for each point, but evaluates several points per instruction
+   *  where the processor allows (SSE2, or AVX if compiled for it).
+   *
+   * @param inner test the inner quad instead of the whole one
+   * @param near2 if positive, points whose midpointDist2() exceeds
+   *              this are not in the quad (nor its hull)
+   * @param x, y arrays of @a n point coordinates
+   * @param inside set to 1 for points in the quad, 0 otherwise
+   * @param hull if not NULL, set to 1 for points within the bounding
+   *             box, 0 otherwise
+   */
+  void pointsInside(unsigned i, bool inner, float near2,
+		    const float x[], const float y[], unsigned n,
+		    unsigned char inside[],
+		    unsigned char hull[] = NULL) const;
+
+  /** Find the first quad containing each of many points.
+   *
+   * @param inner test the inner quads instead of the whole ones
+   * @param near2 as for pointsInside()
+   * @param x, y arrays of @a n point coordinates
+   * @param quad set to index of first quad containing each point,
+   *             -1 if none
+   */
+  void classify(bool inner, float near2,
+		const float x[], const float y[], unsigned n,
+		int quad[]) const;
+
+ private:
+
+  /** corners and edges of one quad per entry */
+  struct Corners
+  {
+    std::vector<float> min_x, max_x, min_y, max_y;
+    std::vector<float> x[4], y[4];	// corners p1 through p4
+    std::vector<float> dx[4], dy[4];	// edge from corner k to k+1
+
+    void resize(unsigned n);
+    void set(unsigned i, const float cx[4], const float cy[4]);
+
+    bool inHull(unsigned i, float px, float py) const
+    {
+      return (Epsilon::gte(px, min_x[i]) && Epsilon::lte(px, max_x[i]) &&
+	      Epsilon::gte(py, min_y[i]) && Epsilon::lte(py, max_y[i]));
+    };
+
+    /** unrolled crossing-number test, @return true if odd */
+    bool crossings(unsigned i, float px, float py) const
+    {
+      bool odd = false;
+      for (int k = 0; k < 4; ++k)
+	{
+	  float y1 = y[k][i];
+	  float y2 = y[(k+1)&3][i];
+	  if ((y1 < py && y2 >= py) || (y2 < py && y1 >= py))
+	    if (x[k][i] + (py-y1)/dy[k][i]*dx[k][i] < px)
+	      odd = !odd;
+	}
+      return odd;
+    };
+  };
+
+  void resize(unsigned n);
+  void set(unsigned i, const float cx[4], const float cy[4],
+	   double mx, double my);
+
+  Corners outer_;
+  Corners inner_;
+  std::vector<float> len2_[4];		// squared outer edge lengths
+  std::vector<float> len_[4];		// outer edge lengths
+  std::vector<double> mid_x_, mid_y_;	// as precise as the message
+
+  const poly_list_t *polys_;		// list built from, if any
+  const art_msgs::ArtLanes *lanes_;	// message built from, if any
+  poly_id_t first_id_;
+  poly_id_t last_id_;
+  float ratio_;
+};
+
 /** Polygon operations.
  *
  *  @todo This class has no state.  It should be replaced by a
@@ -146,6 +421,9 @@ class PolyOps
 
   int get_waypoint_index(const std::vector<poly> &polys,
 			 const ElementID& waypoint);
+  int get_waypoint_index(const std::vector<poly> &polys,
+			 const PolyIndex &index,
+			 const ElementID& waypoint);
 
   int getPolyWayPt(const std::vector<poly> &polys,
 				const ElementID& waypoint);
@@ -154,6 +432,10 @@ class PolyOps
   void add_polys_for_waypts(const std::vector <poly> &from_polys,
 			    std::vector <poly> &to_polys,
 			    ElementID from_id, ElementID to_id);
+  void add_polys_for_waypts(const std::vector <poly> &from_polys,
+			    const PolyIndex &index,
+			    std::vector <poly> &to_polys,
+			    ElementID from_id, ElementID to_id);
 
   // add from_polys polygons matching segment and lane to to_polys
   void AddTransitionPolys(const std::vector <poly> &from_polys,
@@ -168,6 +450,10 @@ class PolyOps
   void AddLanePolys(const std::vector <poly> &from_polys,
 		    std::vector <poly> &to_polys, WayPointNode waypt);
 
+  void AddLanePolys(const std::vector <poly> &from_polys,
+		    const PolyIndex &index,
+		    std::vector <poly> &to_polys, ElementID id);
+
   // add from_polys polygons matching segment and lane to to_polys
   // in either direction (reverse if direction < 0)
   void AddLanePolysEither(const std::vector <poly> &from_polys,
@@ -181,6 +467,10 @@ class PolyOps
 
   void AddReverseLanePolys(const std::vector <poly> &from_polys,
 			   std::vector <poly> &to_polys, WayPointNode waypt);
+
+  void AddReverseLanePolys(const std::vector <poly> &from_polys,
+			   const PolyIndex &index,
+			   std::vector <poly> &to_polys, ElementID id);
   
   // Collect all polygons of from_poly from start to end from to_polys.
   void CollectPolys(const std::vector<poly> &from_polys,
@@ -321,6 +611,16 @@ class PolyOps
     return pointInPoly(Coordinates::Polar_to_MapXY(polar, origin), p);
   };
 
+  // same as pointInPoly() for polys[i], using geometry cached in geom
+  bool pointInPoly(float x, float y, const std::vector<poly> &polys,
+                   const QuadGeometry &geom, unsigned i);
+
+  // pointInPoly() for many points at once: sets in[j] to 1 if point
+  // (x[j], y[j]) is in any of polys, otherwise 0
+  void pointsInPolys(const float x[], const float y[], unsigned n,
+                     const std::vector<poly> &polys,
+                     const QuadGeometry &geom, unsigned char in[]);
+
   //bool pointInPoly(const player_pose2d_t &pose, const poly& p)
   //{
   //  return pointInPoly(pose.px, pose.py, p);
@@ -370,6 +670,20 @@ class PolyOps
     return getContainingPoly(polys, pose.map.x, pose.map.y);
   };
 
+  // same, using geometry cached in geom
+  int getContainingPoly(const std::vector<poly> &polys,
+                        const QuadGeometry &geom, float x, float y);
+  int getContainingPoly(const std::vector<poly>& polys,
+                        const QuadGeometry &geom, const MapXY& pt)
+  {
+    return getContainingPoly(polys, geom, pt.x, pt.y);
+  };
+  int getContainingPoly(const std::vector<poly>& polys,
+                        const QuadGeometry &geom, const MapPose &pose)
+  {
+    return getContainingPoly(polys, geom, pose.map.x, pose.map.y);
+  };
+
   // return containing POLYGON ID, -1 if none in list
   poly_id_t getContainingPolyID(const std::vector<poly> &polys,
                                 float x, float y)
@@ -430,6 +744,11 @@ class PolyOps
   {
     return getShortestDistToPoly(pt.x, pt.y, p);
   }
+
+  // same for polys[i], using geometry cached in geom
+  float getShortestDistToPoly(float x, float y,
+                              const std::vector<poly> &polys,
+                              const QuadGeometry &geom, unsigned i);
   //float getShortestDistToPoly(const player_pose2d_t &pose, const poly& p)
   //{
   //  return getShortestDistToPoly(pose.px, pose.py, p);
@@ -448,6 +767,20 @@ class PolyOps
   {
     return getClosestPoly(polys, pose.map.x, pose.map.y);
   }
+
+  // same, using geometry cached in geom
+  int getClosestPoly(const std::vector<poly>& polys,
+                     const QuadGeometry &geom, float x, float y);
+  int getClosestPoly(const std::vector<poly>& polys,
+                     const QuadGeometry &geom, MapXY pt)
+  {
+    return getClosestPoly(polys, geom, pt.x, pt.y);
+  }
+  int getClosestPoly(const std::vector<poly>& polys,
+                     const QuadGeometry &geom, const MapPose &pose)
+  {
+    return getClosestPoly(polys, geom, pose.map.x, pose.map.y);
+  }
   //int getClosestPoly(const std::vector<poly>& polys, const Polar& pt, 
   //      	     player_pose2d_t pose)
   //{
@@ -537,11 +870,20 @@ class PolyOps
   float distanceAlongLane(const std::vector<poly>& polygons,
                           const MapXY& from,
                           const MapXY& to);
+  float distanceAlongLane(const std::vector<poly>& polygons,
+                          const LaneLengths& lengths,
+                          const MapXY& from,
+                          const MapXY& to);
 
   std::pair<float, MapXY>
   specialDistanceAlongLane(const std::vector<poly>& polygons,
                            const MapXY& from,
                            const MapXY& to);
+  std::pair<float, MapXY>
+  specialDistanceAlongLane(const std::vector<poly>& polygons,
+                           const LaneLengths& lengths,
+                           const MapXY& from,
+                           const MapXY& to);
     
   //Finds the distance between the midpoints of two polygons
   //float distanceBetweenPolygons(const std::vector<poly>& polygons,
@@ -566,6 +908,8 @@ class PolyOps
 
   // Return a Set of unique lane IDs corresponding to the polys in the list
   std::set<ElementID> getPolyLaneIds(const std::vector<poly>& polys);
+  std::set<ElementID> getPolyLaneIds(const std::vector<poly>& polys,
+                                     const PolyIndex &index);
 
   // Return a unique lane ID corresponding to the polys/dir given
   // (uses transition polygons to determine closest lanes)
@@ -623,6 +967,15 @@ class PolyOps
                   const int direction,
                   const MapPose &pose);
 
+  // Same, given the index in polys of the polygon closest to pose,
+  // when the caller already has it.
+  void getLaneDir(const std::vector<poly>& polys,
+                  std::vector<poly>& to_polys,
+                  const int relative,
+                  const int direction,
+                  const MapPose &pose,
+                  int cur_poly_index);
+
   // Return the lane polys to the left up to num_lanes away.
   // similar interface to getLaneDir()
   //void getNumLanesDir(const std::vector<poly>& polys,
@@ -701,7 +1054,21 @@ class PolyOps
   float length_between_polygons(const std::vector<poly>& polygons,
                                 int index1=-1,
                                 int index2=-1);
+  float length_between_polygons(const std::vector<poly>& polygons,
+                                const LaneLengths *lengths,
+                                int index1, int index2);
+
+  std::pair<float, MapXY>
+  specialDistanceAlongLane(const std::vector<poly>& polygons,
+                           const LaneLengths *lengths,
+                           const MapXY& from,
+                           const MapXY& to);
 
+  // tests for a QuadGeometry already known to be current
+  bool point_in_quad(const QuadGeometry &geom, unsigned i,
+                     float x, float y);
+  float dist_to_quad(const QuadGeometry &geom, unsigned i,
+                     float x, float y);
 
 };
 
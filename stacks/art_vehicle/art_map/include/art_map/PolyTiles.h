@@ -0,0 +1,142 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     C++ interface for a tiled store of MapLanes filtered polygons.
+
+     Each filtered polygon carries four Kalman filters, several times
+     the size of the polygon itself.  The store groups the polygons
+     into square geographic tiles by midpoint.  A tile not resident
+     keeps only its compact seed polygons; a resident tile keeps
+     only their filtered polygons, built when it is paged in.  A
+     background thread pages tiles in around the vehicle pose, and
+     evicts the least recently used ones when more than the budget
+     are resident.
+
+     A filtered polygon that was never updated is a pure function of
+     its seed, so queries for polygons of tiles not resident are
+     answered from the seed, without building any filters, giving
+     the same answers.  Tiles containing updated polygons stay
+     resident.
+
+ */
+
+#ifndef __POLYTILES_H__
+#define __POLYTILES_H__
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <art_msgs/ArtQuadrilateral.h>
+#include <art_map/FilteredPolygon.h>
+#include <art_map/PolyOps.h>
+
+class PolyTiles
+{
+public:
+  PolyTiles();
+  ~PolyTiles();
+
+  /** start over with a new set of polygons
+   *
+   * @param polys seed polygons, copied
+   * @param tile_size tile width (m), 0 makes one resident tile
+   * @param max_tiles resident tile budget, 0 means no limit
+   */
+  void build(const std::vector<poly> &polys, float tile_size=0.0,
+	     unsigned max_tiles=0);
+
+  void clear();
+
+  unsigned size() const
+  {
+    return tile_of_.size();
+  };
+
+  /** @return number of tiles resident */
+  unsigned resident();
+
+  /** @return current filtered polygon i */
+  poly polygon(unsigned i);
+
+  /** @return current filtered polygon i as a quadrilateral message */
+  art_msgs::ArtQuadrilateral quad(unsigned i);
+
+  /** @return copy of filtered polygon i */
+  FilteredPolygon filtered(unsigned i);
+
+  /** replace filtered polygon i, keeping its tile resident */
+  void set(unsigned i, const FilteredPolygon &fp);
+
+  /** FilteredPolygon::UpdatePoint() for polygon i, keeping its tile
+   *  resident
+   */
+  void updatePoint(unsigned i, int point_id, float distance,
+		   float bearing, float confidence,
+		   float rx, float ry, float rori);
+
+  /** page in tiles around the vehicle in the background
+   *
+   * @param here vehicle position
+   * @param radius distance polygons will be needed (m)
+   */
+  void setPose(const MapXY &here, float radius);
+
+private:
+
+  /** polygons with midpoints in one square of the map */
+  struct Tile
+  {
+    int tx, ty;				// tile coordinates
+    std::vector<poly> seeds;		// polygons, if not resident
+    std::vector<FilteredPolygon> filt;	// built polygons, if resident
+    bool resident;
+    bool pinned;			// updated, never evict
+    unsigned long last_used;		// clock_ value when last used
+  };
+
+  typedef std::map<std::pair<int, int>, unsigned> TileMap;
+
+  int coord(float v) const;
+  static void load(const std::vector<poly> &seeds,
+		   std::vector<FilteredPolygon> &filt);
+  void install(unsigned tile, std::vector<FilteredPolygon> &filt);
+  FilteredPolygon &pin(unsigned i);
+  void nearTiles(std::vector<unsigned> &near) const;
+  void evict(const std::vector<unsigned> &near);
+  void pager();
+  void stopPager();
+
+  std::vector<unsigned> tile_of_;	// tile of each polygon
+  std::vector<unsigned> slot_of_;	// index of each polygon in its tile
+  std::vector<Tile> tiles_;
+  TileMap tile_map_;			// tile by coordinates
+  float tile_size_;
+  unsigned max_tiles_;
+  unsigned nresident_;
+  unsigned long clock_;
+
+  // background pager, started by the first setPose()
+  boost::mutex lock_;			// protects everything above
+  boost::condition_variable wake_;
+  boost::shared_ptr<boost::thread> pager_;
+  bool stop_;
+  bool moved_;				// pose changed since last paged
+  MapXY pose_;
+  float radius_;
+};
+
+#endif // __POLYTILES_H__
@@ -25,6 +25,7 @@
 #include <map>
 
 #include <art_map/Graph.h>
+#include <art_map/TextScanner.h>
 
 template <class T>
 void print_vector (std::vector<T> vec);
@@ -38,7 +39,7 @@ class LL_Waypoint {
   //double longitude; //6 decimal digits
   
   //METHODS
-  LL_Waypoint(std::string line, int x, int y, int line_number, bool& valid,
+  LL_Waypoint(const TextSpan &line, int x, int y, int line_number, bool& valid,
 	      bool verbose);
   bool isvalid(){return(waypoint_id > 0);};
   void clear(){ waypoint_id = -1; ll.latitude = ll.longitude = -1.0;};
@@ -60,7 +61,7 @@ class Checkpoint {
   //METHODS
   Checkpoint(){};
   //Returns a parsed checkpoint from 'line' with waypoint id 'x.y.z' 
-  Checkpoint (std::string line, int x, int y, int line_number, bool& valid,
+  Checkpoint (const TextSpan &line, int x, int y, int line_number, bool& valid,
 	      bool verbose);
   bool isvalid(){return (waypoint_id > 0 && checkpoint_id > 0 );};
   void clear(){ waypoint_id = checkpoint_id = -1;}; 
@@ -86,7 +87,7 @@ class Exit {
  public:
   Unique_id start_point;
   Unique_id end_point;
-  Exit(std::string line, int x, int y, int line_number, bool& valid, 
+  Exit(const TextSpan &line, int x, int y, int line_number, bool& valid, 
        bool verbose);
   bool isvalid(){    return (start_point.isvalid() && end_point.isvalid());};
   void clear(){start_point.waypoint_id = end_point.waypoint_id
@@ -118,7 +119,7 @@ class Stop{
   void clear(){waypoint_id = -1;};
   void print(){printf("Stop at Waypoint %d\n", waypoint_id);}; 
   //Returns a parsed stop from 'line' with waypoint id 'x.y.z' 
-  Stop (std::string line, int x, int y, int line_number, bool& valid, bool verbose);
+  Stop (const TextSpan &line, int x, int y, int line_number, bool& valid, bool verbose);
 };
 
 //<lane>
@@ -221,7 +222,7 @@ class Speed_Limit {
   void clear(){id = min_speed = max_speed = -1;};
   void print(); 
 
-  Speed_Limit(std::string line, int line_number, bool& valid, bool verbose);
+  Speed_Limit(const TextSpan &line, int line_number, bool& valid, bool verbose);
   Speed_Limit(){clear();};
   //~Speed_Limit();
   bool operator==(const Speed_Limit &that)
@@ -278,7 +279,7 @@ class RNDF {
   void prep_graph();
 
   int line_number;
-  Lane_marking parse_boundary(std::string line, bool& valid);
+  Lane_marking parse_boundary(const TextSpan &line, bool& valid);
 };
 
 class MDF {
@@ -313,11 +314,12 @@ class MDF {
 };
 
 //Global Functions
-std::string parse_string(std::string line, std::string token, 
+std::string parse_string(const TextSpan &line, const char *token,
 			 int line_number, bool& valid, bool verbose);
-int parse_integer(std::string line, std::string token, 
+int parse_integer(const TextSpan &line, const char *token,
 		  int line_number, bool& valid, bool verbose);
-int parse_integer(std::string line, int line_number, bool& valid, bool verbose);
+int parse_integer(const TextSpan &line, int line_number, bool& valid,
+		  bool verbose);
 
 void checkpoint_error(int seg, int lane, int way);
 void stop_error(int seg, int lane, int way);
@@ -0,0 +1,167 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     C++ interface for generating synthetic road networks.
+
+     RNDFGenerator lays out a grid of streets and writes it as a
+     valid RNDF, with a matching MDF.  Every block between two
+     intersections is a segment with the same number of lanes in each
+     direction.  All intersections are four-way stops, with exits
+     connecting each lane to the corresponding lane of the other
+     streets.  Parking lot zones with spots fill some of the blocks.
+
+     The files are intended for testing and benchmarking the map
+     stack on networks much larger than the RNDFs we have.
+
+ */
+
+#ifndef __RNDFGENERATOR_H__
+#define __RNDFGENERATOR_H__
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/** Parameters for a synthetic road network. */
+class RNDFGeneratorConfig
+{
+public:
+  int rows;                     ///< intersections from south to north
+  int cols;                     ///< intersections from west to east
+  int lanes;                    ///< lanes in each direction
+  int zones;                    ///< parking lots (at most one per block)
+  int spots;                    ///< parking spots per zone (if they fit)
+  int lane_width;               ///< lane width (feet)
+  float block_length;           ///< distance between intersections (m)
+  float waypoint_spacing;       ///< distance between way-points (m)
+  int mission_checkpoints;      ///< checkpoints to visit in MDF
+  int speed_limit;              ///< segment speed limit (mph)
+  unsigned seed;                ///< selects MDF checkpoints
+  double latitude;              ///< south-west intersection
+  double longitude;
+
+  RNDFGeneratorConfig():
+    rows(4), cols(4), lanes(1), zones(1), spots(4), lane_width(12),
+    block_length(100.0), waypoint_spacing(10.0),
+    mission_checkpoints(10), speed_limit(30), seed(1),
+    latitude(30.3800000), longitude(-97.7400000) {};
+};
+
+/** Synthetic RNDF and MDF generator. */
+class RNDFGenerator
+{
+public:
+  RNDFGenerator(const RNDFGeneratorConfig &config);
+
+  /** write the road network
+   *
+   * @param filename path of RNDF to create
+   * @param name value for the RNDF_name header
+   * @return true if successful
+   */
+  bool write_rndf(const std::string &filename, const std::string &name);
+
+  /** write a mission for the road network
+   *
+   * @param filename path of MDF to create
+   * @param rndf_name value for the RNDF header
+   * @return true if successful
+   */
+  bool write_mdf(const std::string &filename, const std::string &rndf_name);
+
+  int segments() const { return nsegments_; };
+  int zones() const { return zones_.size(); };
+  int waypoints() const { return nwaypoints_; };
+  int checkpoints() const { return ncheckpoints_; };
+
+private:
+
+  /** map-relative position in meters (x east, y north) */
+  struct Point
+  {
+    double x;
+    double y;
+    Point(): x(0.0), y(0.0) {};
+    Point(double _x, double _y): x(_x), y(_y) {};
+  };
+
+  /** reference to a way-point, as written in the RNDF */
+  struct WaypointRef
+  {
+    int seg;
+    int lane;
+    int pt;
+    WaypointRef(): seg(0), lane(0), pt(0) {};
+    WaypointRef(int _seg, int _lane, int _pt):
+      seg(_seg), lane(_lane), pt(_pt) {};
+  };
+
+  struct GenExit
+  {
+    int pt;                     ///< way-point leaving from
+    WaypointRef to;
+  };
+
+  struct GenLane
+  {
+    int lane_id;
+    const char *left_boundary;
+    const char *right_boundary;
+    int checkpoint_pt;          ///< way-point with checkpoint
+    int checkpoint_id;
+    bool stop;                  ///< last way-point is a stop
+    std::vector<GenExit> exits;
+    std::vector<Point> points;
+  };
+
+  struct GenSegment
+  {
+    int segment_id;
+    std::vector<GenLane> lanes;
+  };
+
+  struct GenSpot
+  {
+    int checkpoint_id;          ///< checkpoint at way-point 2
+    Point points[2];
+  };
+
+  struct GenZone
+  {
+    int zone_id;
+    std::vector<GenExit> exits; ///< from perimeter points
+    std::vector<Point> perimeter;
+    std::vector<GenSpot> spots;
+  };
+
+  void build();
+  void build_zone(int row, int col);
+  void print_point(FILE *f, const WaypointRef &ref, const Point &pt);
+
+  RNDFGeneratorConfig config_;
+
+  std::vector<GenSegment> segments_;
+  std::vector<GenZone> zones_;
+
+  int nsegments_;
+  int nwaypoints_;
+  int ncheckpoints_;
+
+  // segment IDs of the blocks leaving each intersection to the
+  // east and north (zero if none)
+  std::vector<int> east_segment_;
+  std::vector<int> north_segment_;
+
+  double meters_per_lat_;       ///< at config_.latitude
+  double meters_per_long_;
+};
+
+#endif // __RNDFGENERATOR_H__
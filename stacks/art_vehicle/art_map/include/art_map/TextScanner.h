@@ -0,0 +1,146 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     C++ interface for scanning map text files in place.
+
+     The RNDF and MDF parsers use these classes instead of reading
+     each line into a std::string and running sscanf() on copies of
+     it.  The file is memory-mapped, and lines and tokens are views
+     into that buffer.  TextScanner reproduces the sscanf() matching
+     rules the parsers relied on, so the same lines are accepted and
+     rejected.
+
+ */
+
+#ifndef __TEXTSCANNER_H__
+#define __TEXTSCANNER_H__
+
+#include <stddef.h>
+#include <string>
+
+/** Read-only view of a range of characters (not NUL terminated). */
+class TextSpan
+{
+public:
+  const char *begin;
+  const char *end;
+
+  TextSpan(): begin(NULL), end(NULL) {};
+  TextSpan(const char *_begin, const char *_end):
+    begin(_begin), end(_end) {};
+
+  /** view the characters of @a s, which must outlive this span */
+  TextSpan(const std::string &s):
+    begin(s.data()), end(s.data() + s.size()) {};
+
+  size_t size() const { return end - begin; };
+  bool empty() const { return begin == end; };
+
+  // true if span exactly matches NUL-terminated string s
+  bool equals(const char *s) const;
+
+  // true if span starts with NUL-terminated string s
+  bool starts_with(const char *s) const;
+
+  // true if span contains NUL-terminated string s anywhere
+  bool contains(const char *s) const;
+
+  // true if span has nothing but spaces, tabs and carriage returns
+  bool blank() const;
+
+  std::string str() const { return std::string(begin, end); };
+};
+
+/** Memory-mapped read-only file. */
+class MappedFile
+{
+public:
+  MappedFile(): data_(NULL), size_(0) {};
+  ~MappedFile() { close(); };
+
+  /** map file into memory
+   *
+   * @param filename path of file to map
+   * @return true if successful
+   */
+  bool open(const std::string &filename);
+  void close();
+
+  TextSpan text() const { return TextSpan(data_, data_ + size_); };
+
+private:
+  // not copyable
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+
+  const char *data_;
+  size_t size_;
+};
+
+/** Split text into lines, the same way std::getline() does. */
+class LineReader
+{
+public:
+  LineReader(const TextSpan &text): next_(text.begin), end_(text.end) {};
+
+  /** get next line, without its '\\n'
+   *
+   * @param line set to next line, if any
+   * @return false at end of text
+   */
+  bool next(TextSpan &line);
+
+private:
+  const char *next_;
+  const char *end_;
+};
+
+/** Scan one line in place, following sscanf() conversion rules.
+ *
+ *  Each method corresponds to one sscanf() directive, and consumes
+ *  input only when it matches.  A chain of calls joined with && is
+ *  equivalent to checking that sscanf() converted every field.
+ */
+class TextScanner
+{
+public:
+  TextScanner(const TextSpan &line): p_(line.begin), end_(line.end) {};
+
+  /** match ordinary characters, like a sscanf() format string
+   *  without conversions: whitespace in @a s matches any amount of
+   *  input whitespace, other characters must match exactly.
+   */
+  bool literal(const char *s);
+
+  // like "%s": next whitespace-delimited token
+  bool token(TextSpan &tok);
+
+  // like "%*s": skip next token
+  bool skip_token()
+  {
+    TextSpan tok;
+    return token(tok);
+  };
+
+  // like "%d"
+  bool integer(int &value);
+
+  // like "%lf"
+  bool real(double &value);
+
+private:
+  void skip_space();
+
+  const char *p_;
+  const char *end_;
+};
+
+#endif // __TEXTSCANNER_H__
@@ -20,8 +20,13 @@
 #define EPSILON 0.5
 #define MAX_RANGE 160.0
 
-
-typedef double cell;
+/** Occupancy grid cell, holding log-odds in units of
+ *  1/LOGODDS_CELL_SCALE, biased by LOGODDS_CELL_ZERO.  Every value
+ *  the updates produce is a multiple of 0.5, so this is exact.
+ */
+typedef uint8_t cell;
+#define LOGODDS_CELL_SCALE 4
+#define LOGODDS_CELL_ZERO 128
 
 /*struct poly{
 		double x1;
@@ -72,7 +77,7 @@ public:
    * The function takes a 180 degree sick laser scan and updates the
    * occupancy grid.
    **/
-  void addSickScan(std::vector<double> ranges);
+  void addSickScan(const std::vector<double> &ranges);
   
   /**
    * Since the robot behaves in local coordinates, if you pass in an x
@@ -84,7 +89,7 @@ public:
    * the point it believes to have a collision based on the set
    * threshold.
    **/
-  cell value(int x, int y);
+  double value(int x, int y);
   
   void setThreshold(int threshold);
   void setCellShift(int shift);
@@ -144,14 +149,25 @@ public:
   
 private:
   bool valid(int x, int y);
-  void lighten(int x, int y);
   cell* at(int x, int y);
   cell *atgoal(int x, int y);
-  
-  cell **_m;
+
+  /** @return grid index in [0, _resolution) */
+  int wrap(int i) const
+  {
+    i %= _resolution;
+    return (i < 0? i + _resolution: i);
+  }
+
+  void scroll(int x_offset, int y_offset);
+
+  // The grid is a ring buffer in both directions, so moving the
+  // robot only changes _x_offset and _y_offset, clearing the rows
+  // and columns that come into view.
+  std::vector<cell> _m;
   double _physical_size;
   int _resolution;
-  double _x;
+  double _x;                    // position at initialize()
   double _y;
   double _theta;
   int _x_offset;
@@ -160,13 +176,6 @@ private:
   int _threshold;
   int _shift;
   
-  bool scan_off_right_side;
-  bool scan_off_left_side;
-  bool scan_off_bottom_side;
-  bool scan_off_top_side;
-  
-  int count;
-  
   double rX;
   double rY;
   
@@ -179,31 +188,28 @@ private:
   // may not need to implement
   void padObstacles(); 
   
-  void clearBottom();
-  void clearTop();
-  void clearRight();
-  void clearLeft();
-  
-  // General Bresenham Function that traverses from (xo, y1) to (x1,
-  // y1) and applies 'function' std::pair<int,int>*
-  // (VisualLanes::*_fp)(int,int)
-  std::pair<int,int>* line(int x0, int y0, int x1, int y1, 
-			   std::pair<int,int>* (VisualLanes::*_fp)(int,int));
+  // General Bresenham Function that traverses from (x0, y0) to (x1,
+  // y1) and applies 'function' to each cell, stopping at the first
+  // one for which it returns true.  Returns true in that case,
+  // storing that cell in *hit, if not NULL.  Allocates nothing.
+  template <bool (VisualLanes::*_fp)(int,int)>
+  bool line(int x0, int y0, int x1, int y1,
+	    std::pair<int,int> *hit = NULL);
   
   // Follows the list of functions that should only be used as
   // parameters to line!!  In no way shape or form should there ever
   // be a way to pass a public function pointer to line nor an
   // external function pointer.
-  std::pair<int,int>* cellLighten(int x, int y);
-  std::pair<int,int>* cellOccupied(int x, int y);
-  std::pair<int,int>* cellOccupiedRelative(int x, int y);
-  std::pair<int,int>* drawPointB(int x, int y); //for map lanes
-  std::pair<int,int>* drawPointW(int x, int y); //for map lanes
+  bool cellLighten(int x, int y);
+  bool cellOccupied(int x, int y);
+  bool cellOccupiedRelative(int x, int y);
+  bool drawPointB(int x, int y); //for map lanes
+  bool drawPointW(int x, int y); //for map lanes
   
   // Debug functions, not yet fully implemented; expect them to be
   // explained in the next update.
-  std::pair<int,int>* cellOccupiedDebug(int x, int y);
-  std::pair<int,int>* cellLightenDebug(int x, int y);
+  bool cellOccupiedDebug(int x, int y);
+  bool cellLightenDebug(int x, int y);
 };
 
 #endif
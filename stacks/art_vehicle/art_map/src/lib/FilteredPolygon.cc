@@ -1,23 +1,21 @@
 #include <stdio.h>
-#include <art_map/Matrix.h>
+#include <art_map/FixedMatrix.h>
 #include <art_map/FilteredPolygon.h>
 
 FilteredPolygon::FilteredPolygon() 
 {
   // Set up the initial KF matrix entries for each point
-  int numStates=2;
-  
-  Matrix initStates = Matrix(numStates,1,false);
+  KF<2>::StateVector initStates;
   initStates[0][0] = -0.001; // Initially place robot at basically 0,0
   initStates[1][0] = -0.001;
 
-  Matrix uncert = Matrix(numStates,numStates,false);
+  KF<2>::ErrorMatrix uncert;
   uncert[0][0] = 6.25;  // Standard deviation is 5.0 metres
   uncert[1][1] = 6.25;
   
   // Start the KF for each point
   for (int i=0; i<NUM_POINTS; i++) {
-    point[i].Start(numStates,uncert,initStates);
+    point[i].Start(uncert,initStates);
     point[i].active=true; // Turn the KF on .. supports multiple models which we don't need here
   }
 
@@ -50,7 +48,7 @@ FilteredPolygon::FilteredPolygon()
 // because it changes the X matrix directly and therefore changing it
 // other times could corrupt the relationship between X and P
 void FilteredPolygon::SetPoint(int pointID, float x, float y) {
-  Matrix X=point[pointID].GetStates();
+  KF<2>::StateVector X=point[pointID].GetStates();
   X[0][0]=x;
   X[1][0]=y;
   point[pointID].SetStates(X);
@@ -68,12 +66,12 @@ void FilteredPolygon::UpdatePoint(int pointID, float visionDistance,
                                   float rX, float rY, float rOri) 
 {
   #ifdef DEBUGFILTER	
-  Matrix X2=point[pointID].GetStates();
+  KF<2>::StateVector X2=point[pointID].GetStates();
   printf("(%f,%f)->",X2[0][0],X2[1][0]);
   #endif
 
 // The current state of the Kalman Filter	
-  Matrix X = point[pointID].GetStates();
+  KF<2>::StateVector X = point[pointID].GetStates();
 
   float visionElevation=0;
   float dist = visionDistance*cos(visionElevation);
@@ -81,7 +79,7 @@ void FilteredPolygon::UpdatePoint(int pointID, float visionDistance,
 
   // ---- Distance Update
   float Rdist = dist*dist/50 ; // modified .. *TODO* Tune this number
-  Matrix Cdist = GetDistanceJacobian(rX, rY, X[0][0], X[1][0]);
+  KF<2>::MeasurementMatrix Cdist = GetDistanceJacobian(rX, rY, X[0][0], X[1][0]);
   float estDist = sqrt(SQUARE(rX - X[0][0]) + SQUARE(rY - X[1][0]));
 
   distStruct.R=Rdist;
@@ -93,7 +91,7 @@ void FilteredPolygon::UpdatePoint(int pointID, float visionDistance,
 
   // ---- Angle Update
   float Rangle = 0.002*10;
-  Matrix Cangle = GetAngleJacobian(rX, rY, X[0][0], X[1][0]);
+  KF<2>::MeasurementMatrix Cangle = GetAngleJacobian(rX, rY, X[0][0], X[1][0]);
   float estAngle = Normalise_PI(atan2(rY-X[1][0],rX-X[0][0]) - rOri);
  // printf("%lf %lf\n",estAngle,visionBearing);
   angleStruct.R=Rangle;
@@ -117,7 +115,7 @@ void FilteredPolygon::UpdatePoint(int pointID, float visionDistance,
   #ifdef DEBUGFILTER	
   X2=point[pointID].GetStates();
   printf("(%f,%f)",X2[0][0],X2[1][0]);
-  Matrix P2=point[pointID].GetErrorMatrix();
+  KF<2>::ErrorMatrix P2=point[pointID].GetErrorMatrix();
   printf("(%f,%f)\n",P2[0][0],P2[1][0]);
   #endif
 }
@@ -125,22 +123,22 @@ void FilteredPolygon::UpdatePoint(int pointID, float visionDistance,
 
 // Jacobian for Distance and Angle, pass in the location of the robot
 // and then the current x,y of the point. Returns a matrix ..
-Matrix FilteredPolygon::GetDistanceJacobian(float xb, float yb,
+FixedMatrix<1,2> FilteredPolygon::GetDistanceJacobian(float xb, float yb,
                                             float x, float y)
 {
   float dist = sqrt((x-xb)*(x-xb) + (y-yb)*(y-yb));
   if (dist == 0) dist = 0.00001;
-  Matrix C = Matrix(1,2,false);
+  FixedMatrix<1,2> C;
   C[0][0] = (x-xb)/dist;
   C[0][1] = (y-yb)/dist;
   return C;
 }
 
-Matrix FilteredPolygon::GetAngleJacobian(float xb, float yb, float x, float y)
+FixedMatrix<1,2> FilteredPolygon::GetAngleJacobian(float xb, float yb, float x, float y)
 {
   float distSqrd = (x-xb)*(x-xb) + (y-yb)*(y-yb);
   if (distSqrd == 0) distSqrd = 0.00001;
-  Matrix C = Matrix(1,2,false);
+  FixedMatrix<1,2> C;
   C[0][0] = (yb-y)/distSqrd;
   C[0][1] = (x-xb)/distSqrd;
   return C;
@@ -157,7 +155,7 @@ void FilteredPolygon::SetPolygon(poly p)
 
 poly FilteredPolygon::GetPolygon()
 {
-  Matrix X=point[0].GetStates();
+  KF<2>::StateVector X=point[0].GetStates();
   polygon_.p1 = MapXY(X[0][0],X[1][0]);  
   X=point[1].GetStates();
   polygon_.p2 = MapXY(X[0][0],X[1][0]);  
@@ -176,7 +174,24 @@ poly FilteredPolygon::GetPolygon()
 /** returns quadrilateral message */
 art_msgs::ArtQuadrilateral FilteredPolygon::GetQuad()
 {
-  poly p = GetPolygon(); 
+  return MakeQuad(GetPolygon());
+}
+
+/** The filter states are floats, like the corners, so they hold the
+ *  corners exactly until updated.  Only the derived fields change.
+ */
+poly FilteredPolygon::InitialPolygon(const poly &p)
+{
+  poly q = p;
+  PolyOps ops;
+  q.heading = ops.PolyHeading(q);
+  q.midpoint = ops.centerpoint(q);
+  q.length = ops.getLength(q);
+  return q;
+}
+
+art_msgs::ArtQuadrilateral FilteredPolygon::MakeQuad(const poly &p)
+{
   art_msgs::ArtQuadrilateral q;
   q.poly.points.resize(art_msgs::ArtQuadrilateral::quad_size);
 
@@ -5,6 +5,8 @@
 
 #include <iostream>
 #include <float.h>
+#include <map>
+#include <set>
 
 #include <art/UTM.h>
 #include <art_map/euclidean_distance.h>
@@ -43,7 +45,47 @@ WayPointNode* Graph::get_node_by_id(const ElementID id) const {
   return NULL;
 };
 
+namespace
+{
+  // k-d tree search predicates
+
+  struct AnyNode
+  {
+    bool operator()(unsigned i, float dist) { return true; }
+  };
+
+  struct WithinLaneWidth
+  {
+    const WayPointNode *nodes;
+    WithinLaneWidth(const WayPointNode *_nodes): nodes(_nodes) {};
+    bool operator()(unsigned i, float dist)
+    {
+      return dist < nodes[i].lane_width;
+    }
+  };
+
+  struct InLane
+  {
+    const WayPointNode *nodes;
+    int seg;
+    int lane;
+    InLane(const WayPointNode *_nodes, int _seg, int _lane):
+      nodes(_nodes), seg(_seg), lane(_lane) {};
+    bool operator()(unsigned i, float dist)
+    {
+      return (nodes[i].id.seg == seg && nodes[i].id.lane == lane);
+    }
+  };
+}
+
 WayPointNode* Graph::get_closest_node(const MapXY &p) const {
+  if (node_tree_.indexes(nodes, nodes_size)) {
+    AnyNode any;
+    int i = node_tree_.nearest(p, any);
+    if (i >= 0)
+      return &nodes[i];
+  }
+
   WayPointNode* closest = NULL;
   float distance = 0;
   float new_distance = 0;
@@ -58,6 +100,12 @@ WayPointNode* Graph::get_closest_node(const MapXY &p) const {
 };
 
 WayPointNode* Graph::get_closest_node_within_radius(const MapXY &p) const {
+  if (node_tree_.indexes(nodes, nodes_size)) {
+    WithinLaneWidth within(nodes);
+    int i = node_tree_.nearest(p, within, max_lane_width_);
+    return (i < 0? NULL: &nodes[i]);
+  }
+
   WayPointNode* closest = NULL;
   float distance = 0;
   float new_distance = 0;
@@ -72,6 +120,18 @@ WayPointNode* Graph::get_closest_node_within_radius(const MapXY &p) const {
   return closest;
 };
 
+void Graph::index_nodes(void) {
+  max_lane_width_ = 0.0;
+  if (nodes == NULL || nodes_size == 0) {
+    node_tree_.clear();
+    return;
+  }
+  node_tree_.build(nodes, nodes_size);
+  for(uint i=0; i<nodes_size; i++)
+    if (nodes[i].lane_width > max_lane_width_)
+      max_lane_width_ = nodes[i].lane_width;
+};
+
 
 /*
 ZoneList get_zones(const Graph& graph) {
@@ -232,7 +292,8 @@ bool Graph::load(const char* fName){
   else if (current_node != number_of_nodes) return false;
   else if (current_edge != number_of_edges) return false;
   //ONE MORE CONDITION: CHECK CURRENT_EDGE, CURRENT_NODE
-  else return true;
+  index_nodes();
+  return true;
 }
 
 void Graph::clear(){
@@ -242,7 +303,8 @@ void Graph::clear(){
   for(uint i = 0; i < edges_size; i++)
     edges[i].clear();
   edges_size = 0;
-  
+  node_tree_.clear();
+  max_lane_width_ = 0.0;
 }
 
 void Graph::printNodes(){
@@ -338,6 +400,7 @@ void Graph::xy_rndf() {
     nodes[i].map.x = nodes[i].ll.latitude;
     nodes[i].map.y = nodes[i].ll.longitude;
   }
+  index_nodes();
   
   for(uint i = 0; i < edges_size; i++){
     WayPointNode* start=get_node_by_index(edges[i].startnode_index);
@@ -385,6 +448,7 @@ void Graph::find_mapxy(void)
       UTM::UTM(nodes[i].ll.latitude, nodes[i].ll.longitude, &tX, &tY);
       nodes[i].map = MapXY(tX - grid_x, tY - grid_y);
     }
+  index_nodes();
 
   for(uint i = 0; i < edges_size; i++){
     WayPointNode* start=get_node_by_index(edges[i].startnode_index);
@@ -396,7 +460,92 @@ void Graph::find_mapxy(void)
   }
 }
 
+/** Lookup tables for find_implicit_edges(), which would otherwise
+ *  scan all nodes and edges for every node.
+ */
+struct Graph::NodeLookup {
+  std::map<ElementID, int> ids;		// array index of each node ID
+  std::set<std::pair<int, int> > lanes;	// (seg, lane) of every node
+  std::vector<std::vector<uint> > edges_from; // edges by start index
+
+  NodeLookup(const Graph &graph) {
+    for (uint i=0; i<graph.nodes_size; i++) {
+      ids[graph.nodes[i].id] = i;
+      lanes.insert(std::make_pair((int) graph.nodes[i].id.seg,
+				  (int) graph.nodes[i].id.lane));
+    }
+    for (uint i=0; i<graph.edges.size(); i++) {
+      uint start = graph.edges[i].startnode_index;
+      if (start >= edges_from.size())
+	edges_from.resize(start+1);
+      edges_from[start].push_back(i);
+    }
+  }
+};
+
+/** @return array index of node in (seg, lane) closest to nodes[index],
+ *          -1 if none.
+ *
+ *  Requires a current node_tree_.  Checks that the lane exists
+ *  first: searching for a lane with no nodes would visit the whole
+ *  tree.
+ */
+int Graph::closest_in_lane(int index, int lane,
+			   const NodeLookup *lookup) const {
+  if (!lookup->lanes.count(std::make_pair((int) nodes[index].id.seg, lane)))
+    return -1;
+  InLane in_lane(nodes, nodes[index].id.seg, lane);
+  return node_tree_.nearest(nodes[index].map, in_lane);
+};
+
+/** @return array index of node with this ID, -1 if none */
+int Graph::find_node_index(const ElementID &id,
+			   const NodeLookup *lookup) const {
+  if (lookup) {
+    std::map<ElementID, int>::const_iterator it = lookup->ids.find(id);
+    return (it == lookup->ids.end()? -1: it->second);
+  }
+
+  int index=-1;
+  for (uint i=0; i<nodes_size; i++)
+    if (nodes[i].id==id)
+      index=i;
+  return index;
+}
+
+/** @return true if edge continues node's lane, and the lane
+ *  boundary on the left or right side of it may not be crossed.
+ */
+static bool crossing_prohibited(const Graph &graph, const WayPointEdge &edge,
+				const WayPointNode &node, bool left) {
+  ElementID neighbor_id=graph.nodes[edge.endnode_index].id;
+  if (neighbor_id.seg==node.id.seg &&
+      neighbor_id.lane==node.id.lane &&
+      neighbor_id.pt==node.id.pt+1) {
+    if (left)
+      {
+	if (edge.left_boundary==DOUBLE_YELLOW ||
+	    edge.left_boundary==SOLID_YELLOW ||
+	    edge.left_boundary==SOLID_WHITE)
+	  return true;
+      }
+    else
+      {
+	if (edge.right_boundary==DOUBLE_YELLOW ||
+	    edge.right_boundary==SOLID_YELLOW ||
+	    edge.right_boundary==SOLID_WHITE)
+	  return true;
+      }
+  }
+  return false;
+}
+
 bool Graph::passing_allowed(int index, int index2, bool left) {
+  return passing_allowed(index, index2, left, NULL);
+}
+
+bool Graph::passing_allowed(int index, int index2, bool left,
+			    const NodeLookup *lookup) {
   if (index < 0 || index >= (int)nodes_size)
     return false;
   
@@ -405,66 +554,36 @@ bool Graph::passing_allowed(int index, int index2, bool left) {
   
   ElementID ahead=ElementID(node1.id.seg,node1.id.lane,node1.id.pt+1);
   
-  bool found_ahead=false;
-
-  for (uint i=0; i<nodes_size; i++)
-    if (nodes[i].id==ahead)
-      {
-	found_ahead=true;
-	break;
-      }
-
-  if (!found_ahead)
+  if (find_node_index(ahead, lookup) < 0)
     return true;
-	
-			       
 
-  for (uint i=0; i<edges.size(); i++)
+  if (lookup)
     {
-      if (edges.at(i).startnode_index==node1.index)
+      if (node1.index < lookup->edges_from.size())
 	{
-	  ElementID neighbor_id=nodes[edges.at(i).endnode_index].id;
-	  if (neighbor_id.seg==node1.id.seg &&
-	      neighbor_id.lane==node1.id.lane &&
-	      neighbor_id.pt==node1.id.pt+1) {
-	    if (left)
-	      {
-		if (edges.at(i).left_boundary==DOUBLE_YELLOW ||
-		    edges.at(i).left_boundary==SOLID_YELLOW ||
-		    edges.at(i).left_boundary==SOLID_WHITE)
-		  return false;
-	      }
-	    else
-	      {
-		if (edges.at(i).right_boundary==DOUBLE_YELLOW ||
-		    edges.at(i).right_boundary==SOLID_YELLOW ||
-		    edges.at(i).right_boundary==SOLID_WHITE)
-		  return false;
-	      }
-	  }
+	  const std::vector<uint> &from = lookup->edges_from[node1.index];
+	  for (uint i=0; i<from.size(); i++)
+	    if (crossing_prohibited(*this, edges[from[i]], node1, left))
+	      return false;
 	}
-      if (edges.at(i).startnode_index==node2.index)
+      if (node2.index < lookup->edges_from.size())
 	{
-	  ElementID neighbor_id= nodes[edges.at(i).endnode_index].id;
-	  if (neighbor_id.seg==node2.id.seg &&
-	      neighbor_id.lane==node2.id.lane &&
-	      neighbor_id.pt==node2.id.pt+1) {
-	    if (!left)
-	      {
-		if (edges.at(i).left_boundary==DOUBLE_YELLOW ||
-		    edges.at(i).left_boundary==SOLID_YELLOW ||
-		    edges.at(i).left_boundary==SOLID_WHITE)
-		  return false;
-	      }
-	    else
-	      {
-		if (edges.at(i).right_boundary==DOUBLE_YELLOW ||
-		    edges.at(i).right_boundary==SOLID_YELLOW ||
-		    edges.at(i).right_boundary==SOLID_WHITE)
-		  return false;
-	      }
-	  }
+	  const std::vector<uint> &from = lookup->edges_from[node2.index];
+	  for (uint i=0; i<from.size(); i++)
+	    if (crossing_prohibited(*this, edges[from[i]], node2, !left))
+	      return false;
 	}
+      return true;
+    }
+
+  for (uint i=0; i<edges.size(); i++)
+    {
+      if (edges.at(i).startnode_index==node1.index
+	  && crossing_prohibited(*this, edges.at(i), node1, left))
+	return false;
+      if (edges.at(i).startnode_index==node2.index
+	  && crossing_prohibited(*this, edges.at(i), node2, !left))
+	return false;
     }
   
   return true;
@@ -472,6 +591,11 @@ bool Graph::passing_allowed(int index, int index2, bool left) {
 }
 
 bool Graph::lanes_in_same_direction(int index1,int index2, bool& left_lane) {
+  return lanes_in_same_direction(index1, index2, left_lane, NULL);
+}
+
+bool Graph::lanes_in_same_direction(int index1,int index2, bool& left_lane,
+				    const NodeLookup *lookup) {
   if (index1<0 || index2<0 ||
       index1>=(int)nodes_size ||
       index2>=(int)nodes_size)
@@ -483,16 +607,8 @@ bool Graph::lanes_in_same_direction(int index1,int index2, bool& left_lane) {
   ElementID el2=ElementID(nodes[index2].id);
   el2.pt+=1;
 
-  int ind1=-1;
-  int ind2=-1;
-
-  for (uint i=0; i<nodes_size; i++)
-    {
-      if (nodes[i].id==el1)
-	ind1=i;
-      if (nodes[i].id==el2)
-	ind2=i;
-    }
+  int ind1=find_node_index(el1, lookup);
+  int ind2=find_node_index(el2, lookup);
   
   float head1;
   float head2;
@@ -515,16 +631,8 @@ bool Graph::lanes_in_same_direction(int index1,int index2, bool& left_lane) {
     {
       el1.pt-=2;
       el2.pt-=2;
-      ind1=-1;
-      ind2=-1;
-
-      for (uint i=0; i<nodes_size; i++)
-	{
-	  if (nodes[i].id==el1)
-	    ind1=i;
-	  if (nodes[i].id==el2)
-	    ind2=i;
-	}
+      ind1=find_node_index(el1, lookup);
+      ind2=find_node_index(el2, lookup);
 
       if (ind1>=0 && ind2>=0)
 	{
@@ -548,7 +656,19 @@ bool Graph::lanes_in_same_direction(int index1,int index2, bool& left_lane) {
 
 }
 
+/** Add implicit lane change edges.
+ *
+ *  Links each way-point to the closest way-point in the lanes on
+ *  either side of it, when those lanes go the same direction and
+ *  the boundary may be crossed.  Closest nodes come from the spatial
+ *  index, and other lookups from tables built here, so this takes
+ *  O(n log n) time instead of O(n^2).
+ */
 void Graph::find_implicit_edges() {
+
+  if (!node_tree_.indexes(nodes, nodes_size))
+    index_nodes();
+  NodeLookup lookup(*this);
   
   for (unsigned i=0; i< nodes_size; i++)
     {
@@ -557,32 +677,16 @@ void Graph::find_implicit_edges() {
 	  node1.is_spot)
 	continue;
       {// left case
-	float min_dist=FLT_MAX;
-	int min_index=-1;
-	for (unsigned j=0; j< nodes_size; j++)
-	  if (i!=j)
-	    {
-	      WayPointNode node2=nodes[j];
-	      if (node1.id.seg==node2.id.seg &&
-		  node1.id.lane-1==node2.id.lane)
-		{
-		  float curr_dist=Euclidean::DistanceTo(node1.map,node2.map);
-		  if (curr_dist < min_dist)
-		    {
-		      min_dist=curr_dist;
-		      min_index=j;
-		    }
-		}
-	    }
+	int min_index=closest_in_lane(i, node1.id.lane-1, &lookup);
 	if (min_index<0)
 	  continue;
 	if (nodes[min_index].is_stop || nodes[min_index].is_perimeter ||
 	    nodes[min_index].is_spot)
 	  continue;
 	bool left_lane;
-	if (lanes_in_same_direction(i,min_index, left_lane))
+	if (lanes_in_same_direction(i,min_index, left_lane, &lookup))
 	  {
-	    if (passing_allowed(i,min_index,left_lane))
+	    if (passing_allowed(i,min_index,left_lane, &lookup))
 	      {
 		WayPointEdge new_edge;
 		new_edge.startnode_index=i;
@@ -599,29 +703,13 @@ void Graph::find_implicit_edges() {
       }
       
       {// right case
-	float min_dist=FLT_MAX;
-	int min_index=-1;
-	for (unsigned j=0; j< nodes_size; j++)
-	  if (i!=j)
-	    {
-	      WayPointNode node2=nodes[j];
-	      if (node1.id.seg==node2.id.seg &&
-		  node1.id.lane+1==node2.id.lane)
-		{
-		  float curr_dist=Euclidean::DistanceTo(node1.map,node2.map) < min_dist;
-		  if (curr_dist < min_dist)
-		    {
-		      min_dist=curr_dist;
-		      min_index=j;
-		    }
-		}
-	    }
+	int min_index=closest_in_lane(i, node1.id.lane+1, &lookup);
 	if (min_index<0)
 	  continue;
 	bool left_lane;
-	if (lanes_in_same_direction(i,min_index, left_lane))
+	if (lanes_in_same_direction(i,min_index, left_lane, &lookup))
 	  {
-	    if (passing_allowed(i,min_index,left_lane))
+	    if (passing_allowed(i,min_index,left_lane, &lookup))
 	      {
 		WayPointEdge new_edge;
 		new_edge.startnode_index=i;
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     2-d tree of way-point graph nodes.
+
+ */
+
+#include <algorithm>
+
+#include <art_map/KDTree.h>
+
+namespace
+{
+  struct CompareX
+  {
+    template <class E>
+    bool operator()(const E &a, const E &b) const { return a.x < b.x; }
+  };
+
+  struct CompareY
+  {
+    template <class E>
+    bool operator()(const E &a, const E &b) const { return a.y < b.y; }
+  };
+}
+
+void KDTree::build(const WayPointNode nodes[], unsigned nnodes)
+{
+  nodes_ = nodes;
+  entries_.resize(nnodes);
+  for (unsigned i = 0; i < nnodes; ++i)
+    {
+      entries_[i].x = nodes[i].map.x;
+      entries_[i].y = nodes[i].map.y;
+      entries_[i].index = i;
+    }
+  build(0, nnodes, 0);
+}
+
+/** put the median of [lo, hi) in the middle, split on x at even
+ *  depths and y at odd ones, then do the same for both halves.
+ */
+void KDTree::build(unsigned lo, unsigned hi, int depth)
+{
+  if (hi - lo < 2)
+    return;
+
+  unsigned mid = (lo + hi) / 2;
+  if (depth & 1)
+    std::nth_element(entries_.begin() + lo, entries_.begin() + mid,
+		     entries_.begin() + hi, CompareY());
+  else
+    std::nth_element(entries_.begin() + lo, entries_.begin() + mid,
+		     entries_.begin() + hi, CompareX());
+  build(lo, mid, depth+1);
+  build(mid+1, hi, depth+1);
+}
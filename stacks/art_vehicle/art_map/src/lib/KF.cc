@@ -8,33 +8,21 @@
 
 using namespace std;
 
-// The constructor defualts to 1x1 matrices. This is meant to be a
-// somewhat generic KF class, so the start method redefines the size
-// of the matrix
-KF::KF() {
-  numStates = 0;
-  I = Matrix(1,1,false);
-  initP = Matrix(1,1,false);
-  initX = Matrix(1,1,false);
-  P = Matrix(1,1,false);
-  X = Matrix(1,1,false);
-  Xchange = Matrix(1,1,false);
-
+// The matrices start out zero; the start method sets their initial
+// values.
+template <int S>
+KF<S>::KF() {
   active = false;    // Is the model currrently in use ?
   activate = false;
   alpha = 1.0;  
 }
 
-// Basically this method is called at the start. The inputs define the size of
-// the KF and the initial values of the matrices.
-bool KF::Start(short n, Matrix& uncert, Matrix& initStates) {
-  if (uncert.getm() != n || uncert.getn() != n || initStates.getm() != n || initStates.getn() != 1) {
-    printf("Incorrect matrix dimensions in method Start()");
-    return false;
-  }
+// Basically this method is called at the start. The inputs define the
+// initial values of the matrices.
+template <int S>
+bool KF<S>::Start(const ErrorMatrix& uncert, const StateVector& initStates) {
   //E.g. uncert is 5x5, initStates = 5x1
-  numStates = n;
-  I = Matrix(n, n, true);
+  I = ErrorMatrix(true);
   initP = uncert;
   initX = initStates;
 
@@ -42,51 +30,29 @@ bool KF::Start(short n, Matrix& uncert, Matrix& initStates) {
   active = false;    // Is the model currrently in use ? By Default it is not .. 
   activate = false;
   return Restart();
-  return true;
 }
 
 // Restarts the KF. Either called at the beginning or at some other point (i.e. a maths problem occured)
-bool KF::Restart() {
+template <int S>
+bool KF<S>::Restart() {
   P = initP;
   X = initX;
-  Xchange = Matrix(numStates, 1, false);
+  Xchange = StateVector();
   // Anything else that needs to be reset should be done here
   return true;
 }
 
-
-bool KF::TimeUpdate(Matrix& A, Matrix& B, Matrix& U, Matrix& Q, bool mainFilterUpdate) { 
-  if (A.getm() != numStates || A.getn() != numStates || B.getm() != numStates || B.getn() != U.getm() || U.getn() != 1 || Q.getm() != numStates || Q.getn() != numStates) {
-    printf("Incorrect matrix dimensions in method TimeUpdate()");
-    return false;
-  }
-
-  X = A*X + B*U;
-  if (mainFilterUpdate) X[2][0] = Normalise_PI(X[2][0]);
-  P = A*P*A.transp() + Q;
-  Xchange = Matrix(numStates, 1, false);
-  for (int  i = 0; i < numStates; i++) Xchange[i][0] = 0;
-  return true;
-}
-
-bool KF::TimeUpdateExtended(Matrix& A, Matrix& Xbar, Matrix& Q) { //A = df/dx|x=x(k) where Xbar = f(x(k))
-  if (A.getm() != numStates || A.getn() != numStates || Xbar.getm() != numStates || Xbar.getn() != 1 || Q.getm() != numStates || Q.getn() != numStates) {
-    printf("Incorrect matrix dimensions in method TimeUpdateExtended()");
-    return false;
-  }
+template <int S>
+bool KF<S>::TimeUpdateExtended(const ErrorMatrix& A, const StateVector& Xbar, const ErrorMatrix& Q) { //A = df/dx|x=x(k) where Xbar = f(x(k))
   //E.g. A is 5x5, X is 5x1, & Q is 5x5
   X = Xbar;
   P = A*P*A.transp() + Q;
-  Xchange = Matrix(numStates, 1, false);
-  for (int  i = 0; i < numStates; i++) Xchange[i][0] = 0;
+  Xchange = StateVector();
   return true;
 }
 
-int KF::MeasurementUpdate(Matrix& C, float R, float Y, bool rejectOutliers, float outlierSD, bool mainFilterAngleUpdate) { // Set mainFilterAngleUpdate to false unless this is an angle update operation and X[2][0] is the orientation of the robot
-  if (C.getn() != numStates || C.getm() != 1) {
-    CompilerError("Incorrect matrix dimensions in method MeasurementUpdate()");
-    return KF_CRASH;
-  }
+template <int S>
+int KF<S>::MeasurementUpdate(const MeasurementMatrix& C, float R, float Y, bool rejectOutliers, float outlierSD, bool mainFilterAngleUpdate) { // Set mainFilterAngleUpdate to false unless this is an angle update operation and X[2][0] is the orientation of the robot
   //E.g. C is 1x5
   float HX = convDble(C*X);
   float innovation = Y - HX;
@@ -100,8 +66,8 @@ int KF::MeasurementUpdate(Matrix& C, float R, float Y, bool rejectOutliers, floa
   }
   float varPredError = posVar + R;
   if (rejectOutliers && (fabs(innovation) > pow(outlierSD,2)*sqrt(varPredError))) return KF_OUTLIER;
-  Matrix J = P*C.transp()/varPredError; //J is now X.M x Y.M e.g. 5x1
-  Matrix newP = (I - J*C)*P;
+  StateVector J = P*C.transp()/varPredError; //J is now X.M x Y.M e.g. 5x1
+  ErrorMatrix newP = (I - J*C)*P;
   for (int i = 0; i < numStates; i++) {
     if (newP[i][i] <= 0) {
       cout << "Numerics error"<< endl << flush;
@@ -122,17 +88,14 @@ int KF::MeasurementUpdate(Matrix& C, float R, float Y, bool rejectOutliers, floa
 }
 
 
-int KF::MeasurementUpdateExtended(Matrix& C,KFStruct s) {
+template <int S>
+int KF<S>::MeasurementUpdateExtended(const MeasurementMatrix& C, const KFStruct &s) {
 	return MeasurementUpdateExtended(C,s.R, s.Y, s.Ybar, s.rejectOutliers, s.outlierSD, s.mainFilterAngleUpdate, s.ingoreLongRangeUpdate, s.deadzoneSize, s.dist, s.ambigObject, s.changeAlpha);
 }
 
 
-int KF::MeasurementUpdateExtended(Matrix& C, float R, float Y, float Ybar, bool rejectOutliers, float outlierSD, bool mainFilterAngleUpdate, bool ignoreLongRangeUpdate, float deadzoneSize, float dist, bool ambigObj, bool changeAlpha) { // Set mainFilterAngleUpdate to false unless this is an angle update operation and X[2][0] is the orientation of the robot
-  if (C.getn() != numStates || C.getm() != 1) {
-    CompilerError("Incorrect matrix dimensions in method MeasurementUpdateExtended()");
-    cout << "Incorrect matrix dimensions in method MeasurementUpdateExtended()" << endl << flush;
-    return KF_CRASH;
-  }
+template <int S>
+int KF<S>::MeasurementUpdateExtended(const MeasurementMatrix& C, float R, float Y, float Ybar, bool rejectOutliers, float outlierSD, bool mainFilterAngleUpdate, bool ignoreLongRangeUpdate, float deadzoneSize, float dist, bool ambigObj, bool changeAlpha) { // Set mainFilterAngleUpdate to false unless this is an angle update operation and X[2][0] is the orientation of the robot
   //E.g. C is 1x5
   float innovation = Y - Ybar;
   float posVar = convDble(C*P*C.transp());
@@ -180,10 +143,10 @@ int KF::MeasurementUpdateExtended(Matrix& C, float R, float Y, float Ybar, bool
     }
 
   
-  Matrix J = P*C.transp()/varPredError; //J is now X.M x Y.M e.g. 5x1
+  StateVector J = P*C.transp()/varPredError; //J is now X.M x Y.M e.g. 5x1
 //  if (!mainFilterAngleUpdate) J[2][0] = 0;
-  Matrix Xbar = X;
-  Matrix newP = (I - J*C)*P;
+  StateVector Xbar = X;
+  ErrorMatrix newP = (I - J*C)*P;
   for (int i = 0; i < numStates; i++) {
     if (newP[i][i] <= 0) {
       //cout << "Numerics error" << endl << flush;
@@ -205,59 +168,23 @@ int KF::MeasurementUpdateExtended(Matrix& C, float R, float Y, float Ybar, bool
 
 // Resets the P matrix, basically increases the location uncertainty. 
 // This sovles problems like the 'kidnappend robot' scenario.
-void KF::Reset() {
+template <int S>
+void KF<S>::Reset() {
   P = initP;
 }
 
-Matrix KF::GetStates() {
-  return X;
-}
-
-void KF::SetStates(Matrix Xbar) {
-  X = Xbar;
-}
-
-float KF::GetState(short n) {
-  return X[n][0];
-}
-
-void KF::SetState(short n, float x) {
-  X[n][0] = x;
-}
-
-void KF::NormaliseState(short n) {
+template <int S>
+void KF<S>::NormaliseState(short n) {
   X[n][0] = Normalise_PI(X[n][0]);
 }
 
-Matrix KF::GetErrorMatrix() {
-  return P;
-}
-
-void KF::SetErrorMatrix(Matrix Pbar) {
-  P = Pbar;
-}
-
-float KF::GetCovariance(short m, short n) {
-  return P[m][n];
-}
-
-float KF::GetVariance(short n) {
-  return P[n][n];
-}
-
-Matrix KF::GetXchanges() {
-  return Xchange;
-}
-
-float KF::GetXchange(short n) {
-  return Xchange[n][0];
-}
-
-void KF::CompilerError(const char* str) {
+template <int S>
+void KF<S>::CompilerError(const char* str) {
   cout << str << endl << flush;
 }
 
-void KF::Deadzone(float* R, float* innovation, float CPC, float eps)
+template <int S>
+void KF<S>::Deadzone(float* R, float* innovation, float CPC, float eps)
 {
 	float invR;
 	// R is the covariance of the measurement (altered by this procedure)
@@ -296,3 +223,6 @@ void KF::Deadzone(float* R, float* innovation, float CPC, float eps)
 	// or, (if we are outside the deadzone), so that the new prediction at most just reaches
 	// the deadzone.
 }
+
+// FilteredPolygon filters each corner in two dimensions
+template class KF<2>;
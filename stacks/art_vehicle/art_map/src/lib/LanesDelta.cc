@@ -0,0 +1,144 @@
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     Delta encoding of local road map lanes.
+
+     Both ends keep the local map in poly_id order, so finding the
+     differences and applying them are linear merges.
+
+ */
+
+#include <art_map/LanesDelta.h>
+
+namespace
+{
+  typedef std::vector<art_msgs::ArtQuadrilateral> quad_list_t;
+
+  /** @return true if polygons are in increasing poly_id order */
+  bool in_order(const quad_list_t &quads)
+  {
+    for (unsigned i = 1; i < quads.size(); ++i)
+      if (quads[i-1].poly_id >= quads[i].poly_id)
+	return false;
+    return true;
+  }
+}
+
+/** The other fields never change for a given poly_id. */
+bool LanesDeltaEncoder::sameShape(const art_msgs::ArtQuadrilateral &a,
+				  const art_msgs::ArtQuadrilateral &b)
+{
+  if (a.poly.points.size() != b.poly.points.size())
+    return false;
+  for (unsigned k = 0; k < a.poly.points.size(); ++k)
+    if (a.poly.points[k].x != b.poly.points[k].x
+	|| a.poly.points[k].y != b.poly.points[k].y)
+      return false;
+  return (a.midpoint.x == b.midpoint.x
+	  && a.midpoint.y == b.midpoint.y
+	  && a.heading == b.heading
+	  && a.length == b.length);
+}
+
+void LanesDeltaEncoder::encode(const art_msgs::ArtLanes &lanes,
+			       art_msgs::ArtLanesDelta &delta)
+{
+  delta.header = lanes.header;
+  delta.sequence = sequence_++;
+  delta.removed.clear();
+  delta.added.clear();
+
+  const quad_list_t &cur = lanes.polygons;
+  bool sorted = in_order(cur);
+  delta.keyframe = (count_ == 0 || !sorted);
+  if (delta.keyframe)
+    {
+      delta.added = cur;
+    }
+  else
+    {
+      unsigned i = 0, j = 0;
+      while (i < prev_.size() || j < cur.size())
+	{
+	  if (j == cur.size()
+	      || (i < prev_.size() && prev_[i].poly_id < cur[j].poly_id))
+	    {
+	      delta.removed.push_back(prev_[i++].poly_id);
+	    }
+	  else if (i == prev_.size() || cur[j].poly_id < prev_[i].poly_id)
+	    {
+	      delta.added.push_back(cur[j++]);
+	    }
+	  else
+	    {
+	      if (!sameShape(prev_[i], cur[j]))
+		delta.added.push_back(cur[j]);
+	      ++i;
+	      ++j;
+	    }
+	}
+    }
+
+  // a map out of order can only be sent whole, so the next one
+  // must be a keyframe, too
+  if (sorted)
+    count_ = (count_ + 1) % interval_;
+  else
+    count_ = 0;
+  prev_ = cur;
+}
+
+bool LanesDeltaDecoder::update(const art_msgs::ArtLanesDelta &delta)
+{
+  if (delta.keyframe)
+    {
+      lanes_.polygons = delta.added;
+      synced_ = true;
+    }
+  else if (synced_ && delta.sequence == sequence_ + 1)
+    {
+      const quad_list_t &cur = lanes_.polygons;
+      const quad_list_t &add = delta.added;
+      next_.clear();
+      unsigned i = 0, j = 0, k = 0;
+      while (i < cur.size() || j < add.size())
+	{
+	  if (j == add.size()
+	      || (i < cur.size() && cur[i].poly_id < add[j].poly_id))
+	    {
+	      // keep this polygon unless it left
+	      while (k < delta.removed.size()
+		     && delta.removed[k] < cur[i].poly_id)
+		++k;
+	      if (k == delta.removed.size()
+		  || delta.removed[k] != cur[i].poly_id)
+		next_.push_back(cur[i]);
+	      ++i;
+	    }
+	  else
+	    {
+	      // new or changed polygon
+	      if (i < cur.size() && cur[i].poly_id == add[j].poly_id)
+		++i;
+	      next_.push_back(add[j++]);
+	    }
+	}
+      lanes_.polygons.swap(next_);
+    }
+  else
+    {
+      synced_ = false;
+    }
+
+  sequence_ = delta.sequence;
+  if (synced_)
+    lanes_.header = delta.header;
+  return synced_;
+}
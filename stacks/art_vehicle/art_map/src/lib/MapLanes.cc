@@ -19,6 +19,9 @@
 #include <art/epsilon.h>
 #include <vector>
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
 #include <art_map/gaussian.h>
 #include <art_map/MapLanes.h>
 #include <art_map/euclidean_distance.h>
@@ -75,15 +78,15 @@ void MapLanes::MakePolygons()
   std::vector<Point2f> lane_pt;
   std::vector<int> lane_map;
 
-  SmoothCurve lc,rc;
+  std::vector<LaneBatch> batches;
 
   ElementID prev_lane;             // used to determine when the edges
                                    // switch lanes
 
   // Walk along graph edges, pushing nodes (and the associated points
   // that the curve code uses) from same lane onto a list, then
-  // process the list whenever a new lane is encountered (or an transition)
-  // or before leaving the function if the list isn't empty.
+  // queue the list whenever a new lane is encountered (or an transition)
+  // or before leaving the loop if the list isn't empty.
 
   for(uint j = 0; j < graph->edges_size; j++)
     { 
@@ -104,27 +107,10 @@ void MapLanes::MakePolygons()
 	      w1.id.pt != prev_lane.pt)
 	    //if new lane push start waypoint onto list
 	    {
-	      // If last lane info is still around, process it
+	      // If last lane info is still around, queue it
 	      if (lane.size()>1)
-		{
-		  Point2f diff_pt=lane_pt[1]-lane_pt[0];
-		  Point2f diff_pt2=lane_pt[lane_pt.size()-1]-
-		    lane_pt[lane_pt.size()-2];
-		  SmoothCurve c=
-		    SmoothCurve(lane_pt,
-				atan2f(diff_pt[1],diff_pt[0]), 1,
-				atan2f(diff_pt2[1],diff_pt2[0]), 1);
-		  
-		  for (uint i=0;i<lane.size()-1;i++)
-		    {
-		      MakeLanePolygon(lane[i],lane[i+1],e,
-				      c.knots[lane_map[i]],
-				      c.knots[lane_map[i+1]],
-				      c, true,
-				      0,0,lc,
-				      0,0,rc);
-		    }
-		}
+		QueueLane(batches, lane, lane_pt, lane_map, e,
+			  false, 0, false);
 	      
 	      // Set up new lane
 	      lane.clear();
@@ -153,24 +139,9 @@ void MapLanes::MakePolygons()
 	// Transition; 
 	{
 	  if (lane.size()>1)
-	    // Process out previous lane if one exists
-	    {
-	      Point2f diff_pt=lane_pt[1]-lane_pt[0];
-	      Point2f diff_pt2=lane_pt[lane_pt.size()-1]-
-		lane_pt[lane_pt.size()-2];
-	      
-	      SmoothCurve c=
-		SmoothCurve(lane_pt,
-			    atan2f(diff_pt[1],diff_pt[0]), 1,
-			    atan2f(diff_pt2[1],diff_pt2[0]), 1);
-	      
-	      for (uint i=0;i<lane.size()-1;i++)
-		MakeLanePolygon(lane[i],lane[i+1],e,
-				c.knots[lane_map[i]],
-				c.knots[lane_map[i+1]],
-				c, true,
-				0,0,lc,0,0,rc);
-	    }
+	    // Queue previous lane if one exists
+	    QueueLane(batches, lane, lane_pt, lane_map, e,
+		      false, 0, false);
 	  
 	  // Make transition polygons
 	  lane.clear();
@@ -231,79 +202,179 @@ void MapLanes::MakePolygons()
 	      lane_pt.push_back(pt);
 	      lane_map.push_back(lane_pt.size()-1);
 	    }
-	    
-	  
-	  Point2f diff_pt=lane_pt[1]-lane_pt[0];
-	  Point2f diff_pt2=lane_pt[lane_pt.size()-1]-
-	    lane_pt[lane_pt.size()-2];
-	  
-	  SmoothCurve c=
-	    SmoothCurve(lane_pt,
-			atan2f(diff_pt[1],diff_pt[0]), 1,
-			atan2f(diff_pt2[1],diff_pt2[0]), 1);
-	  
-	  MakeTransitionPolygon(lane[base_ind],lane[base_ind+1],e,
-				c.knots[lane_map[base_ind]],c.knots[lane_map[base_ind+1]],c);
-	  
-	  // Clear out transition
-	  lane.clear();
-	  lane_pt.clear();
-	  lane_map.clear();
+
+	  // Queue transition, this also clears it out
+	  QueueLane(batches, lane, lane_pt, lane_map, e,
+		    true, base_ind, false);
 	  prev_lane=ElementID();
 	}
     }
   
-  // If last lane info is still around, process it
+  // If last lane info is still around, queue it.  The edge linking
+  // each pair of its way-points is looked up while building it.
   if (lane.size()>1)
+    QueueLane(batches, lane, lane_pt, lane_map, WayPointEdge(),
+	      false, 0, true);
+
+  // Fit curves and build lane polygons in parallel.
+  unsigned nworkers = nthreads;
+  if (nworkers == 0)
+    nworkers = boost::thread::hardware_concurrency();
+  if (nworkers > batches.size())
+    nworkers = batches.size();
+  if (nworkers < 1)
+    nworkers = 1;
+
+  unsigned next_batch = 0;
+  boost::mutex next_lock;
+  boost::thread_group workers;
+  for (unsigned i = 1; i < nworkers; i++)
+    workers.create_thread(boost::bind(&MapLanes::BuildLaneBatches, this,
+				      &batches, &next_batch, &next_lock));
+  BuildLaneBatches(&batches, &next_batch, &next_lock);
+  workers.join_all();
+
+  ROS_DEBUG_STREAM("built " << batches.size() << " lane batches using "
+		   << nworkers << " threads");
+
+  // Merge batches in graph order, assigning polygon IDs.
+  for (uint i = 0; i < batches.size(); i++)
     {
-      // Clear out previous lane
-      Point2f diff_pt=lane_pt[1]-lane_pt[0];
-      Point2f diff_pt2=lane_pt[lane_pt.size()-1]-
-	lane_pt[lane_pt.size()-2];
-      SmoothCurve c=
-	SmoothCurve(lane_pt,
-		    atan2f(diff_pt[1],diff_pt[0]), 1,
-		    atan2f(diff_pt2[1],diff_pt2[0]), 1);
-      
-      for (uint i=0;i<lane.size()-1;i++) {
-	// Find the edge that links lane[i] and lane[i+1]
-	WayPointEdge e;
-	for(uint j = 0; j < graph->edges_size; j++)
-	  { 
-	    e=graph->edges[j];
-	    
-	    if(graph->nodes[e.startnode_index].id.pt==lane[i].id.pt
-	       && graph->nodes[e.startnode_index].id.lane==lane[i].id.lane
-	       && graph->nodes[e.startnode_index].id.seg==lane[i].id.seg
-	       && graph->nodes[e.endnode_index].id.pt==lane[i+1].id.pt
-	       && graph->nodes[e.endnode_index].id.lane==lane[i+1].id.lane
-	       && graph->nodes[e.endnode_index].id.seg==lane[i+1].id.seg)
-	      
-	      break;
-	  }
-	
-	MakeLanePolygon(lane[i],lane[i+1],e,
-			c.knots[lane_map[i]],
-			c.knots[lane_map[i+1]],
-			c, true,0,0,lc,0,0,rc);
+      LaneBatch &b = batches[i];
+      if (b.is_transition)
+	{
+	  // Transitions attach to way-point polygons merged earlier.
+	  MakeTransitionPolygon(b.lane[b.base_ind],b.lane[b.base_ind+1],b.e,
+				b.c.knots[b.lane_map[b.base_ind]],
+				b.c.knots[b.lane_map[b.base_ind+1]],b.c);
+	}
+      else if (b.polys.empty())
+	continue;
+      else if (poly_id_counter == 0 ||
+	       ElementID(allPolys[poly_id_counter-1].end_way)
+	       != ElementID(b.polys[0].start_way))
+	{
+	  // The batch started its lane with a new way-point polygon,
+	  // just as a serial build would have done.
+	  for (uint k = 0; k < b.polys.size(); k++)
+	    {
+	      b.polys[k].poly_id = poly_id_counter++;
+	      allPolys.push_back(b.polys[k]);
+	    }
+	}
+      else
+	{
+	  // The lane continues from the last polygon merged, which
+	  // the batch could not see.  Rebuild it in place.
+	  MakeLanePolys(b, allPolys);
+	}
+      poly_id_counter = allPolys.size();
+    }
+}
+
+/** Queue lane or transition way-points for polygon generation.
+ *
+ *  Moves the contents of @a lane, @a lane_pt and @a lane_map into a
+ *  new batch, leaving them empty.
+ */
+void MapLanes::QueueLane(std::vector<LaneBatch> &batches,
+			 std::vector<WayPointNode> &lane,
+			 std::vector<Point2f> &lane_pt,
+			 std::vector<int> &lane_map,
+			 const WayPointEdge &e,
+			 bool is_transition, int base_ind, bool find_edges)
+{
+  batches.push_back(LaneBatch());
+  LaneBatch &b = batches.back();
+  b.is_transition = is_transition;
+  b.base_ind = base_ind;
+  b.find_edges = find_edges;
+  b.e = e;
+  b.lane.swap(lane);
+  b.lane_pt.swap(lane_pt);
+  b.lane_map.swap(lane_map);
+}
+
+/** Worker thread body: build batches until none remain. */
+void MapLanes::BuildLaneBatches(std::vector<LaneBatch> *batches,
+				unsigned *next_batch, boost::mutex *next_lock)
+{
+  for (;;)
+    {
+      unsigned i;
+      {
+	boost::mutex::scoped_lock lock(*next_lock);
+	i = (*next_batch)++;
       }
+      if (i >= batches->size())
+	return;
+      BuildLaneBatch((*batches)[i]);
     }
-  
-  // Set up new lane
-  lane.clear();
-  lane_pt.clear();
-  lane_map.clear();
 }
 
-void MapLanes::SetFilteredPolygons()
+/** Fit curve to a batch and build its lane polygons.
+ *
+ *  Only reads the graph, so batches may be built concurrently.
+ */
+void MapLanes::BuildLaneBatch(LaneBatch &b)
 {
-  for (int i=0; i<(int)allPolys.size(); i++)
+  Point2f diff_pt=b.lane_pt[1]-b.lane_pt[0];
+  Point2f diff_pt2=b.lane_pt[b.lane_pt.size()-1]-
+    b.lane_pt[b.lane_pt.size()-2];
+  b.c=
+    SmoothCurve(b.lane_pt,
+		atan2f(diff_pt[1],diff_pt[0]), 1,
+		atan2f(diff_pt2[1],diff_pt2[0]), 1);
+
+  // transition polygons are made while merging
+  if (b.is_transition)
+    return;
+
+  for (uint i=0;i<b.lane.size()-1;i++)
     {
-      FilteredPolygon p;
-      p.SetPolygon(allPolys.at(i));
-      filtPolys.push_back(p);
+      WayPointEdge e=b.e;
+      if (b.find_edges)
+	{
+	  // Find the edge that links lane[i] and lane[i+1]
+	  for(uint j = 0; j < graph->edges_size; j++)
+	    { 
+	      e=graph->edges[j];
+	      
+	      if(graph->nodes[e.startnode_index].id.pt==b.lane[i].id.pt
+		 && graph->nodes[e.startnode_index].id.lane==b.lane[i].id.lane
+		 && graph->nodes[e.startnode_index].id.seg==b.lane[i].id.seg
+		 && graph->nodes[e.endnode_index].id.pt==b.lane[i+1].id.pt
+		 && graph->nodes[e.endnode_index].id.lane==b.lane[i+1].id.lane
+		 && graph->nodes[e.endnode_index].id.seg==b.lane[i+1].id.seg)
+		
+		break;
+	    }
+	}
+      b.edges.push_back(e);
     }
 
+  MakeLanePolys(b, b.polys);
+}
+
+/** Make polygons for each way-point pair of a lane batch, appending
+ *  them to @a polys.
+ */
+void MapLanes::MakeLanePolys(LaneBatch &b, std::vector<poly> &polys)
+{
+  SmoothCurve lc,rc;
+  for (uint i=0;i<b.lane.size()-1;i++)
+    MakeLanePolygon(polys,b.lane[i],b.lane[i+1],b.edges[i],
+		    b.c.knots[b.lane_map[i]],
+		    b.c.knots[b.lane_map[i+1]],
+		    b.c, true,
+		    0,0,lc,0,0,rc);
+}
+
+void MapLanes::SetFilteredPolygons()
+{
+  local_dirty=true;
+  filtPolys.build(allPolys, tile_size, max_tiles);
+
   #ifdef DEBUGMAP
   for (int i=0; i<(int)filtPolys.size(); i++) {
     WritePolygonToDebugFile(i);	
@@ -396,7 +467,8 @@ poly MapLanes::build_waypoint_poly(const WayPointNode& w1,
 }
 
 
-void MapLanes::MakeLanePolygon(WayPointNode w1, WayPointNode w2,
+void MapLanes::MakeLanePolygon(std::vector<poly> &polys,
+			       WayPointNode w1, WayPointNode w2,
 			       WayPointEdge e,
 			       float time1, float time2,
 			       SmoothCurve& c,
@@ -412,7 +484,7 @@ void MapLanes::MakeLanePolygon(WayPointNode w1, WayPointNode w2,
 
   // Not necessary because of how this is called, but do this just in
   // case
-  if (poly_id_counter==0)
+  if (polys.empty())
     new_edge=true;
 
   Point2f w1_pt=c.evaluatePoint(time1);
@@ -427,22 +499,21 @@ void MapLanes::MakeLanePolygon(WayPointNode w1, WayPointNode w2,
       poly poly_w1;
 
       // if new lane, make polygon for start node
-      if (poly_id_counter == 0 ||
-	  ElementID(allPolys[poly_id_counter-1].end_way) != w1.id)
+      if (polys.empty() ||
+	  ElementID(polys.back().end_way) != w1.id)
 	{
 	  poly_w1=build_waypoint_poly(w1, e, w1_pt, time1, c);  
 	  
-	  poly_w1.poly_id = poly_id_counter;
+	  poly_w1.poly_id = polys.size();
 	  
 	  // Add the poly to the list
-	  poly_id_counter++;
-	  allPolys.push_back(poly_w1);
+	  polys.push_back(poly_w1);
 	  
 	}
       else  
 	// If not a new lane, get lane waypoint, which should be last
 	// one pushed onto list
-	poly_w1=allPolys[poly_id_counter-1];
+	poly_w1=polys.back();
       
       // Make new polygon around second waypoint, but only add it
       // after recursive all for intermediate polygons
@@ -532,25 +603,24 @@ void MapLanes::MakeLanePolygon(WayPointNode w1, WayPointNode w2,
 	  float lmidtime=(ltime1+ltime2)/2;
 	  float rmidtime=(rtime1+rtime2)/2;
 
-	  MakeLanePolygon(w1, midpoint, e, time1, midtime, c, false,
+	  MakeLanePolygon(polys, w1, midpoint, e, time1, midtime, c, false,
 			  ltime1, lmidtime, lc, rtime1, rmidtime, rc);
 	  
 	  midpoint.id=w1.id;
 	  
-	  MakeLanePolygon(midpoint, w2, e, midtime, time2, c, false,
+	  MakeLanePolygon(polys, midpoint, w2, e, midtime, time2, c, false,
 			  lmidtime, ltime2, lc, rmidtime, rtime2, rc);
 	}
       
       // Now add final waypoint polygon
-      poly_w2.poly_id = poly_id_counter;
+      poly_w2.poly_id = polys.size();
       
       // Force last polygon before waypoint to touch waypoint.
-      allPolys[poly_id_counter-1].p2=poly_w2.p1;
-      allPolys[poly_id_counter-1].p3=poly_w2.p4;
+      polys.back().p2=poly_w2.p1;
+      polys.back().p3=poly_w2.p4;
 
       // Add the poly to the list
-      poly_id_counter++;
-      allPolys.push_back(poly_w2);
+      polys.push_back(poly_w2);
 
     }
   else 
@@ -578,8 +648,8 @@ void MapLanes::MakeLanePolygon(WayPointNode w1, WayPointNode w2,
 	  poly newPoly;
 	  
 	  // Create the edges of the poly
-	  newPoly.p1=allPolys[poly_id_counter-1].p2;
-	  newPoly.p4=allPolys[poly_id_counter-1].p3;
+	  newPoly.p1=polys.back().p2;
+	  newPoly.p4=polys.back().p3;
 
 	  Point2f point2=lc.evaluatePoint(ltime2);
 	  Point2f point3=rc.evaluatePoint(rtime2);
@@ -601,7 +671,7 @@ void MapLanes::MakeLanePolygon(WayPointNode w1, WayPointNode w2,
 	  newPoly.is_stop = false;
 	  newPoly.is_transition = false;
 	  newPoly.contains_way = false;
-	  newPoly.poly_id = poly_id_counter;
+	  newPoly.poly_id = polys.size();
 #if 0 //TODO
           newPoly.left_boundary=e.left_boundary;
  	  newPoly.right_boundary=e.right_boundary;
@@ -615,8 +685,7 @@ void MapLanes::MakeLanePolygon(WayPointNode w1, WayPointNode w2,
 	  newPoly.length = ops.getLength(newPoly);
 
 	  // Add the poly to the list
-	  poly_id_counter++;
-	  allPolys.push_back(newPoly);
+	  polys.push_back(newPoly);
 	  
 	}
       else
@@ -639,10 +708,10 @@ void MapLanes::MakeLanePolygon(WayPointNode w1, WayPointNode w2,
 	  float lmidtime=(ltime1+ltime2)/2;
 	  float rmidtime=(rtime1+rtime2)/2;
 
-	  MakeLanePolygon(w1, midpoint, e, time1, midtime, c, false,
+	  MakeLanePolygon(polys, w1, midpoint, e, time1, midtime, c, false,
 			  ltime1,lmidtime,lc,rtime1,rmidtime,rc);
 	  midpoint.id=w1.id;
-	  MakeLanePolygon(midpoint, w2, e, midtime, time2, c, false,
+	  MakeLanePolygon(polys, midpoint, w2, e, midtime, time2, c, false,
 			  lmidtime,ltime2,lc,rmidtime,rtime2,rc);
 	}
     }
@@ -750,7 +819,7 @@ void MapLanes::MakeTransitionPolygon(WayPointNode w1, WayPointNode w2,
 	  float lmidtime=(ltime1+ltime2)/2;
 	  float rmidtime=(rtime1+rtime2)/2;
 
-	  int next_polyid=poly_id_counter;
+	  int next_polyid=allPolys.size();
 
 	  e.left_boundary=UNDEFINED;
 	  e.right_boundary=UNDEFINED;
@@ -758,7 +827,7 @@ void MapLanes::MakeTransitionPolygon(WayPointNode w1, WayPointNode w2,
 	  transition=true;
 	  trans_index=index_w1;
 
-	  MakeLanePolygon(w1, midpoint, e, time1, midtime, c, false,
+	  MakeLanePolygon(allPolys, w1, midpoint, e, time1, midtime, c, false,
 			  ltime1,lmidtime,lc,rtime1,rmidtime,rc);
 	  
 	  // Ensure start of transition attaches to polygon around starting
@@ -770,14 +839,14 @@ void MapLanes::MakeTransitionPolygon(WayPointNode w1, WayPointNode w2,
 	  
 	  midpoint.id=w1.id;
 
-	  MakeLanePolygon(midpoint, w2, e,  midtime, time2, c, false,
+	  MakeLanePolygon(allPolys, midpoint, w2, e,  midtime, time2, c, false,
 			  lmidtime,ltime2,lc,rmidtime,rtime2,rc);
 	  // Ensure end of transition attaches to polygon around ending
 	  // waypoint.
 	  
 	  // Remove for end of transition polygons      
-	  allPolys[poly_id_counter-1].p2=poly_w2.p1;
-	  allPolys[poly_id_counter-1].p3=poly_w2.p4;
+	  allPolys.back().p2=poly_w2.p1;
+	  allPolys.back().p3=poly_w2.p4;
 	  
 	  for (uint i=next_polyid; i<allPolys.size(); i++)
 	    allPolys[i].is_transition=true;
@@ -800,7 +869,7 @@ int MapLanes::getAllLanes(art_msgs::ArtLanes *lanes)
 
   for(unsigned int i = 0; i < filtPolys.size(); i++)
     {
-      art_msgs::ArtQuadrilateral temp = filtPolys.at(i).GetQuad();
+      art_msgs::ArtQuadrilateral temp = filtPolys.quad(i);
       lanes->polygons.push_back(temp);
     }
 
@@ -808,22 +877,66 @@ int MapLanes::getAllLanes(art_msgs::ArtLanes *lanes)
 }
 
 
+/** find polygons near a point for getLanes().
+ *
+ *  Indexes the filtered polygon midpoints first, if they changed.
+ *
+ *  @post local_ids and local_quads hold every polygon within range
+ *        plus reuse_distance of @a here, in filtPolys order.
+ */
+void MapLanes::FindLocalPolys(MapXY here)
+{
+  if (local_dirty)
+    {
+      std::vector<MapXY> midpoints(filtPolys.size());
+      for(unsigned int i = 0; i < filtPolys.size(); i++)
+        midpoints[i] = filtPolys.polygon(i).midpoint;
+      local_grid.build(midpoints, range / 4);
+      local_dirty = false;
+    }
+
+  // an extra centimeter covers float rounding in the distances
+  local_grid.within(here, range + reuse_distance + 0.01, local_ids);
+  local_quads.resize(local_ids.size());
+  for(unsigned int k = 0; k < local_ids.size(); k++)
+    local_quads[k] = filtPolys.quad(local_ids[k]);
+
+  local_center = here;
+  local_valid = true;
+}
+
+/** copy polygons within range of a point to an ArtLanes message.
+ *
+ *  Only searches the map when the point is at least reuse_distance
+ *  from where it last did.  Any polygon within range of @a here is
+ *  within range plus reuse_distance of that spot, so otherwise the
+ *  polygons found then are enough.
+ *
+ * @return 0
+ */
 int MapLanes::getLanes(art_msgs::ArtLanes *lanes, MapXY here)
 {
   if (range < 0)
     return getAllLanes(lanes);
 
+  if (!local_valid || local_dirty
+      || Euclidean::DistanceTo(here, local_center) >= reuse_distance)
+    FindLocalPolys(here);
+
+  // page in filtered polygon tiles that will be needed soon
+  filtPolys.setPose(here, range + reuse_distance);
+
   lanes->polygons.clear();
 
-  for(unsigned int i = 0; i < filtPolys.size(); i++)
+  for(unsigned int k = 0; k < local_quads.size(); k++)
     {
-      art_msgs::ArtQuadrilateral temp = filtPolys.at(i).GetQuad();
+      const art_msgs::ArtQuadrilateral &temp = local_quads[k];
       float dist = Euclidean::DistanceTo(MapXY(temp.midpoint), here);
       
       if(dist <= range)
         {
           lanes->polygons.push_back(temp);
-          allPolys[i] = poly(temp);
+          allPolys[local_ids[k]] = poly(temp);
         }
     }
 
@@ -851,7 +964,7 @@ int MapLanes::getVisionLanes(art_msgs::ArtLanes *lanes, float x, float y,
   poly current = allPolys.at(index);
   for(unsigned int i = 0; i < filtPolys.size(); i++)
     {
-      art_msgs::ArtQuadrilateral temp = filtPolys.at(i).GetQuad();
+      art_msgs::ArtQuadrilateral temp = filtPolys.quad(i);
 
       if (temp.start_way.lane != current.start_way.lane
           || temp.start_way.seg != current.start_way.seg
@@ -878,8 +991,7 @@ void MapLanes::UpdatePoly(polyUpdate upPoly, float rrX, float rrY, float rrOri)
     return;
   }
   if (upPoly.distance<3.0) return;
-  FilteredPolygon* filt=&(filtPolys.at(upPoly.poly_id));
-  poly curr=filt->GetPolygon();
+  poly curr=filtPolys.polygon(upPoly.poly_id);
   
   // Don't break waypoints !
   if (upPoly.poly_id <=0 || upPoly.poly_id>=(int)filtPolys.size()) {
@@ -888,8 +1000,8 @@ void MapLanes::UpdatePoly(polyUpdate upPoly, float rrX, float rrY, float rrOri)
   //printf("Good %i \n",upPoly.poly_id);
 
   //printf("1 %i %lf %lf\n",upPoly.poly_id,upPoly.distance,upPoly.bearing);
-  poly prev=(filtPolys.at(upPoly.poly_id-1)).GetPolygon();
-  poly next=(filtPolys.at(upPoly.poly_id+1)).GetPolygon();
+  poly prev=filtPolys.polygon(upPoly.poly_id-1);
+  poly next=filtPolys.polygon(upPoly.poly_id+1);
   // Don't update the bottom points if they touch a waypoint
   if (prev.contains_way && (upPoly.point_id==0 || upPoly.point_id==3)) return;
   // Don't update the top points if they touch a waypoint
@@ -897,7 +1009,8 @@ void MapLanes::UpdatePoly(polyUpdate upPoly, float rrX, float rrY, float rrOri)
 
   //static gaussian g1(0.0,3.0);
   //upPoly.distance=upPoly.distance+g1.get_sample_1D();
-  filt->UpdatePoint(upPoly.point_id,upPoly.distance,upPoly.bearing,upPoly.confidence,rrX,rrY,Normalise_PI(rrOri+PI));
+  local_dirty=true;
+  filtPolys.updatePoint(upPoly.poly_id,upPoly.point_id,upPoly.distance,upPoly.bearing,upPoly.confidence,rrX,rrY,Normalise_PI(rrOri+PI));
   
   #ifdef DEBUGMAP
    WritePolygonToDebugFile(upPoly.poly_id);
@@ -905,20 +1018,18 @@ void MapLanes::UpdatePoly(polyUpdate upPoly, float rrX, float rrY, float rrOri)
 
   int point=0;
   if ((upPoly.point_id==0 || upPoly.point_id==3) && curr.poly_id==prev.poly_id+1 && curr.start_way.lane==prev.start_way.lane && curr.start_way.seg==prev.start_way.seg) {
-     FilteredPolygon* temp=&(filtPolys.at(prev.poly_id));
      if (upPoly.point_id==0) point=1; 
      if (upPoly.point_id==3) point=2;
-     temp->UpdatePoint(point,upPoly.distance,upPoly.bearing,upPoly.confidence,rrX,rrY,Normalise_PI(rrOri+PI));
+     filtPolys.updatePoint(prev.poly_id,point,upPoly.distance,upPoly.bearing,upPoly.confidence,rrX,rrY,Normalise_PI(rrOri+PI));
      
      #ifdef DEBUGMAP
        WritePolygonToDebugFile(prev.poly_id);
      #endif
   }
   if ((upPoly.point_id==1 || upPoly.point_id==2) && curr.poly_id==next.poly_id-1 && curr.start_way.lane==next.start_way.lane && curr.start_way.seg==next.start_way.seg) {
-     FilteredPolygon* temp=&(filtPolys.at(next.poly_id));
      if (upPoly.point_id==1) point=0; 
      if (upPoly.point_id==2) point=3;
-     temp->UpdatePoint(point,upPoly.distance,upPoly.bearing,upPoly.confidence,rrX,rrY,Normalise_PI(rrOri+PI));
+     filtPolys.updatePoint(next.poly_id,point,upPoly.distance,upPoly.bearing,upPoly.confidence,rrX,rrY,Normalise_PI(rrOri+PI));
   
      #ifdef DEBUGMAP
        WritePolygonToDebugFile(next.poly_id);
@@ -928,25 +1039,25 @@ void MapLanes::UpdatePoly(polyUpdate upPoly, float rrX, float rrY, float rrOri)
 
 void MapLanes::UpdateWithCurrent(int i){
   static gaussian g1(0.0,1.0);
-  FilteredPolygon* filt=&(filtPolys.at(i));
-  poly temp2 = filtPolys.at(i).GetPolygon();
+  poly temp2 = filtPolys.polygon(i);
   if (temp2.is_transition || temp2.contains_way) return;
+  local_dirty=true;
 
   float angle=AngleFromXY(rX,rY,rOri,temp2.p1.x,temp2.p1.y);
   float distU=DistFromXY(rX,rY,temp2.p1.x,temp2.p1.y);
-  if (distU>5 && distU<80 && fabs(angle) < 0.2) filt->UpdatePoint(0,distU+g1.get_sample_1D(),angle,1.0,rX,rY,rOri);
+  if (distU>5 && distU<80 && fabs(angle) < 0.2) filtPolys.updatePoint(i,0,distU+g1.get_sample_1D(),angle,1.0,rX,rY,rOri);
       
   angle=AngleFromXY(rX,rY,rOri,temp2.p2.x,temp2.p2.y);
   distU=DistFromXY(rX,rY,temp2.p2.x,temp2.p2.y);
-  if (distU>5 && distU<80 && fabs(angle) < 0.2) filt->UpdatePoint(1,distU+g1.get_sample_1D(),angle,1.0,rX,rY,rOri);
+  if (distU>5 && distU<80 && fabs(angle) < 0.2) filtPolys.updatePoint(i,1,distU+g1.get_sample_1D(),angle,1.0,rX,rY,rOri);
 
   angle=AngleFromXY(rX,rY,rOri,temp2.p3.x,temp2.p3.y);
   distU=DistFromXY(rX,rY,temp2.p3.x,temp2.p3.y);
-  if (distU>5 && distU<80 && fabs(angle) < 0.2) filt->UpdatePoint(2,distU+g1.get_sample_1D(),angle,1.0,rX,rY,rOri);     
+  if (distU>5 && distU<80 && fabs(angle) < 0.2) filtPolys.updatePoint(i,2,distU+g1.get_sample_1D(),angle,1.0,rX,rY,rOri);     
 
   angle=AngleFromXY(rX,rY,rOri,temp2.p4.x,temp2.p4.y);
   distU=DistFromXY(rX,rY,temp2.p4.x,temp2.p4.y);
-  if (distU>5 && distU<80 && fabs(angle) < 0.2) filt->UpdatePoint(3,distU+g1.get_sample_1D(),angle,1.0,rX,rY,rOri);
+  if (distU>5 && distU<80 && fabs(angle) < 0.2) filtPolys.updatePoint(i,3,distU+g1.get_sample_1D(),angle,1.0,rX,rY,rOri);
 }
 
 
@@ -973,7 +1084,7 @@ void MapLanes::testDraw(bool with_trans, const ZonePerimeterList &zones)
 
   for(int i = 0; i < (int)filtPolys.size(); i++)
     {
-      poly node=(filtPolys.at(i).GetPolygon());
+      poly node=(filtPolys.polygon(i));
       double lon,lat;
       UTM::UTMtoLL(cY+node.midpoint.y+yOff,cX+node.midpoint.x+xOff,
                    "11S",lon,lat);
@@ -1057,7 +1168,7 @@ void MapLanes::testDraw(bool with_trans, const ZonePerimeterList &zones)
   //draw polygons
   for(int i = 0; i < (int)filtPolys.size(); i++)
     {
-      poly temp = filtPolys.at(i).GetPolygon();
+      poly temp = filtPolys.polygon(i);
       polyImage->addPoly(temp.p1.x-min_x, temp.p2.x-min_x, 
 			 temp.p3.x-min_x,temp.p4.x-min_x, 
 			 max_y-temp.p1.y, max_y-temp.p2.y, 
@@ -1084,7 +1195,7 @@ void MapLanes::testDraw(bool with_trans, const ZonePerimeterList &zones)
 
 #ifdef DEBUGMAP
 void MapLanes::WritePolygonToDebugFile(int i) {
-  poly node=(filtPolys.at(i).GetPolygon());
+  poly node=(filtPolys.polygon(i));
   fprintf(debugFile,"%i %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %i %i\n",
           i,node.p1.x,node.p1.y,node.p2.x,node.p2.y,
           node.p3.x,node.p3.y,node.p4.x,node.p4.y,
@@ -1118,7 +1229,8 @@ bool MapLanes::WriteToFile(char* fName) {
   }  
   for(int i = 0; i < sizeFilt; i++)
   {
-    ret=fwrite(&(filtPolys.at(i)),sizeof(FilteredPolygon),1,f);
+    FilteredPolygon fp = filtPolys.filtered(i);
+    ret=fwrite(&fp,sizeof(FilteredPolygon),1,f);
     if (ret<1) {
       ROS_WARN("MapLanes::WriteToFile Failed - Failed FilteredPoylgon write");
       return false;
@@ -1129,6 +1241,7 @@ bool MapLanes::WriteToFile(char* fName) {
 }
 
 bool MapLanes::LoadFromFile(char* fName) {
+  local_dirty=true;
   FILE* f = fopen(fName,"rb");
 
   if (f==NULL) {
@@ -1185,6 +1298,7 @@ bool MapLanes::LoadFromFile(char* fName) {
     allPolys.push_back(p);
   }  
   FilteredPolygon fp;
+  std::vector<FilteredPolygon> filt;
   for(int i = 0; i < sizeFilt; i++)
   {
     ret=fread(&fp,sizeof(FilteredPolygon),1,f);
@@ -1194,8 +1308,16 @@ bool MapLanes::LoadFromFile(char* fName) {
       filtPolys.clear();
       return false;
     }
-    filtPolys.push_back(fp);
+    filt.push_back(fp);
   }
   fclose(f);
+
+  // the loaded polygons may have been updated, so keep them all
+  std::vector<poly> seeds(filt.size());
+  for(int i = 0; i < sizeFilt; i++)
+    seeds[i] = filt[i].GetPolygon();
+  filtPolys.build(seeds, tile_size, max_tiles);
+  for(int i = 0; i < sizeFilt; i++)
+    filtPolys.set(i, filt[i]);
   return true;
 }
@@ -0,0 +1,97 @@
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     Uniform grid of map points.
+
+ */
+
+#include <algorithm>
+
+#include <art_map/PointGrid.h>
+
+void PointGrid::build(const std::vector<MapXY> &points, float cell_size)
+{
+  clear();
+  points_ = points;
+  unsigned npoints = points_.size();
+  if (npoints == 0)
+    return;
+
+  float max_x, max_y;
+  min_x_ = max_x = points_[0].x;
+  min_y_ = max_y = points_[0].y;
+  for (unsigned i = 1; i < npoints; ++i)
+    {
+      min_x_ = std::min(min_x_, points_[i].x);
+      max_x = std::max(max_x, points_[i].x);
+      min_y_ = std::min(min_y_, points_[i].y);
+      max_y = std::max(max_y, points_[i].y);
+    }
+
+  // A sparse map spread over many kilometers would otherwise need a
+  // huge, nearly empty array of cells.
+  cell_ = (cell_size > 0.0? cell_size: 1.0);
+  for (;;)
+    {
+      nx_ = (int) ((max_x - min_x_) / cell_) + 1;
+      ny_ = (int) ((max_y - min_y_) / cell_) + 1;
+      if ((double) nx_ * ny_ <= 4.0 * npoints + 64)
+	break;
+      cell_ *= 2.0;
+    }
+
+  // counting sort of point indexes by cell, keeping them in
+  // ascending order within each cell
+  std::vector<unsigned> in_cell(npoints);
+  start_.assign(nx_ * ny_ + 1, 0);
+  for (unsigned i = 0; i < npoints; ++i)
+    {
+      in_cell[i] = (cell(points_[i].y, min_y_, ny_) * nx_
+		    + cell(points_[i].x, min_x_, nx_));
+      ++start_[in_cell[i] + 1];
+    }
+  for (unsigned c = 0; c < start_.size() - 1; ++c)
+    start_[c+1] += start_[c];
+
+  std::vector<unsigned> next(start_.begin(), start_.end() - 1);
+  entries_.resize(npoints);
+  for (unsigned i = 0; i < npoints; ++i)
+    entries_[next[in_cell[i]]++] = i;
+}
+
+void PointGrid::within(const MapXY &p, float radius,
+		       std::vector<unsigned> &result) const
+{
+  result.clear();
+  if (points_.empty() || !(radius >= 0.0))
+    return;
+
+  // Visit every cell the circle touches, allowing for float rounding
+  // in the cell computation.  The distance test below decides.
+  float reach = radius * (1.0 + 1e-5) + 1e-3;
+  int x0 = cell(p.x - reach, min_x_, nx_);
+  int x1 = cell(p.x + reach, min_x_, nx_);
+  int y0 = cell(p.y - reach, min_y_, ny_);
+  int y1 = cell(p.y + reach, min_y_, ny_);
+
+  for (int cy = y0; cy <= y1; ++cy)
+    for (int cx = x0; cx <= x1; ++cx)
+      {
+	int c = cy * nx_ + cx;
+	for (unsigned e = start_[c]; e < start_[c+1]; ++e)
+	  {
+	    unsigned i = entries_[e];
+	    if (Euclidean::DistanceTo(points_[i], p) <= radius)
+	      result.push_back(i);
+	  }
+      }
+
+  std::sort(result.begin(), result.end());
+}
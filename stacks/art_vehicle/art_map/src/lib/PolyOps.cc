@@ -20,6 +20,7 @@
 #include <assert.h>
 #include <limits>
 #include <iostream>
+#include <algorithm>
 
 #include <art/epsilon.h>
 
@@ -107,6 +108,21 @@ int PolyOps::getContainingPoly(const std::vector<poly> &polys,
   return -1;			// no match
 }
 
+int PolyOps::getContainingPoly(const std::vector<poly> &polys,
+			       const QuadGeometry &geom, float x, float y)
+{
+  if (!geom.indexes(polys))
+    return getContainingPoly(polys, x, y);
+
+  int pindex = getClosestPoly(polys, geom, x, y);
+  if (pindex >= 0
+      && dist_to_quad(geom, pindex, x, y) < Epsilon::distance)
+    return pindex;
+
+  ROS_DEBUG("no polygon contains point (%.3f, %.3f)", x, y);
+  return -1;			// no match
+}
+
 /*
   int PolyOps::getContainingPoly(const std::vector<poly>& polys, 
   float x, float y)
@@ -157,6 +173,85 @@ float PolyOps::getShortestDistToPoly(float x, float y, const poly& p)
   return dist;
 }
 
+bool PolyOps::pointInPoly(float x, float y, const std::vector<poly> &polys,
+			  const QuadGeometry &geom, unsigned i)
+{
+  if (!geom.indexes(polys))
+    return pointInPoly(x, y, polys[i]);
+  return point_in_quad(geom, i, x, y);
+}
+
+float PolyOps::getShortestDistToPoly(float x, float y,
+				     const std::vector<poly> &polys,
+				     const QuadGeometry &geom, unsigned i)
+{
+  if (!geom.indexes(polys))
+    return getShortestDistToPoly(x, y, polys[i]);
+  return dist_to_quad(geom, i, x, y);
+}
+
+void PolyOps::pointsInPolys(const float x[], const float y[], unsigned n,
+			    const std::vector<poly> &polys,
+			    const QuadGeometry &geom, unsigned char in[])
+{
+  for (unsigned j = 0; j < n; ++j)
+    in[j] = 0;
+
+  if (!geom.indexes(polys))
+    {
+      for (unsigned j = 0; j < n; ++j)
+	for (unsigned i = 0; i < polys.size() && !in[j]; ++i)
+	  in[j] = pointInPoly(x[j], y[j], polys[i]);
+      return;
+    }
+  if (n == 0)
+    return;
+
+  std::vector<unsigned char> inside(n), hull(n);
+  for (unsigned i = 0; i < polys.size(); ++i)
+    {
+      geom.pointsInside(i, false, 0, x, y, n, &inside[0], &hull[0]);
+      for (unsigned j = 0; j < n; ++j)
+	{
+	  // points in the hull but not inside may be on an edge
+	  if (inside[j]
+	      || (hull[j] && !in[j] && pointOnEdges(x[j], y[j], polys[i])))
+	    in[j] = 1;
+	}
+    }
+}
+
+// pointInPoly() for a current QuadGeometry entry
+bool PolyOps::point_in_quad(const QuadGeometry &geom, unsigned i,
+			    float x, float y)
+{
+  if (!geom.pointInHull(i, x, y))
+    return false;
+
+  if (geom.pointInside(i, x, y))
+    return true;
+
+  // same edge order as pointOnEdges()
+  MapXY p1 = geom.vertex(i, 0);
+  MapXY p2 = geom.vertex(i, 1);
+  MapXY p3 = geom.vertex(i, 2);
+  MapXY p4 = geom.vertex(i, 3);
+  return (pointOnSegment(x, y, p1, p2) ||
+	  pointOnSegment(x, y, p3, p2) ||
+	  pointOnSegment(x, y, p4, p3) ||
+	  pointOnSegment(x, y, p1, p4));
+}
+
+// getShortestDistToPoly() for a current QuadGeometry entry
+float PolyOps::dist_to_quad(const QuadGeometry &geom, unsigned i,
+			    float x, float y)
+{
+  if (point_in_quad(geom, i, x, y))
+    return 0;
+
+  return geom.edgeDistance(i, x, y);
+}
+
 // if the point lies within a polygon, that polygon is returned.
 // otherwise, the nearest polygon from the list is returned index of
 // winning poly within list is stored in index
@@ -196,6 +291,32 @@ int PolyOps::getClosestPoly(const std::vector<poly>& polys, float x,
   return index;
 }
 
+int PolyOps::getClosestPoly(const std::vector<poly>& polys,
+			    const QuadGeometry &geom, float x, float y)
+{
+  if (!geom.indexes(polys))
+    return getClosestPoly(polys, x, y);
+
+  int index = -1;
+  float min_dist = std::numeric_limits<float>::max();
+
+  for (int i = 0; (unsigned)i < polys.size(); i++)
+    {
+      float d = dist_to_quad(geom, i, x, y);
+
+      if (Epsilon::equal(d,0)) // point is inside polygon
+	return i;
+
+      if (i == 0 || d < min_dist) // new minimum
+	{
+	  min_dist = d;
+	  index = i;
+	}
+    }
+
+  return index;
+}
+
 // if the point lies within a non-transtion polygon, that polygon is returned.
 // otherwise, the nearest non-transition polygon from the list is returned.
 // index of winning non-transition poly within list is stored in index.
@@ -451,6 +572,19 @@ int PolyOps::get_waypoint_index(const std::vector<poly> &polys,
   return -1;			// no match
 }
 
+int PolyOps::get_waypoint_index(const std::vector<poly> &polys,
+				const PolyIndex &index,
+				const ElementID& waypoint)
+{
+  if (!index.indexes(polys))
+    return get_waypoint_index(polys, waypoint);
+
+  PolyIndex::range_t r = index.waypts(waypoint, waypoint);
+  if (r.first == r.second)
+    return -1;			// no match
+  return *r.first;
+}
+
 int PolyOps::getPolyWayPt(const std::vector<poly> &polys,
 				const ElementID& waypoint) {
 
@@ -500,6 +634,46 @@ void PolyOps::add_polys_for_waypts(const std::vector <poly> &from_polys,
       }
 }
 
+// indexed version of add_polys_for_waypts()
+void PolyOps::add_polys_for_waypts(const std::vector <poly> &from_polys,
+				   const PolyIndex &index,
+				   std::vector <poly> &to_polys,
+				   ElementID from_id, ElementID to_id)
+{
+  if (!index.indexes(from_polys))
+    {
+      add_polys_for_waypts(from_polys, to_polys, from_id, to_id);
+      return;
+    }
+
+  PolyIndex::range_t r;
+  if (from_id != to_id)
+    {
+      for (r = index.waypts(from_id, to_id); r.first != r.second; ++r.first)
+	{
+	  to_polys.push_back(from_polys.at(*r.first));
+#ifdef EXTREME_DEBUG
+	  ROS_DEBUG("adding start, end waypoints %s, %s, poly_id = %d",
+		    to_polys.back().start_way.name().str,
+		    to_polys.back().end_way.name().str,
+		    to_polys.back().poly_id);
+#endif
+	}
+    }
+
+  r = index.waypts(to_id, to_id);
+  if (r.first != r.second)
+    {
+      to_polys.push_back(from_polys.at(*r.first));
+#ifdef EXTREME_DEBUG
+      ROS_DEBUG("adding start, end waypoints %s, %s, poly_id = %d",
+		to_polys.back().start_way.name().str,
+		to_polys.back().end_way.name().str,
+		to_polys.back().poly_id);
+#endif
+    }
+}
+
 // add from_polys polygons matching segment and lane to to_polys
 void PolyOps::AddTransitionPolys(const std::vector <poly> &from_polys,
 				 std::vector <poly> &to_polys,
@@ -536,6 +710,21 @@ void PolyOps::AddLanePolys(const std::vector <poly> &from_polys,
   AddLanePolys(from_polys, to_polys, waypt.id);
 }
 
+// indexed version of AddLanePolys()
+void PolyOps::AddLanePolys(const std::vector <poly> &from_polys,
+			   const PolyIndex &index,
+			   std::vector <poly> &to_polys, ElementID id)
+{
+  if (!index.indexes(from_polys))
+    {
+      AddLanePolys(from_polys, to_polys, id);
+      return;
+    }
+
+  for (PolyIndex::range_t r = index.lane(id); r.first != r.second; ++r.first)
+    to_polys.push_back(from_polys.at(*r.first));
+}
+
 // add from_polys polygons matching segment and lane to to_polys
 // in either direction (reverse if direction < 0)
 void PolyOps::AddLanePolysEither(const std::vector <poly> &from_polys,
@@ -574,6 +763,22 @@ void PolyOps::AddReverseLanePolys(const std::vector <poly> &from_polys,
   AddReverseLanePolys(from_polys, to_polys, waypt.id);
 }
   
+// indexed version of AddReverseLanePolys()
+void PolyOps::AddReverseLanePolys(const std::vector <poly> &from_polys,
+				  const PolyIndex &index,
+				  std::vector <poly> &to_polys, ElementID id)
+{
+  if (!index.indexes(from_polys))
+    {
+      AddReverseLanePolys(from_polys, to_polys, id);
+      return;
+    }
+
+  PolyIndex::range_t r = index.lane(id);
+  while (r.second != r.first)
+    to_polys.push_back(from_polys.at(*--r.second));
+}
+  
 // Collect all polygons of from_poly from start to end from to_polys.
 void PolyOps::CollectPolys(const std::vector<poly> &from_polys,
 			   std::vector<poly> &to_polys,
@@ -772,6 +977,19 @@ float PolyOps::length_between_polygons(const std::vector<poly>& polygons,
 				       int index1,
 				       int index2) 
 {
+  return length_between_polygons(polygons, NULL, index1, index2);
+}
+
+// Total length of polygons strictly between index1 and index2, using
+// lengths if it is current for this list.
+float PolyOps::length_between_polygons(const std::vector<poly>& polygons,
+				       const LaneLengths *lengths,
+				       int index1,
+				       int index2) 
+{
+  if (lengths && lengths->indexes(polygons))
+    return lengths->length(std::max(0, index1) + 1, index2);
+
   float length = 0;
 
   index1=std::max(0,index1);
@@ -804,6 +1022,14 @@ float PolyOps::distanceAlongLane(const std::vector<poly>& polygons,
   return (specialDistanceAlongLane(polygons, from, to)).first;
 }
 
+float PolyOps::distanceAlongLane(const std::vector<poly>& polygons,
+				 const LaneLengths& lengths,
+				 const MapXY& from,
+				 const MapXY& to)
+{
+  return (specialDistanceAlongLane(polygons, &lengths, from, to)).first;
+}
+
 //Required by observers. 
 // Returns the projection of start point on to the lane
 // and the distance along the lane to the 'to' point
@@ -811,6 +1037,24 @@ std::pair<float, MapXY>
 PolyOps::specialDistanceAlongLane(const std::vector<poly>& polygons,
 				  const MapXY& from,
 				  const MapXY& to)
+{
+  return specialDistanceAlongLane(polygons, NULL, from, to);
+}
+
+std::pair<float, MapXY> 
+PolyOps::specialDistanceAlongLane(const std::vector<poly>& polygons,
+				  const LaneLengths& lengths,
+				  const MapXY& from,
+				  const MapXY& to)
+{
+  return specialDistanceAlongLane(polygons, &lengths, from, to);
+}
+
+std::pair<float, MapXY> 
+PolyOps::specialDistanceAlongLane(const std::vector<poly>& polygons,
+				  const LaneLengths *lengths,
+				  const MapXY& from,
+				  const MapXY& to)
 {
   //Check if all Polygons are in the same lane
   int index1=getClosestPoly(polygons, from);
@@ -844,7 +1088,8 @@ PolyOps::specialDistanceAlongLane(const std::vector<poly>& polygons,
 				  distance_start, tmp);
       Euclidean::DistanceFromLine(end_point, poly_end.p1, poly_end.p4,
 				  distance_end, tmp);
-      polygon_length = length_between_polygons(polygons, index1, index2);
+      polygon_length = length_between_polygons(polygons, lengths,
+						 index1, index2);
     }
   else if (index1 > index2)		// target is behind?
     {
@@ -852,7 +1097,8 @@ PolyOps::specialDistanceAlongLane(const std::vector<poly>& polygons,
 				  distance_start, tmp);
       Euclidean::DistanceFromLine(end_point, poly_end.p2, poly_end.p3,
 				  distance_end, tmp);
-      polygon_length = length_between_polygons(polygons, index2, index1);
+      polygon_length = length_between_polygons(polygons, lengths,
+						 index2, index1);
     }
   else					// target in the same polygon
     {
@@ -926,6 +1172,15 @@ std::set<ElementID> PolyOps::getPolyLaneIds(const std::vector<poly>& polys)
   return lane_ids;
 }
 
+// indexed version of getPolyLaneIds()
+std::set<ElementID> PolyOps::getPolyLaneIds(const std::vector<poly>& polys,
+                                            const PolyIndex &index)
+{
+  if (!index.indexes(polys))
+    return getPolyLaneIds(polys);
+  return index.lane_ids();
+}
+
 #if 0 //TODO
 // Return a unique lane ID corresponding to the polys/dir given
 // (uses transition polygons to determine closest lanes)
@@ -1102,11 +1357,22 @@ void PolyOps::getLaneDir(const std::vector<poly>& polys,
                          const int relative,
                          const int direction,
                          const MapPose &pose) 
+{
+  getLaneDir(polys, to_polys, relative, direction, pose,
+             getClosestPoly(polys, pose));
+}
+
+// Same, given the index of the polygon closest to pose
+void PolyOps::getLaneDir(const std::vector<poly>& polys,
+                         std::vector<poly>& to_polys,
+                         const int relative,
+                         const int direction,
+                         const MapPose &pose,
+                         int cur_poly_index) 
 {
   // Clear this out here in case this function returns early.
   to_polys.clear();
 
-  int cur_poly_index = getClosestPoly(polys, pose);
   if (cur_poly_index == -1) {
     ROS_DEBUG("PolyOps::getLaneDir: No poly found");
     return;
@@ -1528,3 +1794,293 @@ std::vector<MapXY> PolyOps::getRoadPerimeterPoints(
   return perim_points;
 
 }
+
+
+/////////////////////////////////////////////////////////////////
+// LaneLengths methods
+/////////////////////////////////////////////////////////////////
+
+void LaneLengths::build(const poly_list_t &polys)
+{
+  sum_.resize(polys.size() + 1);
+  sum_[0] = 0.0;
+  for (unsigned i = 0; i < polys.size(); ++i)
+    sum_[i+1] = sum_[i] + polys[i].length;
+
+  polys_ = &polys;
+  first_id_ = (polys.empty()? -1: polys.front().poly_id);
+  last_id_ = (polys.empty()? -1: polys.back().poly_id);
+}
+
+void LaneLengths::build(const art_msgs::ArtLanes &lanes)
+{
+  sum_.resize(lanes.polygons.size() + 1);
+  sum_[0] = 0.0;
+  for (unsigned i = 0; i < lanes.polygons.size(); ++i)
+    sum_[i+1] = sum_[i] + lanes.polygons[i].length;
+
+  // not built from a polygon list
+  polys_ = NULL;
+  first_id_ = last_id_ = -1;
+}
+
+void LaneLengths::clear()
+{
+  sum_.clear();
+  polys_ = NULL;
+  first_id_ = last_id_ = -1;
+}
+
+/////////////////////////////////////////////////////////////////
+// QuadGeometry methods
+/////////////////////////////////////////////////////////////////
+
+void QuadGeometry::Corners::resize(unsigned n)
+{
+  min_x.resize(n);
+  max_x.resize(n);
+  min_y.resize(n);
+  max_y.resize(n);
+  for (int k = 0; k < 4; ++k)
+    {
+      x[k].resize(n);
+      y[k].resize(n);
+      dx[k].resize(n);
+      dy[k].resize(n);
+    }
+}
+
+void QuadGeometry::Corners::set(unsigned i,
+				const float cx[4], const float cy[4])
+{
+  min_x[i] = fminf(fminf(fminf(cx[0],cx[1]),cx[2]),cx[3]);
+  min_y[i] = fminf(fminf(fminf(cy[0],cy[1]),cy[2]),cy[3]);
+  max_x[i] = fmaxf(fmaxf(fmaxf(cx[0],cx[1]),cx[2]),cx[3]);
+  max_y[i] = fmaxf(fmaxf(fmaxf(cy[0],cy[1]),cy[2]),cy[3]);
+  for (int k = 0; k < 4; ++k)
+    {
+      x[k][i] = cx[k];
+      y[k][i] = cy[k];
+      dx[k][i] = cx[(k+1)&3] - cx[k];
+      dy[k][i] = cy[(k+1)&3] - cy[k];
+    }
+}
+
+void QuadGeometry::resize(unsigned n)
+{
+  outer_.resize(n);
+  inner_.resize(n);
+  for (int k = 0; k < 4; ++k)
+    {
+      len2_[k].resize(n);
+      len_[k].resize(n);
+    }
+  mid_x_.resize(n);
+  mid_y_.resize(n);
+}
+
+/** set quad @a i from its corners, p1 through p4 */
+void QuadGeometry::set(unsigned i, const float cx[4], const float cy[4],
+		       double mx, double my)
+{
+  outer_.set(i, cx, cy);
+  for (int k = 0; k < 4; ++k)
+    {
+      float dx = outer_.dx[k][i];
+      float dy = outer_.dy[k][i];
+      len2_[k][i] = dx*dx + dy*dy;
+      len_[k][i] = sqrtf(len2_[k][i]);
+    }
+  mid_x_[i] = mx;
+  mid_y_[i] = my;
+
+  // inner quad, same arithmetic as quad_ops::quickPointInPolyRatio()
+  const float diff = (1-ratio_)/2;
+  float ix[4], iy[4];
+  ix[0] = cx[0] + (cx[3]-cx[0])*diff;
+  ix[3] = ix[0] + (cx[3]-ix[0])*(1-diff);
+  iy[0] = cy[0] + (cy[3]-cy[0])*diff;
+  iy[3] = iy[0] + (cy[3]-iy[0])*(1-diff);
+  ix[1] = cx[1] + (cx[2]-cx[1])*diff;
+  ix[2] = ix[1] + (cx[2]-ix[1])*(1-diff);
+  iy[1] = cy[1] + (cy[2]-cy[1])*diff;
+  iy[2] = iy[1] + (cy[2]-iy[1])*(1-diff);
+  inner_.set(i, ix, iy);
+}
+
+void QuadGeometry::build(const poly_list_t &polys, float ratio)
+{
+  ratio_ = ratio;
+  resize(polys.size());
+  for (unsigned i = 0; i < polys.size(); ++i)
+    {
+      const poly &p = polys[i];
+      float cx[4] = {p.p1.x, p.p2.x, p.p3.x, p.p4.x};
+      float cy[4] = {p.p1.y, p.p2.y, p.p3.y, p.p4.y};
+      set(i, cx, cy, p.midpoint.x, p.midpoint.y);
+    }
+
+  polys_ = &polys;
+  lanes_ = NULL;
+  first_id_ = (polys.empty()? -1: polys.front().poly_id);
+  last_id_ = (polys.empty()? -1: polys.back().poly_id);
+}
+
+void QuadGeometry::build(const art_msgs::ArtLanes &lanes, float ratio)
+{
+  ratio_ = ratio;
+  resize(lanes.polygons.size());
+  for (unsigned i = 0; i < lanes.polygons.size(); ++i)
+    {
+      const art_msgs::ArtQuadrilateral &q = lanes.polygons[i];
+      float cx[4], cy[4];
+      for (int k = 0; k < 4; ++k)
+	{
+	  cx[k] = q.poly.points[k].x;
+	  cy[k] = q.poly.points[k].y;
+	}
+      set(i, cx, cy, q.midpoint.x, q.midpoint.y);
+    }
+
+  polys_ = NULL;
+  lanes_ = &lanes;
+  first_id_ = (lanes.polygons.empty()? -1: lanes.polygons.front().poly_id);
+  last_id_ = (lanes.polygons.empty()? -1: lanes.polygons.back().poly_id);
+}
+
+void QuadGeometry::clear()
+{
+  resize(0);
+  polys_ = NULL;
+  lanes_ = NULL;
+  first_id_ = last_id_ = -1;
+}
+
+/** same result as PolyOps::shortestDistToLineSegment() for each
+ *  edge, using the cached edge vectors and lengths
+ */
+float QuadGeometry::edgeDistance(unsigned i, float x, float y) const
+{
+  float dist = 0;
+  for (int k = 0; k < 4; ++k)
+    {
+      float ax = outer_.x[k][i];
+      float ay = outer_.y[k][i];
+      float dx = outer_.dx[k][i];
+      float dy = outer_.dy[k][i];
+      float r = ((x-ax)*dx + (y-ay)*dy) / len2_[k][i];
+      float d;
+      if ((r >= 0) && (r <= 1))
+	{
+	  float s = ((ay-y)*dx - (ax-x)*dy) / len2_[k][i];
+	  d = fabs(s)*len_[k][i];
+	}
+      else
+	{
+	  float bx = outer_.x[(k+1)&3][i];
+	  float by = outer_.y[(k+1)&3][i];
+	  float dist1 = (x-ax)*(x-ax) + (y-ay)*(y-ay);
+	  float dist2 = (x-bx)*(x-bx) + (y-by)*(y-by);
+	  d = sqrtf(dist1 < dist2? dist1: dist2);
+	}
+      if (k == 0 || d < dist)
+	dist = d;
+    }
+  return dist;
+}
+
+/////////////////////////////////////////////////////////////////
+// PolyIndex methods
+/////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // compare sort keys of (key, position) pairs, ignoring position
+  struct CompareKey
+  {
+    template <class P>
+    bool operator()(const P &a, const P &b) const
+    {
+      return a.first < b.first;
+    }
+  };
+}
+
+// build index for a polygon list
+void PolyIndex::build(const poly_list_t &polys)
+{
+  std::vector<std::pair<ElementID, int> > lanes;
+  std::vector<std::pair<way_key_t, int> > ways;
+  lanes.reserve(polys.size());
+  ways.reserve(polys.size());
+  lane_ids_.clear();
+
+  for (unsigned i = 0; i < polys.size(); ++i)
+    {
+      const poly &p = polys[i];
+      ways.push_back(std::make_pair(way_key_t(p.start_way, p.end_way), i));
+      lane_ids_.insert(ElementID(p.start_way.seg, p.start_way.lane, 0));
+
+      // same test as PolyOps::LanePoly()
+      if (p.start_way.seg == p.end_way.seg
+	  && p.start_way.lane == p.end_way.lane
+	  && !p.is_transition)
+	lanes.push_back(std::make_pair(ElementID(p.start_way.seg,
+						 p.start_way.lane, 0), i));
+    }
+
+  // stable sorts keep each range in list order
+  std::stable_sort(lanes.begin(), lanes.end(), CompareKey());
+  std::stable_sort(ways.begin(), ways.end(), CompareKey());
+
+  lane_keys_.resize(lanes.size());
+  lane_pos_.resize(lanes.size());
+  for (unsigned i = 0; i < lanes.size(); ++i)
+    {
+      lane_keys_[i] = lanes[i].first;
+      lane_pos_[i] = lanes[i].second;
+    }
+
+  way_keys_.resize(ways.size());
+  way_pos_.resize(ways.size());
+  for (unsigned i = 0; i < ways.size(); ++i)
+    {
+      way_keys_[i] = ways[i].first;
+      way_pos_[i] = ways[i].second;
+    }
+
+  polys_ = &polys;
+  size_ = polys.size();
+}
+
+void PolyIndex::clear()
+{
+  lane_keys_.clear();
+  lane_pos_.clear();
+  way_keys_.clear();
+  way_pos_.clear();
+  lane_ids_.clear();
+  polys_ = NULL;
+  size_ = 0;
+}
+
+PolyIndex::range_t PolyIndex::lane(const ElementID &id) const
+{
+  std::pair<std::vector<ElementID>::const_iterator,
+    std::vector<ElementID>::const_iterator> keys =
+    std::equal_range(lane_keys_.begin(), lane_keys_.end(),
+		     ElementID(id.seg, id.lane, 0));
+  return range_t(lane_pos_.begin() + (keys.first - lane_keys_.begin()),
+		 lane_pos_.begin() + (keys.second - lane_keys_.begin()));
+}
+
+PolyIndex::range_t PolyIndex::waypts(const ElementID &from_id,
+				     const ElementID &to_id) const
+{
+  std::pair<std::vector<way_key_t>::const_iterator,
+    std::vector<way_key_t>::const_iterator> keys =
+    std::equal_range(way_keys_.begin(), way_keys_.end(),
+		     way_key_t(from_id, to_id));
+  return range_t(way_pos_.begin() + (keys.first - way_keys_.begin()),
+		 way_pos_.begin() + (keys.second - way_keys_.begin()));
+}
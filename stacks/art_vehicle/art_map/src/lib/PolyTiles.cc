@@ -0,0 +1,323 @@
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     Tiled store of MapLanes filtered polygons.
+
+     The pager thread copies a tile's seed polygons while holding the
+     lock, then builds their filtered polygons without it.  Everything
+     else is protected by the lock.
+
+ */
+
+#include <math.h>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <art_map/PolyTiles.h>
+
+PolyTiles::PolyTiles():
+  tile_size_(0.0),
+  max_tiles_(0),
+  nresident_(0),
+  clock_(0),
+  stop_(false),
+  moved_(false),
+  radius_(0.0)
+{}
+
+PolyTiles::~PolyTiles()
+{
+  stopPager();
+}
+
+void PolyTiles::build(const std::vector<poly> &polys, float tile_size,
+		      unsigned max_tiles)
+{
+  clear();
+
+  boost::mutex::scoped_lock l(lock_);
+  tile_size_ = (tile_size > 0.0? tile_size: 0.0);
+  max_tiles_ = max_tiles;
+
+  tile_of_.resize(polys.size());
+  slot_of_.resize(polys.size());
+  for (unsigned i = 0; i < polys.size(); ++i)
+    {
+      std::pair<int, int> key(coord(polys[i].midpoint.x),
+			      coord(polys[i].midpoint.y));
+      TileMap::iterator it = tile_map_.find(key);
+      if (it == tile_map_.end())
+	{
+	  it = tile_map_.insert(std::make_pair(key, tiles_.size())).first;
+	  tiles_.push_back(Tile());
+	  tiles_.back().tx = key.first;
+	  tiles_.back().ty = key.second;
+	  tiles_.back().resident = false;
+	  tiles_.back().pinned = false;
+	  tiles_.back().last_used = 0;
+	}
+      Tile &t = tiles_[it->second];
+      tile_of_[i] = it->second;
+      slot_of_[i] = t.seeds.size();
+      t.seeds.push_back(polys[i]);
+    }
+
+  // without tiles, everything stays resident, as it always did
+  if (tile_size_ == 0.0)
+    for (unsigned n = 0; n < tiles_.size(); ++n)
+      {
+	std::vector<FilteredPolygon> filt;
+	load(tiles_[n].seeds, filt);
+	install(n, filt);
+      }
+}
+
+void PolyTiles::clear()
+{
+  stopPager();
+
+  boost::mutex::scoped_lock l(lock_);
+  tile_of_.clear();
+  slot_of_.clear();
+  tiles_.clear();
+  tile_map_.clear();
+  nresident_ = 0;
+  clock_ = 0;
+  moved_ = false;
+}
+
+unsigned PolyTiles::resident()
+{
+  boost::mutex::scoped_lock l(lock_);
+  return nresident_;
+}
+
+poly PolyTiles::polygon(unsigned i)
+{
+  boost::mutex::scoped_lock l(lock_);
+  Tile &t = tiles_[tile_of_[i]];
+  if (!t.resident)
+    return FilteredPolygon::InitialPolygon(t.seeds[slot_of_[i]]);
+
+  t.last_used = ++clock_;
+  return t.filt[slot_of_[i]].GetPolygon();
+}
+
+art_msgs::ArtQuadrilateral PolyTiles::quad(unsigned i)
+{
+  boost::mutex::scoped_lock l(lock_);
+  Tile &t = tiles_[tile_of_[i]];
+  if (!t.resident)
+    {
+      poly p = FilteredPolygon::InitialPolygon(t.seeds[slot_of_[i]]);
+      return FilteredPolygon::MakeQuad(p);
+    }
+
+  t.last_used = ++clock_;
+  return t.filt[slot_of_[i]].GetQuad();
+}
+
+FilteredPolygon PolyTiles::filtered(unsigned i)
+{
+  boost::mutex::scoped_lock l(lock_);
+  Tile &t = tiles_[tile_of_[i]];
+  if (t.resident)
+    return t.filt[slot_of_[i]];
+
+  FilteredPolygon fp;
+  fp.SetPolygon(t.seeds[slot_of_[i]]);
+  return fp;
+}
+
+void PolyTiles::set(unsigned i, const FilteredPolygon &fp)
+{
+  boost::mutex::scoped_lock l(lock_);
+  pin(i) = fp;
+}
+
+void PolyTiles::updatePoint(unsigned i, int point_id, float distance,
+			    float bearing, float confidence,
+			    float rx, float ry, float rori)
+{
+  boost::mutex::scoped_lock l(lock_);
+  pin(i).UpdatePoint(point_id, distance, bearing, confidence, rx, ry, rori);
+}
+
+void PolyTiles::setPose(const MapXY &here, float radius)
+{
+  {
+    boost::mutex::scoped_lock l(lock_);
+    if (tile_size_ == 0.0 || tiles_.empty())
+      return;
+    pose_ = here;
+    radius_ = radius;
+    moved_ = true;
+    if (!pager_)
+      pager_.reset(new boost::thread(boost::bind(&PolyTiles::pager, this)));
+  }
+  wake_.notify_one();
+}
+
+/** @return tile coordinate containing a map coordinate */
+int PolyTiles::coord(float v) const
+{
+  if (tile_size_ == 0.0)
+    return 0;
+  return (int) floorf(v / tile_size_);
+}
+
+/** build the filtered polygons for a tile's seeds */
+void PolyTiles::load(const std::vector<poly> &seeds,
+		     std::vector<FilteredPolygon> &filt)
+{
+  filt.resize(seeds.size());
+  for (unsigned k = 0; k < seeds.size(); ++k)
+    filt[k].SetPolygon(seeds[k]);
+}
+
+/** make a tile resident, dropping its seeds
+ *
+ *  @pre lock held, tile not resident
+ */
+void PolyTiles::install(unsigned tile, std::vector<FilteredPolygon> &filt)
+{
+  Tile &t = tiles_[tile];
+  t.filt.swap(filt);
+  std::vector<poly>().swap(t.seeds);
+  t.resident = true;
+  t.last_used = ++clock_;
+  ++nresident_;
+}
+
+/** @return filtered polygon i, keeping its tile resident from now on
+ *
+ *  @pre lock held
+ */
+FilteredPolygon &PolyTiles::pin(unsigned i)
+{
+  unsigned tile = tile_of_[i];
+  Tile &t = tiles_[tile];
+  if (!t.resident)
+    {
+      std::vector<FilteredPolygon> filt;
+      load(t.seeds, filt);
+      install(tile, filt);
+    }
+  t.pinned = true;
+  t.last_used = ++clock_;
+  return t.filt[slot_of_[i]];
+}
+
+/** find tiles within radius_ of pose_, in ascending order
+ *
+ *  @pre lock held
+ */
+void PolyTiles::nearTiles(std::vector<unsigned> &near) const
+{
+  near.clear();
+  int x0 = coord(pose_.x - radius_);
+  int x1 = coord(pose_.x + radius_);
+  int y0 = coord(pose_.y - radius_);
+  int y1 = coord(pose_.y + radius_);
+  for (int tx = x0; tx <= x1; ++tx)
+    for (int ty = y0; ty <= y1; ++ty)
+      {
+	TileMap::const_iterator it = tile_map_.find(std::make_pair(tx, ty));
+	if (it != tile_map_.end())
+	  near.push_back(it->second);
+      }
+  std::sort(near.begin(), near.end());
+}
+
+/** page out least recently used tiles until within budget
+ *
+ *  Tiles near the vehicle, and pinned ones, stay.
+ *
+ *  @pre lock held
+ */
+void PolyTiles::evict(const std::vector<unsigned> &near)
+{
+  while (max_tiles_ > 0 && nresident_ > max_tiles_)
+    {
+      int oldest = -1;
+      for (unsigned n = 0; n < tiles_.size(); ++n)
+	{
+	  const Tile &t = tiles_[n];
+	  if (t.resident && !t.pinned
+	      && (oldest < 0 || t.last_used < tiles_[oldest].last_used)
+	      && !std::binary_search(near.begin(), near.end(), n))
+	    oldest = n;
+	}
+      if (oldest < 0)
+	break;
+
+      // never updated, so each filtered polygon still gives back
+      // its seed
+      Tile &t = tiles_[oldest];
+      t.seeds.resize(t.filt.size());
+      for (unsigned k = 0; k < t.filt.size(); ++k)
+	t.seeds[k] = t.filt[k].GetPolygon();
+      std::vector<FilteredPolygon>().swap(t.filt);
+      t.resident = false;
+      --nresident_;
+    }
+}
+
+/** pager thread: load tiles near each new pose, then evict */
+void PolyTiles::pager()
+{
+  boost::mutex::scoped_lock l(lock_);
+  std::vector<unsigned> near;
+  for (;;)
+    {
+      while (!stop_ && !moved_)
+	wake_.wait(l);
+      if (stop_)
+	return;
+      moved_ = false;
+
+      nearTiles(near);
+      for (unsigned k = 0; k < near.size() && !stop_; ++k)
+	{
+	  Tile &t = tiles_[near[k]];
+	  if (t.resident)
+	    {
+	      t.last_used = ++clock_;
+	      continue;
+	    }
+
+	  std::vector<poly> seeds(t.seeds);
+	  std::vector<FilteredPolygon> filt;
+	  l.unlock();
+	  load(seeds, filt);
+	  l.lock();
+	  if (!t.resident)
+	    install(near[k], filt);
+	}
+      evict(near);
+    }
+}
+
+void PolyTiles::stopPager()
+{
+  {
+    boost::mutex::scoped_lock l(lock_);
+    if (!pager_)
+      return;
+    stop_ = true;
+  }
+  wake_.notify_all();
+  pager_->join();
+
+  boost::mutex::scoped_lock l(lock_);
+  pager_.reset();
+  stop_ = false;
+}
@@ -0,0 +1,278 @@
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     Batch point in quadrilateral tests for QuadGeometry.
+
+     The vector code does the same IEEE float operations as the
+     scalar tests, including the Epsilon comparisons, so each point
+     gets exactly the answer QuadGeometry::pointInside() would give.
+     AVX handles eight points at once when the compiler targets it,
+     otherwise SSE2 handles four.  Other processors, and the points
+     left over at the end, use the scalar code.
+
+ */
+
+#include <art_map/PolyOps.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  /** one quad, copied out of the QuadGeometry arrays */
+  struct Quad
+  {
+    float min_x, max_x, min_y, max_y;
+    float x[4], y[4];
+    float dx[4], dy[4];
+    double mid_x, mid_y;
+    float near2;			// zero to ignore the midpoint
+  };
+
+  /** scalar version, for odd points and other processors */
+  inline void test_point(const Quad &q, float px, float py,
+			 unsigned char &inside, unsigned char &hull)
+  {
+    inside = hull = 0;
+    if (q.near2 > 0
+	&& (float) ((q.mid_x-px)*(q.mid_x-px)
+		    + (q.mid_y-py)*(q.mid_y-py)) > q.near2)
+      return;
+
+    if (!(Epsilon::gte(px, q.min_x) && Epsilon::lte(px, q.max_x) &&
+	  Epsilon::gte(py, q.min_y) && Epsilon::lte(py, q.max_y)))
+      return;
+    hull = 1;
+
+    bool odd = false;
+    for (int k = 0; k < 4; ++k)
+      {
+	float y1 = q.y[k];
+	float y2 = q.y[(k+1)&3];
+	if ((y1 < py && y2 >= py) || (y2 < py && y1 >= py))
+	  if (q.x[k] + (py-y1)/q.dy[k]*q.dx[k] < px)
+	    odd = !odd;
+      }
+    inside = odd;
+  }
+
+#if defined(__AVX__) || defined(__SSE2__)
+
+#if defined(__AVX__)
+
+  /** eight floats per AVX register */
+  struct Vec
+  {
+    typedef __m256 F;
+    static const unsigned width = 8;
+
+    static F load(const float *p) { return _mm256_loadu_ps(p); }
+    static F set1(float v) { return _mm256_set1_ps(v); }
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm256_div_ps(a, b); }
+    static F max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static F le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static F gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static F ge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static F ngt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_NGT_UQ); }
+    static F and_(F a, F b) { return _mm256_and_ps(a, b); }
+    static F or_(F a, F b) { return _mm256_or_ps(a, b); }
+    static F xor_(F a, F b) { return _mm256_xor_ps(a, b); }
+    static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static int bits(F a) { return _mm256_movemask_ps(a); }
+
+    /** squared midpoint distances, in double like the scalar code */
+    static F dist2(F x, F y, double mx, double my)
+    {
+      __m256d vmx = _mm256_set1_pd(mx);
+      __m256d vmy = _mm256_set1_pd(my);
+      __m128 half[2];
+      for (int h = 0; h < 2; ++h)
+	{
+	  __m128 xh = (h? _mm256_extractf128_ps(x, 1):
+		       _mm256_castps256_ps128(x));
+	  __m128 yh = (h? _mm256_extractf128_ps(y, 1):
+		       _mm256_castps256_ps128(y));
+	  __m256d ddx = _mm256_sub_pd(vmx, _mm256_cvtps_pd(xh));
+	  __m256d ddy = _mm256_sub_pd(vmy, _mm256_cvtps_pd(yh));
+	  half[h] = _mm256_cvtpd_ps(_mm256_add_pd(_mm256_mul_pd(ddx, ddx),
+						  _mm256_mul_pd(ddy, ddy)));
+	}
+      return _mm256_insertf128_ps(_mm256_castps128_ps256(half[0]),
+				  half[1], 1);
+    }
+  };
+
+#else // SSE2
+
+  /** four floats per SSE register */
+  struct Vec
+  {
+    typedef __m128 F;
+    static const unsigned width = 4;
+
+    static F load(const float *p) { return _mm_loadu_ps(p); }
+    static F set1(float v) { return _mm_set1_ps(v); }
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm_div_ps(a, b); }
+    static F max(F a, F b) { return _mm_max_ps(a, b); }
+    static F lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static F le(F a, F b) { return _mm_cmple_ps(a, b); }
+    static F gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+    static F ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+    static F ngt(F a, F b) { return _mm_cmpngt_ps(a, b); }
+    static F and_(F a, F b) { return _mm_and_ps(a, b); }
+    static F or_(F a, F b) { return _mm_or_ps(a, b); }
+    static F xor_(F a, F b) { return _mm_xor_ps(a, b); }
+    static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static int bits(F a) { return _mm_movemask_ps(a); }
+
+    /** squared midpoint distances, in double like the scalar code */
+    static F dist2(F x, F y, double mx, double my)
+    {
+      __m128d vmx = _mm_set1_pd(mx);
+      __m128d vmy = _mm_set1_pd(my);
+      __m128d dxl = _mm_sub_pd(vmx, _mm_cvtps_pd(x));
+      __m128d dxh = _mm_sub_pd(vmx, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+      __m128d dyl = _mm_sub_pd(vmy, _mm_cvtps_pd(y));
+      __m128d dyh = _mm_sub_pd(vmy, _mm_cvtps_pd(_mm_movehl_ps(y, y)));
+      __m128 lo = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(dxl, dxl),
+					  _mm_mul_pd(dyl, dyl)));
+      __m128 hi = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(dxh, dxh),
+					  _mm_mul_pd(dyh, dyh)));
+      return _mm_movelh_ps(lo, hi);
+    }
+  };
+
+#endif // __AVX__
+
+  typedef Vec::F F;
+
+  /** Epsilon::equal(), a lane at a time */
+  inline F equal(F a, F b)
+  {
+    const F eps = Vec::set1(Epsilon::float_value);
+    F diff = Vec::abs(Vec::sub(a, b));
+    F rel = Vec::div(diff, Vec::max(Vec::abs(a), Vec::abs(b)));
+    return Vec::or_(Vec::lt(diff, eps), Vec::le(rel, eps));
+  }
+
+  inline F gte(F a, F b) { return Vec::or_(Vec::gt(a, b), equal(a, b)); }
+  inline F lte(F a, F b) { return Vec::or_(Vec::lt(a, b), equal(a, b)); }
+
+  /** test points [j, j + Vec::width) */
+  inline void test_block(const Quad &q, const float x[], const float y[],
+			 unsigned j, unsigned char inside[],
+			 unsigned char hull[])
+  {
+    F px = Vec::load(x + j);
+    F py = Vec::load(y + j);
+
+    F ok = Vec::and_(Vec::and_(gte(px, Vec::set1(q.min_x)),
+			       lte(px, Vec::set1(q.max_x))),
+		     Vec::and_(gte(py, Vec::set1(q.min_y)),
+			       lte(py, Vec::set1(q.max_y))));
+    if (q.near2 > 0)
+      ok = Vec::and_(ok, Vec::ngt(Vec::dist2(px, py, q.mid_x, q.mid_y),
+				  Vec::set1(q.near2)));
+
+    int in_hull = Vec::bits(ok);
+    int in_quad = 0;
+    if (in_hull)
+      {
+	F odd = Vec::set1(0.0f);
+	for (int k = 0; k < 4; ++k)
+	  {
+	    F y1 = Vec::set1(q.y[k]);
+	    F y2 = Vec::set1(q.y[(k+1)&3]);
+	    F crosses = Vec::or_(Vec::and_(Vec::lt(y1, py), Vec::ge(y2, py)),
+				 Vec::and_(Vec::lt(y2, py), Vec::ge(y1, py)));
+	    F xi = Vec::add(Vec::set1(q.x[k]),
+			    Vec::mul(Vec::div(Vec::sub(py, y1),
+					      Vec::set1(q.dy[k])),
+				     Vec::set1(q.dx[k])));
+	    odd = Vec::xor_(odd, Vec::and_(crosses, Vec::lt(xi, px)));
+	  }
+	in_quad = Vec::bits(Vec::and_(ok, odd));
+      }
+
+    for (unsigned b = 0; b < Vec::width; ++b)
+      inside[j+b] = (in_quad >> b) & 1;
+    if (hull)
+      for (unsigned b = 0; b < Vec::width; ++b)
+	hull[j+b] = (in_hull >> b) & 1;
+  }
+
+#endif // __AVX__ || __SSE2__
+
+} // namespace
+
+void QuadGeometry::pointsInside(unsigned i, bool inner, float near2,
+				const float x[], const float y[], unsigned n,
+				unsigned char inside[],
+				unsigned char hull[]) const
+{
+  const Corners &c = (inner? inner_: outer_);
+  Quad q;
+  q.min_x = c.min_x[i];
+  q.max_x = c.max_x[i];
+  q.min_y = c.min_y[i];
+  q.max_y = c.max_y[i];
+  for (int k = 0; k < 4; ++k)
+    {
+      q.x[k] = c.x[k][i];
+      q.y[k] = c.y[k][i];
+      q.dx[k] = c.dx[k][i];
+      q.dy[k] = c.dy[k][i];
+    }
+  q.mid_x = mid_x_[i];
+  q.mid_y = mid_y_[i];
+  q.near2 = near2;
+
+  unsigned j = 0;
+#if defined(__AVX__) || defined(__SSE2__)
+  for (; j + Vec::width <= n; j += Vec::width)
+    test_block(q, x, y, j, inside, hull);
+#endif
+  unsigned char in_hull;
+  for (; j < n; ++j)
+    {
+      test_point(q, x[j], y[j], inside[j], in_hull);
+      if (hull)
+	hull[j] = in_hull;
+    }
+}
+
+void QuadGeometry::classify(bool inner, float near2,
+			    const float x[], const float y[], unsigned n,
+			    int quad[]) const
+{
+  for (unsigned j = 0; j < n; ++j)
+    quad[j] = -1;
+  if (n == 0)
+    return;
+
+  std::vector<unsigned char> inside(n);
+  for (unsigned i = 0; i < size(); ++i)
+    {
+      pointsInside(i, inner, near2, x, y, n, &inside[0]);
+      for (unsigned j = 0; j < n; ++j)
+	if (inside[j] && quad[j] < 0)
+	  quad[j] = i;
+    }
+}
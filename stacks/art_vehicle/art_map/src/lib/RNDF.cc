@@ -13,6 +13,7 @@
 #include <art_msgs/ArtVehicle.h>
 #include <art/epsilon.h>
 #include <art_map/RNDF.h>
+#include <art_map/TextScanner.h>
 
 #define DEFAULT_LANE_WIDTH (art_msgs::ArtVehicle::width+1)
 #define DEFAULT_SPOT_WIDTH (art_msgs::ArtVehicle::width+1)
@@ -36,9 +37,8 @@ RNDF::RNDF(std::string rndfname, bool verbose)
   number_of_segments = number_of_zones = -1;
   is_valid=true;
   
-  std::ifstream rndf_file;
-  rndf_file.open(rndfname.c_str());
-  if (!rndf_file)
+  MappedFile rndf_file;
+  if (!rndf_file.open(rndfname))
     {
       ROS_ERROR_STREAM("Error opening RNDF \"" << rndfname << "\"");
       is_valid = false;
@@ -63,49 +63,42 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 
 
 
-  std::string lineread;
-  while(getline(rndf_file, lineread)) // Read line by line
+  // Lines and tokens are views into the mapped file.
+  LineReader lines(rndf_file.text());
+  TextSpan lineread;
+  char temp_char [64];                  // formatted ID prefix
+
+  while(lines.next(lineread)) // Read line by line
     {
       line_number++;
-      uint real_characters=0;
 
-      for (uint ind=0; ind < lineread.length(); ind++)
-	if (lineread[ind] != '\r' &&
-	    lineread[ind] != '\t' &&
-	    lineread[ind] != ' ')
-	  real_characters++;
-      
       //Blank lines
-      if (real_characters == 0) {
+      if (lineread.blank()) {
 	if (verbose)
 	  printf("%d: Blank Line\n",line_number);
 	continue;
       }
       
-      std::string token;
-      char token_char [lineread.size()+1];
-      char temp_char [lineread.size()+1];
-
-      //Read in one line
-      sscanf(lineread.c_str(), "%s", token_char);
-      token.assign(token_char);
+      //Read first token of line
+      TextSpan token;
+      TextScanner(lineread).token(token);
 
-      //      printf("Token: |%s|\n", token.c_str());
+      //      printf("Token: |%s|\n", token.str().c_str());
 
       if (state != COMMENT){
-	if (token.compare("RNDF_name") == 0)
+	if (token.equals("RNDF_name"))
 	  change_state(previous_state, state, GENERAL);
-	else if (token.compare("segment") == 0)
+	else if (token.equals("segment"))
 	  change_state(previous_state, state, SEGMENTS);
-	else if (token.compare("lane") == 0)
+	else if (token.equals("lane"))
 	  change_state(previous_state, state, LANES);
-	else if (token.compare("zone") == 0)
+	else if (token.equals("zone"))
 	  change_state(previous_state, state, ZONES);
-	else if (token.compare("perimeter") == 0)
+	else if (token.equals("perimeter"))
 	  change_state(previous_state, state, PERIMETER);
-	else if (token.compare("spot") == 0)
+	else if (token.equals("spot"))
 	  change_state(previous_state, state, PARKING_SPOT);
-	else if (token.find("/*") != std::string::npos)
+	else if (token.contains("/*"))
 	  change_state(previous_state, state, COMMENT);
       }
 
@@ -113,42 +106,43 @@ RNDF::RNDF(std::string rndfname, bool verbose)
       switch (state){
       case COMMENT:
 	if (verbose)
-	  printf("%d: COMMENT: %s\n", line_number, lineread.c_str());
-	if (lineread.find("*/") != std::string::npos)
+	  printf("%d: COMMENT: %.*s\n", line_number,
+		 (int) lineread.size(), lineread.begin);
+	if (lineread.contains("*/"))
 	  state = previous_state;
 	break;
       case GENERAL:
 	//RNDF_NAME
-	if (token.compare("RNDF_name") == 0)
+	if (token.equals("RNDF_name"))
 	  filename =
-	    parse_string(lineread, std::string("RNDF_name"),
+	    parse_string(lineread, "RNDF_name",
 			 line_number, valid, verbose);
 	//NUM_SEGMENTS
-	else if (token.compare("num_segments") == 0){
+	else if (token.equals("num_segments")){
 	  number_of_segments =
-	    parse_integer(lineread, std::string("num_segments"),
+	    parse_integer(lineread, "num_segments",
 			  line_number, valid, verbose);
 	  if (number_of_segments <= 0) valid = false;
 	}
 	//NUM_ZONES
-	else if (token.compare("num_zones") == 0){
+	else if (token.equals("num_zones")){
 	  number_of_zones =
-	    parse_integer(lineread, std::string("num_zones"),
+	    parse_integer(lineread, "num_zones",
 			  line_number, valid, verbose);
 	  if (number_of_zones < 0) valid = false;
 	}
 	//FORMAT_VERSION
-	else if (token.compare("format_version") == 0)
+	else if (token.equals("format_version"))
 	  format_version =
-	    parse_string(lineread, std::string("format_version"),
+	    parse_string(lineread, "format_version",
 			 line_number, valid, verbose);
 	//CREATION_DATE
-	else if (token.compare("creation_date") == 0)
+	else if (token.equals("creation_date"))
 	  creation_date =
-	    parse_string(lineread, std::string("creation_date"),
+	    parse_string(lineread, "creation_date",
 			 line_number, valid, verbose);
 	//END_FILE
-	else if (token.compare("end_file") == 0){
+	else if (token.equals("end_file")){
 	  if (!isvalid())
 	    valid = false;
 	  else if (verbose)
@@ -162,26 +156,26 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	break;
       case SEGMENTS:
 	//SEGMENT
-	if(token.compare("segment") == 0){
+	if(token.equals("segment")){
 	  temp_segment.segment_id =
-	    parse_integer(lineread, std::string("segment"),
+	    parse_integer(lineread, "segment",
 			  line_number, valid, verbose);
 	  if (temp_segment.segment_id <= 0) valid = false;
 	}
 	//NUM_LANES
-	else if(token.compare("num_lanes") == 0){
+	else if(token.equals("num_lanes")){
 	  temp_segment.number_of_lanes =
-	    parse_integer(lineread, std::string("num_lanes"),
+	    parse_integer(lineread, "num_lanes",
 			  line_number, valid, verbose);
 	  if (temp_segment.number_of_lanes <= 0) valid = false;
 	}
 	//SEGMENT_NAME
-	else if(token.compare("segment_name") == 0)
+	else if(token.equals("segment_name"))
 	  temp_segment.segment_name =
-	    parse_string(lineread, std::string("segment_name"),
+	    parse_string(lineread, "segment_name",
 			 line_number, valid, verbose);
 	//END_SEGMENT
-	else if(token.compare("end_segment") == 0){
+	else if(token.equals("end_segment")){
 	  if (!temp_segment.isvalid())
 	    valid = false;
 	  else{
@@ -199,9 +193,11 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	break;
       case LANES:
 	//LANE
-	if(token.compare("lane") == 0){
-	  sprintf(temp_char, "lane %d.%%d", temp_segment.segment_id);
-	  if (sscanf(lineread.c_str(), temp_char, &temp_lane.lane_id) == 1){
+	if(token.equals("lane")){
+	  snprintf(temp_char, sizeof(temp_char), "lane %d.",
+		   temp_segment.segment_id);
+	  TextScanner scan(lineread);
+	  if (scan.literal(temp_char) && scan.integer(temp_lane.lane_id)){
 	    if (verbose)
 	      printf("%d: Lane number is %d\n",
 		     line_number, temp_lane.lane_id);
@@ -210,21 +206,21 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	  if (temp_lane.lane_id <= 0) valid = false;
 	}
 	//NUM_WAYPOINTS
-	else if(token.compare("num_waypoints") == 0){
+	else if(token.equals("num_waypoints")){
 	  temp_lane.number_of_waypoints =
-	    parse_integer(lineread, std::string("num_waypoints"),
+	    parse_integer(lineread, "num_waypoints",
 			  line_number, valid, verbose);
 	  if (temp_lane.number_of_waypoints <= 0) valid = false;
 	}
 	//LANE_WIDTH
-	else if(token.compare("lane_width") == 0){
+	else if(token.equals("lane_width")){
 	  temp_lane.lane_width =
-	    parse_integer(lineread, std::string("lane_width"),
+	    parse_integer(lineread, "lane_width",
 			  line_number, valid, verbose);
 	  if (temp_lane.lane_width <= 0) valid = false;
 	}
 	//LEFT_BOUNDARY
-	else if(token.compare("left_boundary") == 0){
+	else if(token.equals("left_boundary")){
 	  temp_lane.left_boundary =
 	    parse_boundary(lineread, valid);
 	  if (verbose)
@@ -232,7 +228,7 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 		   line_number, temp_lane.left_boundary);
 	}
 	//RIGHT_BOUNDARY
-	else if(token.compare("right_boundary") == 0){
+	else if(token.equals("right_boundary")){
 	  temp_lane.right_boundary =
 	    parse_boundary(lineread, valid);
 	  if (verbose)
@@ -240,25 +236,25 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 		   line_number, temp_lane.right_boundary);
 	}
 	//CHECKPOINT
-	else if(token.compare("checkpoint") == 0){
+	else if(token.equals("checkpoint")){
 	  Checkpoint checkpoint(lineread, temp_segment.segment_id,
 				temp_lane.lane_id, line_number, valid, verbose);
 	  temp_lane.checkpoints.push_back(checkpoint);
 	}
 	//STOP
-	else if(token.compare("stop") == 0){
+	else if(token.equals("stop")){
 	  Stop stop(lineread, temp_segment.segment_id,
 		    temp_lane.lane_id, line_number, valid, verbose);
 	  temp_lane.stops.push_back(stop);
 	}
 	//EXIT
-	else if(token.compare("exit") == 0){
+	else if(token.equals("exit")){
 	  Exit exit(lineread, temp_segment.segment_id,
 		    temp_lane.lane_id, line_number, valid, verbose);
 	  temp_lane.exits.push_back(exit);
 	}
 	//END_LANE
-	else if(token.compare("end_lane") == 0){
+	else if(token.equals("end_lane")){
 	  if(temp_lane.number_of_waypoints != (int)temp_lane.waypoints.size())
 	    printf("Number of waypoints in lane does not match num_waypoints\n");
 	  if (!temp_lane.isvalid())
@@ -275,9 +271,9 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	//NO TOKEN
 	else{
 	  //WAYPOINT
-	  sprintf(temp_char, "%d.%d.", temp_segment.segment_id,
-		  temp_lane.lane_id);
-	  if(token.find(temp_char) != std::string::npos ){
+	  snprintf(temp_char, sizeof(temp_char), "%d.%d.",
+		   temp_segment.segment_id, temp_lane.lane_id);
+	  if(token.contains(temp_char)){
 	    LL_Waypoint wp(lineread, temp_segment.segment_id,
 			   temp_lane.lane_id, line_number, valid, verbose);
 	    temp_lane.waypoints.push_back(wp);
@@ -290,27 +286,27 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	break;
       case ZONES:
 	//ZONE
-	if(token.compare("zone") == 0){
+	if(token.equals("zone")){
 	  temp_zone.zone_id =
-	    parse_integer(lineread, std::string("zone"),
+	    parse_integer(lineread, "zone",
 			  line_number, valid, verbose);
 	  if (temp_zone.zone_id <= 0) valid = false;
 	
 	}
 	//NUM_SPOTS
-	else if(token.compare("num_spots") == 0){
+	else if(token.equals("num_spots")){
 	  temp_zone.number_of_parking_spots =
-	    parse_integer(lineread, std::string("num_spots"),
+	    parse_integer(lineread, "num_spots",
 			  line_number, valid, verbose);
 	  if (temp_zone.number_of_parking_spots < 0) valid = false;	
 	}
 	//ZONE_NAME
-	else if(token.compare("zone_name") == 0)
+	else if(token.equals("zone_name"))
 	  temp_zone.zone_name =
-	    parse_string(lineread, std::string("zone_name"),
+	    parse_string(lineread, "zone_name",
 			 line_number, valid, verbose);
 	//END_ZONE
-	else if(token.compare("end_zone") == 0){
+	else if(token.equals("end_zone")){
 	  if(!temp_zone.isvalid())
 	    valid = false;
 	  else{
@@ -328,10 +324,12 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	break;
       case PERIMETER:
 	//PERIMETER
-	if(token.compare("perimeter") == 0){
-	  sprintf(temp_char,"perimeter %d.%%d" , temp_zone.zone_id);
-	  if (sscanf(lineread.c_str(), temp_char,
-		     &temp_perimeter.perimeter_id) == 1){
+	if(token.equals("perimeter")){
+	  snprintf(temp_char, sizeof(temp_char), "perimeter %d.",
+		   temp_zone.zone_id);
+	  TextScanner scan(lineread);
+	  if (scan.literal(temp_char)
+	      && scan.integer(temp_perimeter.perimeter_id)){
 	    if (verbose)
 	      printf("%d: Perimeter id is %d\n",
 		     line_number, temp_perimeter.perimeter_id);
@@ -341,21 +339,21 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	    valid = false;
 	}
 	//NUM_PERIMETER_POINTS
-	else if(token.compare("num_perimeterpoints") == 0){
+	else if(token.equals("num_perimeterpoints")){
 	  temp_perimeter.number_of_perimeterpoints =
-	    parse_integer(lineread, std::string("num_perimeterpoints"),
+	    parse_integer(lineread, "num_perimeterpoints",
 			  line_number, valid, verbose);
 	  if (temp_perimeter.number_of_perimeterpoints <= 0)
 	    valid = false;
 	}
 	//EXIT
-	else if(token.compare("exit") == 0){
+	else if(token.equals("exit")){
 	  Exit exit(lineread, temp_zone.zone_id, 0, line_number, valid,
 		    verbose);
 	  temp_perimeter.exits_from_perimeter.push_back(exit);
 	}
 	//END_PERIMETER
-	else if(token.compare("end_perimeter") == 0){
+	else if(token.equals("end_perimeter")){
 	  if(!temp_perimeter.isvalid())
 	    valid = false;
 	  else{
@@ -368,8 +366,9 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	}
 	else{
 	  //WAYPOINT
-	  sprintf(temp_char, "%d.%d.", temp_zone.zone_id, 0);
-	  if(token.find(temp_char) != std::string::npos ){
+	  snprintf(temp_char, sizeof(temp_char), "%d.%d.",
+		   temp_zone.zone_id, 0);
+	  if(token.contains(temp_char)){
 	    LL_Waypoint wp(lineread, temp_zone.zone_id, 0, line_number,
 			   valid, verbose);
 	    temp_perimeter.perimeterpoints.push_back(wp);
@@ -379,9 +378,11 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	break;
       case PARKING_SPOT:
 	//SPOT
-	if(token.compare("spot") == 0){
-	  sprintf(temp_char,"spot %d.%%d" , temp_zone.zone_id);
-	  if (sscanf(lineread.c_str(), temp_char, &temp_spot.spot_id) == 1){
+	if(token.equals("spot")){
+	  snprintf(temp_char, sizeof(temp_char), "spot %d.",
+		   temp_zone.zone_id);
+	  TextScanner scan(lineread);
+	  if (scan.literal(temp_char) && scan.integer(temp_spot.spot_id)){
 	    if (verbose)
 	      printf("%d: Spot id is %d\n", line_number, temp_spot.spot_id);
 	  }
@@ -389,19 +390,19 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	  if (temp_spot.spot_id <= 0) valid = false;
 	}
 	//SPOT_WIDTH
-	else if(token.compare("spot_width") == 0){
+	else if(token.equals("spot_width")){
 	  temp_spot.spot_width =
-	    parse_integer(lineread, std::string("spot_width"),
+	    parse_integer(lineread, "spot_width",
 			  line_number, valid, verbose);
 	  if (temp_spot.spot_width <= 0) valid = false;	
 	}
 	//CHECKPOINT
-	else if(token.compare("checkpoint") == 0)
+	else if(token.equals("checkpoint"))
 	  temp_spot.checkpoint = Checkpoint(lineread, temp_zone.zone_id,
 					    temp_spot.spot_id,
 					    line_number, valid, verbose);
 	//END_SPOT
-	else if(token.compare("end_spot") == 0){
+	else if(token.equals("end_spot")){
 	  if(!temp_spot.isvalid())
 	    valid = false;
 	  else{
@@ -414,8 +415,9 @@ RNDF::RNDF(std::string rndfname, bool verbose)
 	}
 	else{
 	  //WAYPOINT
-	  sprintf(temp_char, "%d.%d.", temp_zone.zone_id, temp_spot.spot_id);
-	  if(token.find(temp_char) != std::string::npos ){
+	  snprintf(temp_char, sizeof(temp_char), "%d.%d.",
+		   temp_zone.zone_id, temp_spot.spot_id);
+	  if(token.contains(temp_char)){
 	    LL_Waypoint wp(lineread, temp_zone.zone_id,
 			   temp_spot.spot_id, line_number, valid, verbose);
 	    temp_spot.waypoints.push_back(wp);
@@ -432,7 +434,7 @@ RNDF::RNDF(std::string rndfname, bool verbose)
       }
       if (!valid) {
 	is_valid=false;
-	print_error_message(line_number, token);
+	print_error_message(line_number, token.str());
 	return;
       }
     }
@@ -448,9 +450,8 @@ MDF::MDF(std::string mdfname, bool verbose)
 
   if (verbose) printf("MDF Parser Begins\n");
 
-  std::ifstream mdf_file;
-  mdf_file.open(mdfname.c_str());
-  if (!mdf_file){
+  MappedFile mdf_file;
+  if (!mdf_file.open(mdfname)){
     printf("Error in opening MDF file\n");
     is_valid=false;
     return;
@@ -460,45 +461,35 @@ MDF::MDF(std::string mdfname, bool verbose)
   line_number = 0;
   MDF_PARSE_STATE state = MDF_UNKNOWN, previous_state = MDF_UNKNOWN;
 
-  std::string lineread;
-  while(getline(mdf_file, lineread) ) // Read line by line
+  // Lines and tokens are views into the mapped file.
+  LineReader lines(mdf_file.text());
+  TextSpan lineread;
+
+  while(lines.next(lineread)) // Read line by line
     {
 
       line_number++;
 
-      uint real_characters=0;
-
-      for (uint ind=0; ind < lineread.length(); ind++)
-	if (lineread[ind] != '\r' &&
-	    lineread[ind] != '\t' &&
-	    lineread[ind] != ' ')
-	  real_characters++;
- 
-
       //Blank lines
-      if (real_characters == 0) {
+      if (lineread.blank()) {
 	if (verbose)
 	  printf("%d: Blank Line\n",line_number);
 	continue;
       }
 
-      std::string token;
-      char token_char [lineread.size()+1];
-      // char temp_char [lineread.size()+1];
-
-      //Read in one line
-      sscanf(lineread.c_str(), "%s", token_char);
-      token.assign(token_char);
+      //Read first token of line
+      TextSpan token;
+      TextScanner(lineread).token(token);
 
 
       if (state != MDF_COMMENT){
-	if (token.compare("MDF_name") == 0)
+	if (token.equals("MDF_name"))
 	  change_state(previous_state, state, MDF_GENERAL);
-	else if (token.compare(0, 11, "checkpoints") == 0)
+	else if (token.starts_with("checkpoints"))
 	  change_state(previous_state, state, MDF_CHECKPOINTS);
-	else if (token.compare(0, 12, "speed_limits") == 0)
+	else if (token.starts_with("speed_limits"))
 	  change_state(previous_state, state, MDF_SPEEDLIMITS);
-	else if (token.find("/*") != std::string::npos)
+	else if (token.contains("/*"))
 	  change_state(previous_state, state, MDF_COMMENT);
       }
 
@@ -506,28 +497,29 @@ MDF::MDF(std::string mdfname, bool verbose)
       switch (state){
       case MDF_COMMENT:
 	if (verbose)
-	  printf("%d: COMMENT: %s\n", line_number, lineread.c_str());
-	if (lineread.find("*/") != std::string::npos)
+	  printf("%d: COMMENT: %.*s\n", line_number,
+		 (int) lineread.size(), lineread.begin);
+	if (lineread.contains("*/"))
 	  state = previous_state;
 	break;
       case MDF_GENERAL:
-	if (token.compare("MDF_name") == 0)
+	if (token.equals("MDF_name"))
 	  filename =
-	    parse_string(lineread, std::string("MDF_name"),
+	    parse_string(lineread, "MDF_name",
 			 line_number, valid, verbose);
-	else if (token.compare("RNDF") == 0)
+	else if (token.equals("RNDF"))
 	  RNDF_name =
-	    parse_string(lineread, std::string("RNDF"),
+	    parse_string(lineread, "RNDF",
 			 line_number, valid, verbose);
-	else if (token.compare("format_version") == 0)
+	else if (token.equals("format_version"))
 	  format_version =
-	    parse_string(lineread, std::string("format_version"),
+	    parse_string(lineread, "format_version",
 			 line_number, valid, verbose);
-	else if (token.compare("creation_date") == 0)
+	else if (token.equals("creation_date"))
 	  creation_date =
-	    parse_string(lineread, std::string("creation_date"),
+	    parse_string(lineread, "creation_date",
 			 line_number, valid, verbose);
-	else if (token.compare("end_file") == 0){
+	else if (token.equals("end_file")){
 	  if (!isvalid()){
 	    printf("%d: MDF Properties are not valid\n", line_number);	
 	    valid = false;
@@ -541,17 +533,17 @@ MDF::MDF(std::string mdfname, bool verbose)
 	}
 	break;
       case MDF_SPEEDLIMITS:
-	if(token.compare(0, 12, "speed_limits") == 0){
+	if(token.starts_with("speed_limits")){
 	  if (verbose)
 	    printf("%d: Speed Limits\n", line_number);
 	}
-	else if(token.compare(0, 16, "num_speed_limits") == 0){
+	else if(token.starts_with("num_speed_limits")){
 	  number_of_speedlimits =
-	    parse_integer(lineread, std::string("num_speed_limits"),
+	    parse_integer(lineread, "num_speed_limits",
 			  line_number, valid, verbose);
 	  if (number_of_speedlimits <= 0) valid = false;
 	}
-	else if(token.compare("end_speed_limits") == 0){
+	else if(token.equals("end_speed_limits")){
 	  if (number_of_speedlimits != (int) speed_limits.size())
 	    printf("Number of Speed Limits do not match num_speedlimits\n");
 	  else if (verbose)
@@ -568,17 +560,17 @@ MDF::MDF(std::string mdfname, bool verbose)
 	}
 	break;
       case MDF_CHECKPOINTS:
-	if(token.compare(0, 11, "checkpoints") == 0){
+	if(token.starts_with("checkpoints")){
 	  if (verbose)
 	    printf("%d: Checkpoints\n", line_number);
 	}
-	else if(token.compare("num_checkpoints") == 0){
+	else if(token.equals("num_checkpoints")){
 	  number_of_checkpoints =
-	    parse_integer(lineread, std::string("num_checkpoints"),
+	    parse_integer(lineread, "num_checkpoints",
 			  line_number, valid, verbose);
 	  if (number_of_checkpoints <= 0) valid = false;
 	}
-	else if(token.compare("end_checkpoints") == 0){
+	else if(token.equals("end_checkpoints")){
 	  if (number_of_checkpoints != (int) checkpoint_ids.size())
 	    printf("Number of Checkpoints do not match num_checkpoints\n");
 	  else if (verbose)
@@ -599,12 +591,13 @@ MDF::MDF(std::string mdfname, bool verbose)
 	}
 	break;
       case MDF_UNKNOWN:
-	printf("%d: COULD NOT PARSE: %s\n", line_number, lineread.c_str());
+	printf("%d: COULD NOT PARSE: %.*s\n", line_number,
+	       (int) lineread.size(), lineread.begin);
 	valid = false;
       }
       if (!valid) {
 	is_valid=false;
-	print_error_message(line_number, token);
+	print_error_message(line_number, token.str());
 	return;
       }
     }
@@ -613,18 +606,19 @@ MDF::MDF(std::string mdfname, bool verbose)
 
 }
 
-Lane_marking RNDF::parse_boundary(std::string line, bool& valid){
+Lane_marking RNDF::parse_boundary(const TextSpan &line, bool& valid){
   Lane_marking boundary_type = UNDEFINED;
-  char temp_char [line.size()+1];
-  if (!sscanf(line.c_str(), "%*s %s", temp_char) == 1)
+  TextSpan value;
+  TextScanner scan(line);
+  if (!scan.skip_token() || !scan.token(value))
     valid = false;
-  if (strcmp(temp_char, "double_yellow") == 0)
+  if (value.equals("double_yellow"))
     boundary_type = DOUBLE_YELLOW;
-  else if (strcmp(temp_char, "solid_yellow") == 0)
+  else if (value.equals("solid_yellow"))
     boundary_type = SOLID_YELLOW;
-  else if (strcmp(temp_char, "solid_white") == 0)
+  else if (value.equals("solid_white"))
     boundary_type = SOLID_WHITE;
-  else if (strcmp(temp_char, "broken_white") == 0)
+  else if (value.equals("broken_white"))
     boundary_type = BROKEN_WHITE;
   else
     valid=false;
@@ -632,12 +626,13 @@ Lane_marking RNDF::parse_boundary(std::string line, bool& valid){
 
 };
 
-Checkpoint::Checkpoint(std::string line, int x, int y,
+Checkpoint::Checkpoint(const TextSpan &line, int x, int y,
 		       int line_number, bool& valid, bool verbose) {
-  char temp_char [line.size()+1];
-  sprintf(temp_char,"checkpoint %d.%d.%%d %%d" ,x, y);
-  if (sscanf(line.c_str(), temp_char, &waypoint_id, &checkpoint_id) == 2 &&
-      isvalid()){
+  char temp_char [64];
+  snprintf(temp_char, sizeof(temp_char), "checkpoint %d.%d.", x, y);
+  TextScanner scan(line);
+  if (scan.literal(temp_char) && scan.integer(waypoint_id) &&
+      scan.integer(checkpoint_id) && isvalid()){
     if (verbose){ 
       printf("%d: ", line_number);
       print();
@@ -649,12 +644,14 @@ Checkpoint::Checkpoint(std::string line, int x, int y,
   }
 };
 
-LL_Waypoint::LL_Waypoint(std::string line, int x, int y,
+LL_Waypoint::LL_Waypoint(const TextSpan &line, int x, int y,
 			 int line_number, bool& valid, bool verbose) {
 
-  char temp_char [line.size()+1];
-  sprintf(temp_char, "%d.%d.%%d %%lf %%lf", x, y);
-  if(sscanf(line.c_str(), temp_char, &waypoint_id, &ll.latitude, &ll.longitude) == 3 && isvalid()){
+  char temp_char [64];
+  snprintf(temp_char, sizeof(temp_char), "%d.%d.", x, y);
+  TextScanner scan(line);
+  if(scan.literal(temp_char) && scan.integer(waypoint_id) &&
+     scan.real(ll.latitude) && scan.real(ll.longitude) && isvalid()){
     if (verbose) {
       printf("%d: ", line_number);
       print();
@@ -668,16 +665,18 @@ LL_Waypoint::LL_Waypoint(std::string line, int x, int y,
 
 
 
-Exit::Exit(std::string line, int x, int y, int line_number, bool& valid,
+Exit::Exit(const TextSpan &line, int x, int y, int line_number, bool& valid,
 	   bool verbose) {
 
-  char temp_char [line.size()+1];
-  sprintf(temp_char,"exit %d.%d.%%d %%d.%%d.%%d", x, y);
+  char temp_char [64];
+  snprintf(temp_char, sizeof(temp_char), "exit %d.%d.", x, y);
   start_point.segment_id = x;
   start_point.lane_id = y;
-  if (sscanf(line.c_str(), temp_char, &start_point.waypoint_id,
-	     &end_point.segment_id, &end_point.lane_id,
-	     &end_point.waypoint_id) == 4  && isvalid()){
+  TextScanner scan(line);
+  if (scan.literal(temp_char) && scan.integer(start_point.waypoint_id) &&
+      scan.integer(end_point.segment_id) && scan.literal(".") &&
+      scan.integer(end_point.lane_id) && scan.literal(".") &&
+      scan.integer(end_point.waypoint_id) && isvalid()){
     if (verbose){
       printf("%d: ", line_number);
       print();
@@ -691,9 +690,11 @@ Exit::Exit(std::string line, int x, int y, int line_number, bool& valid,
   }
 };
 
-Speed_Limit::Speed_Limit(std::string line, int line_number, bool& valid,
+Speed_Limit::Speed_Limit(const TextSpan &line, int line_number, bool& valid,
 			 bool verbose){
-  if (sscanf(line.c_str(), "%d %d %d", &id, &min_speed, &max_speed) == 3 && isvalid()){
+  TextScanner scan(line);
+  if (scan.integer(id) && scan.integer(min_speed) &&
+      scan.integer(max_speed) && isvalid()){
     if (verbose){
       printf("%d: ", line_number);
       print();
@@ -705,12 +706,13 @@ Speed_Limit::Speed_Limit(std::string line, int line_number, bool& valid,
   }
 };
 
-Stop::Stop(std::string line, int x, int y,
+Stop::Stop(const TextSpan &line, int x, int y,
 	   int line_number, bool& valid, bool verbose){
   //  clear()
-  char temp_char [line.size()+1];
-  sprintf(temp_char,"stop %d.%d.%%d" , x, y);
-  if (sscanf(line.c_str(), temp_char, &waypoint_id) == 1 && isvalid()){
+  char temp_char [64];
+  snprintf(temp_char, sizeof(temp_char), "stop %d.%d.", x, y);
+  TextScanner scan(line);
+  if (scan.literal(temp_char) && scan.integer(waypoint_id) && isvalid()){
     if (verbose)
       printf("%d: Stop at Waypoint %d\n",
 	     line_number, waypoint_id);
@@ -722,27 +724,29 @@ Stop::Stop(std::string line, int x, int y,
 };
 
 
-std::string parse_string(std::string line, std::string token,
+// Like the sscanf() this replaced, a missing value yields an empty
+// string, not an error.
+std::string parse_string(const TextSpan &line, const char *token,
 			 int line_number, bool& valid, bool verbose){
-  char temp_char [line.size()+1];
-  temp_char[0]='\0';
-  if (sscanf(line.c_str(), "%*s %s", temp_char)){
-    if (verbose)
-      printf("%d: %s is %s\n", line_number, token.c_str(), temp_char);
-  }
-  else
-    valid=false;
-
-  return std::string(temp_char);
+  TextSpan value;
+  TextScanner scan(line);
+  if (scan.skip_token())
+    scan.token(value);
+  if (verbose)
+    printf("%d: %s is %.*s\n", line_number, token,
+	   (int) value.size(), value.begin);
+
+  return value.str();
 };
 
 //WITH STRING TOKEN
-int parse_integer(std::string line, std::string token,
+int parse_integer(const TextSpan &line, const char *token,
 		  int line_number, bool& valid, bool verbose){
   int integer = INT_MIN;
-  if (sscanf(line.c_str(), "%*s %d", &integer) == 1){
+  TextScanner scan(line);
+  if (scan.skip_token() && scan.integer(integer)){
     if (verbose)
-      printf("%d: %s is %d\n", line_number, token.c_str(), integer);
+      printf("%d: %s is %d\n", line_number, token, integer);
   }
   else
     valid=false;
@@ -752,10 +756,10 @@ int parse_integer(std::string line, std::string token,
 };
 
 //WITHOUT TOKEN
-int parse_integer(std::string line, int line_number, bool& valid,
+int parse_integer(const TextSpan &line, int line_number, bool& valid,
 		  bool verbose){
   int integer = INT_MIN;
-  if (sscanf(line.c_str(), "%d", &integer) == 1){
+  if (TextScanner(line).integer(integer)){
     if (verbose)
       printf("%d: %d\n", line_number, integer);
   }
@@ -0,0 +1,408 @@
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     Generate synthetic road networks.
+
+ */
+
+#include <math.h>
+#include <algorithm>
+
+#include <art/conversions.h>
+
+#include <art_map/RNDFGenerator.h>
+
+namespace
+{
+  // one street approaching an intersection
+  struct Approach
+  {
+    int segment;                        // index in segments_
+    int arriving;                       // first lane ID arriving
+    int departing;                      // first lane ID departing
+    Approach(int _segment, int _arriving, int _departing):
+      segment(_segment), arriving(_arriving), departing(_departing) {};
+  };
+
+  const float curb_margin = 2.0;        // curb to zone perimeter (m)
+  const float spot_length = 6.0;        // parking spot length (m)
+  const int zone_speed_limit = 10;      // mph
+}
+
+RNDFGenerator::RNDFGenerator(const RNDFGeneratorConfig &config):
+  config_(config)
+{
+  if (config_.rows < 1)
+    config_.rows = 1;
+  if (config_.cols < 1)
+    config_.cols = 1;
+  if (config_.rows * config_.cols < 2)
+    config_.cols = 2;
+  if (config_.lanes < 1)
+    config_.lanes = 1;
+  if (config_.lane_width < 1)
+    config_.lane_width = 1;
+  if (config_.waypoint_spacing <= 0.0)
+    config_.waypoint_spacing = 1.0;
+  if (config_.mission_checkpoints < 1)
+    config_.mission_checkpoints = 1;
+
+  // leave room for several way-points and a zone in every block
+  float setback = (config_.lanes * feet2meters(config_.lane_width)
+		   + curb_margin);
+  float min_length = 2.0 * setback + fmaxf(3.0 * config_.waypoint_spacing,
+					   3.0 * spot_length);
+  if (config_.block_length < min_length)
+    config_.block_length = min_length;
+
+  double lat = config_.latitude * M_PI / 180.0;
+  meters_per_lat_ = 111132.954 - 559.822 * cos(2.0 * lat)
+    + 1.175 * cos(4.0 * lat);
+  meters_per_long_ = 111412.84 * cos(lat) - 93.5 * cos(3.0 * lat);
+
+  build();
+}
+
+/** lay out the whole network */
+void RNDFGenerator::build()
+{
+  const int k = config_.lanes;
+  const float width = feet2meters(config_.lane_width);
+  const float block = config_.block_length;
+  const float setback = k * width + curb_margin;
+  const float usable = block - 2.0 * setback;
+  const int npoints = std::max(4, (int) (usable / config_.waypoint_spacing
+					 + 1.5));
+  const float step = usable / (npoints - 1);
+
+  segments_.clear();
+  zones_.clear();
+  nwaypoints_ = 0;
+  ncheckpoints_ = 0;
+
+  int nodes = config_.rows * config_.cols;
+  east_segment_.assign(nodes, 0);
+  north_segment_.assign(nodes, 0);
+
+  // one segment for each block leaving an intersection to the east
+  // or north; forward lanes 1..k travel that way, lanes k+1..2k
+  // come back
+  for (int r = 0; r < config_.rows; ++r)
+    {
+      for (int c = 0; c < config_.cols; ++c)
+	{
+	  for (int north = 0; north < 2; ++north)
+	    {
+	      if ((north && r + 1 >= config_.rows)
+		  || (!north && c + 1 >= config_.cols))
+		continue;
+
+	      GenSegment seg;
+	      seg.segment_id = segments_.size() + 1;
+	      if (north)
+		north_segment_[r * config_.cols + c] = seg.segment_id;
+	      else
+		east_segment_[r * config_.cols + c] = seg.segment_id;
+
+	      Point a(c * block, r * block);
+	      Point d(north? 0.0: 1.0, north? 1.0: 0.0);
+	      Point n(d.y, -d.x);	// right of d
+
+	      for (int l = 1; l <= 2*k; ++l)
+		{
+		  int i = (l <= k? l: l - k); // position from center line
+		  double sign = (l <= k? 1.0: -1.0);
+		  double offset = (i - 0.5) * width;
+
+		  GenLane lane;
+		  lane.lane_id = l;
+		  lane.left_boundary = (i == 1? "double_yellow": "broken_white");
+		  lane.right_boundary = (i == k? "solid_white": "broken_white");
+		  lane.stop = true;
+		  lane.checkpoint_pt = npoints / 2 + 1;
+		  lane.checkpoint_id = ++ncheckpoints_;
+
+		  // start of lane, relative to intersection a
+		  double along = (l <= k? setback: block - setback);
+		  Point start(a.x + d.x * along + sign * n.x * offset,
+			      a.y + d.y * along + sign * n.y * offset);
+		  for (int j = 0; j < npoints; ++j)
+		    lane.points.push_back(Point(start.x + sign * d.x * j * step,
+						start.y + sign * d.y * j * step));
+		  nwaypoints_ += npoints;
+		  seg.lanes.push_back(lane);
+		}
+	      segments_.push_back(seg);
+	    }
+	}
+    }
+  nsegments_ = segments_.size();
+
+  // four-way stops: each arriving lane exits to the corresponding
+  // lane of every other street at that intersection
+  for (int r = 0; r < config_.rows; ++r)
+    {
+      for (int c = 0; c < config_.cols; ++c)
+	{
+	  std::vector<Approach> approaches;
+	  int node = r * config_.cols + c;
+	  if (east_segment_[node])
+	    approaches.push_back(Approach(east_segment_[node] - 1, k+1, 1));
+	  if (north_segment_[node])
+	    approaches.push_back(Approach(north_segment_[node] - 1, k+1, 1));
+	  if (c > 0)
+	    approaches.push_back(Approach(east_segment_[node - 1] - 1,
+					  1, k+1));
+	  if (r > 0)
+	    approaches.push_back(Approach(north_segment_[node - config_.cols]
+					  - 1, 1, k+1));
+
+	  for (unsigned a = 0; a < approaches.size(); ++a)
+	    {
+	      for (unsigned b = 0; b < approaches.size(); ++b)
+		{
+		  // no U-turns, except at a dead end
+		  if (a == b && approaches.size() > 1)
+		    continue;
+		  for (int i = 0; i < k; ++i)
+		    {
+		      GenSegment &from = segments_[approaches[a].segment];
+		      GenLane &lane = from.lanes[approaches[a].arriving + i - 1];
+		      GenExit exit;
+		      exit.pt = lane.points.size();
+		      exit.to = WaypointRef(approaches[b].segment + 1,
+					    approaches[b].departing + i, 1);
+		      lane.exits.push_back(exit);
+		    }
+		}
+	    }
+	}
+    }
+
+  // spread the zones evenly over the blocks
+  int blocks = (config_.rows - 1) * (config_.cols - 1);
+  int nzones = std::min(config_.zones, blocks);
+  for (int z = 0; z < nzones; ++z)
+    {
+      int b = (int) (((long) z * blocks) / nzones);
+      build_zone(b / (config_.cols - 1), b % (config_.cols - 1));
+    }
+}
+
+/** build a parking lot in the block north-east of intersection (row, col)
+ *
+ *  Entry and exit are from the outside lane of the street along the
+ *  south side of the block, which travels west.
+ */
+void RNDFGenerator::build_zone(int row, int col)
+{
+  const int k = config_.lanes;
+  const float width = feet2meters(config_.lane_width);
+  const float block = config_.block_length;
+  const float setback = k * width + curb_margin;
+
+  GenZone zone;
+  zone.zone_id = nsegments_ + zones_.size() + 1;
+
+  int seg_id = east_segment_[row * config_.cols + col];
+  GenLane &lane = segments_[seg_id - 1].lanes[2*k - 1];
+  int npoints = lane.points.size();
+  int entry = npoints / 3;		// zero-based way-point indexes
+  int leave = (2 * npoints) / 3;
+
+  double x0 = col * block + setback;
+  double x1 = (col + 1) * block - setback;
+  double y0 = row * block + setback;
+  double y1 = (row + 1) * block - setback;
+
+  // counter-clockwise from the south-west corner; points 2 and 3
+  // are the exit and entry
+  zone.perimeter.push_back(Point(x0, y0));
+  zone.perimeter.push_back(Point(lane.points[leave].x, y0));
+  zone.perimeter.push_back(Point(lane.points[entry].x, y0));
+  zone.perimeter.push_back(Point(x1, y0));
+  zone.perimeter.push_back(Point(x1, y1));
+  zone.perimeter.push_back(Point(x0, y1));
+  nwaypoints_ += zone.perimeter.size();
+
+  GenExit in;
+  in.pt = entry + 1;
+  in.to = WaypointRef(zone.zone_id, 0, 3);
+  lane.exits.push_back(in);
+
+  GenExit out;
+  out.pt = 2;
+  out.to = WaypointRef(seg_id, 2*k, leave + 1);
+  zone.exits.push_back(out);
+
+  // a row of spots facing the north side of the lot
+  float pitch = width + 1.0;
+  int nspots = std::min(config_.spots, (int) ((x1 - x0 - 2.0) / pitch));
+  for (int s = 0; s < nspots; ++s)
+    {
+      GenSpot spot;
+      double x = x0 + 1.0 + (s + 0.5) * pitch;
+      spot.points[0] = Point(x, y1 - 1.0 - spot_length);
+      spot.points[1] = Point(x, y1 - 1.0);
+      spot.checkpoint_id = ++ncheckpoints_;
+      zone.spots.push_back(spot);
+      nwaypoints_ += 2;
+    }
+
+  zones_.push_back(zone);
+}
+
+void RNDFGenerator::print_point(FILE *f, const WaypointRef &ref,
+				const Point &pt)
+{
+  fprintf(f, "%d.%d.%d\t%.7f\t%.7f\n", ref.seg, ref.lane, ref.pt,
+	  config_.latitude + pt.y / meters_per_lat_,
+	  config_.longitude + pt.x / meters_per_long_);
+}
+
+bool RNDFGenerator::write_rndf(const std::string &filename,
+			       const std::string &name)
+{
+  FILE *f = fopen(filename.c_str(), "w");
+  if (f == NULL)
+    {
+      perror(filename.c_str());
+      return false;
+    }
+
+  fprintf(f, "RNDF_name\t%s\n", name.c_str());
+  fprintf(f, "num_segments\t%d\n", nsegments_);
+  fprintf(f, "num_zones\t%d\n", (int) zones_.size());
+  fprintf(f, "format_version\t1.0\n");
+  fprintf(f, "creation_date\tgenerated\n");
+
+  for (unsigned s = 0; s < segments_.size(); ++s)
+    {
+      const GenSegment &seg = segments_[s];
+      fprintf(f, "segment\t%d\n", seg.segment_id);
+      fprintf(f, "num_lanes\t%d\n", (int) seg.lanes.size());
+      fprintf(f, "segment_name\tBlock_%d\n", seg.segment_id);
+      for (unsigned l = 0; l < seg.lanes.size(); ++l)
+	{
+	  const GenLane &lane = seg.lanes[l];
+	  fprintf(f, "lane\t%d.%d\n", seg.segment_id, lane.lane_id);
+	  fprintf(f, "num_waypoints\t%d\n", (int) lane.points.size());
+	  fprintf(f, "lane_width\t%d\n", config_.lane_width);
+	  fprintf(f, "left_boundary\t%s\n", lane.left_boundary);
+	  fprintf(f, "right_boundary\t%s\n", lane.right_boundary);
+	  fprintf(f, "checkpoint\t%d.%d.%d\t%d\n", seg.segment_id,
+		  lane.lane_id, lane.checkpoint_pt, lane.checkpoint_id);
+	  if (lane.stop)
+	    fprintf(f, "stop\t%d.%d.%d\n", seg.segment_id, lane.lane_id,
+		    (int) lane.points.size());
+	  for (unsigned e = 0; e < lane.exits.size(); ++e)
+	    fprintf(f, "exit\t%d.%d.%d\t%d.%d.%d\n",
+		    seg.segment_id, lane.lane_id, lane.exits[e].pt,
+		    lane.exits[e].to.seg, lane.exits[e].to.lane,
+		    lane.exits[e].to.pt);
+	  for (unsigned p = 0; p < lane.points.size(); ++p)
+	    print_point(f, WaypointRef(seg.segment_id, lane.lane_id, p+1),
+			lane.points[p]);
+	  fprintf(f, "end_lane\n");
+	}
+      fprintf(f, "end_segment\n");
+    }
+
+  for (unsigned z = 0; z < zones_.size(); ++z)
+    {
+      const GenZone &zone = zones_[z];
+      fprintf(f, "zone\t%d\n", zone.zone_id);
+      fprintf(f, "num_spots\t%d\n", (int) zone.spots.size());
+      fprintf(f, "zone_name\tLot_%d\n", zone.zone_id);
+      fprintf(f, "perimeter\t%d.0\n", zone.zone_id);
+      for (unsigned e = 0; e < zone.exits.size(); ++e)
+	fprintf(f, "exit\t%d.0.%d\t%d.%d.%d\n",
+		zone.zone_id, zone.exits[e].pt,
+		zone.exits[e].to.seg, zone.exits[e].to.lane,
+		zone.exits[e].to.pt);
+      fprintf(f, "num_perimeterpoints\t%d\n", (int) zone.perimeter.size());
+      for (unsigned p = 0; p < zone.perimeter.size(); ++p)
+	print_point(f, WaypointRef(zone.zone_id, 0, p+1), zone.perimeter[p]);
+      fprintf(f, "end_perimeter\n");
+      for (unsigned s = 0; s < zone.spots.size(); ++s)
+	{
+	  const GenSpot &spot = zone.spots[s];
+	  fprintf(f, "spot\t%d.%d\n", zone.zone_id, s+1);
+	  fprintf(f, "spot_width\t%d\n", config_.lane_width);
+	  fprintf(f, "checkpoint\t%d.%d.2\t%d\n", zone.zone_id, s+1,
+		  spot.checkpoint_id);
+	  for (int p = 0; p < 2; ++p)
+	    print_point(f, WaypointRef(zone.zone_id, s+1, p+1),
+			spot.points[p]);
+	  fprintf(f, "end_spot\n");
+	}
+      fprintf(f, "end_zone\n");
+    }
+  fprintf(f, "end_file\n");
+
+  if (fclose(f) != 0)
+    {
+      perror(filename.c_str());
+      return false;
+    }
+  return true;
+}
+
+bool RNDFGenerator::write_mdf(const std::string &filename,
+			      const std::string &rndf_name)
+{
+  FILE *f = fopen(filename.c_str(), "w");
+  if (f == NULL)
+    {
+      perror(filename.c_str());
+      return false;
+    }
+
+  fprintf(f, "MDF_name\t%s_mission\n", rndf_name.c_str());
+  fprintf(f, "RNDF\t%s\n", rndf_name.c_str());
+  fprintf(f, "format_version\t1.0\n");
+  fprintf(f, "creation_date\tgenerated\n");
+
+  // Pick checkpoints with a private generator, so the same seed
+  // gives the same mission everywhere.
+  fprintf(f, "checkpoints\n");
+  fprintf(f, "num_checkpoints\t%d\n", config_.mission_checkpoints);
+  unsigned long state = config_.seed;
+  int previous = 0;
+  for (int i = 0; i < config_.mission_checkpoints; ++i)
+    {
+      int id;
+      do
+	{
+	  state = state * 1103515245 + 12345;
+	  id = (int) ((state >> 16) % ncheckpoints_) + 1;
+	}
+      while (id == previous && ncheckpoints_ > 1);
+      fprintf(f, "%d\n", id);
+      previous = id;
+    }
+  fprintf(f, "end_checkpoints\n");
+
+  fprintf(f, "speed_limits\n");
+  fprintf(f, "num_speed_limits\t%d\n", nsegments_ + (int) zones_.size());
+  for (int s = 1; s <= nsegments_; ++s)
+    fprintf(f, "%d\t0\t%d\n", s, config_.speed_limit);
+  for (unsigned z = 0; z < zones_.size(); ++z)
+    fprintf(f, "%d\t0\t%d\n", zones_[z].zone_id, zone_speed_limit);
+  fprintf(f, "end_speed_limits\n");
+  fprintf(f, "end_file\n");
+
+  if (fclose(f) != 0)
+    {
+      perror(filename.c_str());
+      return false;
+    }
+  return true;
+}
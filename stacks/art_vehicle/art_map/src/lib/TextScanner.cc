@@ -0,0 +1,342 @@
+/*
+ *  Copyright (C) 2010 Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  \file
+
+     Scan map text files in place.
+
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <art_map/TextScanner.h>
+
+namespace
+{
+  // same characters isspace() accepts in the "C" locale
+  inline bool is_space(char c)
+  {
+    return (c == ' ' || c == '\t' || c == '\n'
+	    || c == '\v' || c == '\f' || c == '\r');
+  }
+
+  inline bool is_digit(char c)
+  {
+    return (c >= '0' && c <= '9');
+  }
+
+  // powers of ten exactly representable as doubles
+  const double exact_pow10[] =
+    {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+     1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+     1e21, 1e22};
+  const int max_exact_pow10 = 22;
+
+  // largest integer all of whose predecessors are exact doubles
+  const uint64_t max_exact_mantissa = (uint64_t) 1 << 53;
+}
+
+bool TextSpan::equals(const char *s) const
+{
+  size_t len = strlen(s);
+  return (size() == len && memcmp(begin, s, len) == 0);
+}
+
+bool TextSpan::starts_with(const char *s) const
+{
+  size_t len = strlen(s);
+  return (size() >= len && memcmp(begin, s, len) == 0);
+}
+
+bool TextSpan::contains(const char *s) const
+{
+  size_t len = strlen(s);
+  if (len == 0)
+    return true;
+  for (const char *p = begin; p + len <= end; ++p)
+    {
+      if (*p == *s && memcmp(p, s, len) == 0)
+	return true;
+    }
+  return false;
+}
+
+bool TextSpan::blank() const
+{
+  for (const char *p = begin; p < end; ++p)
+    {
+      if (*p != '\r' && *p != '\t' && *p != ' ')
+	return false;
+    }
+  return true;
+}
+
+bool MappedFile::open(const std::string &filename)
+{
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    {
+      ::close(fd);
+      return false;
+    }
+
+  size_ = st.st_size;
+  if (size_ > 0)
+    {
+      void *addr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED)
+	{
+	  ::close(fd);
+	  size_ = 0;
+	  return false;
+	}
+      madvise(addr, size_, MADV_SEQUENTIAL);
+      data_ = (const char *) addr;
+    }
+
+  // the mapping remains valid after the descriptor is closed
+  ::close(fd);
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (data_ != NULL)
+    munmap((void *) data_, size_);
+  data_ = NULL;
+  size_ = 0;
+}
+
+bool LineReader::next(TextSpan &line)
+{
+  if (next_ >= end_)
+    return false;
+
+  const char *eol = (const char *) memchr(next_, '\n', end_ - next_);
+  if (eol == NULL)
+    {
+      // last line has no newline
+      line = TextSpan(next_, end_);
+      next_ = end_;
+    }
+  else
+    {
+      line = TextSpan(next_, eol);
+      next_ = eol + 1;
+    }
+  return true;
+}
+
+void TextScanner::skip_space()
+{
+  while (p_ < end_ && is_space(*p_))
+    ++p_;
+}
+
+bool TextScanner::literal(const char *s)
+{
+  for (; *s != '\0'; ++s)
+    {
+      if (is_space(*s))
+	skip_space();
+      else if (p_ < end_ && *p_ == *s)
+	++p_;
+      else
+	return false;
+    }
+  return true;
+}
+
+bool TextScanner::token(TextSpan &tok)
+{
+  skip_space();
+  if (p_ >= end_)
+    return false;
+
+  const char *start = p_;
+  while (p_ < end_ && !is_space(*p_))
+    ++p_;
+  tok = TextSpan(start, p_);
+  return true;
+}
+
+bool TextScanner::integer(int &value)
+{
+  skip_space();
+  const char *q = p_;
+  bool negative = false;
+  if (q < end_ && (*q == '+' || *q == '-'))
+    {
+      negative = (*q == '-');
+      ++q;
+    }
+  if (q >= end_ || !is_digit(*q))
+    return false;
+
+  // Accumulate as a long, saturating on overflow, then truncate to
+  // int.  That is what sscanf() does with an out of range "%d".
+  long result = 0;
+  bool overflow = false;
+  for (; q < end_ && is_digit(*q); ++q)
+    {
+      int digit = *q - '0';
+      if (!overflow)
+	{
+	  if (negative)
+	    {
+	      if (result < (LONG_MIN + digit) / 10)
+		overflow = true;
+	      else
+		result = result * 10 - digit;
+	    }
+	  else
+	    {
+	      if (result > (LONG_MAX - digit) / 10)
+		overflow = true;
+	      else
+		result = result * 10 + digit;
+	    }
+	}
+    }
+  if (overflow)
+    result = (negative? LONG_MIN: LONG_MAX);
+
+  value = (int) result;
+  p_ = q;
+  return true;
+}
+
+bool TextScanner::real(double &value)
+{
+  skip_space();
+  const char *start = p_;
+  const char *q = p_;
+  bool negative = false;
+  if (q < end_ && (*q == '+' || *q == '-'))
+    {
+      negative = (*q == '-');
+      ++q;
+    }
+
+  // Decimal numbers with few enough significant digits are converted
+  // directly.  Their value is a mantissa that is an exact double,
+  // scaled by an exact power of ten, so one multiply or divide gives
+  // the correctly rounded result, the same as strtod().
+  uint64_t mantissa = 0;
+  int ndigits = 0;                      // significant digits seen
+  int scale = 0;                        // decimal exponent of mantissa
+  bool any = false;
+  bool exact = true;
+
+  bool hex = (q + 1 < end_ && q[0] == '0' && (q[1] == 'x' || q[1] == 'X'));
+  if (!hex)
+    {
+      for (; q < end_ && is_digit(*q); ++q)
+	{
+	  any = true;
+	  if (mantissa == 0 && *q == '0')
+	    continue;
+	  if (++ndigits > 19)
+	    exact = false;
+	  else
+	    mantissa = mantissa * 10 + (*q - '0');
+	  if (!exact)
+	    ++scale;
+	}
+      if (q < end_ && *q == '.')
+	{
+	  ++q;
+	  for (; q < end_ && is_digit(*q); ++q)
+	    {
+	      any = true;
+	      if (mantissa == 0 && *q == '0')
+		{
+		  --scale;
+		  continue;
+		}
+	      if (++ndigits > 19)
+		exact = false;
+	      else
+		{
+		  mantissa = mantissa * 10 + (*q - '0');
+		  --scale;
+		}
+	    }
+	}
+    }
+
+  if (any)
+    {
+      // optional exponent, ignored unless it has digits
+      if (q < end_ && (*q == 'e' || *q == 'E'))
+	{
+	  const char *e = q + 1;
+	  bool eneg = false;
+	  if (e < end_ && (*e == '+' || *e == '-'))
+	    {
+	      eneg = (*e == '-');
+	      ++e;
+	    }
+	  if (e < end_ && is_digit(*e))
+	    {
+	      int exponent = 0;
+	      for (; e < end_ && is_digit(*e); ++e)
+		{
+		  if (exponent < 10000)
+		    exponent = exponent * 10 + (*e - '0');
+		}
+	      scale += (eneg? -exponent: exponent);
+	      q = e;
+	    }
+	}
+
+      if (exact && mantissa <= max_exact_mantissa
+	  && scale >= -max_exact_pow10 && scale <= max_exact_pow10)
+	{
+	  double result = (double) mantissa;
+	  if (scale < 0)
+	    result /= exact_pow10[-scale];
+	  else
+	    result *= exact_pow10[scale];
+	  value = (negative? -result: result);
+	  p_ = q;
+	  return true;
+	}
+    }
+
+  // Anything else (many digits, huge exponents, hex, inf, nan) is
+  // rare in map files, let strtod() handle it from a local copy.
+  char buf[128];
+  size_t len = 0;
+  for (const char *c = start;
+       c < end_ && !is_space(*c) && len < sizeof(buf) - 1;
+       ++c)
+    buf[len++] = *c;
+  buf[len] = '\0';
+
+  char *stop;
+  double result = strtod(buf, &stop);
+  if (stop == buf)
+    return false;
+  value = result;
+  p_ = start + (stop - buf);
+  return true;
+}
@@ -6,9 +6,30 @@
 #define ONE_GRID 0.9
 #define TWO_GRID 1.8
 
+namespace
+{
+  // log-odds values, in grid cell units
+  const int UNKNOWN_CELL =
+    LOGODDS_CELL_ZERO + (int) (OCCUPANCY_UNKNOWN * LOGODDS_CELL_SCALE);
+  const int MIN_CELL =
+    LOGODDS_CELL_ZERO + (int) (LOGODDS_MIN_OCCUPANCY * LOGODDS_CELL_SCALE);
+  const int MAX_CELL =
+    LOGODDS_CELL_ZERO + (int) (LOGODDS_MAX_OCCUPANCY * LOGODDS_CELL_SCALE);
+  const int HIT_CELL =
+    LOGODDS_CELL_ZERO + (int) (LOGODDS_OCCUPANCY_INCREMENT * LOGODDS_CELL_SCALE);
+  const int DECREMENT_CELL =
+    (int) (LOGODDS_OCCUPANCY_DECREMENT * LOGODDS_CELL_SCALE);
+
+  /** @return log-odds value of a cell */
+  inline double logodds(cell c)
+  {
+    return (c - LOGODDS_CELL_ZERO) / (double) LOGODDS_CELL_SCALE;
+  }
+}
+
 VisualLanes::VisualLanes(double physical_size,
 			     int resolution) :
-  _m(NULL),
+  _m(resolution * resolution, UNKNOWN_CELL),
   _physical_size(physical_size),
   _resolution(resolution),
   _x(0),
@@ -16,166 +37,75 @@ VisualLanes::VisualLanes(double physical_size,
   _theta(0),
   _x_offset(0),
   _y_offset(0),
+  _threshold(0),
   _shift(0),
-  scan_off_right_side(false),
-  scan_off_left_side(false),
-  scan_off_bottom_side(false),
-  scan_off_top_side(false),
-  count(0) {
-  int r;
-  _m = new cell*[_resolution];
-  for(r = 0; r < _resolution; r++) {
-    _m[r] = NULL;
-    _m[r] = new cell[_resolution];
-  }
+  rX(0),
+  rY(0),
+  laser_range(MAX_RANGE),
+  gpsOnOff(false) {
 }
 
 VisualLanes::~VisualLanes() {
-  int r;
-  for(r = 0; r < _resolution; r++) {
-    delete[] _m[r];
-  }
-  delete[] _m;
 }
 
 void VisualLanes::clear() {
-  int r, c;
-  for(r = 0; r < _resolution; r++) {
-    for(c = 0; c < _resolution; c++) {
-      _m[r][c] = OCCUPANCY_UNKNOWN;
-    }
-  }
+  std::fill(_m.begin(), _m.end(), UNKNOWN_CELL);
 }
 
 void VisualLanes::initialize(double x, double y, double theta) {
   _theta = theta;
   _x = x;
   _y = y;
+  rX = x;
+  rY = y;
   _x_offset = 0;
   _y_offset = 0;
   clear();
 }
 
-/*
- * Note, that all of these fuctions require that _resolution/2 -
- * (laser_range/_physical_size) >= 0); Also, make sure that if a scan
- * range goes off... of a side that executing these searches on the
- * map don't overlap with the robot's position. This can be arranged
- * by using an appropriate size.
+/**
+ * Moves the grid window to new robot cell offsets from the initial
+ * position.  Only the rows and columns coming into view are cleared;
+ * the rest of the grid stays where it is.
  */
-
-void VisualLanes::clearBottom()
+void VisualLanes::scroll(int x_offset, int y_offset)
 {
-  for(int num = _resolution/2; num < _resolution; num++)
-    for(int num2 = 0; num2 < _resolution; num2++)	
-      _m[num][num2] = 0;
-  
-}
-
-void VisualLanes::clearTop()
-{
-  for(int num = 0; num < _resolution/2; num++)
-    for(int num2 = 0; num2 < _resolution; num2++)
-      _m[num][num2] = 0;
-}
+  int half = _resolution / 2;
+  int dx = x_offset - _x_offset;
+  int dy = y_offset - _y_offset;
+  _x_offset = x_offset;
+  _y_offset = y_offset;
+
+  // valid() cells span _resolution - 1 in each direction
+  if (abs(dx) >= _resolution - 1 || abs(dy) >= _resolution - 1)
+    {
+      clear();
+      return;
+    }
 
-void VisualLanes::clearRight()
-{
-  for(int num = 0; num < _resolution; num++)
-    for(int num2 = _resolution/2; num2 < _resolution; num2++)
-      _m[num][num2] = 0;
-}
+  for (int k = 0; k < abs(dx); k++)
+    {
+      int x = (dx > 0? half - 1 - k: 1 - half + k);
+      std::vector<cell>::iterator row =
+        _m.begin() + wrap(x + half + _x_offset) * _resolution;
+      std::fill(row, row + _resolution, UNKNOWN_CELL);
+    }
 
-void VisualLanes::clearLeft()
-{
-  for(int num = 0; num < _resolution; num++)
-    for(int num2 = 0; num2 < _resolution/2; num2++)
-      _m[num][num2] = 0;
+  for (int k = 0; k < abs(dy); k++)
+    {
+      int y = (dy > 0? half - 1 - k: 1 - half + k);
+      int col = wrap(y + half + _y_offset);
+      for (int r = 0; r < _resolution; r++)
+        _m[r * _resolution + col] = UNKNOWN_CELL;
+    }
 }
 
 void VisualLanes::setPosition(double x, double y, double theta) {
   _theta = theta;
   rX = x;
   rY = y;
-  if(fabs(_x - x) >= _physical_size) {
-    double _x_offset_temp = _x_offset + ((x - _x) / _physical_size);
-    _x_offset = (int)_x_offset_temp;
-    //printf("_x_offset %i\n", _x_offset);
-    _x = x - fmod(x, _physical_size);
-  }
-  
-  if(fabs(_y - y) >= _physical_size) {
-    double _y_offset_temp = _y_offset + ((y - _y) / _physical_size);
-    _y_offset = (int)_y_offset_temp;
-    //printf("_y_offset %i\n", _y_offset);
-    _y = y - fmod(y, _physical_size);
-  }
-  
-  
-  
-  double cellX = _resolution / 2 + _x_offset;
-  double cellY = _resolution / 2 + _y_offset;
-  
-  int cellXtemp = (int)(cellX) % _resolution;
-  int cellYtemp = (int)(cellY) % _resolution;
-  
-  if(cellXtemp < 0)
-    {
-      printf("The value of cellX %f\n", cellX);
-    }
-  if(cellYtemp < 0)
-    printf("The value of cellY %f\n", cellY);
-  
-  if( (_resolution/2 + _x_offset) > _resolution
-      && (_resolution/2 + _y_offset)  < _resolution
-      && (_resolution/2 + _y_offset)  >= 0)
-    {
-      clearBottom();
-      _x_offset = -_resolution/2;
-      printf("The bottom was cleared by position\n");
-      scan_off_right_side = false;
-      scan_off_bottom_side = false;
-      scan_off_left_side = false;
-      scan_off_top_side = false;
-    }
-  else if( (_resolution/2 + _x_offset) < 0
-           && (_resolution/2 + _y_offset)  >= 0
-           && (_resolution/2 + _y_offset)  < _resolution)
-    {
-      clearTop();
-      _x_offset = (_resolution - 1) -  _resolution / 2;
-      scan_off_top_side = false;
-      scan_off_bottom_side = false;
-      scan_off_left_side = false;
-      scan_off_right_side = false;
-    }
-  else if( (_resolution/2 + _y_offset) < 0
-           && (_resolution/2 + _x_offset) >= 0
-           && (_resolution/2 + _x_offset) < _resolution)
-    {
-      clearLeft();
-      _y_offset = (_resolution - 1) - _resolution / 2;
-      printf("The _y_offset %i\n", _y_offset);
-      scan_off_top_side = false;
-      scan_off_bottom_side = false;
-      scan_off_left_side = false;
-      scan_off_right_side = false;
-    }
-  else if( (_resolution/2 + _x_offset) < _resolution
-           && (_resolution/2 + _y_offset) > _resolution
-           && (_resolution/2 + _x_offset) >= 0)
-    {
-      clearRight();
-      printf("The right was cleared by position: %i\n", count);
-      _y_offset = -_resolution/2;
-      printf("value: %i \n", _resolution/2 + _y_offset);
-      scan_off_right_side = false;
-      scan_off_bottom_side = false;
-      scan_off_left_side = false;
-      scan_off_top_side = false;
-      count++;
-    }
-  
+  scroll((int) floor((x - _x) / _physical_size),
+         (int) floor((y - _y) / _physical_size));
 }
 
 std::vector<float>* VisualLanes::getPose()
@@ -189,7 +119,7 @@ std::vector<float>* VisualLanes::getPose()
   return temp;
 }
 
-void VisualLanes::addSickScan(std::vector<double> ranges) {
+void VisualLanes::addSickScan(const std::vector<double> &ranges) {
   int l;
   double temp_theta = _theta - angles::from_degrees(90);
   for (l = 0; l < 180; l++) {
@@ -214,40 +144,8 @@ void VisualLanes::addSickScan(std::vector<double> ranges) {
     double x = (ranges[l] * cos(tempTheta)) / _physical_size;
     double y = (ranges[l] * sin(tempTheta)) / _physical_size;
     
-    //lighten(x, y);
-    if( ( x + ( _resolution/2 + _x_offset)%_resolution) > _resolution
-        && y < _resolution && y >= 0 && !scan_off_bottom_side)
-      {
-	clearTop();
-	scan_off_bottom_side = true;
-      }
-    if( (x < _resolution
-         && (y + (_resolution/2 + _y_offset)%_resolution) > _resolution
-         && x >= 0 && !scan_off_right_side))
-      { 
-	clearLeft();
-	scan_off_right_side = true;
-      }
-    if( x < _resolution
-        && (y + (_resolution/2 + _y_offset)%_resolution ) < 0
-        && x >= 0 && !scan_off_left_side)
-      {
-	clearRight();
-	scan_off_left_side = true;
-      }
-    if( (x + (_resolution/2 + _x_offset)%_resolution ) < 0
-        && y >= 0
-        && y < _resolution && !scan_off_top_side)
-      {
-	clearBottom();
-	scan_off_top_side = true;
-      }
-    
-    
-    //fp = VisualLanes::cellLighten;
-    
-    
-    VisualLanes::line( 0, 0, (int)x, (int)y, (&VisualLanes::cellLighten));
+    // cells outside the grid are skipped, it scrolls with the robot
+    line<&VisualLanes::cellLighten>(0, 0, (int)x, (int)y);
     
     //lighten(x, y);
     double distance = Euclidean::DistanceTo(x,y,0,0);
@@ -256,14 +154,14 @@ if ( ( distance < (laser_range / _physical_size - EPSILON)) && ranges[l] != 0)
 	cell* c = at((int)x, (int)y);
 	if(c != NULL)
 	  {
-	    if((*c) < 0)
-	      (*c) = 3.5;
+	    if((*c) < LOGODDS_CELL_ZERO)
+	      (*c) = HIT_CELL;
 	    else
 	      {
 		//(*c) = std::min(LOGODDS_MAX_OCCUPANCY, (*c) +
 		//	 LOGODDS_OCCUPANCY_INCREMENT);
 		//printf("moo\n");
-		(*c) = LOGODDS_MAX_OCCUPANCY;
+		(*c) = MAX_CELL;
 	      }
 	  }	
       }
@@ -306,80 +204,70 @@ void VisualLanes::setThreshold(int threshold)
  * need number of args... but its there so I can get to the parameters
  * I want.
  */
-std::pair<int,int>* VisualLanes::cellLighten(int x, int y)
+bool VisualLanes::cellLighten(int x, int y)
 {
   cell* c = at(x,y);
   if(c != NULL)
     {
-      (*c) = std::max((*c)-LOGODDS_OCCUPANCY_DECREMENT, LOGODDS_MIN_OCCUPANCY);
-      //(*c) = LOGODDS_MIN_OCCUPANCY;
+      (*c) = std::max((*c)-DECREMENT_CELL, MIN_CELL);
+      //(*c) = MIN_CELL;
     } 
-  return NULL;	
+  return false;	
 }
 
 /**
- * If the cell is occupied then return the std::pair<int,int>
- * containing the x and y that refer to the occupancy grid point.
- * 
- * Note, don't forget that the pair will be casted to void* before
- * return!!
+ * If the cell is occupied then return true, so line() stops there
+ * and reports the x and y that refer to the occupancy grid point.
  */
-std::pair<int,int>* VisualLanes::cellOccupied(int x, int y)
+bool VisualLanes::cellOccupied(int x, int y)
 {
   cell* c = atgoal(x,y);
   if(c != NULL)
     {
       //cellLightenDebug(x,y);
-      if( *c >= _threshold )
+      if( logodds(*c) >= _threshold )
 	{
 	  //printf("x: %i, y: %i 's value: %i\n", x, y, *c);
 	  //printf("_threshold: %i: \n", _threshold);
-	  std::pair<int,int>* result = new std::pair<int,int>();
-	  result->first = x;
-	  result->second = y;
-	  return result;
+	  return true;
 	}
     }
-  return NULL;
+  return false;
 }
 
-std::pair<int,int>* VisualLanes::cellOccupiedDebug(int x, int y)
+bool VisualLanes::cellOccupiedDebug(int x, int y)
 {
   cell* c = atgoal(x,y);
   if(c != NULL)
     {
       //printf("x: %i, y: %i 's value: %i\n", x, y, *c);
       cellLightenDebug(x,y);
-      if( *c >= _threshold )
-	{
-	  std::pair<int,int>* result = new std::pair<int,int>();
-	  result->first = x;
-	  result->second = y;
-	  return result;
-	}
+      if( logodds(*c) >= _threshold )
+	return true;
     }
-  return NULL;
+  return false;
 }
 
-std::pair<int,int>* VisualLanes::cellLightenDebug(int x, int y)
+bool VisualLanes::cellLightenDebug(int x, int y)
 {
   cell* c = atgoal(x,y);
   if(c != NULL)
     {
-      //(*c) = std::max((*c)-LOGODDS_OCCUPANCY_DECREMENT, LOGODDS_MIN_OCCUPANCY);
-      (*c) = LOGODDS_MIN_OCCUPANCY;
+      //(*c) = std::max((*c)-DECREMENT_CELL, MIN_CELL);
+      (*c) = MIN_CELL;
     } 
-  return NULL;	
+  return false;	
 }
 
 /**
  * Takes in a function pointer to a function that opperates
  * on x and y cell. The x and y are cells that must be reached by
- * by a line trace.
+ * by a line trace.  As a template parameter, the function is
+ * called directly, usually inline.
  */
-std::pair<int,int>* VisualLanes::line(int x0, int y0, int x1, int y1,
-                                      std::pair<int,int>*
-                                      (VisualLanes::*_fp) (int,int))
+template <bool (VisualLanes::*_fp)(int,int)>
+bool VisualLanes::line(int x0, int y0, int x1, int y1,
+                       std::pair<int,int> *hit)
 {
   //This is how you invoke a pointer to a memeber function!!!
   //(this->*_fp)(1,1);
@@ -389,8 +277,6 @@ std::pair<int,int>* VisualLanes::line(int x0, int y0, int x1, int y1,
   int dx = x1 - x0;
   int stepx, stepy;
   
-  std::pair<int,int> *result = NULL;
-  
   if (dy < 0) { dy = -dy;  stepy = -1; } else { stepy = 1; }
   if (dx < 0) { dx = -dx;  stepx = -1; } else { stepx = 1; }
   dy <<= 1;                                                  // dy is now 2*dy
@@ -408,8 +294,12 @@ std::pair<int,int>* VisualLanes::line(int x0, int y0, int x1, int y1,
       }
       x0 += stepx;
       fraction += dy;                   // same as fraction -= 2*dy
-      if( (result = (this->*(_fp))(x0, y0)) != NULL  )
-	return result;
+      if( (this->*(_fp))(x0, y0) )
+	{
+	  if (hit != NULL)
+	    *hit = std::make_pair(x0, y0);
+	  return true;
+	}
     }
   } else {
     int fraction = dx - (dy >> 1);
@@ -420,16 +310,20 @@ std::pair<int,int>* VisualLanes::line(int x0, int y0, int x1, int y1,
       }
       y0 += stepy;
       fraction += dx;
-      if( (result = (this->*(_fp))(x0, y0)) != NULL  )
-	return result;
+      if( (this->*(_fp))(x0, y0) )
+	{
+	  if (hit != NULL)
+	    *hit = std::make_pair(x0, y0);
+	  return true;
+	}
     }
   }
-  return result;     
+  return false;
 }
 
-cell VisualLanes::value(int x, int y) {
+double VisualLanes::value(int x, int y) {
   if(valid(x, y)) {
-    return *(at(x,y));
+    return logodds(*(at(x,y)));
   }
   else return OCCUPANCY_UNKNOWN;
 }
@@ -443,7 +337,7 @@ bool VisualLanes::valid(int x, int y) {
 
 void VisualLanes::savePGM(const char *filename) {
   int i, j;
-  cell c;
+  double c;
   unsigned char d;
   FILE *file;
   
@@ -456,7 +350,7 @@ void VisualLanes::savePGM(const char *filename) {
   fprintf(file, "P5 %d %d 255\n", _resolution, _resolution);
   for (j = _resolution - 1; j >= 0; j--) {
     for (i = 0; i < _resolution; i++) {
-      c = _m[i][j];
+      c = logodds(_m[i * _resolution + j]);
       
       d = (unsigned char)((unsigned int)(((20 - c)*255/40)));
       
@@ -473,22 +367,17 @@ void VisualLanes::padObstacles()
   
 }
 
-std::pair<int,int>* VisualLanes::cellOccupiedRelative(int x, int y)
+bool VisualLanes::cellOccupiedRelative(int x, int y)
 {
   cell* c = at(x,y);
   if(c != NULL)
     {
-      if( *c >= _threshold )
-	{
-	  std::pair<int,int>* result = new std::pair<int,int>();
-	  result->first = x;
-	  result->second = y;
-	  return result;
-	}
+      if( logodds(*c) >= _threshold )
+	return true;
       //else
-      //   printf("c value %f\n", *c);
+      //   printf("c value %f\n", logodds(*c));
     }
-  return NULL;
+  return false;
 }
 
 std::pair<double,double>* VisualLanes::laserScan(double x, double y)
@@ -498,12 +387,11 @@ std::pair<double,double>* VisualLanes::laserScan(double x, double y)
   result->first = 0;
   result->second = 0;
   
-  std::pair<int,int>* temp;
+  std::pair<int,int> hit;
+  std::pair<int,int>* temp = &hit;
   //uses a different occupied that looks locally to the robot rather than
   //some global point in the map!!
-  temp = VisualLanes::line(0, 0, (int)x, (int)y,
-                           (&VisualLanes::cellOccupiedRelative));
-  if(temp != NULL)
+  if(line<&VisualLanes::cellOccupiedRelative>(0, 0, (int)x, (int)y, temp))
     {
       //double x_offsetObstacle = (2 * temp->first - _resolution)
       //                           /(_physical_size + 2);
@@ -516,7 +404,10 @@ std::pair<double,double>* VisualLanes::laserScan(double x, double y)
       //       x_offsetObstacle, y_offsetObstacle);
     }
   else
-    return NULL;
+    {
+      delete result;
+      return NULL;
+    }
   
   return result;    
 }
@@ -562,48 +453,41 @@ std::pair<double,double>* VisualLanes::isPathClear(double x, double y)
   
   //printf("xGoalLocal: %i yGoalLocal: %i xRobotLocal: %i yRobotLocal: %i\n",
   //       xGoalLocal, yGoalLocal, xRobotLocal, yRobotLocal);
-  std::pair<int,int>* center_collision;
   double offset_right = _theta-HALFPI;
   offset_right=Coordinates::normalize(offset_right);
   double offset_left = _theta+HALFPI;
   offset_left=Coordinates::normalize(offset_left);
   
-  center_collision = (VisualLanes::line(xRobotLocal, yRobotLocal,
-                                        xGoalLocal, yGoalLocal,
-                                        (&VisualLanes::cellOccupied)));
-  std::pair<int,int>* right_collision =
-    (VisualLanes::line((int)(cos(offset_right) * ONE_GRID + xRobotLocal),
-                       (int)(sin(offset_right) * ONE_GRID + yRobotLocal),
-                       (int)(cos(offset_right) * ONE_GRID + xGoalLocal),
-                       (int)(sin(offset_right) * ONE_GRID + yGoalLocal),
-                       (&VisualLanes::cellOccupied)));
-  std::pair<int,int>* right_collision2 =
-    (VisualLanes::line((int)(cos(offset_right) * TWO_GRID + xRobotLocal),
-                       (int)(sin(offset_right) * TWO_GRID + yRobotLocal),
-                       (int)(cos(offset_right) * TWO_GRID + xGoalLocal),
-                       (int)(sin(offset_right) * TWO_GRID + yGoalLocal),
-                       (&VisualLanes::cellOccupied)));
-  std::pair<int,int>* left_collision =
-    (VisualLanes::line((int)(cos(offset_left) * ONE_GRID + xRobotLocal),
-                       (int)(sin(offset_left) * ONE_GRID + yRobotLocal),
-                       (int)(cos(offset_left) * ONE_GRID + xGoalLocal),
-                       (int)(sin(offset_left) * ONE_GRID + yGoalLocal),
-                       (&VisualLanes::cellOccupied)));
-  std::pair<int,int>* left_collision2 =
-    (VisualLanes::line((int)(cos(offset_left) * TWO_GRID + xRobotLocal),
-                       (int)(sin(offset_left) * TWO_GRID + yRobotLocal),
-                       (int)(cos(offset_left) * TWO_GRID + xGoalLocal),
-                       (int)(sin(offset_left) * TWO_GRID + yGoalLocal),
-                       (&VisualLanes::cellOccupied)));
-  
-  std::pair<int,int>* collision = center_collision;
-  
-  //FORGIVE US JACK!
-  collision = (center_collision != NULL) ? center_collision : 
-    (right_collision != NULL) ? right_collision :
-    (right_collision2 != NULL) ? right_collision2 :
-    (left_collision != NULL) ? left_collision :
-    (left_collision2 != NULL) ? left_collision2 : NULL;
+  // first collision along the center, then one and two cells right,
+  // then one and two cells left
+  std::pair<int,int> hit;
+  std::pair<int,int>* collision = &hit;
+  bool blocked =
+    line<&VisualLanes::cellOccupied>(xRobotLocal, yRobotLocal,
+                                     xGoalLocal, yGoalLocal, collision)
+    || line<&VisualLanes::cellOccupied>
+    ((int)(cos(offset_right) * ONE_GRID + xRobotLocal),
+     (int)(sin(offset_right) * ONE_GRID + yRobotLocal),
+     (int)(cos(offset_right) * ONE_GRID + xGoalLocal),
+     (int)(sin(offset_right) * ONE_GRID + yGoalLocal), collision)
+    || line<&VisualLanes::cellOccupied>
+    ((int)(cos(offset_right) * TWO_GRID + xRobotLocal),
+     (int)(sin(offset_right) * TWO_GRID + yRobotLocal),
+     (int)(cos(offset_right) * TWO_GRID + xGoalLocal),
+     (int)(sin(offset_right) * TWO_GRID + yGoalLocal), collision)
+    || line<&VisualLanes::cellOccupied>
+    ((int)(cos(offset_left) * ONE_GRID + xRobotLocal),
+     (int)(sin(offset_left) * ONE_GRID + yRobotLocal),
+     (int)(cos(offset_left) * ONE_GRID + xGoalLocal),
+     (int)(sin(offset_left) * ONE_GRID + yGoalLocal), collision)
+    || line<&VisualLanes::cellOccupied>
+    ((int)(cos(offset_left) * TWO_GRID + xRobotLocal),
+     (int)(sin(offset_left) * TWO_GRID + yRobotLocal),
+     (int)(cos(offset_left) * TWO_GRID + xGoalLocal),
+     (int)(sin(offset_left) * TWO_GRID + yGoalLocal), collision);
+  
+  if(!blocked)
+    collision = NULL;
   
   if(collision != NULL)
     {
@@ -620,7 +504,10 @@ std::pair<double,double>* VisualLanes::isPathClear(double x, double y)
       //result->second = temp->second;
     }
   else
-    result = NULL;
+    {
+      delete result;
+      result = NULL;
+    }
   
   return result;
 }
@@ -639,7 +526,7 @@ std::pair<double,double>
 VisualLanes::nearestClearPath(std::pair<double,double> obstacle,
                               std::pair<double,double> original)
 {
-  std::pair<int,int>* temp;
+  std::pair<int,int> temp;
   
   double slop = 0;
   
@@ -721,36 +608,29 @@ VisualLanes::nearestClearPath(std::pair<double,double> obstacle,
         (int)(-1 * _shift * shiftScaler + localYobstacle);
       
       //Logic Flaw here to fix... at a later date
-      temp = (VisualLanes::line(localXshiftedUp, localYshiftedUp,
-                                (int)localXGoal, (int)localYGoal,
-                                (&VisualLanes::cellOccupied)));
-      if(temp == NULL)
+      if(!line<&VisualLanes::cellOccupied>(localXshiftedUp, localYshiftedUp,
+                                           (int)localXGoal, (int)localYGoal))
 	{
-	  temp = new std::pair<int,int>( (int)localXshiftedUp,
-                                         (int)localYshiftedUp);
+	  temp = std::pair<int,int>( (int)localXshiftedUp,
+                                     (int)localYshiftedUp);
 	  break;
 	}
-      temp = (VisualLanes::line(localXshiftedDown, localYshiftedDown,
-                                (int)localXGoal, (int)localYGoal,
-                                (&VisualLanes::cellOccupied)));
-      if(temp != NULL)
+      if(line<&VisualLanes::cellOccupied>(localXshiftedDown, localYshiftedDown,
+                                          (int)localXGoal, (int)localYGoal))
 	{
-	  temp = new std::pair<int,int>( (int)localXshiftedDown,
-                                         (int)localYshiftedDown);
+	  temp = std::pair<int,int>( (int)localXshiftedDown,
+                                     (int)localYshiftedDown);
 	  break;
 	}
       
       shiftScaler++;
     }
   
-  double x_offsetSubPoint = (2 * temp->first - _resolution)/(_physical_size + 2);
-  double y_offsetSubPoint = (2 * temp->second -_resolution)/(_physical_size + 2);
-  
-  std::pair<double,double>* result =
-    new std::pair<double,double>(_physical_size * x_offsetSubPoint,
-                                 _physical_size * y_offsetSubPoint);
+  double x_offsetSubPoint = (2 * temp.first - _resolution)/(_physical_size + 2);
+  double y_offsetSubPoint = (2 * temp.second -_resolution)/(_physical_size + 2);
   
-  return *result;
+  return std::pair<double,double>(_physical_size * x_offsetSubPoint,
+                                  _physical_size * y_offsetSubPoint);
 }
 
 
@@ -758,35 +638,16 @@ cell *VisualLanes::atgoal(int x, int y)
 {
   //printf(" cell x index %i\n",
   //       ((x + _resolution)/2 + x_offsetCurrentGoal) % _resolution);
-  return &(_m[x % _resolution][y % _resolution]);
+  return &_m[wrap(x) * _resolution + wrap(y)];
 }
 
 
 cell *VisualLanes::at(int x, int y) {
   if(valid(x,y)) {
     
-    int cellX = (x + _resolution / 2 + _x_offset) % _resolution;
-    int cellY = (y + _resolution / 2 + _y_offset) % _resolution;
-    //return &(_m[(x + _resolution / 2 + _x_offset) % _resolution]
-    //	 [(y + _resolution / 2 + _y_offset) % _resolution]);
-    
-    //if(cellY == 0)
-    //{
-    //	printf("The Y offset: %i\n", _y_offset);
-    //	printf("The Y value: %i\n", y);
-    //	printf("Cell Value: %i\n",
-    //         (y + _resolution/2 + _y_offset) % _resolution);
-    //}
-    if( cellX >= 0 && cellY >= 0 )
-      return &_m[cellX][cellY];
-    else if(cellY < 0 && cellX < 0)
-      return &_m[_resolution+cellX][_resolution+cellY];
-    else if(cellX < 0)
-      return &_m[_resolution+cellX][cellY];
-    else
-      return &_m[cellX][_resolution+cellY];
-    
-    
+    int cellX = wrap(x + _resolution / 2 + _x_offset);
+    int cellY = wrap(y + _resolution / 2 + _y_offset);
+    return &_m[cellX * _resolution + cellY];
   }
   return NULL;
 }
@@ -900,37 +761,7 @@ void VisualLanes::addMapLane(std::vector<double> ranges)
     double x = (ranges[l] * cos(tempTheta)) / _physical_size;
     double y = (ranges[l] * sin(tempTheta)) / _physical_size;
 
-    //lighten(x, y);
-    if(( x + ( _resolution/2 + _x_offset)%_resolution) > _resolution
-       && y < _resolution && y >= 0 && !scan_off_bottom_side)
-      {
-        clearTop();
-        scan_off_bottom_side = true;
-      }
-    if( (x < _resolution
-         && (y + (_resolution/2 + _y_offset)%_resolution) > _resolution
-         && x >= 0
-         && !scan_off_right_side))
-      { 
-        clearLeft();
-        scan_off_right_side = true;
-      }
-    if( x < _resolution
-        && (y + (_resolution/2 + _y_offset)%_resolution ) < 0
-        && x >= 0 && !scan_off_left_side)
-      {
-        clearRight();
-        scan_off_left_side = true;
-      }
-    if( (x + (_resolution/2 + _x_offset)%_resolution ) < 0
-        && y >= 0 && y < _resolution && !scan_off_top_side)
-      {
-        clearBottom();
-        scan_off_top_side = true;
-      }
-
-    VisualLanes::line( 0, 0, (int)x, (int)y,
-                       (&VisualLanes::drawPointW));
+    line<&VisualLanes::drawPointW>(0, 0, (int)x, (int)y);
 
     if(laneMark){
       drawPointB((int)x, (int)y);
@@ -954,18 +785,14 @@ void VisualLanes::addPoly(double x1, double x2, double x3, double x4,
   if(is_stop)
     {
       //draw front
-      VisualLanes::line((int)x2, (int)y2, (int)x3, (int)y3,
-                        (&VisualLanes::drawPointW));
+      line<&VisualLanes::drawPointW>((int)x2, (int)y2, (int)x3, (int)y3);
       //draw back
-      VisualLanes::line((int)x4, (int)y4, (int)x1, (int)y1,
-                        (&VisualLanes::drawPointW));
+      line<&VisualLanes::drawPointW>((int)x4, (int)y4, (int)x1, (int)y1);
     }
   //draw left
-  VisualLanes::line( (int)x1, (int)y1, (int)x2, (int)y2,
-                     (&VisualLanes::drawPointB));
+  line<&VisualLanes::drawPointB>((int)x1, (int)y1, (int)x2, (int)y2);
   //draw right
-  VisualLanes::line((int)x3, (int)y3, (int)x4, (int)y4,
-                    (&VisualLanes::drawPointB));
+  line<&VisualLanes::drawPointB>((int)x3, (int)y3, (int)x4, (int)y4);
 }
 
 void VisualLanes::addTrace(double w1lat, double w1long,
@@ -975,29 +802,28 @@ void VisualLanes::addTrace(double w1lat, double w1long,
   double y1 = w1long / _physical_size;
   double x2 = w2lat / _physical_size;
   double y2 = w2long / _physical_size;
-  VisualLanes::line( (int)x1, (int)y1, (int)x2, (int)y2,
-                     (&VisualLanes::drawPointW));
+  line<&VisualLanes::drawPointW>((int)x1, (int)y1, (int)x2, (int)y2);
 }
 
 //for map lanes: only makes cell black if not already white to avoid overdraw
-std::pair<int,int>* VisualLanes::drawPointB(int x, int y)
+bool VisualLanes::drawPointB(int x, int y)
 {
   cell* c = at(x,y);
   if(c != NULL)
     {
-      (*c) = LOGODDS_MAX_OCCUPANCY;;
+      (*c) = MAX_CELL;
     } 
-  return NULL;	
+  return false;	
 }
 
 //for map lanes
-std::pair<int,int>* VisualLanes::drawPointW(int x, int y)
+bool VisualLanes::drawPointW(int x, int y)
 {
   cell* c = at(x,y);
   if(c != NULL)
     {
-      (*c) = LOGODDS_MIN_OCCUPANCY;;
+      (*c) = MIN_CELL;
     } 
-  return NULL;	
+  return false;	
 }
 //end map lane stuff
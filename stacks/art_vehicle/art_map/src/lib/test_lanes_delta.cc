@@ -0,0 +1,180 @@
+/*
+ *  ART local road map delta encoding unit test
+ *
+ *  Copyright (C) 2010 Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <gtest/gtest.h>
+#include <art_map/LanesDelta.h>
+
+/** make a polygon whose shape depends on its poly_id */
+art_msgs::ArtQuadrilateral make_quad(int32_t poly_id, float shift=0.0)
+{
+  art_msgs::ArtQuadrilateral quad;
+  quad.poly_id = poly_id;
+  quad.poly.points.resize(4);
+  for (unsigned k = 0; k < 4; ++k)
+    {
+      quad.poly.points[k].x = 2.0 * poly_id + (k == 1 || k == 2? 2.0: 0.0);
+      quad.poly.points[k].y = shift + (k < 2? 1.5: -1.5);
+    }
+  quad.midpoint.x = 2.0 * poly_id + 1.0;
+  quad.midpoint.y = shift;
+  quad.heading = 0.0;
+  quad.length = 2.0;
+  return quad;
+}
+
+/** make local map of polygons [first, first + count), in order */
+art_msgs::ArtLanes make_map(int32_t first, int32_t count, uint32_t seq)
+{
+  art_msgs::ArtLanes lanes;
+  lanes.header.seq = seq;
+  for (int32_t id = first; id < first + count; ++id)
+    lanes.polygons.push_back(make_quad(id));
+  return lanes;
+}
+
+void expect_same_map(const art_msgs::ArtLanes &expected,
+                     const art_msgs::ArtLanes &actual)
+{
+  EXPECT_EQ(expected.header.seq, actual.header.seq);
+  ASSERT_EQ(expected.polygons.size(), actual.polygons.size());
+  for (unsigned i = 0; i < expected.polygons.size(); ++i)
+    {
+      const art_msgs::ArtQuadrilateral &a = expected.polygons[i];
+      const art_msgs::ArtQuadrilateral &b = actual.polygons[i];
+      EXPECT_EQ(a.poly_id, b.poly_id);
+      ASSERT_EQ(a.poly.points.size(), b.poly.points.size());
+      for (unsigned k = 0; k < a.poly.points.size(); ++k)
+        {
+          EXPECT_EQ(a.poly.points[k].x, b.poly.points[k].x);
+          EXPECT_EQ(a.poly.points[k].y, b.poly.points[k].y);
+        }
+      EXPECT_EQ(a.midpoint.x, b.midpoint.x);
+      EXPECT_EQ(a.midpoint.y, b.midpoint.y);
+    }
+}
+
+// a window sliding along the road, growing and shrinking
+TEST(LanesDelta, roundTrip)
+{
+  LanesDeltaEncoder encoder(10);
+  LanesDeltaDecoder decoder;
+  art_msgs::ArtLanesDelta delta;
+  unsigned keyframes = 0;
+
+  for (uint32_t seq = 0; seq < 100; ++seq)
+    {
+      art_msgs::ArtLanes lanes = make_map(seq / 2, 20 + seq % 7, seq);
+      encoder.encode(lanes, delta);
+      EXPECT_EQ(seq, delta.sequence);
+      if (delta.keyframe)
+        {
+          ++keyframes;
+          EXPECT_EQ(lanes.polygons.size(), delta.added.size());
+          EXPECT_TRUE(delta.removed.empty());
+        }
+      else
+        EXPECT_LT(delta.added.size(), lanes.polygons.size());
+
+      EXPECT_TRUE(decoder.update(delta));
+      expect_same_map(lanes, decoder.lanes());
+    }
+  EXPECT_EQ(10u, keyframes);
+}
+
+// a polygon changing shape is sent again
+TEST(LanesDelta, changedShape)
+{
+  LanesDeltaEncoder encoder(10);
+  LanesDeltaDecoder decoder;
+  art_msgs::ArtLanesDelta delta;
+
+  art_msgs::ArtLanes lanes = make_map(0, 10, 0);
+  encoder.encode(lanes, delta);
+  EXPECT_TRUE(decoder.update(delta));
+
+  lanes.header.seq = 1;
+  lanes.polygons[4] = make_quad(4, 0.25);
+  encoder.encode(lanes, delta);
+  EXPECT_FALSE(delta.keyframe);
+  ASSERT_EQ(1u, delta.added.size());
+  EXPECT_EQ(4, delta.added[0].poly_id);
+  EXPECT_TRUE(delta.removed.empty());
+
+  EXPECT_TRUE(decoder.update(delta));
+  expect_same_map(lanes, decoder.lanes());
+}
+
+// after a lost message, nothing is current until the next keyframe
+TEST(LanesDelta, lostMessage)
+{
+  LanesDeltaEncoder encoder(5);
+  LanesDeltaDecoder decoder;
+  art_msgs::ArtLanesDelta delta;
+  art_msgs::ArtLanes last_synced;
+
+  for (uint32_t seq = 0; seq < 30; ++seq)
+    {
+      art_msgs::ArtLanes lanes = make_map(seq, 12, seq);
+      encoder.encode(lanes, delta);
+      if (seq == 7 || seq == 16 || seq == 17)
+        continue;                       // lost
+
+      bool expect_sync = (seq < 7 || (seq >= 10 && seq < 16) || seq >= 20);
+      EXPECT_EQ(expect_sync, decoder.update(delta)) << "seq " << seq;
+      EXPECT_EQ(expect_sync, decoder.synced());
+      if (expect_sync)
+        {
+          expect_same_map(lanes, decoder.lanes());
+          last_synced = lanes;
+        }
+      else
+        {
+          // stale map is left alone
+          expect_same_map(last_synced, decoder.lanes());
+        }
+    }
+}
+
+// a map out of poly_id order goes whole, and so does the next one
+TEST(LanesDelta, unsortedMap)
+{
+  LanesDeltaEncoder encoder(10);
+  LanesDeltaDecoder decoder;
+  art_msgs::ArtLanesDelta delta;
+
+  art_msgs::ArtLanes lanes = make_map(0, 10, 0);
+  encoder.encode(lanes, delta);
+  EXPECT_TRUE(decoder.update(delta));
+
+  lanes = make_map(1, 10, 1);
+  std::swap(lanes.polygons[2], lanes.polygons[3]);
+  encoder.encode(lanes, delta);
+  EXPECT_TRUE(delta.keyframe);
+  EXPECT_TRUE(decoder.update(delta));
+  expect_same_map(lanes, decoder.lanes());
+
+  lanes = make_map(2, 10, 2);
+  encoder.encode(lanes, delta);
+  EXPECT_TRUE(delta.keyframe);
+  EXPECT_TRUE(decoder.update(delta));
+  expect_same_map(lanes, decoder.lanes());
+
+  lanes = make_map(3, 10, 3);
+  encoder.encode(lanes, delta);
+  EXPECT_FALSE(delta.keyframe);
+  EXPECT_TRUE(decoder.update(delta));
+  expect_same_map(lanes, decoder.lanes());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,151 @@
+/*
+ *  utility to generate synthetic RNDF and MDF files
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+
+#include <string>
+
+#include <art_map/RNDFGenerator.h>
+
+/** @file
+
+ @brief utility to generate synthetic RNDF and MDF files.
+
+ Lays out a grid of streets with four-way stops and parking lots,
+ and writes it as NAME.rndf, with a mission in NAME.mdf.
+
+*/
+
+static char *pname;
+static RNDFGeneratorConfig config;
+static const char *name;
+
+/** parse command line arguments */
+static void parse_args(int argc, char *argv[])
+{
+  bool print_usage = false;
+  const char *options = "b:c:hl:m:r:s:S:w:z:";
+  int opt = 0;
+  int option_index = 0;
+  struct option long_options[] =
+    {
+      { "block", 1, 0, 'b' },
+      { "cols", 1, 0, 'c' },
+      { "help", 0, 0, 'h' },
+      { "lanes", 1, 0, 'l' },
+      { "mission", 1, 0, 'm' },
+      { "rows", 1, 0, 'r' },
+      { "spots", 1, 0, 's' },
+      { "seed", 1, 0, 'S' },
+      { "spacing", 1, 0, 'w' },
+      { "zones", 1, 0, 'z' },
+      { 0, 0, 0, 0 }
+    };
+
+  /* basename $0 */
+  pname = strrchr(argv[0], '/');
+  if (pname == 0)
+    pname = argv[0];
+  else
+    pname++;
+
+  opterr = 0;
+  while ((opt = getopt_long(argc, argv, options,
+			    long_options, &option_index)) != EOF)
+    {
+      switch (opt)
+	{
+	case 'b':
+	  config.block_length = atof(optarg);
+	  break;
+
+	case 'c':
+	  config.cols = atoi(optarg);
+	  break;
+
+	case 'l':
+	  config.lanes = atoi(optarg);
+	  break;
+
+	case 'm':
+	  config.mission_checkpoints = atoi(optarg);
+	  break;
+
+	case 'r':
+	  config.rows = atoi(optarg);
+	  break;
+
+	case 's':
+	  config.spots = atoi(optarg);
+	  break;
+
+	case 'S':
+	  config.seed = strtoul(optarg, NULL, 0);
+	  break;
+
+	case 'w':
+	  config.waypoint_spacing = atof(optarg);
+	  break;
+
+	case 'z':
+	  config.zones = atoi(optarg);
+	  break;
+
+	default:
+	  fprintf(stderr, "unknown option character %c\n",
+		  optopt);
+	  /*fallthru*/
+	case 'h':
+	  print_usage = true;
+	}
+    }
+
+  if (print_usage || optind >= argc)
+    {
+      fprintf(stderr,
+	      "usage: %s [options] NAME\n\n"
+	      "    Write grid road network to NAME.rndf and NAME.mdf.\n"
+	      "    Possible options:\n"
+	      "\t-b, --block\tdistance between intersections (m)\n"
+	      "\t-c, --cols\tintersections from west to east\n"
+	      "\t-h, --help\tprint this message\n"
+	      "\t-l, --lanes\tlanes in each direction\n"
+	      "\t-m, --mission\tcheckpoints to visit in MDF\n"
+	      "\t-r, --rows\tintersections from south to north\n"
+	      "\t-s, --spots\tparking spots per zone\n"
+	      "\t-S, --seed\tseed for MDF checkpoints\n"
+	      "\t-w, --spacing\tdistance between way-points (m)\n"
+	      "\t-z, --zones\tnumber of parking zones\n",
+	      pname);
+      exit(9);
+    }
+
+  name = argv[optind];
+}
+
+/** main program */
+int main(int argc, char *argv[])
+{
+  parse_args(argc, argv);
+
+  RNDFGenerator gen(config);
+  std::string base(name);
+  if (!gen.write_rndf(base + ".rndf", base)
+      || !gen.write_mdf(base + ".mdf", base))
+    return 1;
+
+  printf("%s: %d segments, %d zones, %d way-points, %d checkpoints\n",
+	 name, gen.segments(), gen.zones(), gen.waypoints(),
+	 gen.checkpoints());
+  return 0;
+}
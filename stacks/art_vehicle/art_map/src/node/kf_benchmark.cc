@@ -0,0 +1,271 @@
+/*
+ *  utility to measure Kalman filter update speed
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include <art_map/Matrix.h>
+#include <art_map/FixedMatrix.h>
+#include <art_map/FilteredPolygon.h>
+
+/** @file
+
+ @brief utility to measure Kalman filter update speed.
+
+ Runs the same sequence of two-state measurement updates through the
+ heap-allocated Matrix class and the FixedMatrix template, checks
+ that both give the same answers, and prints updates per second.
+ Then times FilteredPolygon::UpdatePoint(), which does a distance and
+ an angle update through KF<2>.
+
+*/
+
+static char *pname;
+static int num_updates = 1000000;
+static int repeat = 3;
+
+/** @return current time in seconds */
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/** one measurement, from a robot position to a filtered point */
+struct Measurement
+{
+  float rx, ry;
+  float dist;
+  float bearing;
+};
+
+/** make a repeatable sequence of noisy measurements of (10, 20),
+ *  from the 5 to 80 meter range MapLanes::UpdateWithCurrent() uses
+ */
+static void make_measurements(Measurement m[], int n)
+{
+  srand(1);
+  for (int i = 0; i < n; ++i)
+    {
+      float range = 5.0 + (rand() % 7500) / 100.0;
+      float heading = (rand() % 6283) / 1000.0;
+      m[i].rx = 10.0 + range * cos(heading);
+      m[i].ry = 20.0 + range * sin(heading);
+      m[i].dist = range + (rand() % 100) / 100.0 - 0.5;
+      m[i].bearing = atan2(m[i].ry - 20.0, m[i].rx - 10.0)
+	+ (rand() % 100) / 10000.0 - 0.005;
+    }
+}
+
+/** Kalman filter state held in Matrix objects */
+struct HeapFilter
+{
+  Matrix I, X, P, Xchange;
+  HeapFilter(): I(2, 2, true), X(2, 1), P(2, 2), Xchange(2, 1)
+  {
+    X[0][0] = X[1][0] = -0.001;
+    P[0][0] = P[1][1] = 6.25;
+  }
+
+  /** distance update, as KF::MeasurementUpdateExtended() does it */
+  void update(const Measurement &m)
+  {
+    float x = X[0][0], y = X[1][0];
+    float d = sqrt(SQUARE(x - m.rx) + SQUARE(y - m.ry));
+    if (d == 0) d = 0.00001;
+    Matrix C(1, 2);
+    C[0][0] = (x - m.rx) / d;
+    C[0][1] = (y - m.ry) / d;
+
+    float innovation = m.dist - d;
+    float posVar = convDble(C*P*C.transp());
+    Xchange = Xchange - X;
+    float varPredError = posVar + m.dist * m.dist / 50;
+    Matrix J = P*C.transp()/varPredError;
+    Matrix newP = (I - J*C)*P;
+    X = X + J*innovation;
+    P = newP;
+    Xchange = Xchange + X;
+  }
+};
+
+/** Kalman filter state held in FixedMatrix objects */
+struct FixedFilter
+{
+  FixedMatrix<2,2> I, P;
+  FixedMatrix<2,1> X, Xchange;
+  FixedFilter(): I(true)
+  {
+    X[0][0] = X[1][0] = -0.001;
+    P[0][0] = P[1][1] = 6.25;
+  }
+
+  /** distance update, as KF<2>::MeasurementUpdateExtended() does it */
+  void update(const Measurement &m)
+  {
+    float x = X[0][0], y = X[1][0];
+    float d = sqrt(SQUARE(x - m.rx) + SQUARE(y - m.ry));
+    if (d == 0) d = 0.00001;
+    FixedMatrix<1,2> C;
+    C[0][0] = (x - m.rx) / d;
+    C[0][1] = (y - m.ry) / d;
+
+    float innovation = m.dist - d;
+    float posVar = convDble(C*P*C.transp());
+    Xchange = Xchange - X;
+    float varPredError = posVar + m.dist * m.dist / 50;
+    FixedMatrix<2,1> J = P*C.transp()/varPredError;
+    FixedMatrix<2,2> newP = (I - J*C)*P;
+    X = X + J*innovation;
+    P = newP;
+    Xchange = Xchange + X;
+  }
+};
+
+/** time a filter over all the measurements
+ *
+ * @return best elapsed time in seconds
+ */
+template <class Filter>
+static double time_filter(Filter &f, const Measurement m[], int n)
+{
+  double best = 0.0;
+  for (int r = 0; r < repeat; ++r)
+    {
+      f = Filter();
+      double t0 = now();
+      for (int i = 0; i < n; ++i)
+	f.update(m[i]);
+      double t = now() - t0;
+      if (r == 0 || t < best)
+	best = t;
+    }
+  return best;
+}
+
+/** parse command line arguments */
+static void parse_args(int argc, char *argv[])
+{
+  bool print_usage = false;
+  const char *options = "hn:r:";
+  int opt = 0;
+  int option_index = 0;
+  struct option long_options[] =
+    {
+      { "help", 0, 0, 'h' },
+      { "num", 1, 0, 'n' },
+      { "repeat", 1, 0, 'r' },
+      { 0, 0, 0, 0 }
+    };
+
+  /* basename $0 */
+  pname = strrchr(argv[0], '/');
+  if (pname == 0)
+    pname = argv[0];
+  else
+    pname++;
+
+  opterr = 0;
+  while ((opt = getopt_long(argc, argv, options,
+			    long_options, &option_index)) != EOF)
+    {
+      switch (opt)
+	{
+	case 'n':
+	  num_updates = atoi(optarg);
+	  break;
+
+	case 'r':
+	  repeat = atoi(optarg);
+	  break;
+
+	default:
+	  fprintf(stderr, "unknown option character %c\n",
+		  optopt);
+	  /*fallthru*/
+	case 'h':
+	  print_usage = true;
+	}
+    }
+
+  if (print_usage || num_updates <= 0 || repeat <= 0)
+    {
+      fprintf(stderr,
+	      "usage: %s [options]\n\n"
+	      "    Time Kalman filter updates.  Possible options:\n"
+	      "\t-h, --help\tprint this message\n"
+	      "\t-n, --num\tupdates per run (default 1000000)\n"
+	      "\t-r, --repeat\tnumber of timed runs (default 3)\n",
+	      pname);
+      exit(9);
+    }
+}
+
+/** main program */
+int main(int argc, char *argv[])
+{
+  parse_args(argc, argv);
+
+  Measurement *m = new Measurement[num_updates];
+  make_measurements(m, num_updates);
+
+  HeapFilter heap;
+  double t_heap = time_filter(heap, m, num_updates);
+  FixedFilter fixed;
+  double t_fixed = time_filter(fixed, m, num_updates);
+
+  int rc = 0;
+  for (int i = 0; i < 2; ++i)
+    {
+      if (heap.X[i][0] != fixed.X[i][0]
+	  || heap.P[i][0] != fixed.P[i][0]
+	  || heap.P[i][1] != fixed.P[i][1])
+	{
+	  fprintf(stderr, "%s: Matrix and FixedMatrix results differ\n",
+		  pname);
+	  rc = 1;
+	}
+    }
+
+  printf("Matrix:      %.3f s, %.0f updates/s\n",
+	 t_heap, num_updates / t_heap);
+  printf("FixedMatrix: %.3f s, %.0f updates/s (%.1fx)\n",
+	 t_fixed, num_updates / t_fixed, t_heap / t_fixed);
+
+  // FilteredPolygon::UpdatePoint() does two updates per call
+  double best = 0.0;
+  for (int r = 0; r < repeat; ++r)
+    {
+      FilteredPolygon fp;
+      poly p;
+      p.p1 = MapXY(10.0, 20.0);
+      p.p2 = MapXY(10.0, 25.0);
+      p.p3 = MapXY(13.0, 25.0);
+      p.p4 = MapXY(13.0, 20.0);
+      fp.SetPolygon(p);
+      double t0 = now();
+      for (int i = 0; i < num_updates; ++i)
+	fp.UpdatePoint(0, m[i].dist, m[i].bearing, 1.0,
+		       m[i].rx, m[i].ry, 0.0);
+      double t = now() - t0;
+      if (r == 0 || t < best)
+	best = t;
+    }
+  printf("FilteredPolygon::UpdatePoint: %.3f s, %.0f calls/s\n",
+	 best, num_updates / best);
+
+  delete [] m;
+  return rc;
+}
@@ -11,7 +11,10 @@
 
 #include <unistd.h>
 #include <string.h>
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <vector>
 
 #include <ros/ros.h>
 #include <tf/tf.h>
@@ -23,6 +26,7 @@
 
 #include <art_msgs/ArtLanes.h>
 #include <art_map/Graph.h>
+#include <art_map/LanesDelta.h>
 #include <art_map/MapLanes.h>
 #include <art_map/RNDF.h>
 
@@ -40,6 +44,9 @@ Publishes:
 
 - @b roadmap_global [art_msgs::ArtLanes] global road map lanes (latched topic)
 - @b roadmap_local [art_msgs::ArtLanes] local area road map lanes
+- @b roadmap_local_delta [art_msgs::ArtLanesDelta] local road map
+     lanes entering and leaving the area, with periodic keyframes
+     (see LanesDeltaDecoder)
 - @b visualization_marker_array [visualization_msgs::MarkerArray]
      markers for map visualization
 
@@ -80,12 +87,32 @@ private:
                        const art_msgs::ArtLanes &lane_data);
   void publishMapMarks(ros::Publisher &pub,
                        const std::string &map_name,
-                       ros::Duration life,
                        const art_msgs::ArtLanes &lane_data);
 
+  /** cached rviz markers for one polygon */
+  struct PolyMarks
+  {
+    bool has_lane;
+    bool has_way;
+    visualization_msgs::Marker lane;
+    visualization_msgs::Marker way;
+    art_msgs::ArtQuadrilateral quad;    // polygon they were made from
+  };
+  void makePolyMarks(const std::string &map_name,
+                     const art_msgs::ArtQuadrilateral &poly,
+                     PolyMarks &marks);
+  void deletePolyMarks(int32_t poly_id);
+
   // parameters:
   double range_;                ///< radius of local lanes to report (m)
+  double reuse_distance_;       ///< move before searching map again (m)
   double poly_size_;            ///< maximum polygon size (m)
+  int threads_;                 ///< polygon build threads (0 = all cores)
+  double tile_size_;            ///< polygon tile width (m), 0 for none
+  int max_tiles_;               ///< resident tile budget (0 = no limit)
+  int keyframe_interval_;       ///< local map deltas per keyframe
+  double marker_rate_;          ///< rviz marker update rate (Hz)
+  int marks_refresh_;           ///< marker updates per full refresh
   std::string rndf_name_;       ///< Road Network Definition File name
   std::string frame_id_;        ///< frame ID of map (default "/map")
 
@@ -95,11 +122,15 @@ private:
 
   ros::Publisher roadmap_global_;       // global road map publisher
   ros::Publisher roadmap_local_;        // local road map publisher
+  ros::Publisher roadmap_delta_;        // local road map changes
   ros::Publisher mapmarks_;             // rviz visualization markers
   ros::Publisher car_image_;            // rviz marker for 3D image of car
 
   ros::Publisher roadmap_cloud_;        // local road map point cloud
 
+  LanesDeltaEncoder delta_encoder_;     // local road map changes
+  art_msgs::ArtLanesDelta delta_msg_;   // reused on every cycle
+
   // this vector is only used while publishMapMarks() is running
   // we define it here to avoid memory allocation on every cycle
   sensor_msgs::PointCloud cloud_msg_;
@@ -108,6 +139,17 @@ private:
   // we define it here to avoid memory allocation on every cycle
   visualization_msgs::MarkerArray marks_msg_;
 
+  // rviz marker cache
+  std::map<int32_t, PolyMarks> marks_cache_; // markers by poly_id
+  std::vector<int32_t> marks_shown_;    // poly_ids sent, in order
+  std::vector<std::pair<int32_t, uint32_t> > marks_ids_; // (poly_id, index)
+  uint32_t marks_subscribers_;          // subscribers at last update
+  int marks_cycle_;                     // updates since full refresh
+  ros::Time next_marks_;                // time for next marker update
+
+  // poly_ids in cloud_msg_, to skip rebuilding it
+  std::vector<int32_t> cloud_ids_;
+
   Graph *graph_;                  ///< graph object (used by MapLanes)
   MapLanes* map_;                 ///< MapLanes object instance
   bool initial_position_;         ///< true if initial odometry received
@@ -117,6 +159,8 @@ private:
 MapLanesDriver::MapLanesDriver(void)
 {
   initial_position_ = false;
+  marks_subscribers_ = 0;
+  marks_cycle_ = 0;
 
   // use private node handle to get parameters
   ros::NodeHandle nh("~");
@@ -130,9 +174,44 @@ MapLanesDriver::MapLanesDriver(void)
   nh.param("range", range_, 80.0);
   ROS_INFO("range to publish = %.0f meters", range_);
 
+  nh.param("reuse_distance", reuse_distance_, 5.0);
+  if (reuse_distance_ < 0.0)
+    reuse_distance_ = 0.0;
+  ROS_INFO("local map search reused within %.1f meters", reuse_distance_);
+
   nh.param("poly_size", poly_size_, MIN_POLY_SIZE);
   ROS_INFO("polygon size = %.0f meters", poly_size_);
 
+  nh.param("threads", threads_, 0);
+  if (threads_ < 0)
+    threads_ = 0;
+  ROS_INFO("polygon build threads = %d (0 means all cores)", threads_);
+
+  nh.param("tile_size", tile_size_, 0.0);
+  nh.param("max_tiles", max_tiles_, 0);
+  if (tile_size_ < 0.0)
+    tile_size_ = 0.0;
+  if (max_tiles_ < 0)
+    max_tiles_ = 0;
+  if (tile_size_ > 0.0)
+    ROS_INFO("polygon tiles %.0f meters wide, %d resident (0 means all)",
+             tile_size_, max_tiles_);
+
+  nh.param("keyframe_interval", keyframe_interval_, 10);
+  if (keyframe_interval_ < 1)
+    keyframe_interval_ = 1;
+  ROS_INFO("local map keyframe every %d cycles", keyframe_interval_);
+  delta_encoder_.setKeyframeInterval(keyframe_interval_);
+
+  nh.param("marker_rate", marker_rate_, 2.0);
+  if (marker_rate_ <= 0.0)
+    marker_rate_ = art_msgs::ArtHertz::MAPLANES;
+  nh.param("marker_refresh", marks_refresh_, 10);
+  if (marks_refresh_ < 1)
+    marks_refresh_ = 1;
+  ROS_INFO("rviz markers at %.1f Hz, all resent every %d updates",
+           marker_rate_, marks_refresh_);
+
   rndf_name_ = "";
   std::string rndf_param;
   if (nh.searchParam("rndf", rndf_param))
@@ -147,6 +226,9 @@ MapLanesDriver::MapLanesDriver(void)
 
   // create the MapLanes class
   map_ = new MapLanes(range_);
+  map_->SetThreads(threads_);
+  map_->SetReuseDistance(reuse_distance_);
+  map_->SetTiles(tile_size_, max_tiles_);
   graph_ = NULL;
 }
 
@@ -208,6 +290,10 @@ int MapLanesDriver::Setup(ros::NodeHandle node)
   roadmap_local_ =
     node.advertise<art_msgs::ArtLanes>("roadmap_local", qDepth);
 
+  // Local road map changes publisher
+  roadmap_delta_ =
+    node.advertise<art_msgs::ArtLanesDelta>("roadmap_local_delta", qDepth);
+
   // Local road map point cloud publisher
   cloud_msg_.channels.clear();
   roadmap_cloud_ =
@@ -251,7 +337,8 @@ void MapLanesDriver::processOdom(const nav_msgs::Odometry::ConstPtr &odomIn)
 /** @brief Publish map point cloud
  *
  *  Converts polygon data into point cloud for clearing the occupancy
- *  grid.
+ *  grid.  The points are only rebuilt when the set of polygons
+ *  changes, which is not every cycle.
  *
  *  @param pub topic to publish
  *  @param lane_data polygons to publish
@@ -262,40 +349,147 @@ void MapLanesDriver::publishMapCloud(ros::Publisher &pub,
   if (pub.getNumSubscribers() == 0)     // no subscribers?
     return;
 
-  // clear message array, this is a class variable to avoid memory
-  // allocation and deallocation on every cycle
-  cloud_msg_.points.resize(3 * lane_data.polygons.size());
   cloud_msg_.header.frame_id = frame_id_;
   cloud_msg_.header.stamp = ros::Time::now();
 
-  int top_left = art_msgs::ArtQuadrilateral::top_left;
-  int top_right = art_msgs::ArtQuadrilateral::top_right;
+  bool same = (cloud_ids_.size() == lane_data.polygons.size());
+  for (uint32_t i = 0; same && i < lane_data.polygons.size(); ++i)
+    same = (cloud_ids_[i] == lane_data.polygons[i].poly_id);
 
-  for (uint32_t i = 0; i < lane_data.polygons.size(); ++i)
+  if (!same)
     {
-      cloud_msg_.points[3*i].x =
-        lane_data.polygons[i].midpoint.x;
-      cloud_msg_.points[3*i].y =
-        lane_data.polygons[i].midpoint.y;
-      cloud_msg_.points[3*i].z =
-        lane_data.polygons[i].midpoint.z;
-      cloud_msg_.points[3*i+1] =
-        lane_data.polygons[i].poly.points[top_left];
-      cloud_msg_.points[3*i+2] =
-        lane_data.polygons[i].poly.points[top_right];
+      // clear message array, this is a class variable to avoid memory
+      // allocation and deallocation on every cycle
+      cloud_msg_.points.resize(3 * lane_data.polygons.size());
+      cloud_ids_.resize(lane_data.polygons.size());
+
+      int top_left = art_msgs::ArtQuadrilateral::top_left;
+      int top_right = art_msgs::ArtQuadrilateral::top_right;
+
+      for (uint32_t i = 0; i < lane_data.polygons.size(); ++i)
+        {
+          cloud_msg_.points[3*i].x =
+            lane_data.polygons[i].midpoint.x;
+          cloud_msg_.points[3*i].y =
+            lane_data.polygons[i].midpoint.y;
+          cloud_msg_.points[3*i].z =
+            lane_data.polygons[i].midpoint.z;
+          cloud_msg_.points[3*i+1] =
+            lane_data.polygons[i].poly.points[top_left];
+          cloud_msg_.points[3*i+2] =
+            lane_data.polygons[i].poly.points[top_right];
+          cloud_ids_[i] = lane_data.polygons[i].poly_id;
+        }
     }
 
   pub.publish(cloud_msg_);
 }
 
+/** @brief Build rviz visualization markers for one polygon.
+ *
+ *  Markers are identified by poly_id, so they can be built once and
+ *  updated incrementally.  Their zero time stamps mean "always", so
+ *  cached copies never go stale.
+ *
+ *  @param map_name marker namespace
+ *  @param poly polygon to mark
+ *  @param marks returns markers for this polygon
+ */
+void MapLanesDriver::makePolyMarks(const std::string &map_name,
+                                   const art_msgs::ArtQuadrilateral &poly,
+                                   PolyMarks &marks)
+{
+  std_msgs::ColorRGBA green;            // green map markers
+  green.r = 0.0;
+  green.g = 1.0;
+  green.b = 0.0;
+  green.a = 1.0;
+
+  marks.quad = poly;
+  marks.has_lane = !poly.is_transition;
+  if (marks.has_lane)
+    {
+      visualization_msgs::Marker &lane = marks.lane;
+      lane.header.stamp = ros::Time();  // zero time means "always"
+      lane.header.frame_id = frame_id_;
+
+      // publish lane boundaries (experimental)
+      //
+      // It is almost certainly more efficient for rviz rendering
+      // to collect the right and left lane boundaries for each
+      // lane as two strips, then publish them as separate
+      // LINE_STRIP markers. This LINE_LIST version is an
+      // experiment to see how it looks (pretty good).
+      lane.ns = "lanes_" + map_name ;
+      lane.id = poly.poly_id;
+      lane.type = visualization_msgs::Marker::LINE_LIST;
+      lane.action = visualization_msgs::Marker::ADD;
+
+      // define lane boundary points: first left (0, 1), then right (2, 3)
+      lane.points.resize(poly.poly.points.size());
+      for (uint32_t j = 0; j < poly.poly.points.size(); ++j)
+        {
+          // convert Point32 message to Point (there should be a
+          // better way)
+          lane.points[j].x = poly.poly.points[j].x;
+          lane.points[j].y = poly.poly.points[j].y;
+          lane.points[j].z = poly.poly.points[j].z;
+        }
+
+      lane.scale.x = 0.1;               // 10cm lane boundaries
+      lane.color = green;
+      lane.lifetime = ros::Duration();  // until deleted
+    }
+
+  marks.has_way = poly.contains_way;
+  if (marks.has_way)
+    {
+      visualization_msgs::Marker &wp = marks.way;
+      wp.header.stamp = ros::Time();    // zero time means "always"
+      wp.header.frame_id = frame_id_;
+
+      // publish way-points
+      wp.ns = "waypoints_" + map_name;
+      wp.id = poly.poly_id;
+      wp.type = visualization_msgs::Marker::CYLINDER;
+      wp.action = visualization_msgs::Marker::ADD;
+
+      wp.pose.position = poly.midpoint;
+      wp.pose.orientation = tf::createQuaternionMsgFromYaw(poly.heading);
+
+      wp.scale.x = 1.0;
+      wp.scale.y = 1.0;
+      wp.scale.z = 0.1;
+      wp.lifetime = ros::Duration();    // until deleted
+
+      wp.color.a = 0.8;                 // way-points are slightly transparent
+      if (poly.is_stop)
+        {
+          // make stop way-points red
+          wp.color.r = 1.0;
+          wp.color.g = 0.0;
+          wp.color.b = 0.0;
+        }
+      else
+        {
+          // make other way-points yellow
+          wp.color.r = 1.0;
+          wp.color.g = 1.0;
+          wp.color.b = 0.0;
+        }
+    }
+}
+
 /** @brief Publish map visualization markers
  *
- *  Converts polygon data into an array of rviz visualization
- *  markers.
+ *  Sends rviz markers for polygons entering the map or changing
+ *  shape, and deletes those for polygons leaving it.  Markers are
+ *  built when a polygon enters the map, then cached until it leaves
+ *  or changes.  Every few cycles, and whenever a new subscriber
+ *  appears, all current markers are sent again.
  *
  *  @param pub topic to publish
  *  @param map_name marker namespace
- *  @param life lifespan for these markers
  *  @param lane_data polygons to publish
  *
  *  @note Do not to send too much information to rviz every cycle.  If
@@ -303,131 +497,96 @@ void MapLanesDriver::publishMapCloud(ros::Publisher &pub,
  */
 void MapLanesDriver::publishMapMarks(ros::Publisher &pub,
                                      const std::string &map_name,
-                                     ros::Duration life,
                                      const art_msgs::ArtLanes &lane_data)
 {
-  if (pub.getNumSubscribers() == 0)     // no subscribers?
-    return;
+  uint32_t subscribers = pub.getNumSubscribers();
+  if (subscribers == 0)                 // no subscribers?
+    {
+      marks_subscribers_ = 0;
+      return;
+    }
 
-  std_msgs::ColorRGBA green;            // green map markers
-  green.r = 0.0;
-  green.g = 1.0;
-  green.b = 0.0;
-  green.a = 1.0;
-  ros::Time now = ros::Time::now();
+  // resend everything if rviz may have missed something
+  bool resend = (subscribers > marks_subscribers_ || marks_cycle_ == 0);
+  marks_subscribers_ = subscribers;
+  if (++marks_cycle_ >= marks_refresh_)
+    marks_cycle_ = 0;
+
+  // polygons in the map now, in poly_id order
+  marks_ids_.resize(lane_data.polygons.size());
+  for (uint32_t i = 0; i < lane_data.polygons.size(); ++i)
+    marks_ids_[i] = std::make_pair(lane_data.polygons[i].poly_id, i);
+  std::sort(marks_ids_.begin(), marks_ids_.end());
 
   // clear message array, this is a class variable to avoid memory
   // allocation and deallocation on every cycle
   marks_msg_.markers.clear();
 
-  for (uint32_t i = 0; i < lane_data.polygons.size(); ++i)
+  // compare with polygons already shown
+  std::vector<int32_t>::const_iterator shown = marks_shown_.begin();
+  for (uint32_t i = 0; i < marks_ids_.size(); ++i)
     {
-#if 0
-      visualization_msgs::Marker mark;
-      mark.header.stamp = now;
-      mark.header.frame_id = frame_id_;
-
-      // publish polygon centers
-      mark.ns = "polygons_" + map_name;
-      mark.id = (int32_t) i;
-      mark.type = visualization_msgs::Marker::ARROW;
-      mark.action = visualization_msgs::Marker::ADD;
-
-      mark.pose.position = lane_data.polygons[i].midpoint;
-      mark.pose.orientation = 
-        tf::createQuaternionMsgFromYaw(lane_data.polygons[i].heading);
-
-      mark.scale.x = 1.0;
-      mark.scale.y = 1.0;
-      mark.scale.z = 1.0;
-      mark.color = green;
-      mark.lifetime = life;
-
-      // Add this polygon to the vector of markers to publish
-      marks_msg_.markers.push_back(mark);
-#endif
-      if (!lane_data.polygons[i].is_transition)
+      int32_t id = marks_ids_[i].first;
+      const art_msgs::ArtQuadrilateral &quad =
+        lane_data.polygons[marks_ids_[i].second];
+      for (; shown != marks_shown_.end() && *shown < id; ++shown)
+        deletePolyMarks(*shown);
+      bool still_there = (shown != marks_shown_.end() && *shown == id);
+      if (still_there)
+        ++shown;
+
+      // build its markers when entering the map or changing shape,
+      // using the same test as the local map delta encoder
+      std::map<int32_t, PolyMarks>::iterator it = marks_cache_.find(id);
+      if (it == marks_cache_.end())
         {
-          visualization_msgs::Marker lane;
-          lane.header.stamp = now;
-          lane.header.frame_id = frame_id_;
-
-          // publish lane boundaries (experimental)
-          //
-          // It is almost certainly more efficient for rviz rendering
-          // to collect the right and left lane boundaries for each
-          // lane as two strips, then publish them as separate
-          // LINE_STRIP markers. This LINE_LIST version is an
-          // experiment to see how it looks (pretty good).
-          lane.ns = "lanes_" + map_name ;
-          lane.id = (int32_t) i;
-          lane.type = visualization_msgs::Marker::LINE_LIST;
-          lane.action = visualization_msgs::Marker::ADD;
-
-          // define lane boundary points: first left (0, 1), then right (2, 3)
-          for (uint32_t j = 0;
-               j < lane_data.polygons[i].poly.points.size(); ++j)
-            {
-              // convert Point32 message to Point (there should be a
-              // better way)
-              geometry_msgs::Point p;
-              p.x = lane_data.polygons[i].poly.points[j].x;
-              p.y = lane_data.polygons[i].poly.points[j].y;
-              p.z = lane_data.polygons[i].poly.points[j].z;
-              lane.points.push_back(p);
-            }
-
-          lane.scale.x = 0.1;               // 10cm lane boundaries
-          lane.color = green;
-          lane.lifetime = life;
-
-          // Add these boundaries to the vector of markers to publish
-          marks_msg_.markers.push_back(lane);
-        }
-
-      if (lane_data.polygons[i].contains_way)
-        {
-          visualization_msgs::Marker wp;
-          wp.header.stamp = now;
-          wp.header.frame_id = frame_id_;
-
-          // publish way-points
-          wp.ns = "waypoints_" + map_name;
-          wp.id = (int32_t) i;
-          wp.type = visualization_msgs::Marker::CYLINDER;
-          wp.action = visualization_msgs::Marker::ADD;
-
-          wp.pose.position = lane_data.polygons[i].midpoint;
-          wp.pose.orientation = 
-            tf::createQuaternionMsgFromYaw(lane_data.polygons[i].heading);
-
-          wp.scale.x = 1.0;
-          wp.scale.y = 1.0;
-          wp.scale.z = 0.1;
-          wp.lifetime = life;
-
-          wp.color.a = 0.8;     // way-points are slightly transparent
-          if (lane_data.polygons[i].is_stop)
-            {
-              // make stop way-points red
-              wp.color.r = 1.0;
-              wp.color.g = 0.0;
-              wp.color.b = 0.0;
-            }
-          else
-            {
-              // make other way-points yellow
-              wp.color.r = 1.0;
-              wp.color.g = 1.0;
-              wp.color.b = 0.0;
-            }
-
-          // Add this way-point to the vector of markers to publish
-          marks_msg_.markers.push_back(wp);
+          it = marks_cache_.insert(std::make_pair(id, PolyMarks())).first;
+          makePolyMarks(map_name, quad, it->second);
         }
+      else if (!LanesDeltaEncoder::sameShape(it->second.quad, quad))
+        makePolyMarks(map_name, quad, it->second);
+      else if (still_there && !resend)
+        continue;
+      if (it->second.has_lane)
+        marks_msg_.markers.push_back(it->second.lane);
+      if (it->second.has_way)
+        marks_msg_.markers.push_back(it->second.way);
     }
+  for (; shown != marks_shown_.end(); ++shown)
+    deletePolyMarks(*shown);
+
+  marks_shown_.resize(marks_ids_.size());
+  for (uint32_t i = 0; i < marks_ids_.size(); ++i)
+    marks_shown_[i] = marks_ids_[i].first;
 
-  pub.publish(marks_msg_);
+  if (!marks_msg_.markers.empty())
+    pub.publish(marks_msg_);
+}
+
+/** @brief Add rviz DELETE markers for a polygon leaving the map,
+ *         and drop its cached markers.
+ */
+void MapLanesDriver::deletePolyMarks(int32_t poly_id)
+{
+  std::map<int32_t, PolyMarks>::iterator it = marks_cache_.find(poly_id);
+  if (it == marks_cache_.end())
+    return;
+
+  visualization_msgs::Marker mark;
+  mark.header.frame_id = frame_id_;
+  mark.action = visualization_msgs::Marker::DELETE;
+  mark.id = poly_id;
+  if (it->second.has_lane)
+    {
+      mark.ns = it->second.lane.ns;
+      marks_msg_.markers.push_back(mark);
+    }
+  if (it->second.has_way)
+    {
+      mark.ns = it->second.way.ns;
+      marks_msg_.markers.push_back(mark);
+    }
+  marks_cache_.erase(it);
 }
 
 /** Publish global road map */
@@ -449,7 +608,7 @@ void MapLanesDriver::publishGlobalMap(void)
   roadmap_global_.publish(lane_data);
 #if 0 // only publish local map (for now)
   // publish global map with permanent duration
-  publishMapMarks(mapmarks_, "global_roadmap", ros::Duration(), lane_data);
+  publishMapMarks(mapmarks_, "global_roadmap", lane_data);
 #endif
 }
 
@@ -472,9 +631,22 @@ void MapLanesDriver::publishLocalMap(void)
                    <<" local roadmap polygons");
   roadmap_local_.publish(lane_data);
 
-  // publish local map with temporary duration
-  publishMapMarks(mapmarks_, "local_roadmap",
-                  ros::Duration(art_msgs::ArtHertz::MAPLANES), lane_data);
+  // Deltas are relative to the last map encoded, so skipping them
+  // while nobody listens is safe.  New subscribers wait for the
+  // next keyframe anyway.
+  if (roadmap_delta_.getNumSubscribers() > 0)
+    {
+      delta_encoder_.encode(lane_data, delta_msg_);
+      roadmap_delta_.publish(delta_msg_);
+    }
+
+  // update rviz markers at their own rate
+  ros::Time now = ros::Time::now();
+  if (now >= next_marks_)
+    {
+      next_marks_ = now + ros::Duration(1.0 / marker_rate_);
+      publishMapMarks(mapmarks_, "local_roadmap", lane_data);
+    }
 
   // publish local map with temporary duration
   publishMapCloud(roadmap_cloud_, lane_data);
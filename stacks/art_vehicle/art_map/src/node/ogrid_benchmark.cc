@@ -0,0 +1,246 @@
+/*
+ *  utility to measure VisualLanes occupancy grid speed
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <vector>
+
+#include <art_map/VisualLanes.h>
+
+/** @file
+
+ @brief utility to measure VisualLanes occupancy grid speed.
+
+ Feeds a repeatable set of random 180 degree laser scans into a
+ VisualLanes grid, first with the vehicle standing still, then
+ driving a winding course so the grid keeps scrolling.  Prints scans
+ and cells updated per second, followed by laserScan() queries per
+ second against the resulting grid.
+
+*/
+
+static char *pname;
+static int num_scans = 2000;
+static int resolution = 400;
+static double cell_size = 0.25;
+static int repeat = 3;
+static const int scan_points = 181;
+
+/** @return current time in seconds */
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/** @return random double in [lo, hi) */
+static double uniform(double lo, double hi)
+{
+  return lo + (hi - lo) * (rand() / (RAND_MAX + 1.0));
+}
+
+/** make laser scans, mostly returns within the grid with a few
+ *  max range readings
+ */
+static void make_scans(std::vector<std::vector<double> > &scans, int n)
+{
+  srand(1);
+  double max_range = cell_size * resolution / 2;
+  scans.resize(n);
+  for (int s = 0; s < n; ++s)
+    {
+      scans[s].resize(scan_points);
+      for (int i = 0; i < scan_points; ++i)
+	scans[s][i] = (rand() % 20 == 0? MAX_RANGE:
+		       uniform(1.0, max_range));
+    }
+}
+
+/** @return number of cells ray traced by one scan */
+static long scan_cells(const std::vector<double> &ranges)
+{
+  long cells = 0;
+  for (int l = 0; l < 180; ++l)
+    {
+      double r = ranges[l] / cell_size;
+      double t = l * M_PI / 180.0;
+      cells += (long) std::max(fabs(r * cos(t)), fabs(r * sin(t))) + 1;
+    }
+  return cells;
+}
+
+/** time one pass of scans, returning elapsed seconds
+ *
+ * @param speed distance moved per scan (m), 0 to stand still
+ */
+static double run_scans(VisualLanes &grid,
+			const std::vector<std::vector<double> > &scans,
+			double speed)
+{
+  double x = 0.0, y = 0.0, heading = 0.0;
+  grid.initialize(x, y, heading);
+  double t0 = now();
+  for (unsigned s = 0; s < scans.size(); ++s)
+    {
+      if (speed > 0.0)
+	{
+	  heading += 0.01 * sin(s / 50.0);
+	  x += speed * cos(heading);
+	  y += speed * sin(heading);
+	}
+      grid.setPosition(x, y, heading);
+      grid.addSickScan(scans[s]);
+    }
+  return now() - t0;
+}
+
+/** print one result line */
+static void report(const char *name, double t, int scans, long cells)
+{
+  printf("%-16s %.3f s, %.0f scans/s, %.0f cells/s\n",
+	 name, t, scans / t, cells / t);
+}
+
+/** parse command line arguments */
+static void parse_args(int argc, char *argv[])
+{
+  bool print_usage = false;
+  const char *options = "c:hn:r:s:";
+  int opt = 0;
+  int option_index = 0;
+  struct option long_options[] =
+    {
+      { "cell", 1, 0, 'c' },
+      { "help", 0, 0, 'h' },
+      { "num", 1, 0, 'n' },
+      { "repeat", 1, 0, 'r' },
+      { "size", 1, 0, 's' },
+      { 0, 0, 0, 0 }
+    };
+
+  /* basename $0 */
+  pname = strrchr(argv[0], '/');
+  if (pname == 0)
+    pname = argv[0];
+  else
+    pname++;
+
+  opterr = 0;
+  while ((opt = getopt_long(argc, argv, options,
+			    long_options, &option_index)) != EOF)
+    {
+      switch (opt)
+	{
+	case 'c':
+	  cell_size = atof(optarg);
+	  break;
+
+	case 'n':
+	  num_scans = atoi(optarg);
+	  break;
+
+	case 'r':
+	  repeat = atoi(optarg);
+	  break;
+
+	case 's':
+	  resolution = atoi(optarg);
+	  break;
+
+	default:
+	  fprintf(stderr, "unknown option character %c\n",
+		  optopt);
+	  /*fallthru*/
+	case 'h':
+	  print_usage = true;
+	}
+    }
+
+  if (print_usage || num_scans <= 0 || resolution <= 2
+      || !(cell_size > 0.0) || repeat <= 0)
+    {
+      fprintf(stderr,
+	      "usage: %s [options]\n\n"
+	      "    Time occupancy grid updates.  Possible options:\n"
+	      "\t-c, --cell\tcell size in meters (default 0.25)\n"
+	      "\t-h, --help\tprint this message\n"
+	      "\t-n, --num\tlaser scans (default 2000)\n"
+	      "\t-r, --repeat\tnumber of timed runs (default 3)\n"
+	      "\t-s, --size\tgrid cells on a side (default 400)\n",
+	      pname);
+      exit(9);
+    }
+}
+
+/** main program */
+int main(int argc, char *argv[])
+{
+  parse_args(argc, argv);
+
+  std::vector<std::vector<double> > scans;
+  make_scans(scans, num_scans);
+  long cells = 0;
+  for (unsigned s = 0; s < scans.size(); ++s)
+    cells += scan_cells(scans[s]);
+
+  VisualLanes grid(cell_size, resolution);
+  grid.setLaserRange(MAX_RANGE);
+  grid.setThreshold(5);
+
+  printf("%d x %d grid of %.2f m cells, %lu bytes\n",
+	 resolution, resolution, cell_size,
+	 (unsigned long) (resolution * resolution * sizeof(cell)));
+
+  double t_still = 0.0, t_moving = 0.0;
+  for (int r = 0; r < repeat; ++r)
+    {
+      double t = run_scans(grid, scans, 0.0);
+      if (r == 0 || t < t_still)
+	t_still = t;
+      t = run_scans(grid, scans, 0.5);
+      if (r == 0 || t < t_moving)
+	t_moving = t;
+    }
+  report("standing still", t_still, num_scans, cells);
+  report("driving", t_moving, num_scans, cells);
+
+  // queries against the grid left by the last run
+  srand(2);
+  int num_queries = num_scans * 10;
+  double range = cell_size * resolution / 2;
+  std::vector<double> qx(num_queries), qy(num_queries);
+  for (int i = 0; i < num_queries; ++i)
+    {
+      qx[i] = uniform(-range, range);
+      qy[i] = uniform(-range, range);
+    }
+  int blocked = 0;
+  double t0 = now();
+  for (int i = 0; i < num_queries; ++i)
+    {
+      std::pair<double,double> *hit = grid.laserScan(qx[i], qy[i]);
+      if (hit != NULL)
+	{
+	  ++blocked;
+	  delete hit;
+	}
+    }
+  double t = now() - t0;
+  printf("%-16s %.3f s, %.0f queries/s, %d blocked\n",
+	 "laserScan", t, num_queries / t, blocked);
+
+  return 0;
+}
@@ -0,0 +1,298 @@
+/*
+ *  utility to measure point in polygon speed
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <vector>
+
+#include <art_map/PolyOps.h>
+
+/** @file
+
+ @brief utility to measure point in polygon speed.
+
+ Makes a road of random lane-sized quadrilaterals and a repeatable
+ set of random points around them.  Times the PolyOps point in
+ polygon, distance and closest polygon tests directly on the polygons
+ and through a QuadGeometry, checks that both give the same answers,
+ and prints tests per second.  Then classifies the points near the
+ first stretch of road, about the size of a local map, one at a time
+ and with the batch PolyOps::pointsInPolys().
+
+*/
+
+static char *pname;
+static int num_points = 2000000;
+static int num_quads = 1000;
+static int repeat = 3;
+static const int local_quads = 100;
+
+/** @return current time in seconds */
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/** @return random float in [lo, hi) */
+static float uniform(float lo, float hi)
+{
+  return lo + (hi - lo) * (rand() / (RAND_MAX + 1.0));
+}
+
+/** make a winding road of slightly irregular quads, each about
+ *  4 meters long and a lane wide
+ */
+static void make_quads(poly_list_t &polys, int n)
+{
+  srand(1);
+  polys.resize(n);
+  float x = 0.0, y = 0.0, heading = 0.0;
+  for (int i = 0; i < n; ++i)
+    {
+      poly &p = polys[i];
+      float len = uniform(3.0, 5.0);
+      float half = uniform(1.6, 2.0);
+      float turn = uniform(-0.1, 0.1);
+      float nx = x + len * cos(heading);
+      float ny = y + len * sin(heading);
+      float left = heading + M_PI/2;
+      float next_left = heading + turn + M_PI/2;
+      p.p1 = MapXY(x + half * cos(left), y + half * sin(left));
+      p.p2 = MapXY(nx + half * cos(next_left), ny + half * sin(next_left));
+      p.p3 = MapXY(nx - half * cos(next_left), ny - half * sin(next_left));
+      p.p4 = MapXY(x - half * cos(left), y - half * sin(left));
+      p.midpoint = MapXY((x + nx) / 2, (y + ny) / 2);
+      p.length = len;
+      p.heading = heading;
+      p.poly_id = i;
+      x = nx;
+      y = ny;
+      heading += turn;
+    }
+}
+
+/** make points scattered around randomly chosen quads
+ *
+ * @param quad receives index of the quad each point is near
+ */
+static void make_points(const poly_list_t &polys, MapXY pts[],
+			int quad[], int n)
+{
+  srand(2);
+  for (int i = 0; i < n; ++i)
+    {
+      quad[i] = rand() % polys.size();
+      const MapXY &mid = polys[quad[i]].midpoint;
+      pts[i] = MapXY(mid.x + uniform(-4.0, 4.0), mid.y + uniform(-4.0, 4.0));
+    }
+}
+
+/** print one result line */
+static void report(const char *name, double t_poly, double t_geom, int n)
+{
+  printf("%-22s poly: %.3f s, %.0f/s  geometry: %.3f s, %.0f/s (%.1fx)\n",
+	 name, t_poly, n / t_poly, t_geom, n / t_geom, t_poly / t_geom);
+}
+
+/** parse command line arguments */
+static void parse_args(int argc, char *argv[])
+{
+  bool print_usage = false;
+  const char *options = "hn:q:r:";
+  int opt = 0;
+  int option_index = 0;
+  struct option long_options[] =
+    {
+      { "help", 0, 0, 'h' },
+      { "num", 1, 0, 'n' },
+      { "quads", 1, 0, 'q' },
+      { "repeat", 1, 0, 'r' },
+      { 0, 0, 0, 0 }
+    };
+
+  /* basename $0 */
+  pname = strrchr(argv[0], '/');
+  if (pname == 0)
+    pname = argv[0];
+  else
+    pname++;
+
+  opterr = 0;
+  while ((opt = getopt_long(argc, argv, options,
+			    long_options, &option_index)) != EOF)
+    {
+      switch (opt)
+	{
+	case 'n':
+	  num_points = atoi(optarg);
+	  break;
+
+	case 'q':
+	  num_quads = atoi(optarg);
+	  break;
+
+	case 'r':
+	  repeat = atoi(optarg);
+	  break;
+
+	default:
+	  fprintf(stderr, "unknown option character %c\n",
+		  optopt);
+	  /*fallthru*/
+	case 'h':
+	  print_usage = true;
+	}
+    }
+
+  if (print_usage || num_points <= 0 || num_quads <= 0 || repeat <= 0)
+    {
+      fprintf(stderr,
+	      "usage: %s [options]\n\n"
+	      "    Time point in polygon tests.  Possible options:\n"
+	      "\t-h, --help\tprint this message\n"
+	      "\t-n, --num\tquery points (default 2000000)\n"
+	      "\t-q, --quads\tquads in the road (default 1000)\n"
+	      "\t-r, --repeat\tnumber of timed runs (default 3)\n",
+	      pname);
+      exit(9);
+    }
+}
+
+/** main program */
+int main(int argc, char *argv[])
+{
+  parse_args(argc, argv);
+
+  PolyOps pops;
+  poly_list_t polys;
+  make_quads(polys, num_quads);
+  QuadGeometry geom(polys);
+
+  MapXY *pts = new MapXY[num_points];
+  int *quad = new int[num_points];
+  make_points(polys, pts, quad, num_points);
+
+  int rc = 0;
+  int mismatches = 0;
+  double best_poly[2] = {0.0, 0.0};
+  double best_geom[2] = {0.0, 0.0};
+  for (int r = 0; r < repeat; ++r)
+    {
+      // point in polygon
+      int in_poly = 0, in_geom = 0;
+      double t0 = now();
+      for (int i = 0; i < num_points; ++i)
+	in_poly += pops.pointInPoly(pts[i], polys[quad[i]]);
+      double t1 = now();
+      for (int i = 0; i < num_points; ++i)
+	in_geom += pops.pointInPoly(pts[i].x, pts[i].y, polys, geom, quad[i]);
+      double t2 = now();
+      if (in_poly != in_geom)
+	++mismatches;
+      if (r == 0 || t1 - t0 < best_poly[0])
+	best_poly[0] = t1 - t0;
+      if (r == 0 || t2 - t1 < best_geom[0])
+	best_geom[0] = t2 - t1;
+
+      // distance to polygon
+      double d_poly = 0.0, d_geom = 0.0;
+      t0 = now();
+      for (int i = 0; i < num_points; ++i)
+	d_poly += pops.getShortestDistToPoly(pts[i], polys[quad[i]]);
+      t1 = now();
+      for (int i = 0; i < num_points; ++i)
+	d_geom += pops.getShortestDistToPoly(pts[i].x, pts[i].y,
+					     polys, geom, quad[i]);
+      t2 = now();
+      if (d_poly != d_geom)
+	++mismatches;
+      if (r == 0 || t1 - t0 < best_poly[1])
+	best_poly[1] = t1 - t0;
+      if (r == 0 || t2 - t1 < best_geom[1])
+	best_geom[1] = t2 - t1;
+    }
+  report("pointInPoly", best_poly[0], best_geom[0], num_points);
+  report("getShortestDistToPoly", best_poly[1], best_geom[1], num_points);
+
+  // closest polygon searches the whole road for each point, so use
+  // fewer of them
+  int num_closest = num_points / num_quads + 1;
+  double t_poly = 0.0, t_geom = 0.0;
+  for (int r = 0; r < repeat; ++r)
+    {
+      double t0 = now();
+      for (int i = 0; i < num_closest; ++i)
+	quad[i] = pops.getClosestPoly(polys, pts[i]);
+      double t1 = now();
+      for (int i = 0; i < num_closest; ++i)
+	if (quad[i] != pops.getClosestPoly(polys, geom, pts[i]))
+	  ++mismatches;
+      double t2 = now();
+      if (r == 0 || t1 - t0 < t_poly)
+	t_poly = t1 - t0;
+      if (r == 0 || t2 - t1 < t_geom)
+	t_geom = t2 - t1;
+    }
+  report("getClosestPoly", t_poly, t_geom, num_closest);
+
+  // classify points near a local map, like the points_on_road node
+  poly_list_t local(polys.begin(),
+		    polys.begin() + std::min(local_quads, num_quads));
+  QuadGeometry local_geom(local);
+  int num_local = num_points / 10 + 1;
+  MapXY *local_pts = new MapXY[num_local];
+  make_points(local, local_pts, quad, num_local);
+  std::vector<float> x(num_local), y(num_local);
+  for (int j = 0; j < num_local; ++j)
+    {
+      x[j] = local_pts[j].x;
+      y[j] = local_pts[j].y;
+    }
+  std::vector<unsigned char> in_poly(num_local), in_batch(num_local);
+  for (int r = 0; r < repeat; ++r)
+    {
+      double t0 = now();
+      for (int j = 0; j < num_local; ++j)
+	{
+	  in_poly[j] = 0;
+	  for (unsigned i = 0; i < local.size() && !in_poly[j]; ++i)
+	    in_poly[j] = pops.pointInPoly(x[j], y[j], local[i]);
+	}
+      double t1 = now();
+      pops.pointsInPolys(&x[0], &y[0], num_local, local, local_geom,
+			 &in_batch[0]);
+      double t2 = now();
+      if (in_poly != in_batch)
+	++mismatches;
+      if (r == 0 || t1 - t0 < t_poly)
+	t_poly = t1 - t0;
+      if (r == 0 || t2 - t1 < t_geom)
+	t_geom = t2 - t1;
+    }
+  report("pointsInPolys", t_poly, t_geom, num_local);
+
+  if (mismatches)
+    {
+      fprintf(stderr, "%s: polygon and geometry results differ\n", pname);
+      rc = 1;
+    }
+
+  delete [] pts;
+  delete [] local_pts;
+  delete [] quad;
+  return rc;
+}
@@ -0,0 +1,236 @@
+/*
+ *  utility to measure RNDF parsing speed
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <art_map/RNDF.h>
+#include <art_map/Graph.h>
+
+/** @file
+
+ @brief utility to measure RNDF parsing speed.
+
+ Writes a synthetic RNDF with the requested number of way-points
+ (one lane per segment, near Austin), then times parsing it and
+ building the way-point graph.
+
+*/
+
+static char *pname;
+static int num_waypoints = 1000000;
+static int lane_waypoints = 1000;
+static int repeat = 3;
+static bool keep_file = false;
+static const char *rndf_name = "/tmp/rndf_benchmark.rndf";
+
+/** @return current time in seconds */
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/** write a synthetic RNDF
+ *
+ * @return true if successful
+ */
+static bool write_rndf(const char *filename, int waypoints, int per_lane)
+{
+  FILE *f = fopen(filename, "w");
+  if (f == NULL)
+    {
+      perror(filename);
+      return false;
+    }
+
+  int nsegs = (waypoints + per_lane - 1) / per_lane;
+  fprintf(f, "RNDF_name\tbenchmark\n");
+  fprintf(f, "num_segments\t%d\n", nsegs);
+  fprintf(f, "num_zones\t0\n");
+  fprintf(f, "format_version\t1.0\n");
+  fprintf(f, "creation_date\t2010-01-01\n");
+
+  int left = waypoints;
+  for (int s = 1; s <= nsegs; ++s)
+    {
+      int npts = (left < per_lane? left: per_lane);
+      left -= npts;
+
+      // parallel east-west lanes, about 10 meters apart
+      double lat = 30.3800000 + (s-1) * 0.0001;
+      fprintf(f, "segment\t%d\n", s);
+      fprintf(f, "num_lanes\t1\n");
+      fprintf(f, "segment_name\tseg%d\n", s);
+      fprintf(f, "lane\t%d.1\n", s);
+      fprintf(f, "num_waypoints\t%d\n", npts);
+      fprintf(f, "lane_width\t12\n");
+      fprintf(f, "left_boundary\tdouble_yellow\n");
+      fprintf(f, "right_boundary\tsolid_white\n");
+      fprintf(f, "stop\t%d.1.%d\n", s, npts);
+      for (int p = 1; p <= npts; ++p)
+	fprintf(f, "%d.1.%d\t%.7f\t%.7f\n", s, p,
+		lat, -97.7400000 + p * 0.00005);
+      fprintf(f, "end_lane\n");
+      fprintf(f, "end_segment\n");
+    }
+  fprintf(f, "end_file\n");
+
+  if (fclose(f) != 0)
+    {
+      perror(filename);
+      return false;
+    }
+  return true;
+}
+
+/** parse command line arguments */
+static void parse_args(int argc, char *argv[])
+{
+  bool print_usage = false;
+  const char *options = "hkl:n:o:r:";
+  int opt = 0;
+  int option_index = 0;
+  struct option long_options[] =
+    {
+      { "help", 0, 0, 'h' },
+      { "keep", 0, 0, 'k' },
+      { "lane", 1, 0, 'l' },
+      { "num", 1, 0, 'n' },
+      { "output", 1, 0, 'o' },
+      { "repeat", 1, 0, 'r' },
+      { 0, 0, 0, 0 }
+    };
+
+  /* basename $0 */
+  pname = strrchr(argv[0], '/');
+  if (pname == 0)
+    pname = argv[0];
+  else
+    pname++;
+
+  opterr = 0;
+  while ((opt = getopt_long(argc, argv, options,
+			    long_options, &option_index)) != EOF)
+    {
+      switch (opt)
+	{
+	case 'k':
+	  keep_file = true;
+	  break;
+
+	case 'l':
+	  lane_waypoints = atoi(optarg);
+	  break;
+
+	case 'n':
+	  num_waypoints = atoi(optarg);
+	  break;
+
+	case 'o':
+	  rndf_name = optarg;
+	  break;
+
+	case 'r':
+	  repeat = atoi(optarg);
+	  break;
+
+	default:
+	  fprintf(stderr, "unknown option character %c\n",
+		  optopt);
+	  /*fallthru*/
+	case 'h':
+	  print_usage = true;
+	}
+    }
+
+  if (print_usage || num_waypoints <= 0 || lane_waypoints <= 0
+      || repeat <= 0)
+    {
+      fprintf(stderr,
+	      "usage: %s [options]\n\n"
+	      "    Time parsing a synthetic RNDF.  Possible options:\n"
+	      "\t-h, --help\tprint this message\n"
+	      "\t-k, --keep\tdo not delete the RNDF file\n"
+	      "\t-l, --lane\tway-points per lane (default 1000)\n"
+	      "\t-n, --num\ttotal way-points (default 1000000)\n"
+	      "\t-o, --output\tRNDF file name\n"
+	      "\t-r, --repeat\tnumber of timed runs (default 3)\n",
+	      pname);
+      exit(9);
+    }
+}
+
+/** main program */
+int main(int argc, char *argv[])
+{
+  parse_args(argc, argv);
+
+  if (!write_rndf(rndf_name, num_waypoints, lane_waypoints))
+    return 1;
+
+  struct stat st;
+  if (stat(rndf_name, &st) != 0)
+    {
+      perror(rndf_name);
+      return 1;
+    }
+  double mbytes = st.st_size / (1024.0 * 1024.0);
+  printf("%s: %d way-points, %.1f MB\n", rndf_name, num_waypoints, mbytes);
+
+  int rc = 0;
+  double best_parse = 0.0;
+  double best_graph = 0.0;
+  for (int i = 0; i < repeat; ++i)
+    {
+      double t0 = now();
+      RNDF *rndf = new RNDF(rndf_name);
+      double t1 = now();
+      if (!rndf->is_valid)
+	{
+	  fprintf(stderr, "%s: RNDF not valid\n", rndf_name);
+	  delete rndf;
+	  rc = 1;
+	  break;
+	}
+
+      Graph *graph = new Graph();
+      rndf->populate_graph(*graph);
+      double t2 = now();
+
+      printf("run %d: parse %.3f s, graph %.3f s, %u nodes\n",
+	     i+1, t1 - t0, t2 - t1, graph->nodes_size);
+
+      if (i == 0 || t1 - t0 < best_parse)
+	best_parse = t1 - t0;
+      if (i == 0 || t2 - t1 < best_graph)
+	best_graph = t2 - t1;
+
+      delete graph;
+      delete rndf;
+    }
+
+  if (rc == 0)
+    printf("best: parse %.3f s (%.0f way-points/s, %.1f MB/s),"
+	   " graph %.3f s\n",
+	   best_parse, num_waypoints / best_parse, mbytes / best_parse,
+	   best_graph);
+
+  if (!keep_file)
+    unlink(rndf_name);
+
+  return rc;
+}
@@ -12,6 +12,7 @@
 #define _ESTIMATE_H_
 
 #include <nav_msgs/Odometry.h>
+#include <art_nav/odom_history.h>
 
 /** @file
  *
@@ -23,6 +24,14 @@ namespace Estimate
                     ros::Time est_time,
                     nav_msgs::Odometry &est);
 
+  void control_pose(const OdomHistory &history,
+                    const nav_msgs::Odometry &odom,
+                    ros::Time est_time,
+                    nav_msgs::Odometry &est);
+
+  void extrapolate(double &x, double &y, double &yaw,
+                   double speed, double yaw_rate, double dt);
+
   void front_bumper_pose(const nav_msgs::Odometry &odom,
                          nav_msgs::Odometry &est);
 
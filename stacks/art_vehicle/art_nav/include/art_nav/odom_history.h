@@ -0,0 +1,106 @@
+/* -*- mode: C++ -*-
+ *
+ *  ART odometry history
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#ifndef _ODOM_HISTORY_H_
+#define _ODOM_HISTORY_H_
+
+#include <nav_msgs/Odometry.h>
+
+/** @file
+ *
+ *  @brief ART odometry history ring buffer.
+ */
+
+/** @brief Recent odometry, indexed by time stamp.
+ *
+ *  Keeps the planar pose, speed and yaw rate of the last SIZE
+ *  odometry messages, not the messages themselves, so data stamped
+ *  in the recent past can be matched with the pose at that time.
+ *
+ *  One thread adds samples, any number read them, and no one ever
+ *  waits.  Each slot has a sequence number, odd while being written
+ *  and counting the times it was filled, so a reader can tell it
+ *  copied a sample intact, and which one it was.  Readers retry when
+ *  the writer laps them.
+ */
+class OdomHistory
+{
+ public:
+  static const unsigned SIZE = 128;	//< samples kept, power of two
+
+  /** one odometry sample */
+  struct Sample
+  {
+    double time;			//< time stamp (s)
+    double x, y;			//< position (m)
+    double yaw;				//< heading (radians)
+    double speed;			//< forward velocity (m/s)
+    double yaw_rate;			//< (radians/s)
+  };
+
+  OdomHistory(): head_(0)
+  {
+    for (unsigned i = 0; i < SIZE; ++i)
+      slots_[i].seq = 0;
+  }
+
+  /** add a sample from odometry, writer thread only
+   *
+   * @return false if not newer than the last sample added
+   */
+  bool add(const nav_msgs::Odometry &odom);
+
+  /** @return true if any sample available */
+  bool empty(void) const
+  {
+    return head_ == 0;
+  }
+
+  /** get the newest sample
+   *
+   * @return true if successful
+   */
+  bool latest(Sample &s) const;
+
+  /** interpolate between the samples around time @a t
+   *
+   * @return true if successful, false if @a t is not within the
+   *         history, or equal to the newest sample time
+   */
+  bool interpolate(const ros::Time &t, Sample &s) const;
+
+  /** estimate the sample at time @a t, interpolating within the
+   *  history, or extrapolating past the newest sample at constant
+   *  speed and yaw rate
+   *
+   * @param max_dt extrapolate at most this many seconds
+   * @return true if successful
+   */
+  bool estimate(const ros::Time &t, Sample &s, double max_dt=1.0) const;
+
+ private:
+  struct Slot
+  {
+    volatile unsigned long seq;		// 2 * times filled, odd if writing
+    volatile double time;
+    volatile double x, y, yaw;
+    volatile double speed, yaw_rate;
+  };
+
+  static void blend(const Sample &before, const Sample &after,
+		    double t, Sample &s);
+  bool read(unsigned long n, Sample &s) const;
+  int search(double t, Sample &before, Sample &after) const;
+
+  Slot slots_[SIZE];
+  volatile unsigned long head_;		// samples ever added
+};
+
+#endif // _ODOM_HISTORY_H_
@@ -0,0 +1,409 @@
+/*
+ *  measure how the map stack scales with road network size
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <art_msgs/ArtLanes.h>
+#include <art_map/Graph.h>
+#include <art_map/MapLanes.h>
+#include <art_map/PolyOps.h>
+#include <art_map/RNDF.h>
+#include <art_map/RNDFGenerator.h>
+#include <art_nav/GraphSearch.h>
+
+/** @file
+
+ @brief measure how the map stack scales with road network size.
+
+ For each grid size, generates a synthetic RNDF and MDF, then
+ reports:
+
+   - RNDF and MDF parse time
+   - graph build time (populate_graph(), find_mapxy() and MDF speed
+     limits), and find_implicit_edges() separately
+   - MapLanes polygon build time
+   - resident memory growth after building everything
+   - A* latency percentiles between random lane way-points
+   - PolyOps and Graph query rates at random map points
+
+ Each grid size runs in its own process, so the memory figures are
+ not affected by earlier runs.
+
+*/
+
+static char *pname;
+static std::vector<int> grid_sizes;
+static RNDFGeneratorConfig config;
+static bool zones_given = false;
+static int astar_queries = 100;
+static int point_queries = 10000;
+static unsigned threads = 0;
+static bool keep_files = false;
+static const char *file_prefix = "/tmp/map_benchmark";
+
+/** @return current time in seconds */
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/** @return resident set size in megabytes */
+static double resident_mbytes(void)
+{
+  long pages = 0;
+  long resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f != NULL)
+    {
+      if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+	resident = 0;
+      fclose(f);
+    }
+  return resident * (sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+}
+
+/** @return nearest-rank percentile of sorted samples */
+static double percentile(const std::vector<double> &sorted, double pct)
+{
+  if (sorted.empty())
+    return 0.0;
+  int rank = (int) (pct / 100.0 * sorted.size() + 0.999999);
+  if (rank < 1)
+    rank = 1;
+  return sorted[std::min(rank, (int) sorted.size()) - 1];
+}
+
+/** run all measurements for one grid size
+ *
+ *  @return 0 if successful
+ */
+static int run_scale(int size)
+{
+  RNDFGeneratorConfig cfg = config;
+  cfg.rows = cfg.cols = size;
+  if (!zones_given)
+    cfg.zones = (size - 1) * (size - 1) / 4;
+
+  char base[256];
+  snprintf(base, sizeof(base), "%s_%d", file_prefix, size);
+  std::string rndf_name = std::string(base) + ".rndf";
+  std::string mdf_name = std::string(base) + ".mdf";
+
+  RNDFGenerator gen(cfg);
+  if (!gen.write_rndf(rndf_name, base) || !gen.write_mdf(mdf_name, base))
+    return 1;
+
+  double rss0 = resident_mbytes();
+
+  // parse
+  double t0 = now();
+  RNDF *rndf = new RNDF(rndf_name);
+  MDF *mdf = new MDF(mdf_name);
+  double t1 = now();
+  if (!rndf->is_valid || !mdf->is_valid)
+    {
+      fprintf(stderr, "%s: generated files not valid\n", base);
+      return 1;
+    }
+
+  // graph
+  Graph *graph = new Graph();
+  rndf->populate_graph(*graph);
+  graph->find_mapxy();
+  mdf->add_speed_limits(*graph);
+  double t2 = now();
+  graph->find_implicit_edges();
+  double t3 = now();
+
+  // polygons
+  MapLanes *mapl = new MapLanes();
+  mapl->SetThreads(threads);
+  int rc = mapl->MapRNDF(graph);
+  double t4 = now();
+  if (rc != 0)
+    {
+      fprintf(stderr, "%s: cannot process RNDF (error code %d)\n", base, rc);
+      return 1;
+    }
+  art_msgs::ArtLanes lanes;
+  mapl->getAllLanes(&lanes);
+  PolyOps pops;
+  std::vector<poly> polys;
+  pops.GetPolys(lanes, polys);
+
+  double rss = resident_mbytes() - rss0;
+
+  // A* between random lane way-points
+  std::vector<waypt_index_t> lane_nodes;
+  float min_x = 0.0, max_x = 0.0, min_y = 0.0, max_y = 0.0;
+  for (uint i = 0; i < graph->nodes_size; ++i)
+    {
+      const WayPointNode &node = graph->nodes[i];
+      if (!node.is_spot && !node.is_perimeter)
+	lane_nodes.push_back(node.index);
+      if (i == 0 || node.map.x < min_x)
+	min_x = node.map.x;
+      if (i == 0 || node.map.x > max_x)
+	max_x = node.map.x;
+      if (i == 0 || node.map.y < min_y)
+	min_y = node.map.y;
+      if (i == 0 || node.map.y > max_y)
+	max_y = node.map.y;
+    }
+
+  unsigned seed = cfg.seed;
+  std::vector<double> latency;
+  int no_path = 0;
+  for (int q = 0; q < astar_queries; ++q)
+    {
+      waypt_index_t start = lane_nodes[rand_r(&seed) % lane_nodes.size()];
+      waypt_index_t goal = lane_nodes[rand_r(&seed) % lane_nodes.size()];
+      double a0 = now();
+      WayPointEdgeList path =
+	GraphSearch::astar_search(*graph, start, goal);
+      latency.push_back((now() - a0) * 1000.0);
+      if (path.empty() && start != goal)
+	++no_path;
+    }
+  std::sort(latency.begin(), latency.end());
+
+  // point queries, all at the same random points
+  std::vector<MapXY> points;
+  for (int q = 0; q < point_queries; ++q)
+    points.push_back(MapXY(min_x + (max_x - min_x) * rand_r(&seed)
+			   / (float) RAND_MAX,
+			   min_y + (max_y - min_y) * rand_r(&seed)
+			   / (float) RAND_MAX));
+
+  int hits = 0;
+  double p0 = now();
+  for (int q = 0; q < point_queries; ++q)
+    if (pops.getContainingPoly(polys, points[q]) >= 0)
+      ++hits;
+  double p1 = now();
+  for (int q = 0; q < point_queries; ++q)
+    pops.getClosestPoly(polys, points[q]);
+  double p2 = now();
+  for (int q = 0; q < point_queries; ++q)
+    graph->get_closest_node(points[q]);
+  double p3 = now();
+
+  printf("%4d %6d %8u %7u %7.3f %7.3f %8.3f %8.3f %7.1f"
+	 " %7.2f %7.2f %7.2f %8.2f %9.0f %9.0f %9.0f\n",
+	 size, gen.segments(), graph->nodes_size, (unsigned) polys.size(),
+	 t1 - t0, t2 - t1, t3 - t2, t4 - t3, rss,
+	 percentile(latency, 50), percentile(latency, 90),
+	 percentile(latency, 99), percentile(latency, 100),
+	 point_queries / (p1 - p0), point_queries / (p2 - p1),
+	 point_queries / (p3 - p2));
+  fflush(stdout);
+  if (no_path > 0)
+    fprintf(stderr, "%s: %d of %d A* searches found no path\n",
+	    base, no_path, astar_queries);
+  if (hits == 0 && point_queries > 0)
+    fprintf(stderr, "%s: no query point was inside a polygon\n", base);
+
+  delete mapl;
+  delete graph;
+  delete mdf;
+  delete rndf;
+
+  if (!keep_files)
+    {
+      unlink(rndf_name.c_str());
+      unlink(mdf_name.c_str());
+    }
+  return 0;
+}
+
+/** parse comma-separated grid sizes */
+static bool parse_sizes(const char *arg)
+{
+  grid_sizes.clear();
+  while (*arg != '\0')
+    {
+      char *end;
+      long size = strtol(arg, &end, 10);
+      if (end == arg || size < 2)
+	return false;
+      grid_sizes.push_back(size);
+      arg = end;
+      if (*arg == ',')
+	++arg;
+    }
+  return !grid_sizes.empty();
+}
+
+/** parse command line arguments */
+static void parse_args(int argc, char *argv[])
+{
+  bool print_usage = false;
+  const char *options = "a:b:g:hkl:o:p:s:t:w:z:";
+  int opt = 0;
+  int option_index = 0;
+  struct option long_options[] =
+    {
+      { "astar", 1, 0, 'a' },
+      { "block", 1, 0, 'b' },
+      { "grid", 1, 0, 'g' },
+      { "help", 0, 0, 'h' },
+      { "keep", 0, 0, 'k' },
+      { "lanes", 1, 0, 'l' },
+      { "output", 1, 0, 'o' },
+      { "points", 1, 0, 'p' },
+      { "spots", 1, 0, 's' },
+      { "threads", 1, 0, 't' },
+      { "spacing", 1, 0, 'w' },
+      { "zones", 1, 0, 'z' },
+      { 0, 0, 0, 0 }
+    };
+
+  /* basename $0 */
+  pname = strrchr(argv[0], '/');
+  if (pname == 0)
+    pname = argv[0];
+  else
+    pname++;
+
+  parse_sizes("4,8,16");
+
+  opterr = 0;
+  while ((opt = getopt_long(argc, argv, options,
+			    long_options, &option_index)) != EOF)
+    {
+      switch (opt)
+	{
+	case 'a':
+	  astar_queries = atoi(optarg);
+	  break;
+
+	case 'b':
+	  config.block_length = atof(optarg);
+	  break;
+
+	case 'g':
+	  if (!parse_sizes(optarg))
+	    print_usage = true;
+	  break;
+
+	case 'k':
+	  keep_files = true;
+	  break;
+
+	case 'l':
+	  config.lanes = atoi(optarg);
+	  break;
+
+	case 'o':
+	  file_prefix = optarg;
+	  break;
+
+	case 'p':
+	  point_queries = atoi(optarg);
+	  break;
+
+	case 's':
+	  config.spots = atoi(optarg);
+	  break;
+
+	case 't':
+	  threads = atoi(optarg);
+	  break;
+
+	case 'w':
+	  config.waypoint_spacing = atof(optarg);
+	  break;
+
+	case 'z':
+	  config.zones = atoi(optarg);
+	  zones_given = true;
+	  break;
+
+	default:
+	  fprintf(stderr, "unknown option character %c\n",
+		  optopt);
+	  /*fallthru*/
+	case 'h':
+	  print_usage = true;
+	}
+    }
+
+  if (print_usage || astar_queries < 0 || point_queries < 0)
+    {
+      fprintf(stderr,
+	      "usage: %s [options]\n\n"
+	      "    Measure the map stack on generated grid networks.\n"
+	      "    Possible options:\n"
+	      "\t-a, --astar\tA* searches per grid (default 100)\n"
+	      "\t-b, --block\tdistance between intersections (m)\n"
+	      "\t-g, --grid\tcomma-separated grid sizes (default 4,8,16)\n"
+	      "\t-h, --help\tprint this message\n"
+	      "\t-k, --keep\tkeep generated RNDF and MDF files\n"
+	      "\t-l, --lanes\tlanes in each direction\n"
+	      "\t-o, --output\tprefix for generated file names\n"
+	      "\t-p, --points\tpoint queries per grid (default 10000)\n"
+	      "\t-s, --spots\tparking spots per zone\n"
+	      "\t-t, --threads\tMapLanes threads (default: all cores)\n"
+	      "\t-w, --spacing\tdistance between way-points (m)\n"
+	      "\t-z, --zones\tparking zones (default: every fourth block)\n",
+	      pname);
+      exit(9);
+    }
+}
+
+/** main program */
+int main(int argc, char *argv[])
+{
+  parse_args(argc, argv);
+
+  // times in seconds, A* latency in milliseconds, queries per second
+  printf("%4s %6s %8s %7s %7s %7s %8s %8s %7s"
+	 " %7s %7s %7s %8s %9s %9s %9s\n",
+	 "grid", "segs", "nodes", "polys", "parse", "graph", "implicit",
+	 "polygons", "rss_MB", "A*_p50", "A*_p90", "A*_p99", "A*_max",
+	 "contain", "closest", "node");
+  fflush(stdout);
+
+  int rc = 0;
+  for (unsigned i = 0; i < grid_sizes.size(); ++i)
+    {
+      // measure each size in a fresh process
+      pid_t pid = fork();
+      if (pid < 0)
+	{
+	  perror("fork");
+	  return 1;
+	}
+      if (pid == 0)
+	exit(run_scale(grid_sizes[i]));
+
+      int status;
+      if (waitpid(pid, &status, 0) < 0
+	  || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+	  fprintf(stderr, "%s: grid size %d failed\n", pname, grid_sizes[i]);
+	  rc = 1;
+	}
+    }
+  return rc;
+}
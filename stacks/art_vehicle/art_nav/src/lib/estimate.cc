@@ -64,37 +64,10 @@ namespace Estimate
     // Refine pose estimate based on last reported velocity and yaw
     // rate: how far has the car travelled and its heading changed?
 
-    double odom_yaw = tf::getYaw(odom.pose.pose.orientation);
-    double odom_yawrate = odom.twist.twist.angular.z;
-    double est_dist = odom.twist.twist.linear.x * dt;
-    double est_yaw = Coordinates::normalize(odom_yaw
-                                            + odom_yawrate * dt);
-    if (fabs(odom_yawrate) < Epsilon::yaw)
-      {
-	// estimate straight line path at current velocity and heading
-	est.pose.pose.position.x = (odom.pose.pose.position.x
-                                    + est_dist * cos(odom_yaw));
-	est.pose.pose.position.y = (odom.pose.pose.position.y
-                                    + est_dist * sin(odom_yaw));
-
-        ROS_DEBUG("estimated straight path distance = %.3f", est_dist);
-      }
-    else					// turning
-      {
-	// Car is turning. Estimate circular path [see: _Probabilistic
-	// Robotics_, Thrun, Burgard and Fox, ISBN 0-262-20162-3,
-	// 2005; section 5.3.3, exact motion model, pp. 125-127].
-	double est_radius = est_dist / odom_yawrate;
-	est.pose.pose.position.x = (odom.pose.pose.position.x
-                                    - est_radius * sin(odom_yaw)
-                                    + est_radius * sin(est_yaw));
-	est.pose.pose.position.y = (odom.pose.pose.position.y
-                                    + est_radius * cos(odom_yaw)
-                                    - est_radius * cos(est_yaw));
-
-        ROS_DEBUG("estimated path distance = %.3f, radius = %.3f",
-		  est_dist, est_radius);
-      }
+    double est_yaw = tf::getYaw(odom.pose.pose.orientation);
+    extrapolate(est.pose.pose.position.x, est.pose.pose.position.y,
+                est_yaw, odom.twist.twist.linear.x,
+                odom.twist.twist.angular.z, dt);
 
     ROS_DEBUG("estimated control pose = (%.3f, %.3f, %.3f)",
 	      est.pose.pose.position.x,
@@ -113,6 +86,80 @@ namespace Estimate
 #endif
   }
 
+  /** Estimate control pose from odometry history.
+   *
+   * When @a est_time is within the history, interpolates between the
+   * samples around it, instead of rejecting the negative delta time.
+   * That happens when odometry stamped later than @a est_time has
+   * already arrived.  Past the newest sample, extrapolates from it,
+   * even if @a odom is older.  Without history for @a est_time,
+   * falls back to control_pose() above.
+   *
+   * @param history recent odometry, including @a odom
+   * @param[in] odom latest odometry, with time stamp
+   * @param est_time time for which estimated odometry desired
+   * @param est estimated odometry for time in @a est.header.stamp
+   */
+  void control_pose(const OdomHistory &history,
+                    const nav_msgs::Odometry &odom,
+                    ros::Time est_time,
+                    nav_msgs::Odometry &est)
+  {
+    OdomHistory::Sample s;
+    if (!history.estimate(est_time, s))
+      {
+        control_pose(odom, est_time, est);
+        return;
+      }
+
+    est = odom;
+    est.header.stamp = est_time;
+    est.pose.pose.position.x = s.x;
+    est.pose.pose.position.y = s.y;
+    est.pose.pose.orientation = tf::createQuaternionMsgFromYaw(s.yaw);
+    est.twist.twist.linear.x = s.speed;
+    est.twist.twist.angular.z = s.yaw_rate;
+
+    ROS_DEBUG("estimated control pose = (%.3f, %.3f, %.3f)",
+	      s.x, s.y, s.yaw);
+  }
+
+  /** Move a planar pose at constant velocity and yaw rate.
+   *
+   * @param x,y,yaw[in,out] pose to move
+   * @param speed forward velocity (m/s)
+   * @param yaw_rate (radians/s)
+   * @param dt time to move (s)
+   */
+  void extrapolate(double &x, double &y, double &yaw,
+                   double speed, double yaw_rate, double dt)
+  {
+    double odom_yaw = yaw;
+    double est_dist = speed * dt;
+    double est_yaw = Coordinates::normalize(odom_yaw + yaw_rate * dt);
+    if (fabs(yaw_rate) < Epsilon::yaw)
+      {
+	// estimate straight line path at current velocity and heading
+	x = x + est_dist * cos(odom_yaw);
+	y = y + est_dist * sin(odom_yaw);
+
+        ROS_DEBUG("estimated straight path distance = %.3f", est_dist);
+      }
+    else					// turning
+      {
+	// Car is turning. Estimate circular path [see: _Probabilistic
+	// Robotics_, Thrun, Burgard and Fox, ISBN 0-262-20162-3,
+	// 2005; section 5.3.3, exact motion model, pp. 125-127].
+	double est_radius = est_dist / yaw_rate;
+	x = x - est_radius * sin(odom_yaw) + est_radius * sin(est_yaw);
+	y = y + est_radius * cos(odom_yaw) - est_radius * cos(est_yaw);
+
+        ROS_DEBUG("estimated path distance = %.3f, radius = %.3f",
+		  est_dist, est_radius);
+      }
+    yaw = est_yaw;
+  }
+
   void front_bumper_pose(const nav_msgs::Odometry &odom, 
                          nav_msgs::Odometry &est)
   {
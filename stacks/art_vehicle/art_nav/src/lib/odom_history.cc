@@ -0,0 +1,176 @@
+/*
+ *  ART odometry history
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <math.h>
+#include <algorithm>
+
+#include <art_map/coordinates.h>
+
+#include <art_nav/estimate.h>
+#include <art_nav/odom_history.h>
+
+/** @file
+ *
+ *  @brief ART odometry history ring buffer.
+ */
+
+bool OdomHistory::add(const nav_msgs::Odometry &odom)
+{
+  double t = odom.header.stamp.toSec();
+  unsigned long n = head_;
+  if (n > 0 && t <= slots_[(n-1) & (SIZE-1)].time)
+    return false;			// out of order
+
+  Slot &slot = slots_[n & (SIZE-1)];
+  __sync_fetch_and_add(&slot.seq, 1);	// odd: being written
+  slot.time = t;
+  slot.x = odom.pose.pose.position.x;
+  slot.y = odom.pose.pose.position.y;
+  slot.yaw = tf::getYaw(odom.pose.pose.orientation);
+  slot.speed = odom.twist.twist.linear.x;
+  slot.yaw_rate = odom.twist.twist.angular.z;
+  __sync_fetch_and_add(&slot.seq, 1);	// even: done
+
+  head_ = n + 1;
+  __sync_synchronize();
+  return true;
+}
+
+bool OdomHistory::latest(Sample &s) const
+{
+  Sample after;
+  return (search(INFINITY, s, after) == 0);
+}
+
+bool OdomHistory::interpolate(const ros::Time &t, Sample &s) const
+{
+  Sample before, after;
+  if (search(t.toSec(), before, after) != 1)
+    return false;
+  blend(before, after, t.toSec(), s);
+  return true;
+}
+
+bool OdomHistory::estimate(const ros::Time &t, Sample &s,
+			   double max_dt) const
+{
+  Sample before, after;
+  switch (search(t.toSec(), before, after))
+    {
+    case 1:
+      blend(before, after, t.toSec(), s);
+      return true;
+
+    case 0:
+      {
+	double dt = t.toSec() - before.time;
+	if (dt > max_dt)
+	  return false;
+	s = before;
+	Estimate::extrapolate(s.x, s.y, s.yaw, s.speed, s.yaw_rate, dt);
+	s.time = t.toSec();
+	return true;
+      }
+
+    default:
+      return false;
+    }
+}
+
+/** interpolate linearly between two samples, turning the short way */
+void OdomHistory::blend(const Sample &before, const Sample &after,
+			double t, Sample &s)
+{
+  double f = (t - before.time) / (after.time - before.time);
+  s.time = t;
+  s.x = before.x + f * (after.x - before.x);
+  s.y = before.y + f * (after.y - before.y);
+  s.yaw = Coordinates::normalize(before.yaw + f * Coordinates::normalize
+				 (after.yaw - before.yaw));
+  s.speed = before.speed + f * (after.speed - before.speed);
+  s.yaw_rate = before.yaw_rate + f * (after.yaw_rate - before.yaw_rate);
+}
+
+/** copy sample @a n, counting from the first ever added
+ *
+ *  @return true if the copy is intact and still sample @a n
+ */
+bool OdomHistory::read(unsigned long n, Sample &s) const
+{
+  const Slot &slot = slots_[n & (SIZE-1)];
+  unsigned long seq = slot.seq;
+  __sync_synchronize();
+  s.time = slot.time;
+  s.x = slot.x;
+  s.y = slot.y;
+  s.yaw = slot.yaw;
+  s.speed = slot.speed;
+  s.yaw_rate = slot.yaw_rate;
+  __sync_synchronize();
+  return (seq == 2 * (n / SIZE + 1) && slot.seq == seq);
+}
+
+/** find the samples around time @a t
+ *
+ *  @return 1 if @a before is at or before @a t and @a after is the
+ *            next sample;
+ *          0 if @a t is at or past the newest sample, returned in
+ *            @a before;
+ *          -1 if @a t is before the history, or it is empty
+ */
+int OdomHistory::search(double t, Sample &before, Sample &after) const
+{
+  // the writer rarely laps a reader, try again if it does
+  for (int attempt = 0; attempt < 4; ++attempt)
+    {
+      unsigned long head = head_;
+      __sync_synchronize();
+      if (head == 0)
+	return -1;
+
+      // skip the oldest slot, the next one to be written
+      unsigned long lo = (head > SIZE-1? head - (SIZE-1): 0);
+      unsigned long hi = head - 1;
+      if (!read(hi, before))
+	continue;
+      if (t >= before.time)
+	return 0;
+      if (!read(lo, after))
+	continue;
+      if (t < after.time)
+	return -1;
+
+      // keep time[lo] <= t < time[hi]
+      Sample s;
+      std::swap(before, after);
+      bool intact = true;
+      while (hi - lo > 1)
+	{
+	  unsigned long mid = lo + (hi - lo) / 2;
+	  if (!read(mid, s))
+	    {
+	      intact = false;
+	      break;
+	    }
+	  if (s.time <= t)
+	    {
+	      lo = mid;
+	      before = s;
+	    }
+	  else
+	    {
+	      hi = mid;
+	      after = s;
+	    }
+	}
+      if (intact)
+	return 1;
+    }
+  return -1;
+}
@@ -13,6 +13,7 @@
 #define __CONTROLLER_HH__
 
 #include "navigator_internal.h"
+#include "cycle_profiler.h"
 
 class Controller
 {
@@ -13,6 +13,7 @@
 
 #include "navigator_internal.h"
 #include "course.h"
+#include "cycle_profiler.h"
 #include <art/steering.h>
 #include <art_map/coordinates.h>
 #include <art_nav/estimate.h>
@@ -39,7 +40,10 @@ Course::Course(Navigator *_nav, int _verbose)
 
   // initialize polygon vectors
   plan.clear();
+  plan_steps_valid = false;
   polygons.clear();
+  polygons_index.clear();
+  polygons_geometry.clear();
 
   for (unsigned i = 0; i < 2; ++i)
     adj_polys[i].clear();
@@ -59,6 +63,8 @@ Course::Course(Navigator *_nav, int _verbose)
 //
 void Course::begin_run_cycle(void)
 {
+  CYCLE_TIMER("Course::begin_run_cycle");
+
   waypoint_checked = false;
 
   // Finding the current polygon is easy in a travel lane, but
@@ -77,7 +83,7 @@ void Course::begin_run_cycle(void)
   else
     {
       // Not in the planned travel lane, check the whole road network.
-      poly_index = pops->getContainingPoly(polygons,
+      poly_index = pops->getContainingPoly(polygons, polygons_geometry,
                                            MapPose(estimate->pose.pose));
     }
 
@@ -205,6 +211,9 @@ void Course::configure()
   nh.param("spot_waypoint_radius", spot_waypoint_radius, 0.5);
   ROS_INFO("spot waypoint radius is %.3f m", spot_waypoint_radius);
 #endif
+
+  // curve speed limits depend on these parameters
+  plan_updated();
 }
 
 /** Set heading for desired course.
@@ -408,7 +417,8 @@ float Course::distance_in_plan(const MapPose &from,
 {
   if (plan.empty())
     return Euclidean::DistanceToWaypt(from, wp);
-  else return pops->distanceAlongLane(plan, from.map, wp.map);
+  else return pops->distanceAlongLane(plan, plan_lengths,
+                                      from.map, wp.map);
 }
 
 // return distance in plan to a pose
@@ -417,7 +427,8 @@ float Course::distance_in_plan(const MapPose &from,
 {
   if (plan.empty())
     return Euclidean::DistanceTo(from, to);
-  else return pops->distanceAlongLane(plan, from.map, to.map);
+  else return pops->distanceAlongLane(plan, plan_lengths,
+                                      from.map, to.map);
 }
 
 float Course::distance_in_plan(const MapPose &from,
@@ -425,7 +436,8 @@ float Course::distance_in_plan(const MapPose &from,
 {
   if (plan.empty())
     return Euclidean::DistanceTo(from.map, to);
-  else return pops->distanceAlongLane(plan, from.map,to);
+  else return pops->distanceAlongLane(plan, plan_lengths,
+                                      from.map, to);
 }
 
 
@@ -437,6 +449,8 @@ float Course::distance_in_plan(const MapPose &from,
 //
 void Course::end_run_cycle()
 {
+  CYCLE_TIMER("Course::end_run_cycle");
+
   if (!waypoint_checked)
     ROS_ERROR("failed to check for way-point reached!");
 }
@@ -569,7 +583,8 @@ bool Course::find_passing_lane(void)
 	continue;
 
       // collect lane polygons
-      pops->AddLanePolys(polygons, adj_polys[i], adj_lane[i]);
+      pops->AddLanePolys(polygons, polygons_index, adj_polys[i],
+                         adj_lane[i]);
       int this_index =
         pops->getClosestPoly(adj_polys[i],
                              MapXY(order->waypt[1].mapxy));
@@ -589,7 +604,8 @@ bool Course::find_passing_lane(void)
 	{
 	  // collect polygons in reverse direction, instead
 	  adj_polys[i].clear();
-	  pops->AddReverseLanePolys(polygons, adj_polys[i], adj_lane[i]);
+	  pops->AddReverseLanePolys(polygons, polygons_index,
+                                    adj_polys[i], adj_lane[i]);
 	}
 
       if (verbose >= 4)
@@ -694,7 +710,7 @@ void Course::find_travel_lane(bool rejoin)
 	}
 
       // push waypt[0] polygon onto the plan
-      pops->add_polys_for_waypts(polygons, plan,
+      pops->add_polys_for_waypts(polygons, polygons_index, plan,
 				 order->waypt[0].id, order->waypt[0].id);
       if (verbose >= 6)
         log("debug plan", plan);
@@ -707,7 +723,7 @@ void Course::find_travel_lane(bool rejoin)
               != ElementID(order->waypt[i].id))
 	    // Collect all polygons from previous waypt to this one and
 	    // also the polygon containing this one.
-	    pops->add_polys_for_waypts(polygons, plan,
+	    pops->add_polys_for_waypts(polygons, polygons_index, plan,
 				       order->waypt[i-1].id,
 				       order->waypt[i].id);
 	  // don't plan past a zone entry
@@ -726,7 +742,11 @@ void Course::find_travel_lane(bool rejoin)
                     plan.at(1).end_way.name().str,
                     plan.at(1).poly_id);
 	}
+      plan_updated();
       log("find_travel_lane() plan", plan);
+
+      // remember how it was built, for patching with new lanes
+      plan_steps_valid = build_plan_steps();
     }
   
   new_plan_lanes = false;		// plan reflects current lanes
@@ -804,8 +824,10 @@ Polar Course::head_for_waypt(float target_dist)
 // return lane change direction
 Course::direction_t Course::lane_change_direction(void)
 {
-  int w0_index = pops->get_waypoint_index(polygons, order->waypt[0].id);
-  int w1_index = pops->get_waypoint_index(polygons, order->waypt[1].id);
+  int w0_index = pops->get_waypoint_index(polygons, polygons_index,
+                                          order->waypt[0].id);
+  int w1_index = pops->get_waypoint_index(polygons, polygons_index,
+                                          order->waypt[1].id);
 
   // give up unless both polygons are available
   if (w0_index < 0 || w1_index < 0)
@@ -867,7 +889,8 @@ bool Course::lane_waypoint_reached(void)
   // get polygon index of waypt[1] (TODO: save somewhere)
   int w1_index = -1;
 
-  w1_index = pops->get_waypoint_index(polygons, order->waypt[1].id);
+  w1_index = pops->get_waypoint_index(polygons, polygons_index,
+                                      order->waypt[1].id);
   
   if (w1_index >= 0)
     {
@@ -910,16 +933,184 @@ void Course::lanes_message(const art_msgs::ArtLanes &lanes)
   polygons.resize(lanes.polygons.size());
   for (unsigned num = 0; num < lanes.polygons.size(); num++)
     polygons.at(num) = lanes.polygons[num];
+  polygons_index.build(polygons);
+  polygons_geometry.build(polygons);
 
   if (polygons.empty())
     ROS_WARN("empty lanes polygon list received!");
 
-  // force plan to be recomputed
-  new_plan_lanes = true;
+  // force plan to be recomputed, unless it can be patched
+  if (!patch_plan())
+    new_plan_lanes = true;
 
   log("lanes input:", polygons);
 };
 
+/** @brief collect the polygons of each step of the current plan
+ *
+ * Follows find_travel_lane() step by step, so the steps together
+ * hold exactly the polygons of the plan it made from the current
+ * polygons.
+ *
+ * @return false unless each step lists its polygons in poly_id
+ *         order, as MapLanes sends them.  Otherwise, the plan cannot
+ *         be rebuilt from them in the same order.
+ */
+bool Course::build_plan_steps(void)
+{
+  plan_steps.clear();
+  plan_ids.clear();
+  plan_steps.push_back(PlanStep(order->waypt[0].id, order->waypt[0].id));
+  for (int i = 1; i < Order::N_WAYPTS; ++i)
+    {
+      ElementID from_id(order->waypt[i-1].id);
+      ElementID to_id(order->waypt[i].id);
+      if (from_id != to_id)
+	{
+	  plan_steps.push_back(PlanStep(from_id, to_id));
+	  plan_steps.push_back(PlanStep(to_id, to_id));
+	}
+      if (order->waypt[i].is_perimeter)
+	break;
+    }
+
+  bool changed;
+  if (!update_plan_steps(changed))
+    return false;
+
+  for (unsigned k = 0; k < plan_steps.size(); ++k)
+    {
+      const std::map<int, poly> &polys = plan_steps[k].polys;
+      for (std::map<int, poly>::const_iterator it = polys.begin();
+	   it != polys.end(); ++it)
+	plan_ids.push_back(it->first);
+    }
+
+  // should never differ, but a wrong patch would be worse than none
+  if (plan_ids.size() != plan.size())
+    return false;
+  for (unsigned i = 0; i < plan.size(); ++i)
+    if (plan[i].poly_id != plan_ids[i])
+      return false;
+  return true;
+}
+
+/** @brief bring the plan steps up to date with the current polygons
+ *
+ * Merges each step with its polygons in the current list, removing
+ * the ones that left the local map, adding the ones that entered it,
+ * and replacing the ones that changed shape.
+ *
+ * @param changed set true if any step changed.
+ * @return false if the polygons of some step are not in poly_id
+ *         order.
+ */
+bool Course::update_plan_steps(bool &changed)
+{
+  changed = false;
+  for (unsigned k = 0; k < plan_steps.size(); ++k)
+    {
+      PlanStep &step = plan_steps[k];
+      PolyIndex::range_t r =
+	polygons_index.waypts(step.from_id, step.to_id);
+
+      // a way-point's own step only holds the first polygon
+      if (step.from_id == step.to_id && r.first != r.second)
+	r.second = r.first + 1;
+
+      std::map<int, poly>::iterator it = step.polys.begin();
+      int last_id = -1;
+      for (; r.first != r.second; ++r.first)
+	{
+	  const poly &p = polygons.at(*r.first);
+	  if (p.poly_id <= last_id)
+	    return false;
+	  last_id = p.poly_id;
+
+	  while (it != step.polys.end() && it->first < p.poly_id)
+	    {
+	      step.polys.erase(it++);	// left the local map
+	      changed = true;
+	    }
+	  if (it != step.polys.end() && it->first == p.poly_id)
+	    {
+	      poly &old = it->second;
+	      if (!(old.p1 == p.p1 && old.p2 == p.p2
+		    && old.p3 == p.p3 && old.p4 == p.p4
+		    && old.midpoint == p.midpoint
+		    && old.heading == p.heading
+		    && old.length == p.length))
+		{
+		  old = p;		// changed shape
+		  changed = true;
+		}
+	      ++it;
+	    }
+	  else
+	    {
+	      step.polys.insert(it, std::make_pair((int) p.poly_id, p));
+	      changed = true;
+	    }
+	}
+      while (it != step.polys.end())
+	{
+	  step.polys.erase(it++);
+	  changed = true;
+	}
+    }
+  return true;
+}
+
+/** @brief patch the plan for new lane polygons
+ *
+ * The steps of the plan stay the same until the order way-points
+ * change, so new polygons only add to or remove from them.  When
+ * nothing changed, the plan stays as it was.
+ *
+ * @pre polygons and polygons_index are current
+ * @return true if the plan reflects the current polygons.
+ */
+bool Course::patch_plan(void)
+{
+  if (!plan_steps_valid || plan.empty()
+      || !polygons_index.indexes(polygons))
+    return false;
+
+  // A passing plan replaces the travel plan for a while.  Only
+  // patch the plan find_travel_lane() made.
+  if (plan.size() != plan_ids.size())
+    return false;
+  for (unsigned i = 0; i < plan.size(); ++i)
+    if (plan[i].poly_id != plan_ids[i])
+      return false;
+
+  bool changed;
+  if (!update_plan_steps(changed))
+    {
+      plan_steps_valid = false;
+      return false;
+    }
+  if (!changed)
+    return true;
+
+  plan.clear();
+  plan_ids.clear();
+  for (unsigned k = 0; k < plan_steps.size(); ++k)
+    {
+      const std::map<int, poly> &polys = plan_steps[k].polys;
+      for (std::map<int, poly>::const_iterator it = polys.begin();
+	   it != polys.end(); ++it)
+	{
+	  plan.push_back(it->second);
+	  plan_ids.push_back(it->first);
+	}
+    }
+  plan_updated();
+  log("patched plan", plan);
+  return !plan.empty();
+}
+
+
 // log a vector of polygons
 void Course::log(const char *str, const poly_list_t &polys)
 {
@@ -972,6 +1163,9 @@ void Course::reset(void)
 
   // clear the previous plan
   plan.clear();
+  plan_lengths.clear();
+  plan_speeds.clear();
+  plan_steps_valid = false;
   aim_poly.poly_id = -1;
 }
 
@@ -1010,10 +1204,10 @@ ElementID Course::replan_roadblock(void)
 Course::direction_t Course::intersection_direction(void)
 {
   int w0_index =
-    pops->getContainingPoly(polygons,
+    pops->getContainingPoly(polygons, polygons_geometry,
                             MapXY(order->waypt[0].mapxy));
   int w1_index =
-    pops->getContainingPoly(polygons,
+    pops->getContainingPoly(polygons, polygons_geometry,
                             MapXY(order->waypt[1].mapxy));
 
   // give up unless both polygons are available
@@ -1054,7 +1248,7 @@ float Course::stop_waypt_distance(bool same_lane)
 	{
 	  // find stop way-point polygon
 	  int stop_index =
-            pops->getContainingPoly(polygons,
+            pops->getContainingPoly(polygons, polygons_geometry,
                                     MapXY(order->waypt[i].mapxy));
 	  if (stop_index < 0)		// none found?
 	    continue;			// keep looking
@@ -1099,6 +1293,7 @@ bool Course::switch_to_passing_lane()
   // collect all the polygons from aim_index to end of passing lane
   plan.clear();
   pops->CollectPolys(adj_polys[passing_lane], plan, aim_index);
+  plan_updated();
   
   log("switch_to_passing_lane() plan", plan);
   if (plan.empty())
@@ -1136,7 +1331,7 @@ float Course::uturn_distance(void)
 
   // find stop way-point polygon
   int stop_index =
-    pops->getContainingPoly(polygons,
+    pops->getContainingPoly(polygons, polygons_geometry,
                             MapXY(order->waypt[i].mapxy));
   if (stop_index < 0)		// none found?
     return Infinite::distance;
@@ -1223,7 +1418,7 @@ bool Course::zone_perimeter_reached(void)
   waypoint_checked = true;
   
   int w1_index =
-    pops->getClosestPoly(polygons,
+    pops->getClosestPoly(polygons, polygons_geometry,
                          MapXY(order->waypt[1].mapxy));
   if (w1_index >= 0)
     {
@@ -1341,6 +1536,62 @@ float Course::max_speed_for_change_in_heading(const float& dheading,
 }
 
 
+float Course::curve_speed(const poly_list_t &polys, int begin, int stop,
+			  int *end, float *length)
+{
+  float curve_length = 0;
+  int curve_end = begin;
+  while (curve_end < stop && curve_length < config_->min_curve_length)
+    {
+      curve_length += (polys.at(curve_end).length +
+		       polys.at(curve_end+1).length)/2.0;
+      curve_end++;
+    }
+
+  float dheading = Coordinates::normalize(polys[curve_end].heading
+					  - polys[begin].heading);
+  if (end)
+    *end = curve_end;
+  if (length)
+    *length = curve_length;
+
+  return fmaxf(config_->min_speed_for_curves,
+	       max_speed_for_change_in_heading(dheading, curve_length, 100,
+					       config_->max_yaw_rate));
+}
+
+/** Rebuild the arc lengths and curve speed limits along the plan.
+ *
+ *  Call after every change to the plan, so the controllers can look
+ *  them up each cycle instead of walking the plan.
+ */
+void Course::plan_updated(void)
+{
+  plan_lengths.build(plan);
+
+  int n = plan.size();
+  std::vector<float> speed(n, 0.0);
+  std::vector<int> end(n, n-1);
+  for (int i = 0; i < n-1; ++i)
+    speed[i] = curve_speed(plan, i, n-1, &end[i]);
+
+  // stop way-points still ahead in the order, not waypt[0], which
+  // the car has already reached
+  std::vector<int> stops;
+  for (int i = 0; i < n; ++i)
+    if (plan[i].is_stop)
+      for (unsigned k = 1; k < art_msgs::Order::N_WAYPTS; ++k)
+	if (order->waypt[k].is_stop
+	    && ElementID(order->waypt[k].id) == plan[i].start_way)
+	  {
+	    stops.push_back(i);
+	    break;
+	  }
+
+  plan_speeds.build(plan, speed, end, config_->max_deceleration,
+		    stops, config_->stop_deceleration);
+}
+
 float Course::get_yaw_spring_system(const Polar& aim_polar, 
 				    int poly_id,
 				    float poly_heading,
@@ -1353,9 +1604,11 @@ float Course::get_yaw_spring_system(const Polar& aim_polar,
   float velocity = fmaxf(curr_velocity, Steering::steer_speed_min);
   nav_msgs::Odometry front_est;  
   Estimate::front_axle_pose(*estimate, front_est);
-  ros::Duration frequency(1.0 / art_msgs::ArtHertz::NAVIGATOR);
+  // the command holds until the next cycle, expected as long as
+  // the last one
+  ros::Duration cycle(nav->cycle_interval);
   ros::Time time_in_future = (ros::Time::now()
-                              + frequency
+                              + cycle
                               + ros::Duration(velocity * spring_lookahead));
   nav_msgs::Odometry pos_est;
   Estimate::control_pose(front_est, time_in_future, pos_est);
@@ -12,6 +12,7 @@
 #ifndef _COURSE_HH_
 #define _COURSE_HH_
 
+#include <map>
 #include <vector>
 
 #include <art/infinity.h>
@@ -20,6 +21,7 @@
 #include <art_map/zones.h>
 
 #include "Controller.h"
+#include "speed_profile.h"
 
 /** @brief Navigator course planning class. */
 class Course
@@ -45,6 +47,16 @@ class Course
   /** @brief set configuration variables. */
   void configure();
 
+  /** @brief highest speed entering the curve starting at
+   *         polys[begin], which ends @a min_curve_length later, or at
+   *         polys[stop]
+   *
+   * @param end returns index of the polygon ending the curve
+   * @param length returns length of the curve
+   */
+  float curve_speed(const poly_list_t &polys, int begin, int stop,
+		    int *end=NULL, float *length=NULL);
+
   /** @brief set heading for desired course */
   void desired_heading(pilot_command_t &pcmd, float offset_ratio = 0.0);
 
@@ -128,8 +140,8 @@ class Course
 
   /** @brief return whether the current plan is still valid
    *
-   * Technically, a plan is no longer valid after we receive new
-   * polygons, but that is currently ignored for simplicity.
+   * New lane polygons only invalidate the plan when lanes_message()
+   * could not patch it in place.
    */
   bool plan_valid(void)
   {
@@ -151,6 +163,9 @@ class Course
    */
   ElementID replan_roadblock(void);
 
+  /** @brief rebuild everything derived from the plan after changing it */
+  void plan_updated(void);
+
   /** @brief reset course */
   void reset(void);
 
@@ -264,7 +279,11 @@ class Course
 
   // public class data
   poly_list_t polygons;			//< all polygons for local area
+  PolyIndex polygons_index;		//< lanes and way-points of polygons
+  QuadGeometry polygons_geometry;	//< cached shapes of polygons
   poly_list_t plan;			//< planned course
+  LaneLengths plan_lengths;		//< arc lengths along plan
+  SpeedProfile plan_speeds;		//< speed limits along plan
 
   poly_list_t passed_lane;		//< original lane being passed
   bool passing_left;			//< when passing, true if to left
@@ -308,6 +327,25 @@ class Course
   // automatic.
   ElementID plan_waypt[art_msgs::Order::N_WAYPTS]; //< waypts in the plan
   bool new_plan_lanes;			//< new lanes since plan made
+
+  /** One step of the travel plan: the polygons leading from one
+   *  way-point to the next, or, when both IDs are the same, the
+   *  first polygon containing that way-point.  Keyed by poly_id, so
+   *  new lanes can patch it with just the polygons that came or went.
+   */
+  struct PlanStep
+  {
+    ElementID from_id;
+    ElementID to_id;
+    std::map<int, poly> polys;
+    PlanStep(ElementID from, ElementID to): from_id(from), to_id(to) {}
+  };
+  std::vector<PlanStep> plan_steps;	//< steps of last plan made
+  std::vector<int> plan_ids;		//< poly_ids of that plan
+  bool plan_steps_valid;		//< plan_steps match the plan
+  bool build_plan_steps(void);
+  bool update_plan_steps(bool &changed);
+  bool patch_plan(void);
   bool waypoint_checked;
   int poly_index;			// index in polygons of odom pose
 
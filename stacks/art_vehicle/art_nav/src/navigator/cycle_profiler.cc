@@ -0,0 +1,74 @@
+/*
+ *  Navigator cycle profiler
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <string.h>
+
+#include "cycle_profiler.h"
+
+const uint64_t CycleProfiler::limit_us[] =
+  {50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000};
+
+CycleProfiler &CycleProfiler::instance(void)
+{
+  static CycleProfiler profiler;
+  return profiler;
+}
+
+int CycleProfiler::timer(const char *name)
+{
+  boost::mutex::scoped_lock l(lock_);
+  for (unsigned i = 0; i < size_; ++i)
+    if (strcmp(slots_[i].name, name) == 0)
+      return i;
+  if (size_ >= MAX_TIMERS)
+    return -1;
+
+  Slot &s = slots_[size_];
+  s.name = name;
+  s.count = s.cycle = 0;
+  s.total_ns = s.worst_ns = s.last_ns = 0;
+  for (unsigned bin = 0; bin < N_BINS; ++bin)
+    s.bins[bin] = 0;
+
+  // publish the slot only once it is filled in
+  __sync_synchronize();
+  return size_++;
+}
+
+void CycleProfiler::snapshot(std::vector<Stats> &stats, bool reset)
+{
+  unsigned n = size_;
+  __sync_synchronize();
+  stats.resize(n);
+  for (unsigned i = 0; i < n; ++i)
+    {
+      Slot &s = slots_[i];
+      Stats &st = stats[i];
+      st.name = s.name;
+      st.cycle = s.cycle;
+      st.last_ns = s.last_ns;
+      if (reset)
+	{
+	  // read each value and zero it in one step
+	  st.count = __sync_fetch_and_and(&s.count, 0);
+	  st.total_ns = __sync_fetch_and_and(&s.total_ns, 0);
+	  st.worst_ns = __sync_fetch_and_and(&s.worst_ns, 0);
+	  for (unsigned bin = 0; bin < N_BINS; ++bin)
+	    st.bins[bin] = __sync_fetch_and_and(&s.bins[bin], 0);
+	}
+      else
+	{
+	  st.count = s.count;
+	  st.total_ns = s.total_ns;
+	  st.worst_ns = s.worst_ns;
+	  for (unsigned bin = 0; bin < N_BINS; ++bin)
+	    st.bins[bin] = s.bins[bin];
+	}
+    }
+}
@@ -0,0 +1,155 @@
+/* -*- mode: C++ -*-
+ *
+ *  Navigator cycle profiler
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#ifndef __CYCLE_PROFILER_H__
+#define __CYCLE_PROFILER_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+/** @brief Navigator cycle profiler.
+ *
+ *  Collects the elapsed times of the controllers and Course methods
+ *  run each navigator cycle.  Each named timer gets a fixed slot
+ *  holding a histogram and the worst time seen, updated with the GCC
+ *  atomic builtins, so timing never takes a lock.  Only creating a
+ *  timer does, once per name.
+ *
+ *  Times are inclusive: the Run timer includes every controller Run
+ *  calls.  Use the CYCLE_TIMER() macro to time a block.
+ */
+class CycleProfiler
+{
+ public:
+  static const unsigned N_BINS = 10;	//< histogram bins
+  static const unsigned MAX_TIMERS = 32; //< named timers
+
+  /** bin upper limits (microseconds), the last bin has none */
+  static const uint64_t limit_us[N_BINS-1];
+
+  /** one timer's statistics, as copied by snapshot() */
+  struct Stats
+  {
+    const char *name;
+    unsigned long count;		//< times recorded
+    unsigned long cycle;		//< cycle of the last one
+    uint64_t total_ns;
+    uint64_t worst_ns;
+    uint64_t last_ns;
+    unsigned long bins[N_BINS];
+  };
+
+  /** @return the process-wide profiler */
+  static CycleProfiler &instance(void);
+
+  /** @return monotonic time in nanoseconds */
+  static uint64_t now(void)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+  }
+
+  /** @return id of the timer for @a name, creating it if needed;
+   *          -1 if all MAX_TIMERS are in use
+   *
+   * @param name must remain valid, normally a string literal
+   */
+  int timer(const char *name);
+
+  /** record an elapsed time for timer @a id */
+  void record(int id, uint64_t ns)
+  {
+    if (id < 0)
+      return;
+    Slot &s = slots_[id];
+    unsigned bin = 0;
+    uint64_t us = ns / 1000;
+    while (bin < N_BINS-1 && us >= limit_us[bin])
+      ++bin;
+    __sync_fetch_and_add(&s.bins[bin], 1);
+    __sync_fetch_and_add(&s.count, 1);
+    __sync_fetch_and_add(&s.total_ns, ns);
+    s.last_ns = ns;
+    s.cycle = cycle_;
+    uint64_t worst = s.worst_ns;
+    while (ns > worst)
+      {
+	uint64_t prev = __sync_val_compare_and_swap(&s.worst_ns, worst, ns);
+	if (prev == worst)
+	  break;
+	worst = prev;
+      }
+  }
+
+  /** start a new navigator cycle
+   *
+   * @return number of the new cycle
+   */
+  unsigned long next_cycle(void)
+  {
+    return __sync_add_and_fetch(&cycle_, 1);
+  }
+
+  /** copy the statistics of all timers
+   *
+   * @param stats returns one entry per timer, in order of creation
+   * @param reset if true, start the counts and worst times over
+   *
+   * Each value is copied atomically, but not all of them together,
+   * so a time recorded meanwhile may show in some and not others.
+   */
+  void snapshot(std::vector<Stats> &stats, bool reset);
+
+ private:
+  CycleProfiler(): size_(0), cycle_(0) {};
+
+  struct Slot
+  {
+    const char *name;
+    volatile unsigned long count;
+    volatile unsigned long cycle;
+    volatile uint64_t total_ns;
+    volatile uint64_t worst_ns;
+    volatile uint64_t last_ns;
+    volatile unsigned long bins[N_BINS];
+  };
+
+  Slot slots_[MAX_TIMERS];
+  volatile unsigned size_;		// slots in use
+  volatile unsigned long cycle_;	// current cycle number
+  boost::mutex lock_;			// serializes timer()
+};
+
+/** @brief Record the time from construction to destruction. */
+class ScopedCycleTimer
+{
+ public:
+  ScopedCycleTimer(int id): id_(id), start_(CycleProfiler::now()) {};
+  ~ScopedCycleTimer()
+  {
+    CycleProfiler::instance().record(id_, CycleProfiler::now() - start_);
+  };
+ private:
+  int id_;
+  uint64_t start_;
+};
+
+/** time the rest of the enclosing block as @a name */
+#define CYCLE_TIMER(name)						\
+  static const int cycle_timer_id_ =					\
+    CycleProfiler::instance().timer(name);				\
+  ScopedCycleTimer cycle_timer_(cycle_timer_id_)
+
+#endif // __CYCLE_PROFILER_H__
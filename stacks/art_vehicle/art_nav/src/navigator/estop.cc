@@ -112,6 +112,8 @@ void Estop::Add(NavEstopEvent::event_t event, action_t action,
 
 Controller::result_t Estop::control(pilot_command_t &pcmd)
 {
+  CYCLE_TIMER("Estop");
+
   event = current_event();
 
   // state transition table pointer
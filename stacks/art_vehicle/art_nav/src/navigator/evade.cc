@@ -30,7 +30,7 @@ static const char *state_name[] =
 Evade::Evade(Navigator *navptr, int _verbose):
   Controller(navptr, _verbose)
 {
-  evade_timer = new NavTimer(nav->cycle);
+  evade_timer = new NavTimer(nav);
   halt = new Halt(navptr, _verbose);
   lane_edge = new LaneEdge(navptr, _verbose);
   safety = new Safety(navptr, verbose);
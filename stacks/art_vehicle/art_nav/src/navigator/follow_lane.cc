@@ -12,6 +12,7 @@
 #include "Controller.h"
 #include "course.h"
 #include "obstacle.h"
+#include "rollout.h"
 #include "follow_lane.h"
 
 #include "avoid.h"
@@ -140,6 +141,8 @@ FollowLane::~FollowLane()
 //
 Controller::result_t FollowLane::control(pilot_command_t &pcmd)
 {
+  CYCLE_TIMER("FollowLane");
+
   if (order->waypt[1].is_perimeter)
     pcmd.velocity=fminf(pcmd.velocity,1.0); //Make this config
 
@@ -235,8 +238,10 @@ Controller::result_t FollowLane::control(pilot_command_t &pcmd)
 	result = stop_result;		// ignore follow_safely result
     }
 
-  // set heading to desired course
-  course->desired_heading(pcmd);
+  // set heading and speed for the best candidate course within the
+  // travel lane, which stops the car if none is feasible
+  if (!nav->rollout->control(pcmd) && result != Finished)
+    result = (in_safety_area? Unsafe: Blocked);
 
   // check if way-point reached, ignoring stop lines and U-turns
   course->lane_waypoint_reached();
@@ -40,6 +40,8 @@ FollowSafely::~FollowSafely() {};
 //
 Controller::result_t FollowSafely::control(pilot_command_t &pcmd)
 {
+  CYCLE_TIMER("FollowSafely");
+
   bool was_blocked = navdata->lane_blocked;
   navdata->lane_blocked = false;
 
@@ -0,0 +1,93 @@
+/* -*- mode: C++ -*-
+ *
+ *  Latest-value message slot
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#ifndef __LATEST_SLOT_H__
+#define __LATEST_SLOT_H__
+
+#include <boost/shared_ptr.hpp>
+#include <ros/ros.h>
+
+/** @brief Latest-value message slot.
+ *
+ *  Passes messages from a subscription callback thread to the
+ *  navigator thread without locking.  Each put() replaces any message
+ *  not yet taken, so the reader always gets the most recent one, and
+ *  a reader that falls behind never sees a backlog.
+ *
+ *  The slot holds a pointer to a heap entry, swapped with the GCC
+ *  atomic builtins, which are full memory barriers.
+ */
+template <class M>
+class LatestSlot
+{
+ public:
+  typedef boost::shared_ptr<M const> MConstPtr;
+
+  LatestSlot(): entry_(NULL) {}
+  ~LatestSlot()
+  {
+    delete exchange(NULL);
+  }
+
+  /** store a new message, discarding any not taken */
+  void put(const MConstPtr &msg)
+  {
+    Entry *e = new Entry;
+    e->msg = msg;
+    e->received = ros::WallTime::now();
+    delete exchange(e);
+  }
+
+  /** take the latest message, if any
+   *
+   * @param msg returns message
+   * @param received returns wall time when it was put
+   * @return true if there was a message
+   */
+  bool take(MConstPtr &msg, ros::WallTime &received)
+  {
+    Entry *e = exchange(NULL);
+    if (e == NULL)
+      return false;
+    msg = e->msg;
+    received = e->received;
+    delete e;
+    return true;
+  }
+
+ private:
+  struct Entry
+  {
+    MConstPtr msg;
+    ros::WallTime received;
+  };
+
+  /** @return previous entry, after atomically replacing it with e */
+  Entry *exchange(Entry *e)
+  {
+    Entry *old = entry_;
+    for (;;)
+      {
+	Entry *prev = __sync_val_compare_and_swap(&entry_, old, e);
+	if (prev == old)
+	  return old;
+	old = prev;
+      }
+  }
+
+  Entry * volatile entry_;
+
+  // not copyable
+  LatestSlot(const LatestSlot &);
+  LatestSlot &operator=(const LatestSlot &);
+};
+
+#endif // __LATEST_SLOT_H__
@@ -15,6 +15,7 @@
 #include "course.h"
 
 #include "obstacle.h"
+#include "rollout.h"
 
 // subordinate controller classes
 #include "estop.h"
@@ -45,10 +46,14 @@ Navigator::Navigator(nav_msgs::Odometry *odom_msg)
   navdata.last_waypt = null_waypt;
   navdata.replan_waypt = null_waypt;
 
+  // nominal cycle interval until two cycles have run
+  cycle_interval = 1.0 / art_msgs::ArtHertz::NAVIGATOR;
+
   // allocate helper classes
   pops = new PolyOps();
   course = new Course(this, verbose);
   obstacle = new Obstacle(this, verbose);
+  rollout = new Rollout(this, verbose);
 
   // allocate controller classes
   estop = new Estop(this, verbose);
@@ -60,6 +65,7 @@ Navigator::~Navigator()
   delete estop;
 
   // free helper classes
+  delete rollout;
   delete obstacle;
   delete course; 
   delete pops;
@@ -76,6 +82,15 @@ pilot_command_t Navigator::navigate(void)
 {
   pilot_command_t pcmd;			// pilot command to return
 
+  // Measure the time since the last cycle, which varies when cycles
+  // follow the odometry messages.  A gap of more than four cycles
+  // counts as only four, so timers do not expire all at once.
+  ros::Time now = ros::Time::now();
+  if (!last_cycle.isZero() && now > last_cycle)
+    cycle_interval = fmin((now - last_cycle).toSec(),
+			  4.0 / art_msgs::ArtHertz::NAVIGATOR);
+  last_cycle = now;
+
   // report whether odometry reports vehicle currently stopped
   navdata.stopped = (fabsf(odometry->twist.twist.linear.x)
                      < Epsilon::speed);
@@ -94,5 +109,6 @@ pilot_command_t Navigator::navigate(void)
 void Navigator::configure()
 {
   course->configure();
+  rollout->configure();
 }
 
@@ -36,6 +36,7 @@
 #include <nav_msgs/Odometry.h>
 
 #include <art_nav/NavBehavior.h>
+#include <art_nav/odom_history.h>
 
 #include "art_nav/NavigatorConfig.h"
 typedef art_nav::NavigatorConfig Config;
@@ -60,6 +61,7 @@ typedef struct
 class Estop;
 class Course;
 class Obstacle;
+class Rollout;
 
 class Navigator
 {
@@ -69,6 +71,7 @@ public:
   PolyOps* pops;			// polygon operations class
   Course* course;			// course planning class
   Obstacle* obstacle;			// obstacle class
+  Rollout* rollout;			// candidate trajectory class
 
   // subordinate controllers
   Estop	*estop;
@@ -78,6 +81,8 @@ public:
   art_msgs::NavigatorState navdata;    // current navigator state data
   nav_msgs::Odometry estimate;         // estimated control position
   nav_msgs::Odometry *odometry;
+  OdomHistory odom_history;            // recent odometry, by time
+  double cycle_interval;               // time since last cycle (s)
 
   // public methods
   Navigator(nav_msgs::Odometry *odom_msg);
@@ -108,6 +113,7 @@ public:
 
 private:
   int verbose;				// log message verbosity
+  ros::Time last_cycle;			// time of last cycle
 };
 
 #endif // __NAVIGATOR_INTERNAL_H__
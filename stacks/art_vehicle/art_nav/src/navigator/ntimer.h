@@ -15,6 +15,8 @@
 #include <sys/time.h>
 #include <time.h>
 
+#include "navigator_internal.h"
+
 /** @brief Navigator node timer class.
  *
  *  This class is specific to the navigator node.
@@ -23,8 +25,12 @@ class NavTimer
 {
  public:
 
-  /** @brief Constructor */
-  NavTimer()
+  /** @brief Constructor
+   *
+   * @param _nav navigator whose cycles run the timer
+   */
+  NavTimer(const Navigator *_nav):
+    nav(_nav)
     {
       this->Cancel();
     };
@@ -49,8 +55,8 @@ class NavTimer
     if (!timer_running)
       return false;			// timer not set
 
-    // decrement time remaining by the duration of one cycle
-    time_remaining -= (1.0 / art_msgs::ArtHertz::NAVIGATOR);
+    // decrement time remaining by the duration of this cycle
+    time_remaining -= nav->cycle_interval;
     return (time_remaining <= 0.0);
   }
 
@@ -77,6 +83,7 @@ class NavTimer
 
   double time_remaining;		//< time remaining until done
   bool timer_running;			//< true when timer running
+  const Navigator *nav;			//< navigator running the timer
 };
 
 #endif // _NAV_TIMER_HH_
@@ -39,6 +39,7 @@ Obstacle::Obstacle(Navigator *_nav, int _verbose)
   // initialize observers state to all clear in case that driver is
   // not subscribed or not publishing data
   obstate.obs.resize(Observation::N_Observers);
+  obs_stamp_.resize(Observation::N_Observers);
   for (unsigned i = 0; i < Observation::N_Observers; ++i)
     {
       obstate.obs[i].oid = i;
@@ -50,11 +51,15 @@ Obstacle::Obstacle(Navigator *_nav, int _verbose)
   obstate.obs[Observation::Nearest_forward].applicable = false;
 
   // allocate timers
-  blockage_timer = new NavTimer();
+  blockage_timer = new NavTimer(nav);
   was_stopped = false;
 
   reset();
+}
 
+/** subscribe to observations */
+void Obstacle::subscribe(void)
+{
   ros::NodeHandle node;
   obs_sub_ = node.subscribe("observations", 10,
                             &Obstacle::observers_message, this,
@@ -191,8 +196,64 @@ void
   for (uint32_t i = 0; i < obs_msg->obs.size(); ++i)
     {
       obstate.obs[obs_msg->obs[i].oid] = obs_msg->obs[i];
-      // TODO (maybe) track time stamps separately for each OID?
+      obs_stamp_[obs_msg->obs[i].oid] = obs_msg->header.stamp;
+    }
+}
+
+/** @brief Bring an observed distance up to the control pose time.
+ *
+ *  The observers measure distances along the lane from where the car
+ *  was at the observation time stamp.  Since then, the car has moved
+ *  on, which the odometry history tells exactly, and so has the
+ *  obstacle, at the speed implied by the observed rate of change of
+ *  the distance and the car's speed at the time.
+ *
+ *  Only the nearest forward and backward observers say which side of
+ *  the car the obstacle is on, so only their distances are moved.
+ *
+ *  @param obs[in,out] observation to align
+ *  @param stamp time of the observation
+ */
+void Obstacle::align(art_msgs::Observation &obs, const ros::Time &stamp) const
+{
+  bool ahead = (obs.oid == Observation::Nearest_forward);
+  if (!(ahead || obs.oid == Observation::Nearest_backward)
+      || !isfinite(obs.distance))
+    return;
+
+  double dt = (estimate->header.stamp - stamp).toSec();
+  if (dt <= 0.0)
+    return;
+
+  OdomHistory::Sample then, now;
+  if (!nav->odom_history.estimate(stamp, then)
+      || !nav->odom_history.estimate(estimate->header.stamp, now))
+    return;				// not enough history
+
+  double travelled = hypot(now.x - then.x, now.y - then.y);
+  if (then.speed + now.speed < 0.0)	// backing up?
+    travelled = -travelled;
+
+  double distance;
+  if (ahead)
+    {
+      double obstacle_speed = then.speed + obs.velocity;
+      distance = obs.distance - travelled + obstacle_speed * dt;
     }
+  else
+    {
+      double obstacle_speed = then.speed - obs.velocity;
+      distance = obs.distance + travelled - obstacle_speed * dt;
+    }
+  distance = fmax(distance, 0.0);
+
+  ROS_DEBUG("observer %d distance %.3f m, %.3f s ago, now %.3f m",
+            obs.oid, obs.distance, dt, distance);
+
+  // time to reach the obstacle is proportional to the distance
+  if (isfinite(obs.time) && obs.distance > 0.0)
+    obs.time *= distance / obs.distance;
+  obs.distance = distance;
 }
 
 // return true when observer reports passing lane clear
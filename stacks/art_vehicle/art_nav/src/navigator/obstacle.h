@@ -67,10 +67,14 @@ class Obstacle
   /** @brief maximum scan range accessor. */
   float maximum_range(void) {return max_range;}
 
-  /** @brief return current observation state */
+  /** @brief return current observation state, with distances
+   *         brought up to the control pose time
+   */
   art_msgs::Observation observation(art_msgs::Observation::_oid_type oid)
   {
-    return obstate.obs[oid];
+    art_msgs::Observation obs = obstate.obs[oid];
+    align(obs, obs_stamp_[oid]);
+    return obs;
   }
 
   /** @brief return true when observer reports clear to go */
@@ -92,6 +96,10 @@ class Obstacle
   /** @brief reset obstacles. */
   void reset(void);
 
+  /** @brief subscribe to observations, unless the caller passes
+   *  them to observers_message() instead */
+  void subscribe(void);
+
   /** @brief mark car not blocked, cancel timeout. */
   void unblocked(void)
   {
@@ -120,6 +128,8 @@ class Obstacle
 
  private:
 
+  void align(art_msgs::Observation &obs, const ros::Time &stamp) const;
+
   // parameters
   float max_range;			//< maximum scan range
 
@@ -127,6 +137,7 @@ class Obstacle
 
   // observers data
   art_msgs::ObservationArray obstate;   //< current observers state
+  std::vector<ros::Time> obs_stamp_;	//< time of each observation
 
   // blockage timer
   NavTimer *blockage_timer;
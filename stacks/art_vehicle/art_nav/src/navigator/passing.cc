@@ -12,6 +12,7 @@
 #include "Controller.h"
 #include "course.h"
 #include "obstacle.h"
+#include "rollout.h"
 #include "passing.h"
 
 #include "halt.h"
@@ -46,6 +47,8 @@ Passing::~Passing()
 //	Finished, if original lane reached.
 Controller::result_t Passing::control(pilot_command_t &pcmd)
 {
+  CYCLE_TIMER("Passing");
+
 #if 0 // not doing avoid right now
   pilot_command_t incmd = pcmd;		// copy of original input
 #endif // not doing avoid right now
@@ -79,8 +82,10 @@ Controller::result_t Passing::control(pilot_command_t &pcmd)
       result = Finished;
     }
 
-  // set heading to desired course
-  course->desired_heading(pcmd);
+  // set heading and speed for the best candidate course, which may
+  // use the passed lane, and stops the car if none is feasible
+  if (!nav->rollout->control(pcmd, true) && result != Finished)
+    result = Blocked;
 
   // check if way-point reached
   course->lane_waypoint_reached();
@@ -8,8 +8,16 @@
  */
 
 #include <unistd.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <ros/callback_queue.h>
 #include <dynamic_reconfigure/server.h>
+#include <diagnostic_updater/diagnostic_updater.h>
 
 #include <art/frames.h>
 
@@ -25,7 +33,9 @@
 
 #include "navigator_internal.h"
 #include "course.h"
-//#include "obstacle.h"
+#include "obstacle.h"
+#include "latest_slot.h"
+#include "cycle_profiler.h"
 
 /** @file
 
@@ -33,13 +43,92 @@
 
   Use the commander node to control this node.
 
-  @todo Add Observers interface.
+  By default, the node runs the navigator at a fixed rate.  With
+  ~event_driven set, subscription callbacks run on a separate thread
+  and leave their messages in latest-value slots, and each new
+  odometry message runs the navigator at once.  If none arrives
+  within 1/~min_rate seconds, a watchdog runs it anyway.
+
+  Every ~latency_report seconds, the node logs histograms of the
+  time from receiving each kind of input to publishing the first
+  pilot command based on it.
+
+  The "navigator cycle" diagnostic reports histograms of the time
+  each controller took, and the whole navigate() cycle, since the
+  previous report.  When a cycle takes longer than the cycle_budget
+  parameter, the node warns, naming the slowest controllers.
 
   @author Jack O'Quin
 */
 
 #define CLASS "NavQueueMgr"
 
+/** @brief histogram of input to command latencies */
+class LatencyHistogram
+{
+public:
+  LatencyHistogram()
+  {
+    clear();
+  }
+
+  void add(double secs)
+  {
+    double ms = secs * 1000.0;
+    unsigned bin = 0;
+    while (bin < N_BINS-1 && ms >= limit_[bin])
+      ++bin;
+    ++count_[bin];
+    ++n_;
+    sum_ += ms;
+    if (ms > max_)
+      max_ = ms;
+  }
+
+  void clear()
+  {
+    for (unsigned bin = 0; bin < N_BINS; ++bin)
+      count_[bin] = 0;
+    n_ = 0;
+    sum_ = max_ = 0.0;
+  }
+
+  unsigned long size() const
+  {
+    return n_;
+  }
+
+  /** @return one line summary, counts per bin in milliseconds */
+  std::string str() const
+  {
+    std::string result;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "n %lu, mean %.2f, max %.2f ms:",
+             n_, (n_? sum_ / n_: 0.0), max_);
+    result = buf;
+    for (unsigned bin = 0; bin < N_BINS; ++bin)
+      {
+        if (bin < N_BINS-1)
+          snprintf(buf, sizeof(buf), " <%g:%lu", limit_[bin], count_[bin]);
+        else
+          snprintf(buf, sizeof(buf), " >=%g:%lu",
+                   limit_[bin-1], count_[bin]);
+        result += buf;
+      }
+    return result;
+  }
+
+private:
+  static const unsigned N_BINS = 8;
+  static const double limit_[N_BINS-1]; // bin upper limits (ms)
+  unsigned long count_[N_BINS];
+  unsigned long n_;
+  double sum_;
+  double max_;
+};
+
+const double LatencyHistogram::limit_[] = {1, 2, 5, 10, 20, 50, 100};
+
 // The class for the driver
 class NavQueueMgr
 {
@@ -58,10 +147,28 @@ public:
 
 private:
 
+  // inputs tracked for latency
+  enum input_t {Odom, RoadMap, Observations, Command, N_INPUTS};
+
+  void checkBudget(unsigned long cycle, uint64_t elapsed);
+  void cycle(void);
+  void received(input_t input, const ros::WallTime &when);
+  void reportLatency(void);
+  void spinEvents(void);
+  void spinFixed(void);
+  void takeInputs(void);
+
+  // event driven subscription callbacks
+  void queueNavCmd(const art_msgs::NavigatorCommand::ConstPtr &cmdIn);
+  void queueObservations(const art_msgs::ObservationArray::ConstPtr &obsIn);
+  void queueOdom(const nav_msgs::Odometry::ConstPtr &odomIn);
+  void queueRoadMap(const art_msgs::ArtLanes::ConstPtr &mapIn);
+
   void processNavCmd(const art_msgs::NavigatorCommand::ConstPtr &cmdIn);
   void processOdom(const nav_msgs::Odometry::ConstPtr &odomIn);
   void processRoadMap(const art_msgs::ArtLanes::ConstPtr &cmdIn);
   void processRelays(const art_msgs::IOadrState::ConstPtr &sigIn);
+  void profileStatus(diagnostic_updater::DiagnosticStatusWrapper &stat);
   void PublishState(void);
   void reconfig(Config &newconfig, uint32_t level);
   void SetRelays(void);
@@ -76,7 +183,7 @@ private:
   ros::Publisher  signals_cmd_;
   ros::Subscriber signals_state_;
 
-  //ros::Subscriber observers_;
+  ros::Subscriber observers_;           // observations, if event driven
 
   // relay variables
   bool signal_on_left_;			// reported turn signal states
@@ -94,6 +201,33 @@ private:
   // navigator implementation class
   Navigator *nav_;
 
+  // event driven operation
+  bool event_driven_;                   // run when odometry arrives
+  double min_rate_;                     // watchdog rate (Hz)
+  ros::CallbackQueue event_queue_;      // callbacks for the slots
+  LatestSlot<art_msgs::NavigatorCommand> cmd_slot_;
+  LatestSlot<art_msgs::ArtLanes> map_slot_;
+  LatestSlot<art_msgs::ObservationArray> obs_slot_;
+  LatestSlot<nav_msgs::Odometry> odom_slot_;
+  boost::mutex odom_lock_;              // protects odom_ready_
+  boost::condition_variable odom_cond_; // signalled on odom_ready_
+  bool odom_ready_;                     // odometry in odom_slot_
+  unsigned long watchdog_cycles_;       // cycles without odometry
+
+  // input to command latencies
+  double report_secs_;                  // seconds between reports
+  ros::WallTime report_time_;           // time of last report
+  ros::WallTime pending_[N_INPUTS];     // inputs not yet commanded
+  bool have_pending_[N_INPUTS];
+  LatencyHistogram latency_[N_INPUTS];
+
+  // cycle profile
+  diagnostic_updater::Updater diagnostics_;
+  int navigate_timer_;                  // profiler id for navigate()
+  uint64_t worst_cycle_;                // longest cycle ever (ns)
+  unsigned long over_budget_;           // cycles over budget, this report
+  std::vector<CycleProfiler::Stats> profile_;
+
   // configuration callback
   dynamic_reconfigure::Server<Config> ccb_;
 };
@@ -103,6 +237,16 @@ NavQueueMgr::NavQueueMgr()
 {
   signal_on_left_ = signal_on_right_ = false;
   flasher_on_ = alarm_on_ = false;
+  event_driven_ = false;
+  min_rate_ = art_msgs::ArtHertz::NAVIGATOR / 2.0;
+  odom_ready_ = false;
+  watchdog_cycles_ = 0;
+  report_secs_ = 60.0;
+  for (unsigned i = 0; i < N_INPUTS; ++i)
+    have_pending_[i] = false;
+  navigate_timer_ = CycleProfiler::instance().timer("navigate");
+  worst_cycle_ = 0;
+  over_budget_ = 0;
 
   // create control driver, declare dynamic reconfigure callback
   nav_ = new Navigator(&odom_msg_);
@@ -117,6 +261,8 @@ void NavQueueMgr::processNavCmd(const
                    << NavBehavior(cmdIn->order.behavior).Name());
   cmd_time_ = cmdIn->header.stamp;
   nav_->order = cmdIn->order;
+  if (!event_driven_)
+    received(Command, ros::WallTime::now());
 }
 
 /** Handle Odometry input. */
@@ -133,6 +279,12 @@ void NavQueueMgr::processOdom(const nav_msgs::Odometry::ConstPtr &odomIn)
   float vel = odomIn->twist.twist.linear.x;
   ROS_DEBUG("current velocity = %.3f m/sec, (%02.f mph)", vel, mps2mph(vel));
   odom_msg_ = *odomIn;
+  if (!event_driven_)
+    {
+      // queueOdom() already added it when event driven
+      nav_->odom_history.add(*odomIn);
+      received(Odom, ros::WallTime::now());
+    }
 }
 
 /** Handle road map polygons. */
@@ -141,6 +293,90 @@ void NavQueueMgr::processRoadMap(const art_msgs::ArtLanes::ConstPtr &mapIn)
   ROS_DEBUG_STREAM(mapIn->polygons.size() << " lanes polygons received");
   map_time_ = mapIn->header.stamp;
   nav_->course->lanes_message(*mapIn);
+  if (!event_driven_)
+    received(RoadMap, ros::WallTime::now());
+}
+
+/** Queue command input for the navigator thread. */
+void NavQueueMgr::queueNavCmd(const
+                              art_msgs::NavigatorCommand::ConstPtr &cmdIn)
+{
+  cmd_slot_.put(cmdIn);
+}
+
+/** Queue observations for the navigator thread. */
+void NavQueueMgr::queueObservations(const
+                                    art_msgs::ObservationArray::ConstPtr &obsIn)
+{
+  obs_slot_.put(obsIn);
+}
+
+/** Queue odometry for the navigator thread, and wake it. */
+void NavQueueMgr::queueOdom(const nav_msgs::Odometry::ConstPtr &odomIn)
+{
+  nav_->odom_history.add(*odomIn);
+  odom_slot_.put(odomIn);
+  {
+    boost::mutex::scoped_lock l(odom_lock_);
+    odom_ready_ = true;
+  }
+  odom_cond_.notify_one();
+}
+
+/** Queue road map polygons for the navigator thread. */
+void NavQueueMgr::queueRoadMap(const art_msgs::ArtLanes::ConstPtr &mapIn)
+{
+  map_slot_.put(mapIn);
+}
+
+/** Note an input received, for latency reporting.
+ *
+ *  Only the first one since the last pilot command counts.
+ */
+void NavQueueMgr::received(input_t input, const ros::WallTime &when)
+{
+  if (!have_pending_[input])
+    {
+      pending_[input] = when;
+      have_pending_[input] = true;
+    }
+}
+
+/** Take the latest inputs from the event driven slots.
+ *
+ *  Runs in the navigator thread.
+ */
+void NavQueueMgr::takeInputs(void)
+{
+  ros::WallTime when;
+
+  art_msgs::NavigatorCommand::ConstPtr cmd;
+  if (cmd_slot_.take(cmd, when))
+    {
+      processNavCmd(cmd);
+      received(Command, when);
+    }
+
+  art_msgs::ArtLanes::ConstPtr map;
+  if (map_slot_.take(map, when))
+    {
+      processRoadMap(map);
+      received(RoadMap, when);
+    }
+
+  art_msgs::ObservationArray::ConstPtr obs;
+  if (obs_slot_.take(obs, when))
+    {
+      nav_->obstacle->observers_message(obs);
+      received(Observations, when);
+    }
+
+  nav_msgs::Odometry::ConstPtr odom;
+  if (odom_slot_.take(odom, when))
+    {
+      processOdom(odom);
+      received(Odom, when);
+    }
 }
 
 /** Handle relays state message. */
@@ -201,13 +437,47 @@ bool NavQueueMgr::setup(ros::NodeHandle node)
   ros::TransportHints noDelay = ros::TransportHints().tcpNoDelay(true);
   static uint32_t qDepth = 1;
 
+  ros::NodeHandle priv("~");
+  priv.param("event_driven", event_driven_, false);
+  priv.param("min_rate", min_rate_,
+             (double) art_msgs::ArtHertz::NAVIGATOR / 2.0);
+  if (min_rate_ <= 0.0)
+    min_rate_ = art_msgs::ArtHertz::NAVIGATOR / 2.0;
+  priv.param("latency_report", report_secs_, 60.0);
+  if (event_driven_)
+    ROS_INFO("navigator runs on odometry, at least %.1f Hz", min_rate_);
+  else
+    ROS_INFO("navigator runs at %.1f Hz",
+             (double) art_msgs::ArtHertz::NAVIGATOR);
+
   // topics to read
-  odom_state_ = node.subscribe("odom", qDepth,
-                               &NavQueueMgr::processOdom, this, noDelay);
-  nav_cmd_ = node.subscribe("navigator/cmd", qDepth,
-                            &NavQueueMgr::processNavCmd, this, noDelay);
-  roadmap_ = node.subscribe("roadmap_local", qDepth,
-                            &NavQueueMgr::processRoadMap, this, noDelay);
+  if (event_driven_)
+    {
+      // The callbacks run on their own queue in a spinner thread and
+      // only fill the slots.  The navigator's own subscriptions
+      // stay on the global queue, serviced before each cycle.
+      ros::NodeHandle events(node);
+      events.setCallbackQueue(&event_queue_);
+      odom_state_ = events.subscribe("odom", qDepth,
+                                     &NavQueueMgr::queueOdom, this, noDelay);
+      nav_cmd_ = events.subscribe("navigator/cmd", qDepth,
+                                  &NavQueueMgr::queueNavCmd, this, noDelay);
+      roadmap_ = events.subscribe("roadmap_local", qDepth,
+                                  &NavQueueMgr::queueRoadMap, this, noDelay);
+      observers_ = events.subscribe("observations", qDepth,
+                                    &NavQueueMgr::queueObservations, this,
+                                    noDelay);
+    }
+  else
+    {
+      odom_state_ = node.subscribe("odom", qDepth,
+                                   &NavQueueMgr::processOdom, this, noDelay);
+      nav_cmd_ = node.subscribe("navigator/cmd", qDepth,
+                                &NavQueueMgr::processNavCmd, this, noDelay);
+      roadmap_ = node.subscribe("roadmap_local", qDepth,
+                                &NavQueueMgr::processRoadMap, this, noDelay);
+      nav_->obstacle->subscribe();
+    }
   signals_state_ = node.subscribe("ioadr/state", qDepth,
                                   &NavQueueMgr::processRelays, this, noDelay);
 
@@ -217,6 +487,9 @@ bool NavQueueMgr::setup(ros::NodeHandle node)
     node.advertise<art_msgs::NavigatorState>("navigator/state", qDepth);
   signals_cmd_ = node.advertise<art_msgs::IOadrCommand>("ioadr/cmd", qDepth);
 
+  diagnostics_.setHardwareID("navigator");
+  diagnostics_.add("navigator cycle", this, &NavQueueMgr::profileStatus);
+
   return true;
 }
 
@@ -341,23 +614,201 @@ void NavQueueMgr::PublishState(void)
   nav_state_.publish(nav_->navdata);
 }
 
+/** Run one navigator cycle with the inputs already received */
+void NavQueueMgr::cycle(void)
+{
+  // invoke appropriate Navigator method, pass result to Pilot
+  CycleProfiler &profiler = CycleProfiler::instance();
+  unsigned long n = profiler.next_cycle();
+  uint64_t start = CycleProfiler::now();
+  pilot_command_t pcmd = nav_->navigate();
+  uint64_t elapsed = CycleProfiler::now() - start;
+  profiler.record(navigate_timer_, elapsed);
+  SetSpeed(pcmd);
+  checkBudget(n, elapsed);
+
+  // the command is out, note how long its inputs waited
+  ros::WallTime now = ros::WallTime::now();
+  for (unsigned i = 0; i < N_INPUTS; ++i)
+    if (have_pending_[i])
+      {
+        latency_[i].add((now - pending_[i]).toSec());
+        have_pending_[i] = false;
+      }
+
+  SetRelays();
+
+  PublishState();
+
+  diagnostics_.update();
+
+  if (report_secs_ > 0.0
+      && (now - report_time_).toSec() >= report_secs_)
+    {
+      reportLatency();
+      report_time_ = now;
+    }
+}
+
+namespace
+{
+  /** order timers by the time they took last */
+  bool slower(const CycleProfiler::Stats &a, const CycleProfiler::Stats &b)
+  {
+    return a.last_ns > b.last_ns;
+  }
+}
+
+/** Track the worst cycle, warning if this one was over budget.
+ *
+ * @param cycle profiler number of this cycle
+ * @param elapsed time navigate() took (ns)
+ */
+void NavQueueMgr::checkBudget(unsigned long cycle, uint64_t elapsed)
+{
+  if (elapsed > worst_cycle_)
+    worst_cycle_ = elapsed;
+
+  double budget = nav_->config_.cycle_budget;
+  if (budget <= 0.0 || elapsed <= budget * 1e9)
+    return;
+  ++over_budget_;
+
+  // name the slowest controllers run this cycle
+  CycleProfiler::instance().snapshot(profile_, false);
+  std::vector<CycleProfiler::Stats> slowest;
+  for (unsigned i = 0; i < profile_.size(); ++i)
+    if (profile_[i].cycle == cycle && (int) i != navigate_timer_)
+      slowest.push_back(profile_[i]);
+  std::sort(slowest.begin(), slowest.end(), slower);
+
+  std::string detail;
+  char buf[64];
+  for (unsigned i = 0; i < slowest.size() && i < 3; ++i)
+    {
+      snprintf(buf, sizeof(buf), "%s%s %.3f", (i? ", ": ""),
+               slowest[i].name, slowest[i].last_ns / 1e6);
+      detail += buf;
+    }
+  ROS_WARN_THROTTLE(10, "navigator cycle took %.3f ms, budget %.3f ms "
+                    "(%s)", elapsed / 1e6, budget * 1000.0, detail.c_str());
+}
+
+/** Report and clear the cycle profile histograms */
+void NavQueueMgr::profileStatus(diagnostic_updater::DiagnosticStatusWrapper
+                                &stat)
+{
+  if (over_budget_ > 0)
+    stat.summaryf(diagnostic_msgs::DiagnosticStatus::WARN,
+                  "%lu cycles over budget", over_budget_);
+  else
+    stat.summary(diagnostic_msgs::DiagnosticStatus::OK,
+                 "cycles within budget");
+  stat.addf("budget (ms)", "%.3f", nav_->config_.cycle_budget * 1000.0);
+  stat.addf("cycles over budget", "%lu", over_budget_);
+  stat.addf("worst cycle (ms)", "%.3f", worst_cycle_ / 1e6);
+  over_budget_ = 0;
+
+  CycleProfiler::instance().snapshot(profile_, true);
+  char buf[64];
+  for (unsigned i = 0; i < profile_.size(); ++i)
+    {
+      const CycleProfiler::Stats &st = profile_[i];
+      std::string name(st.name);
+      stat.addf(name + " count", "%lu", st.count);
+      stat.addf(name + " mean (ms)", "%.3f",
+                (st.count? st.total_ns / 1e6 / st.count: 0.0));
+      stat.addf(name + " worst (ms)", "%.3f", st.worst_ns / 1e6);
+
+      // counts per bin in microseconds
+      std::string hist;
+      for (unsigned bin = 0; bin < CycleProfiler::N_BINS; ++bin)
+        {
+          if (bin < CycleProfiler::N_BINS-1)
+            snprintf(buf, sizeof(buf), "%s<%llu:%lu", (bin? " ": ""),
+                     (unsigned long long) CycleProfiler::limit_us[bin],
+                     st.bins[bin]);
+          else
+            snprintf(buf, sizeof(buf), " >=%llu:%lu",
+                     (unsigned long long) CycleProfiler::limit_us[bin-1],
+                     st.bins[bin]);
+          hist += buf;
+        }
+      stat.add(name + " histogram (us)", hist);
+    }
+}
+
+/** Log and clear the input to command latency histograms */
+void NavQueueMgr::reportLatency(void)
+{
+  static const char *name[N_INPUTS] =
+    {"odometry", "road map", "observations", "command"};
+  for (unsigned i = 0; i < N_INPUTS; ++i)
+    {
+      if (latency_[i].size() > 0)
+        ROS_INFO("%s latency: %s", name[i], latency_[i].str().c_str());
+      latency_[i].clear();
+    }
+  if (event_driven_)
+    {
+      ROS_INFO("%lu watchdog cycles without odometry", watchdog_cycles_);
+      watchdog_cycles_ = 0;
+    }
+}
+
 /** Spin method for main thread */
 void NavQueueMgr::spin() 
 {
-  ros::Rate cycle(art_msgs::ArtHertz::NAVIGATOR);
+  report_time_ = ros::WallTime::now();
+  if (event_driven_)
+    spinEvents();
+  else
+    spinFixed();
+}
+
+/** Run the navigator when odometry arrives, or when the watchdog
+ *  expires without any.
+ */
+void NavQueueMgr::spinEvents(void)
+{
+  ros::AsyncSpinner spinner(1, &event_queue_);
+  spinner.start();
+
+  boost::posix_time::milliseconds
+    watchdog((long) (1000.0 / min_rate_));
   while(ros::ok())
     {
-      ros::spinOnce();                  // handle incoming messages
+      {
+        boost::mutex::scoped_lock l(odom_lock_);
+        boost::system_time deadline = boost::get_system_time() + watchdog;
+        while (!odom_ready_)
+          if (!odom_cond_.timed_wait(l, deadline))
+            break;
+        if (!odom_ready_)
+          ++watchdog_cycles_;
+        odom_ready_ = false;
+      }
+
+      ros::spinOnce();                  // reconfigure, relays state
+      takeInputs();
+      cycle();
+    }
 
-      // invoke appropriate Navigator method, pass result to Pilot
-      SetSpeed(nav_->navigate());
+  spinner.stop();
+}
 
-      SetRelays();
+/** Run the navigator at a fixed rate */
+void NavQueueMgr::spinFixed(void)
+{
+  ros::Rate cycle_rate(art_msgs::ArtHertz::NAVIGATOR);
+  while(ros::ok())
+    {
+      ros::spinOnce();                  // handle incoming messages
 
-      PublishState();
+      cycle();
 
       // wait for next cycle
-      cycle.sleep();
+      cycle_rate.sleep();
     }
 }
 
@@ -0,0 +1,373 @@
+/*
+ *  Navigator offline replay implementation
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include <art/steering.h>
+#include <art_map/Graph.h>
+#include <art_map/MapLanes.h>
+#include <art_map/RNDF.h>
+#include <art_nav/NavEstopState.h>
+
+#include "navigator_internal.h"
+#include "course.h"
+#include "obstacle.h"
+#include "cycle_profiler.h"
+#include "replay.h"
+
+using replay::Command;
+using replay::Input;
+
+namespace
+{
+/** @return topic name without any leading slash */
+std::string topic_name(const std::string &topic)
+{
+  if (!topic.empty() && topic[0] == '/')
+    return topic.substr(1);
+  return topic;
+}
+
+} // namespace
+
+bool replay::read_bag(const char *bag_name, std::vector<Input> &inputs)
+{
+  rosbag::Bag bag;
+  try
+    {
+      bag.open(bag_name, rosbag::bagmode::Read);
+    }
+  catch (rosbag::BagException &e)
+    {
+      fprintf(stderr, "%s: %s\n", bag_name, e.what());
+      return false;
+    }
+
+  std::vector<std::string> topics;
+  topics.push_back("odom");
+  topics.push_back("roadmap_local");
+  topics.push_back("observations");
+  topics.push_back("navigator/cmd");
+  for (unsigned i = 0; i < 4; ++i)
+    topics.push_back("/" + topics[i]);
+
+  rosbag::View view(bag, rosbag::TopicQuery(topics));
+  for (rosbag::View::iterator it = view.begin(); it != view.end(); ++it)
+    {
+      Input in;
+      in.time = it->getTime();
+      std::string topic = topic_name(it->getTopic());
+      if (topic == "odom")
+	in.odom = it->instantiate<nav_msgs::Odometry>();
+      else if (topic == "roadmap_local")
+	in.map = it->instantiate<art_msgs::ArtLanes>();
+      else if (topic == "observations")
+	in.obs = it->instantiate<art_msgs::ObservationArray>();
+      else
+	in.cmd = it->instantiate<art_msgs::NavigatorCommand>();
+      if (in.odom || in.map || in.obs || in.cmd)
+	inputs.push_back(in);
+    }
+  bag.close();
+
+  if (inputs.empty())
+    {
+      fprintf(stderr, "%s: no navigator inputs\n", bag_name);
+      return false;
+    }
+  return true;
+}
+
+/** The car drives down the lane through the way-points at a steady
+ *  4 m/s for 8 seconds, with 50 Hz odometry, 10 Hz local maps and
+ *  observations, and a commander order every half second.  After 4
+ *  seconds, a slower car appears 30 meters ahead and the gap closes
+ *  at 3 m/s.  Run, Initialize, then Go.
+ */
+bool replay::synthetic_inputs(const char *rndf_name, int start,
+			      std::vector<Input> &inputs)
+{
+  RNDF rndf(rndf_name);
+  if (!rndf.is_valid)
+    {
+      fprintf(stderr, "%s: invalid RNDF\n", rndf_name);
+      return false;
+    }
+  Graph graph;
+  rndf.populate_graph(graph);
+  graph.find_mapxy();
+  if (start < 0 || start + (int) Order::N_WAYPTS > (int) graph.nodes_size)
+    {
+      fprintf(stderr, "%s: no way-points %d to %d\n", rndf_name,
+	      start, start + Order::N_WAYPTS - 1);
+      return false;
+    }
+  MapLanes map_lanes(80.0);
+  map_lanes.MapRNDF(&graph);
+
+  const double speed = 4.0;		// m/s
+  const double step = 0.02;		// odometry period (s)
+  WayPointNode *wp = &graph.nodes[start];
+  inputs.clear();
+
+  for (int s = 0; s < 400; ++s)
+    {
+      double t = s * step;
+      Input in;
+      in.time = ros::Time(1000.0 + t);
+
+      if (s % 25 == 0)
+	{
+	  art_msgs::NavigatorCommandPtr cmd(new art_msgs::NavigatorCommand);
+	  cmd->order.behavior.value = (t < 0.2? NavBehavior::Run:
+				       t < 0.6? NavBehavior::Initialize:
+				       NavBehavior::Go);
+	  for (unsigned k = 0; k < Order::N_WAYPTS; ++k)
+	    {
+	      cmd->order.waypt[k].id = wp[k].id.toMapID();
+	      cmd->order.waypt[k].is_perimeter = false;
+	    }
+	  cmd->order.max_speed = 5.0;
+	  cmd->order.min_speed = 0.0;
+	  Input c = in;
+	  c.cmd = cmd;
+	  inputs.push_back(c);
+	}
+
+      // position along the way-point polyline
+      double d = speed * t;
+      double x = wp[0].map.x;
+      double y = wp[0].map.y;
+      double heading = 0.0;
+      for (unsigned k = 0; k + 1 < Order::N_WAYPTS; ++k)
+	{
+	  double dx = wp[k+1].map.x - wp[k].map.x;
+	  double dy = wp[k+1].map.y - wp[k].map.y;
+	  double len = hypot(dx, dy);
+	  heading = atan2(dy, dx);
+	  if (d <= len)
+	    {
+	      x = wp[k].map.x + dx * d / len;
+	      y = wp[k].map.y + dy * d / len;
+	      break;
+	    }
+	  d -= len;
+	  x = wp[k+1].map.x;
+	  y = wp[k+1].map.y;
+	}
+
+      nav_msgs::OdometryPtr odom(new nav_msgs::Odometry);
+      odom->header.stamp = in.time;
+      odom->pose.pose.position.x = x;
+      odom->pose.pose.position.y = y;
+      odom->pose.pose.orientation.z = sin(heading / 2.0);
+      odom->pose.pose.orientation.w = cos(heading / 2.0);
+      odom->twist.twist.linear.x = speed;
+      Input o = in;
+      o.odom = odom;
+      inputs.push_back(o);
+
+      if (s % 10 == 0)
+	{
+	  art_msgs::ArtLanesPtr lanes(new art_msgs::ArtLanes);
+	  map_lanes.getLanes(lanes.get(), MapXY(x, y));
+	  Input m = in;
+	  m.map = lanes;
+	  inputs.push_back(m);
+
+	  art_msgs::ObservationArrayPtr obs(new art_msgs::ObservationArray);
+	  obs->obs.resize(Observation::N_Observers);
+	  for (unsigned k = 0; k < obs->obs.size(); ++k)
+	    {
+	      obs->obs[k].oid = k;
+	      obs->obs[k].applicable = true;
+	      obs->obs[k].clear = true;
+	      obs->obs[k].distance = 80.0;
+	    }
+	  if (t > 4.0)
+	    {
+	      Observation &ahead = obs->obs[Observation::Nearest_forward];
+	      ahead.clear = false;
+	      ahead.distance = 30.0 - 3.0 * (t - 4.0);
+	      ahead.velocity = 1.0;
+	    }
+	  Input ob = in;
+	  ob.obs = obs;
+	  inputs.push_back(ob);
+	}
+    }
+  return true;
+}
+
+void replay::run(const std::vector<Input> &inputs, bool event_driven,
+		 int threads, std::vector<Command> &commands,
+		 std::vector<double> &latency)
+{
+  nav_msgs::Odometry odom_msg;
+  Navigator *nav = new Navigator(&odom_msg);
+  nav->config_ = Config::__getDefault__();
+  if (threads >= 0)
+    nav->config_.rollout_threads = threads;
+  nav->configure();
+
+  CycleProfiler &profiler = CycleProfiler::instance();
+  const double period = 1.0 / art_msgs::ArtHertz::NAVIGATOR;
+  const double watchdog = 2.0 / art_msgs::ArtHertz::NAVIGATOR;
+  ros::Time start = inputs.front().time;
+  ros::Time end = inputs.back().time;
+  ros::Time cycle_time = start;
+  unsigned next = 0;			// next input to deliver
+
+  while (cycle_time <= end)
+    {
+      if (event_driven)
+	{
+	  // next odometry message, or the watchdog
+	  ros::Time wake = cycle_time + ros::Duration(watchdog);
+	  for (unsigned i = next; i < inputs.size(); ++i)
+	    if (inputs[i].odom)
+	      {
+		if (inputs[i].time < wake)
+		  wake = inputs[i].time;
+		break;
+	      }
+	  if (wake > end)
+	    break;
+	  cycle_time = wake;
+	}
+
+      // deliver the messages received by now
+      while (next < inputs.size() && inputs[next].time <= cycle_time)
+	{
+	  const Input &in = inputs[next++];
+	  ros::Time::setNow(in.time);
+	  if (in.odom)
+	    {
+	      odom_msg = *in.odom;
+	      nav->odom_history.add(*in.odom);
+	    }
+	  else if (in.map)
+	    nav->course->lanes_message(*in.map);
+	  else if (in.obs)
+	    nav->obstacle->observers_message(in.obs);
+	  else
+	    nav->order = in.cmd->order;
+	}
+
+      ros::Time::setNow(cycle_time);
+      profiler.next_cycle();
+      uint64_t t0 = CycleProfiler::now();
+      pilot_command_t pcmd = nav->navigate();
+      latency.push_back((CycleProfiler::now() - t0) / 1e6);
+
+      // what the node would send the pilot
+      if (NavEstopState(nav->navdata.estop) != NavEstopState::Suspend)
+	{
+	  float yawRate = pcmd.yawRate;
+	  if (pcmd.velocity < 0)
+	    yawRate = -yawRate;
+	  Command c;
+	  c.time = (cycle_time - start).toSec();
+	  c.velocity = pcmd.velocity;
+	  c.angle = Steering::steering_angle(fabs(pcmd.velocity), yawRate);
+	  commands.push_back(c);
+	}
+
+      if (!event_driven)
+	cycle_time = cycle_time + ros::Duration(period);
+    }
+
+  delete nav;
+}
+
+int replay::compare(const std::vector<Command> &expected,
+		    const std::vector<Command> &actual, const char *what,
+		    double tolerance)
+{
+  int diffs = 0;
+  unsigned n = std::min(expected.size(), actual.size());
+  for (unsigned i = 0; i < n; ++i)
+    {
+      const Command &e = expected[i];
+      const Command &a = actual[i];
+      if (fabs(e.time - a.time) > tolerance
+	  || fabs(e.velocity - a.velocity) > tolerance
+	  || fabs(e.angle - a.angle) > tolerance)
+	{
+	  if (diffs == 0)
+	    fprintf(stderr, "%s: command %u differs: expected "
+		    "%.3f %.6f %.6f, got %.3f %.6f %.6f\n",
+		    what, i, e.time, e.velocity, e.angle,
+		    a.time, a.velocity, a.angle);
+	  ++diffs;
+	}
+    }
+  if (expected.size() != actual.size())
+    {
+      fprintf(stderr, "%s: expected %u commands, got %u\n", what,
+	      (unsigned) expected.size(), (unsigned) actual.size());
+      diffs += abs((int) expected.size() - (int) actual.size());
+    }
+  return diffs;
+}
+
+bool replay::read_commands(const char *name, std::vector<Command> &commands)
+{
+  FILE *f = fopen(name, "r");
+  if (f == NULL)
+    {
+      perror(name);
+      return false;
+    }
+  Command c;
+  while (fscanf(f, "%lf %lf %lf", &c.time, &c.velocity, &c.angle) == 3)
+    commands.push_back(c);
+  bool ok = feof(f);
+  if (!ok)
+    fprintf(stderr, "%s: bad line after command %u\n",
+	    name, (unsigned) commands.size());
+  fclose(f);
+  return ok;
+}
+
+bool replay::write_commands(const char *name,
+			    const std::vector<Command> &commands)
+{
+  FILE *f = fopen(name, "w");
+  if (f == NULL)
+    {
+      perror(name);
+      return false;
+    }
+  for (unsigned i = 0; i < commands.size(); ++i)
+    fprintf(f, "%.6f %.6f %.6f\n", commands[i].time,
+	    commands[i].velocity, commands[i].angle);
+  return (fclose(f) == 0);
+}
+
+double replay::percentile(const std::vector<double> &sorted, double pct)
+{
+  if (sorted.empty())
+    return 0.0;
+  int rank = (int) (pct / 100.0 * sorted.size() + 0.999999);
+  if (rank < 1)
+    rank = 1;
+  return sorted[std::min(rank, (int) sorted.size()) - 1];
+}
+
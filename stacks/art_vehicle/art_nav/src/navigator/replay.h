@@ -0,0 +1,101 @@
+/* -*- mode: C++ -*-
+ *
+ *  Navigator offline replay interface
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <vector>
+
+#include <ros/ros.h>
+#include <art_msgs/ArtLanes.h>
+#include <art_msgs/NavigatorCommand.h>
+#include <art_msgs/ObservationArray.h>
+#include <nav_msgs/Odometry.h>
+
+/** @brief Replay navigator inputs offline.
+ *
+ *  Shared by the navigator_replay program and the test_replay
+ *  regression test.
+ */
+namespace replay
+{
+  /** one recorded input message */
+  struct Input
+  {
+    ros::Time time;			// when recorded
+    nav_msgs::Odometry::ConstPtr odom;
+    art_msgs::ArtLanes::ConstPtr map;
+    art_msgs::ObservationArray::ConstPtr obs;
+    art_msgs::NavigatorCommand::ConstPtr cmd;
+  };
+
+  /** one pilot command produced */
+  struct Command
+  {
+    double time;			// seconds since first input
+    double velocity;
+    double angle;
+  };
+
+  /** read all navigator inputs from a bag
+   *
+   *  @return true if successful
+   */
+  bool read_bag(const char *bag_name, std::vector<Input> &inputs);
+
+  /** make synthetic inputs for driving down a road
+   *
+   *  @param rndf_name road network to drive in
+   *  @param start index of the first of five way-points in a lane
+   *  @param inputs returns the messages, in time order
+   *  @return true if successful
+   */
+  bool synthetic_inputs(const char *rndf_name, int start,
+			std::vector<Input> &inputs);
+
+  /** run the navigator once through all the inputs
+   *
+   *  @param inputs recorded messages, in time order
+   *  @param event_driven cycle on each odometry message, not at 20 Hz
+   *  @param threads rollout worker threads, or -1 for the default
+   *  @param commands returns pilot commands produced
+   *  @param latency returns navigate() times (ms)
+   */
+  void run(const std::vector<Input> &inputs, bool event_driven,
+	   int threads, std::vector<Command> &commands,
+	   std::vector<double> &latency);
+
+  /** compare commands
+   *
+   *  @return number of commands that differ by more than @a tolerance
+   */
+  int compare(const std::vector<Command> &expected,
+	      const std::vector<Command> &actual, const char *what,
+	      double tolerance);
+
+  /** read a golden commands file
+   *
+   *  @return true if successful
+   */
+  bool read_commands(const char *name, std::vector<Command> &commands);
+
+  /** write commands to a file
+   *
+   *  @return true if successful
+   */
+  bool write_commands(const char *name,
+		      const std::vector<Command> &commands);
+
+  /** @return nearest-rank percentile of sorted samples */
+  double percentile(const std::vector<double> &sorted, double pct);
+};
+
+#endif // __REPLAY_H__
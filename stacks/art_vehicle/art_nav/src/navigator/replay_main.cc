@@ -0,0 +1,240 @@
+/*
+ *  replay recorded navigator inputs offline
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "cycle_profiler.h"
+#include "replay.h"
+
+/** @file
+
+ @brief replay recorded navigator inputs offline.
+
+ Reads the odom, roadmap_local, observations and navigator/cmd
+ messages from a bag, and feeds them straight into the Navigator
+ class, with simulated time and no ROS master.  Before each cycle, it
+ delivers every message recorded up to that time, like ros::spinOnce()
+ in the navigator node.  Cycles come every 1/20 second of simulated
+ time, or with --event, on each odometry message, with a watchdog
+ cycle after 0.1 seconds without any.  They run as fast as possible,
+ but the navigator measures its cycle intervals in simulated time.
+
+ The pilot commands produced are written to a file, one line per
+ command with the simulated time, velocity and steering angle, or
+ compared to such a golden file.  With --repeat, the replay runs
+ several times and every run must produce the same commands.
+
+ Then it reports navigate() latency percentiles and the time each
+ controller took, from the cycle profiler.
+
+ With --synthetic, it makes up the inputs instead of reading a bag,
+ driving down the road from way-point --start of an RNDF.  The
+ test_replay unit test compares those commands with a golden file.
+
+*/
+
+static char *pname;
+static const char *bag_name = NULL;
+static const char *rndf_name = NULL;
+static const char *golden_name = NULL;
+static const char *output_name = NULL;
+static bool event_driven = false;
+static int repeat = 1;
+static int start = 10;
+static int threads = -1;
+static double tolerance = 1e-4;
+
+using replay::Command;
+using replay::Input;
+
+/** parse command line arguments */
+static void parse_args(int argc, char *argv[])
+{
+  bool print_usage = false;
+  const char *options = "c:eho:r:s:S:t:T:";
+  int opt = 0;
+  int option_index = 0;
+  struct option long_options[] =
+    {
+      { "compare", 1, 0, 'c' },
+      { "event", 0, 0, 'e' },
+      { "help", 0, 0, 'h' },
+      { "output", 1, 0, 'o' },
+      { "repeat", 1, 0, 'r' },
+      { "synthetic", 1, 0, 's' },
+      { "start", 1, 0, 'S' },
+      { "threads", 1, 0, 't' },
+      { "tolerance", 1, 0, 'T' },
+      { 0, 0, 0, 0 }
+    };
+
+  /* basename $0 */
+  pname = strrchr(argv[0], '/');
+  if (pname == 0)
+    pname = argv[0];
+  else
+    pname++;
+
+  opterr = 0;
+  while ((opt = getopt_long(argc, argv, options,
+			    long_options, &option_index)) != EOF)
+    {
+      switch (opt)
+	{
+	case 'c':
+	  golden_name = optarg;
+	  break;
+
+	case 'e':
+	  event_driven = true;
+	  break;
+
+	case 'o':
+	  output_name = optarg;
+	  break;
+
+	case 'r':
+	  repeat = atoi(optarg);
+	  break;
+
+	case 's':
+	  rndf_name = optarg;
+	  break;
+
+	case 'S':
+	  start = atoi(optarg);
+	  break;
+
+	case 't':
+	  threads = atoi(optarg);
+	  break;
+
+	case 'T':
+	  tolerance = atof(optarg);
+	  break;
+
+	default:
+	  fprintf(stderr, "unknown option character %c\n",
+		  optopt);
+	  /*fallthru*/
+	case 'h':
+	  print_usage = true;
+	}
+    }
+
+  if (optind + 1 == argc && rndf_name == NULL)
+    bag_name = argv[optind];
+  else if (optind != argc || rndf_name == NULL)
+    print_usage = true;
+
+  if (print_usage || repeat < 1)
+    {
+      fprintf(stderr,
+	      "usage: %s [options] bag\n"
+	      "       %s [options] --synthetic RNDF\n\n"
+	      "    Replay recorded navigator inputs without ROS.\n"
+	      "    Possible options:\n"
+	      "\t-c, --compare\tgolden commands file to compare with\n"
+	      "\t-e, --event\tcycle on each odometry message\n"
+	      "\t-h, --help\tprint this message\n"
+	      "\t-o, --output\twrite commands to this file\n"
+	      "\t-r, --repeat\truns through the inputs (default 1)\n"
+	      "\t-s, --synthetic\tmake up inputs for driving in RNDF\n"
+	      "\t-S, --start\tfirst synthetic way-point index "
+	      "(default 10)\n"
+	      "\t-t, --threads\trollout worker threads "
+	      "(default: configured)\n"
+	      "\t-T, --tolerance\tlargest difference allowed "
+	      "(default 1e-4)\n",
+	      pname, pname);
+      exit(9);
+    }
+}
+
+/** main program */
+int main(int argc, char *argv[])
+{
+  parse_args(argc, argv);
+
+  // simulated time, no ROS master
+  ros::Time::init();
+
+  std::vector<Input> inputs;
+  if (rndf_name)
+    {
+      if (!replay::synthetic_inputs(rndf_name, start, inputs))
+	return 2;
+    }
+  else if (!replay::read_bag(bag_name, inputs))
+    return 2;
+
+  std::vector<Command> first;
+  std::vector<double> latency;
+  int diffs = 0;
+  for (int run = 0; run < repeat; ++run)
+    {
+      std::vector<Command> commands;
+      replay::run(inputs, event_driven, threads, commands, latency);
+      if (run == 0)
+	first = commands;
+      else
+	{
+	  char what[32];
+	  snprintf(what, sizeof(what), "run %d", run + 1);
+	  diffs += replay::compare(first, commands, what, tolerance);
+	}
+    }
+
+  if (output_name && !replay::write_commands(output_name, first))
+    return 2;
+
+  if (golden_name)
+    {
+      std::vector<Command> golden;
+      if (!replay::read_commands(golden_name, golden))
+	return 2;
+      diffs += replay::compare(golden, first, golden_name, tolerance);
+    }
+
+  std::sort(latency.begin(), latency.end());
+  double total = 0.0;
+  for (unsigned i = 0; i < latency.size(); ++i)
+    total += latency[i];
+  printf("%u inputs, %u cycles, %u commands per run\n",
+	 (unsigned) inputs.size(), (unsigned) latency.size() / repeat,
+	 (unsigned) first.size());
+  printf("navigate() ms: mean %.3f, p50 %.3f, p90 %.3f, p99 %.3f, "
+	 "max %.3f\n",
+	 (latency.empty()? 0.0: total / latency.size()),
+	 replay::percentile(latency, 50), replay::percentile(latency, 90),
+	 replay::percentile(latency, 99), replay::percentile(latency, 100));
+
+  // inclusive time per controller
+  std::vector<CycleProfiler::Stats> stats;
+  CycleProfiler::instance().snapshot(stats, false);
+  printf("%-24s %8s %9s %9s\n", "timer", "count", "mean_ms", "worst_ms");
+  for (unsigned i = 0; i < stats.size(); ++i)
+    printf("%-24s %8lu %9.4f %9.3f\n", stats[i].name, stats[i].count,
+	   (stats[i].count? stats[i].total_ns / 1e6 / stats[i].count: 0.0),
+	   stats[i].worst_ns / 1e6);
+
+  if (diffs > 0)
+    {
+      fprintf(stderr, "%d commands differ\n", diffs);
+      return 1;
+    }
+  return 0;
+}
@@ -157,10 +157,10 @@ Road::Road(Navigator *navptr, int _verbose):
   //zone = new RealZone(navptr, _verbose);
 
   // allocate timers
-  passing_timer = new NavTimer();
-  precedence_timer = new NavTimer();
-  roadblock_timer = new NavTimer();
-  stop_line_timer = new NavTimer();
+  passing_timer = new NavTimer(nav);
+  precedence_timer = new NavTimer(nav);
+  roadblock_timer = new NavTimer(nav);
+  stop_line_timer = new NavTimer(nav);
 
   // reset this controller only
   reset_me();
@@ -202,6 +202,8 @@ void Road::cancel_all_timers(void)
 
 Controller::result_t Road::control(pilot_command_t &pcmd)
 {
+  CYCLE_TIMER("Road");
+
   // get next event
   event = pending_event;
   pending_event = NavRoadEvent::None;
@@ -589,6 +591,7 @@ Controller::result_t Road::ActionPassToBlock(pilot_command_t &pcmd)
   ART_MSG(1, "passing blocked, replan route from here");
   course->reset();
   course->plan = course->passed_lane;	// restore original plan
+  course->plan_updated();
   return ActionToBlock(pcmd);
 }
 
@@ -597,6 +600,7 @@ Controller::result_t Road::ActionPassToEvade(pilot_command_t &pcmd)
   ART_MSG(1, "danger while passing, try to evade");
   course->reset();
   course->plan = course->passed_lane;	// restore original plan
+  course->plan_updated();
   return ActionToEvade(pcmd);
 }
 
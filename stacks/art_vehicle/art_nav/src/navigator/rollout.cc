@@ -0,0 +1,486 @@
+/*
+ *  Navigator candidate trajectory rollout
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <boost/bind.hpp>
+
+#include <art/DARPA_rules.h>
+#include <art_msgs/ArtVehicle.h>
+#include <art_map/coordinates.h>
+
+#include "navigator_internal.h"
+#include "course.h"
+#include "cycle_profiler.h"
+#include "obstacle.h"
+#include "rollout.h"
+
+using art_msgs::ArtVehicle;
+
+namespace
+{
+  // candidate offset ratios within the travel lane, lane center
+  // first so it wins ties
+  const float offset_ratios[] = {0.0, 0.5, -0.5, 1.0, -1.0};
+  const unsigned n_offsets = sizeof(offset_ratios) / sizeof(float);
+
+  // offset ratio putting the car mostly in an adjacent lane, left
+  // if positive
+  const float adjacent_ratio = 2.5;
+
+  // candidate speeds, as fractions of the commanded velocity
+  const float speed_ratios[] = {1.0, 0.75, 0.5, 0.25};
+  const unsigned n_speeds = sizeof(speed_ratios) / sizeof(float);
+
+  // cost weights
+  const float offset_cost = 1.0;	// per unit of offset ratio
+  const float speed_cost = 2.0;		// for stopping altogether
+  const float lane_cost = 1.0;		// per meter-second out of lane
+  const float gap_cost = 10.0;		// per second / meter of gap
+
+  // shortest simulation time step (s), bounding the work when
+  // cycles come close together
+  const float min_time_step = 0.01;
+
+  /** @return true if a lane marking may be crossed, as for
+   *          Graph::passing_allowed()
+   */
+  bool may_cross(Lane_marking marking)
+  {
+    return !(marking == DOUBLE_YELLOW
+	     || marking == SOLID_YELLOW
+	     || marking == SOLID_WHITE);
+  }
+
+  /** @return direction of travel through polygon @a i of a lane,
+   *          from the midpoints of its neighbors
+   */
+  float travel_heading(const poly_list_t &lane, unsigned i)
+  {
+    unsigned from = (i > 0? i - 1: i);
+    unsigned to = (i + 1 < lane.size()? i + 1: i);
+    if (from == to)
+      return lane[i].heading;
+    return atan2f(lane[to].midpoint.y - lane[from].midpoint.y,
+		  lane[to].midpoint.x - lane[from].midpoint.x);
+  }
+}
+
+Rollout::Rollout(Navigator *_nav, int _verbose):
+  generation_(0),
+  next_(0),
+  ndone_(0),
+  stop_(false)
+{
+  verbose = _verbose;
+  nav = _nav;
+
+  // copy convenience pointers to Navigator class data
+  pops = nav->pops;
+  course = nav->course;
+  obstacle = nav->obstacle;
+  estimate = &nav->estimate;
+  config_ = &nav->config_;
+
+  best_.offset_ratio = 0.0;
+  best_.speed = 0.0;
+  best_.feasible = true;
+  best_.cost = 0.0;
+}
+
+Rollout::~Rollout()
+{
+  stop_workers();
+}
+
+void Rollout::configure()
+{
+  unsigned n = (config_->rollout_threads > 0? config_->rollout_threads: 0);
+  if (n != workers_.size())
+    {
+      stop_workers();
+      start_workers(n);
+      ROS_INFO("trajectory rollout using %u worker threads", n);
+    }
+}
+
+bool Rollout::control(pilot_command_t &pcmd, bool passing)
+{
+  CYCLE_TIMER("Rollout");
+
+  best_.offset_ratio = 0.0;
+  best_.speed = pcmd.velocity;
+  if (pcmd.velocity <= 0.0 || Epsilon::equal(pcmd.velocity, 0.0)
+      || course->plan.empty())
+    {
+      // nothing to choose between
+      course->desired_heading(pcmd);
+      return true;
+    }
+
+  {
+    // take this cycle's snapshot
+    boost::mutex::scoped_lock l(lock_);
+    MapPose pose(estimate->pose.pose);
+    x0_ = pose.map.x;
+    y0_ = pose.map.y;
+    yaw0_ = pose.yaw;
+    speed0_ = estimate->twist.twist.linear.x;
+    velocity_ = pcmd.velocity;
+    forward_ = obstacle->observation(Observation::Nearest_forward);
+    horizon_ = config_->rollout_horizon;
+    time_step_ = fmaxf(nav->cycle_interval, min_time_step);
+    max_yaw_ = config_->real_max_yaw_rate;
+    steer_dist_ = config_->min_lane_steer_dist;
+    make_path();
+    left_open_ = right_open_ = false;
+    if (passing)
+      adjacent_lane(pose);
+    make_candidates(pcmd.velocity);
+  }
+
+  run();
+
+  // pick the cheapest feasible candidate, earliest on ties
+  int best = -1;
+  for (unsigned i = 0; i < candidates_.size(); ++i)
+    if (candidates_[i].feasible
+	&& (best < 0 || candidates_[i].cost < candidates_[best].cost))
+      best = i;
+
+  if (best < 0)
+    {
+      ROS_WARN_THROTTLE(10, "no feasible trajectory, stopping");
+      best_.speed = pcmd.velocity = 0.0;
+      return false;
+    }
+
+  best_ = candidates_[best];
+  ROS_DEBUG("trajectory %d of %u: offset %.2f, speed %.3f, cost %.3f "
+	    "(%u feasible, %.3f ms)",
+	    best, stats_.candidates, best_.offset_ratio, best_.speed,
+	    best_.cost, stats_.feasible, stats_.last * 1000.0);
+
+  pcmd.velocity = best_.speed;
+  course->desired_heading(pcmd, best_.offset_ratio);
+  return true;
+}
+
+/** Drive one candidate through the path, scoring it.
+ *
+ *  Reads only the snapshot, so the workers run it concurrently.
+ */
+void Rollout::evaluate(Candidate &c) const
+{
+  c.feasible = true;
+  c.cost = offset_cost * fabsf(c.offset_ratio);
+  c.cost += speed_cost * (1.0 - c.speed / velocity_);
+
+  // obstacle ahead in the travel lane, if any
+  bool obstacle_ahead = (forward_.applicable && !forward_.clear
+			 && forward_.distance < obstacle->maximum_range());
+  float approach = 0.0;			// obstacle speed towards us
+  if (obstacle_ahead && !isnan(forward_.velocity))
+    approach = -(forward_.velocity + speed0_); // velocity is d(distance)/dt
+
+  float x = x0_, y = y0_, yaw = yaw0_;
+  unsigned k = 0;			// nearest path point
+  float first_out = NAN;		// lane excursion at start
+  float out = 0.0;			// latest lane excursion
+  bool closed_out = false;		// out across a closed boundary
+  float lookahead = fmaxf(steer_dist_, c.speed * 1.0);
+
+  for (float t = time_step_; t <= horizon_; t += time_step_)
+    {
+      // advance to the nearest path point
+      while (k+1 < path_.size()
+	     && (Euclidean::DistanceTo(x, y, path_[k+1].x, path_[k+1].y)
+		 < Euclidean::DistanceTo(x, y, path_[k].x, path_[k].y)))
+	++k;
+      const PathPoint &near = path_[k];
+
+      // where the car is relative to the lane
+      float dx = x - near.x;
+      float dy = y - near.y;
+      float lateral = (-sinf(near.heading) * dx + cosf(near.heading) * dy);
+      out = fabsf(lateral) + ArtVehicle::halfwidth - near.half_width;
+      if (isnan(first_out))
+	first_out = out;
+      if (out > 0.0)
+	{
+	  bool open = (lateral > 0.0?
+		       left_open_ && near.left_open:
+		       right_open_ && near.right_open);
+	  if (!open && c.speed > 0.0)
+	    {
+	      // only allowed when getting back into the lane
+	      if (!(first_out > 0.0))
+		{
+		  c.feasible = false;
+		  return;
+		}
+	      closed_out = true;
+	    }
+	  c.cost += lane_cost * out * time_step_;
+	}
+
+      // obstacle ahead still in the way unless entirely out of lane
+      if (obstacle_ahead
+	  && fabsf(lateral) - ArtVehicle::halfwidth < near.half_width)
+	{
+	  float gap = forward_.distance - (approach + c.speed) * t;
+	  if (gap < DARPA_rules::min_forw_sep_travel)
+	    {
+	      c.feasible = false;
+	      return;
+	    }
+	  c.cost += gap_cost * time_step_ / gap;
+	}
+
+      // aim at the offset point one lookahead down the path
+      unsigned j = k;
+      while (j+1 < path_.size()
+	     && path_[j].distance - near.distance < lookahead)
+	++j;
+      const PathPoint &aim = path_[j];
+      float offset = c.offset_ratio
+	* fmaxf(aim.half_width - ArtVehicle::halfwidth, 0.0);
+      float ax = aim.x - sinf(aim.heading) * offset;
+      float ay = aim.y + cosf(aim.heading) * offset;
+      float alpha = Coordinates::normalize(atan2f(ay - y, ax - x) - yaw);
+      float range = fmaxf(Euclidean::DistanceTo(x, y, ax, ay), 0.1);
+
+      // pure pursuit, limited by the maximum yaw rate
+      float yaw_rate = 2.0 * c.speed * sinf(alpha) / range;
+      yaw_rate = fmaxf(-max_yaw_, fminf(max_yaw_, yaw_rate));
+
+      yaw = Coordinates::normalize(yaw + yaw_rate * time_step_);
+      x += c.speed * cosf(yaw) * time_step_;
+      y += c.speed * sinf(yaw) * time_step_;
+    }
+
+  // A car already out of its lane may stay out for a while, but must
+  // end up further in than it started.  Stopping is always allowed.
+  if (closed_out && !(out < first_out))
+    c.feasible = false;
+}
+
+/** Open the adjacent lane on the side of the lane being passed.
+ *
+ *  It is the only adjacent lane the navigator knows, and candidates
+ *  may only use it when it goes the same way as the plan and its
+ *  observer reports it clear.  Each path point also says whether
+ *  its lane boundary on that side may be crossed.
+ */
+void Rollout::adjacent_lane(const MapPose &pose)
+{
+  const poly_list_t &passed = course->passed_lane;
+  int i = pops->getClosestPoly(passed, pose);
+  if (i < 0 || path_.empty())
+    return;
+
+  float heading = Coordinates::normalize(travel_heading(passed, i)
+					 - path_[0].heading);
+  if (fabsf(heading) >= HALFPI)
+    return;				// passed lane goes the other way
+
+  bool left = !course->passing_left;
+  Observation adj = obstacle->observation(left?
+					  Observation::Adjacent_left:
+					  Observation::Adjacent_right);
+  if (!adj.applicable || !adj.clear)
+    return;
+
+  if (left)
+    left_open_ = true;
+  else
+    right_open_ = true;
+}
+
+/** Make candidates for all offsets and speeds, plus stopping.
+ *
+ *  Offsets into an adjacent lane are only made for an open one.
+ */
+void Rollout::make_candidates(float velocity)
+{
+  std::vector<float> offsets(offset_ratios, offset_ratios + n_offsets);
+  if (left_open_)
+    offsets.push_back(adjacent_ratio);
+  if (right_open_)
+    offsets.push_back(-adjacent_ratio);
+
+  candidates_.clear();
+  for (unsigned s = 0; s < n_speeds; ++s)
+    for (unsigned o = 0; o < offsets.size(); ++o)
+      {
+	Candidate c;
+	c.offset_ratio = offsets[o];
+	c.speed = velocity * speed_ratios[s];
+	c.feasible = false;
+	c.cost = 0.0;
+	candidates_.push_back(c);
+      }
+
+  Candidate stop;
+  stop.offset_ratio = 0.0;
+  stop.speed = 0.0;
+  stop.feasible = false;
+  stop.cost = 0.0;
+  candidates_.push_back(stop);
+}
+
+/** Copy the part of the plan the candidates can reach. */
+void Rollout::make_path(void)
+{
+  path_.clear();
+  const poly_list_t &plan = course->plan;
+  int start = pops->getClosestPoly(plan, MapPose(estimate->pose.pose));
+  if (start < 0)
+    return;
+
+  float reach = (horizon_ * config_->max_speed + steer_dist_
+		 + config_->max_speed);
+  int stop = pops->index_of_downstream_poly(plan, start, reach);
+  for (int i = start; i <= stop; ++i)
+    {
+      const poly &p = plan[i];
+      PathPoint pt;
+      pt.x = p.midpoint.x;
+      pt.y = p.midpoint.y;
+
+      // polygons of a lane driven backwards keep their own heading
+      // and boundaries, so swap them to the direction of travel
+      bool reversed =
+	(fabsf(Coordinates::normalize(travel_heading(plan, i) - p.heading))
+	 > HALFPI);
+      if (reversed)
+	{
+	  pt.heading = Coordinates::normalize(p.heading + M_PI);
+	  pt.left_open = may_cross(p.right_boundary);
+	  pt.right_open = may_cross(p.left_boundary);
+	}
+      else
+	{
+	  pt.heading = p.heading;
+	  pt.left_open = may_cross(p.left_boundary);
+	  pt.right_open = may_cross(p.right_boundary);
+	}
+      pt.half_width = Euclidean::DistanceTo(p.midpoint,
+					    pops->midpoint(p.p1, p.p2));
+      pt.distance = (path_.empty()? 0.0:
+		     path_.back().distance
+		     + Euclidean::DistanceTo(p.midpoint.x, p.midpoint.y,
+					     path_.back().x, path_.back().y));
+      path_.push_back(pt);
+    }
+}
+
+/** Evaluate all candidates, the calling thread helping the workers. */
+void Rollout::run(void)
+{
+  ros::WallTime t0 = ros::WallTime::now();
+  unsigned n = candidates_.size();
+
+  if (path_.empty())
+    {
+      // no plan polygon nearby: keep the command as it was
+      for (unsigned i = 0; i < n; ++i)
+	{
+	  candidates_[i].feasible = (i == 0);
+	  candidates_[i].cost = 0.0;
+	}
+    }
+  else
+    {
+      boost::mutex::scoped_lock l(lock_);
+      next_ = 0;
+      ndone_ = 0;
+      ++generation_;
+      work_.notify_all();
+      while (next_ < n)
+	{
+	  unsigned i = next_++;
+	  l.unlock();
+	  evaluate(candidates_[i]);
+	  l.lock();
+	  ++ndone_;
+	}
+      while (ndone_ < n)
+	done_.wait(l);
+    }
+
+  stats_.last = (ros::WallTime::now() - t0).toSec();
+  stats_.candidates = n;
+  stats_.feasible = 0;
+  for (unsigned i = 0; i < n; ++i)
+    if (candidates_[i].feasible)
+      ++stats_.feasible;
+  ++stats_.cycles;
+  stats_.mean += (stats_.last - stats_.mean) / stats_.cycles;
+  if (stats_.last > stats_.max)
+    stats_.max = stats_.last;
+
+  // leave at least half the cycle for everything else
+  if (stats_.last > 0.5 * nav->cycle_interval)
+    {
+      ++stats_.over_budget;
+      ROS_WARN_THROTTLE(10, "trajectory rollout took %.3f ms "
+			"(%lu of %lu over budget, max %.3f ms)",
+			stats_.last * 1000.0, stats_.over_budget,
+			stats_.cycles, stats_.max * 1000.0);
+    }
+}
+
+void Rollout::start_workers(unsigned n)
+{
+  {
+    boost::mutex::scoped_lock l(lock_);
+    stop_ = false;
+  }
+  for (unsigned i = 0; i < n; ++i)
+    workers_.push_back(boost::shared_ptr<boost::thread>
+		       (new boost::thread(boost::bind(&Rollout::worker,
+						      this))));
+}
+
+void Rollout::stop_workers(void)
+{
+  {
+    boost::mutex::scoped_lock l(lock_);
+    stop_ = true;
+  }
+  work_.notify_all();
+  for (unsigned i = 0; i < workers_.size(); ++i)
+    workers_[i]->join();
+  workers_.clear();
+}
+
+/** Worker thread: evaluate candidates of each new generation. */
+void Rollout::worker(void)
+{
+  boost::mutex::scoped_lock l(lock_);
+  unsigned long seen = generation_;
+  for (;;)
+    {
+      while (!stop_ && generation_ == seen)
+	work_.wait(l);
+      if (stop_)
+	return;
+      seen = generation_;
+
+      unsigned n = candidates_.size();
+      while (next_ < n)
+	{
+	  unsigned i = next_++;
+	  l.unlock();
+	  evaluate(candidates_[i]);
+	  l.lock();
+	  if (++ndone_ == n)
+	    done_.notify_all();
+	}
+    }
+}
@@ -0,0 +1,158 @@
+/* -*- mode: C++ -*-
+ *
+ *  Navigator candidate trajectory rollout
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#ifndef __ROLLOUT_H__
+#define __ROLLOUT_H__
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/** @brief timing statistics for trajectory rollouts */
+struct RolloutStats
+{
+  unsigned long cycles;			//< rollouts done
+  unsigned long over_budget;		//< rollouts over budget
+  unsigned candidates;			//< candidates last cycle
+  unsigned feasible;			//< feasible ones last cycle
+  double last;				//< last rollout time (s)
+  double mean;				//< mean rollout time (s)
+  double max;				//< longest rollout time (s)
+  RolloutStats():
+    cycles(0), over_budget(0), candidates(0), feasible(0),
+    last(0.0), mean(0.0), max(0.0) {}
+};
+
+/** @brief Navigator candidate trajectory rollout class.
+ *
+ *  Instead of committing to the one heading Course::desired_heading()
+ *  computes, the lane controllers let this class pick among several
+ *  candidates: lateral offsets within the travel lane, at reduced
+ *  speeds.  When passing, offsets out into the passed lane are added
+ *  if it goes the same way, is clear and may be crossed into.  Each candidate is driven
+ *  forward through the plan for a short horizon with a simple
+ *  kinematic model, and scored against the lane boundaries and the
+ *  latest observer reports.  The candidates are independent, so a
+ *  pool of worker threads scores them in parallel with the calling
+ *  thread.  The best one is then steered with desired_heading().
+ *
+ *  On a clear road, the lane-center candidate at full speed wins,
+ *  giving the same command as before.
+ */
+class Rollout
+{
+ public:
+
+  /** @brief Constructor */
+  Rollout(Navigator *_nav, int _verbose);
+
+  /** @brief Destructor */
+  ~Rollout();
+
+  /** @brief set configuration variables, resizing the worker pool */
+  void configure();
+
+  /** @brief choose the best candidate and steer for it
+   *
+   * @param pcmd[in,out] pilot command; velocity set by the other
+   *        controllers is the fastest candidate allowed
+   * @param passing true if the car may use the passed lane
+   * @return false if no candidate was feasible (pcmd stops the car)
+   */
+  bool control(pilot_command_t &pcmd, bool passing=false);
+
+  /** @brief offset ratio of the last candidate chosen */
+  float offset_ratio(void) const
+  {
+    return best_.offset_ratio;
+  }
+
+  /** @brief timing statistics */
+  const RolloutStats &stats(void) const
+  {
+    return stats_;
+  }
+
+ private:
+
+  /** one candidate trajectory */
+  struct Candidate
+  {
+    float offset_ratio;			//< as for desired_heading()
+    float speed;			//< constant speed (m/s)
+    bool feasible;			//< no collision or blocked lane
+    float cost;				//< lower is better
+  };
+
+  /** plan polygon as seen by the workers */
+  struct PathPoint
+  {
+    float x, y;				//< polygon midpoint
+    float heading;			//< polygon heading
+    float half_width;			//< half lane width
+    float distance;			//< distance along path from first
+    bool left_open;			//< left boundary may be crossed
+    bool right_open;			//< right boundary may be crossed
+  };
+
+  void adjacent_lane(const MapPose &pose);
+  void evaluate(Candidate &c) const;
+  void make_candidates(float velocity);
+  void make_path(void);
+  void run(void);
+  void start_workers(unsigned n);
+  void stop_workers(void);
+  void worker(void);
+
+  // snapshot of navigator state for this cycle, read-only while
+  // the workers run
+  std::vector<PathPoint> path_;
+  std::vector<Candidate> candidates_;
+  float x0_, y0_, yaw0_;		//< vehicle pose
+  float speed0_;			//< vehicle speed
+  float velocity_;			//< commanded velocity
+  Observation forward_;			//< Nearest_forward observer
+  bool left_open_;			//< adjacent left lane usable
+  bool right_open_;			//< adjacent right lane usable
+  float horizon_;			//< rollout time (s)
+  float time_step_;			//< simulation time step (s)
+  float max_yaw_;			//< maximum yaw rate (radians/s)
+  float steer_dist_;			//< minimum steering lookahead (m)
+
+  Candidate best_;
+  RolloutStats stats_;
+
+  // worker pool
+  boost::mutex lock_;			//< protects the fields below
+  boost::condition_variable work_;	//< new generation of candidates
+  boost::condition_variable done_;	//< all candidates evaluated
+  std::vector<boost::shared_ptr<boost::thread> > workers_;
+  unsigned long generation_;		//< bumped for each rollout
+  unsigned next_;			//< next candidate to claim
+  unsigned ndone_;			//< candidates evaluated
+  bool stop_;
+
+  // constructor parameters
+  int verbose;				// message verbosity level
+  Navigator *nav;			// internal navigator class
+
+  // convenience pointers to Navigator class data
+  PolyOps* pops;			// polygon operations class
+  Course* course;			// course planning class
+  Obstacle* obstacle;			// obstacle class
+  nav_msgs::Odometry *estimate;         // estimated control position
+  const Config *config_;                // current configuration
+};
+
+#endif // __ROLLOUT_H__
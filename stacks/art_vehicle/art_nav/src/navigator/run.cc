@@ -42,7 +42,7 @@ Run::Run(Navigator *navptr, int _verbose):
   safety =	new Safety(navptr, _verbose);
   unstuck =	new VoronoiZone(navptr, _verbose);
 
-  escape_timer = new NavTimer(cycle);
+  escape_timer = new NavTimer(nav);
 #endif
   go_state = Continue;
 };
@@ -86,6 +86,8 @@ void Run::begin_escape(void)
 */
 Controller::result_t Run::control(pilot_command_t &pcmd)
 {
+  CYCLE_TIMER("Run");
+
   // Do nothing if the order is still Run.  Wait until Commander sends
   // a new behavior.  Also, wait until the course controller receives
   // data from the maplanes driver.
@@ -104,8 +106,10 @@ Controller::result_t Run::control(pilot_command_t &pcmd)
   pcmd.velocity = fminf(order->max_speed, config_->max_speed);
   
   // estimate current dead reckoning position based on time of current
-  // cycle and latest odometry course and speed
-  Estimate::control_pose(*odom, ros::Time::now(), *estimate);
+  // cycle and the odometry history: interpolated if a later message
+  // has already arrived, otherwise extrapolated from the newest one
+  Estimate::control_pose(nav->odom_history, *odom, ros::Time::now(),
+                         *estimate);
 
   course->begin_run_cycle();
 
@@ -20,7 +20,8 @@
 
 Controller::result_t SlowForCurves::control(pilot_command_t &pcmd)
 {
-  
+  CYCLE_TIMER("SlowForCurves");
+
   if (pcmd.velocity < config_->min_speed_for_curves)
     {
       ROS_DEBUG("Already going slow: %.3f", pcmd.velocity);
@@ -28,13 +29,18 @@ Controller::result_t SlowForCurves::control(pilot_command_t &pcmd)
     }
   
 
+  if (!course->plan_speeds.indexes(course->plan))
+    {
+      ROS_DEBUG("speed profile stale, rebuilding it");
+      course->plan_updated();
+    }
+
   // These indices are checked in max_safe_speed
   int start_index = pops->getClosestPoly(course->plan,
                                          MapPose(estimate->pose.pose));
 
   // TODO: lookahead_distance should probably be time in seconds.
-  int stop_index = pops->index_of_downstream_poly(course->plan,
-						  start_index,
+  int stop_index = course->plan_speeds.downstream(start_index,
 						  config_->lookahead_distance);
 	
   float max_speed = max_safe_speed(course->plan,
@@ -93,60 +99,69 @@ float SlowForCurves::max_safe_speed(const std::vector<poly>& polygons,
 	    polygons.at(stop_index).poly_id,
 	    polygons.at(stop_index).start_way.name().str);
 
-  float distance = 0;
-  float max_speed = 100;
+  // The speed profile has the limits for all curves ending by
+  // stop_index.  Only the last few get cut short there.
+  const SpeedProfile &profile = course->plan_speeds;
+  int split = profile.curves_before(start_index, stop_index);
+  int limiting = -1;
+  float max_speed = profile.max_speed(start_index, split, order->max_speed,
+				      &limiting);
+
+  for (int begin = split; begin < stop_index; begin++)
+    {
+      float max_then = course->curve_speed(polygons, begin, stop_index);
+      float max_now =
+	course->max_speed_for_slow_down(max_then,
+					profile.distance(start_index, begin+1),
+					max_speed, config_->max_deceleration);
+      if (max_now < max_speed)
+	limiting = begin;
+      max_speed = fminf(max_speed, max_now);
+    }
 
-  char limiting_string[512] = "";
-  int limiting_id = 0;
+  // Slow down for stop way-points, too.  The caller never goes below
+  // min_speed_for_curves, so StopLine still brings the car to a halt.
+  int stop_at = -1;
+  max_speed = profile.stop_speed(start_index, stop_index+1, max_speed,
+				 &stop_at);
+  if (stop_at >= 0)
+    limiting = stop_at;
 
-  for(int begin = start_index; begin < stop_index; begin++) {
-    distance += (polygons.at(begin).length +
-		 polygons.at(begin+1).length)/2.0;
+  if (Epsilon::equal(max_speed,0.0))
+    return 0.0;
 
-    float length = 0;
-    int end = begin;
-    while(end < stop_index && length < config_->min_curve_length) {
-      length += (polygons.at(end).length +
-		 polygons.at(end+1).length)/2.0;
-      end++;
-    }
-		
-    float dheading =
-      Coordinates::normalize(polygons[end].heading - polygons[begin].heading);
-		
-    float max_then =
-      fmaxf(config_->min_speed_for_curves,
-	    course->max_speed_for_change_in_heading(dheading, length, 
-						    max_speed, config_->max_yaw_rate));
-		
-    float max_now =
-      course->max_speed_for_slow_down(max_then, distance, 
-				      max_speed, config_->max_deceleration);
- 
-    if (max_now < max_speed) {
-      limiting_id = polygons.at(begin).poly_id;
-      sprintf(limiting_string, "Polygons: %d(%s)->%d(%s), (dheading: %.3f, length: %.3f, max_then: %.3f)   Max speed now is %.3f for curve in %.3f meters.",
-	      polygons.at(begin).poly_id,
-	      polygons.at(begin).start_way.name().str,
-	      polygons.at(end).poly_id,
-	      polygons.at(end).start_way.name().str,
-	      dheading,
-	      length,
-	      max_then,
-	      max_now,
-	      distance);
+  int limiting_id = (limiting < 0? 0: polygons.at(limiting).poly_id);
+  if (verbose >= 4 && current_limiting_id != limiting_id)
+    {
+      if (stop_at >= 0)
+	{
+	  ART_MSG(2, "new limiting_factor: stop at polygon %d(%s), "
+		  "Max speed now is %.3f for stop in %.3f meters.",
+		  polygons.at(stop_at).poly_id,
+		  polygons.at(stop_at).start_way.name().str,
+		  max_speed, profile.distance(start_index, stop_at));
+	}
+      else if (limiting >= 0)
+	{
+	  int end;
+	  float length;
+	  float max_then = course->curve_speed(polygons, limiting,
+					       stop_index, &end, &length);
+	  ART_MSG(2, "new limiting_factor: Polygons: %d(%s)->%d(%s), "
+		  "(dheading: %.3f, length: %.3f, max_then: %.3f)   "
+		  "Max speed now is %.3f for curve in %.3f meters.",
+		  polygons.at(limiting).poly_id,
+		  polygons.at(limiting).start_way.name().str,
+		  polygons.at(end).poly_id,
+		  polygons.at(end).start_way.name().str,
+		  Coordinates::normalize(polygons[end].heading
+					 - polygons[limiting].heading),
+		  length, max_then, max_speed,
+		  profile.distance(start_index, limiting+1));
+	}
+      current_limiting_id = limiting_id;
     }
 
-    max_speed = fminf(max_speed, max_now);
-    if (Epsilon::equal(max_speed,0.0))
-      return 0.0;
-  }
-	
-  if(verbose >= 4 && current_limiting_id != limiting_id) {
-    ART_MSG(2, "new limiting_factor: %s", limiting_string);
-    current_limiting_id = limiting_id;
-  }
-
   max_speed = fminf(max_speed, max);
 
   return max_speed;
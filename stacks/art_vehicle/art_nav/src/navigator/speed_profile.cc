@@ -0,0 +1,169 @@
+/*
+ *  Navigator speed profile along the travel plan
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <math.h>
+#include <algorithm>
+
+#include "speed_profile.h"
+
+/** The curve at polygon b, entered at speed v, limits the speed at
+ *  any earlier polygon s to
+ *
+ *	sqrt(v*v + 2*a*(mid[b+1] - mid[s]))
+ *
+ *  That only grows with the key v*v + 2*a*mid[b+1], so the least key
+ *  in a range of curves is the limiting one, wherever s is.
+ */
+void SpeedProfile::build(const poly_list_t &polys,
+			 const std::vector<float> &speed,
+			 const std::vector<int> &end,
+			 float deceleration,
+			 const std::vector<int> &stops,
+			 float stop_deceleration)
+{
+  unsigned n = polys.size();
+  polys_ = &polys;
+  first_id_ = (n > 0? polys.front().poly_id: -1);
+  last_id_ = (n > 0? polys.back().poly_id: -1);
+  deceleration_ = deceleration;
+  stop_deceleration_ = stop_deceleration;
+  stops_ = stops;
+
+  length_.resize(n);
+  mid_.resize(n);
+  key_.resize(n);
+  end_ = end;
+  end_.resize(n);
+  double length = 0.0;
+  for (unsigned i = 0; i < n; ++i)
+    {
+      length += polys[i].length;
+      length_[i] = length;
+      mid_[i] = (i > 0?
+		 mid_[i-1] + (polys[i-1].length + polys[i].length) / 2.0:
+		 0.0);
+    }
+  for (unsigned i = 0; i + 1 < n; ++i)
+    key_[i] = ((double) speed[i] * speed[i]
+	       + 2.0 * deceleration_ * mid_[i+1]);
+  if (n > 0)
+    key_[n-1] = 0.0;			// never a curve start
+
+  // table_[k][i] is the index of the least key in [i, i + 2^k)
+  table_.resize(1);
+  table_[0].resize(n);
+  for (unsigned i = 0; i < n; ++i)
+    table_[0][i] = i;
+  for (unsigned k = 1; (1u << k) <= n; ++k)
+    {
+      table_.resize(k + 1);
+      unsigned half = 1u << (k - 1);
+      table_[k].resize(n - (1u << k) + 1);
+      for (unsigned i = 0; i < table_[k].size(); ++i)
+	{
+	  int a = table_[k-1][i];
+	  int b = table_[k-1][i + half];
+	  table_[k][i] = (key_[b] < key_[a]? b: a);
+	}
+    }
+}
+
+void SpeedProfile::clear()
+{
+  length_.clear();
+  mid_.clear();
+  key_.clear();
+  end_.clear();
+  table_.clear();
+  stops_.clear();
+  polys_ = NULL;
+  first_id_ = last_id_ = -1;
+}
+
+int SpeedProfile::downstream(int start, float distance) const
+{
+  int n = length_.size();
+  if (start < 0 || start >= n)
+    return -1;
+  if (distance <= 0)
+    return start;
+
+  // first polygon ending at least distance past the start of start
+  double base = (start > 0? length_[start-1]: 0.0);
+  std::vector<double>::const_iterator it =
+    std::lower_bound(length_.begin() + start, length_.end(),
+		     base + distance);
+  if (it == length_.end())
+    return n - 1;
+  return it - length_.begin();
+}
+
+int SpeedProfile::curves_before(int start, int stop) const
+{
+  // curve ends never move backwards along the plan
+  return std::upper_bound(end_.begin() + start, end_.begin() + stop, stop)
+    - end_.begin();
+}
+
+/** @return index of the least key in [lo, hi), lo < hi */
+int SpeedProfile::min_index(int lo, int hi) const
+{
+  int k = 0;
+  while ((2 << k) <= hi - lo)
+    ++k;
+  int a = table_[k][lo];
+  int b = table_[k][hi - (1 << k)];
+  return (key_[b] < key_[a]? b: a);
+}
+
+float SpeedProfile::max_speed(int start, int stop, float max,
+			      int *limiting) const
+{
+  if (limiting)
+    *limiting = -1;
+  if (start < 0 || stop >= (int) key_.size() || start >= stop)
+    return max;
+
+  int b = min_index(start, stop);
+  double v2 = key_[b] - 2.0 * deceleration_ * mid_[start];
+  float speed = (v2 > 0.0? sqrt(v2): 0.0);
+  if (speed >= max)
+    return max;
+  if (limiting)
+    *limiting = b;
+  return speed;
+}
+
+/** A stop at polygon b limits the speed at any earlier polygon s to
+ *
+ *	sqrt(2*a*(mid[b] - mid[s]))
+ *
+ *  which is least for the nearest one.
+ */
+float SpeedProfile::stop_speed(int start, int stop, float max,
+			       int *limiting) const
+{
+  if (limiting)
+    *limiting = -1;
+  if (start < 0 || stop > (int) mid_.size() || start >= stop)
+    return max;
+
+  std::vector<int>::const_iterator it =
+    std::lower_bound(stops_.begin(), stops_.end(), start);
+  if (it == stops_.end() || *it >= stop)
+    return max;
+
+  double v2 = 2.0 * stop_deceleration_ * (mid_[*it] - mid_[start]);
+  float speed = (v2 > 0.0? sqrt(v2): 0.0);
+  if (speed >= max)
+    return max;
+  if (limiting)
+    *limiting = *it;
+  return speed;
+}
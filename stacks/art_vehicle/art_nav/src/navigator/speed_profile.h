@@ -0,0 +1,119 @@
+/* -*- mode: C++ -*-
+ *
+ *  Navigator speed profile along the travel plan
+ *
+ *  Copyright (C) 2010, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#ifndef __SPEED_PROFILE_H__
+#define __SPEED_PROFILE_H__
+
+#include <vector>
+
+#include <art_map/PolyOps.h>
+
+/** @brief Curve and stop speed limits along a polygon plan.
+ *
+ *  Built by Course each time the plan changes, from the highest
+ *  speed allowed entering the curve starting at each polygon, and
+ *  the polygons where the car must stop.  Holds the distances along
+ *  the plan and a sparse table over the curve limits, so finding the
+ *  polygon some distance downstream takes O(log n), and the highest
+ *  speed that still allows slowing down for every curve in a range
+ *  of polygons takes O(1).  The nearest stop is always the limiting
+ *  one, so stops take O(log n).
+ *
+ *  Distances between curves are measured the way SlowForCurves
+ *  always has: from the middle of one polygon to the middle of the
+ *  next.
+ */
+class SpeedProfile
+{
+ public:
+  SpeedProfile(): polys_(NULL), first_id_(-1), last_id_(-1),
+		  deceleration_(0.0), stop_deceleration_(0.0) {};
+
+  /** build the profile for a plan
+   *
+   * @param polys the plan
+   * @param speed highest speed entering the curve starting at each
+   *        polygon, the last one unused
+   * @param end index of the polygon ending each of those curves
+   * @param deceleration maximum deceleration (m/s/s)
+   * @param stops indexes of polygons to stop in, ascending
+   * @param stop_deceleration deceleration for stops (m/s/s)
+   */
+  void build(const poly_list_t &polys,
+	     const std::vector<float> &speed,
+	     const std::vector<int> &end,
+	     float deceleration,
+	     const std::vector<int> &stops,
+	     float stop_deceleration);
+  void clear();
+
+  /** @return true if built for this list, as it is now */
+  bool indexes(const poly_list_t &polys) const
+  {
+    return (&polys == polys_
+	    && polys.size() == length_.size()
+	    && (polys.empty()
+		|| (polys.front().poly_id == first_id_
+		    && polys.back().poly_id == last_id_)));
+  };
+
+  /** @return index of the polygon @a distance meters downstream of
+   *          the start of polygon @a start, like
+   *          PolyOps::index_of_downstream_poly()
+   */
+  int downstream(int start, float distance) const;
+
+  /** @return middle-to-middle distance from polygon @a from to @a to */
+  float distance(int from, int to) const
+  {
+    return mid_[to] - mid_[from];
+  };
+
+  /** @return first polygon in [@a start, @a stop) whose curve ends
+   *          past @a stop, or @a stop if none do
+   */
+  int curves_before(int start, int stop) const;
+
+  /** @return highest speed at polygon @a start that still allows
+   *          slowing down for the curves starting at polygons
+   *          @a start through @a stop - 1, or @a max if lower
+   *
+   * @param limiting returns index of the limiting curve, or -1
+   */
+  float max_speed(int start, int stop, float max,
+		  int *limiting=NULL) const;
+
+  /** @return highest speed at polygon @a start that still allows
+   *          stopping in the first stop polygon from @a start
+   *          through @a stop - 1, or @a max if lower
+   *
+   * @param limiting returns index of the limiting stop, or -1
+   */
+  float stop_speed(int start, int stop, float max,
+		   int *limiting=NULL) const;
+
+ private:
+  int min_index(int lo, int hi) const;
+
+  std::vector<double> length_;		// lengths through each polygon
+  std::vector<double> mid_;		// distance to each middle
+  std::vector<double> key_;		// curve limits, see build()
+  std::vector<int> end_;		// end of each curve
+  std::vector<std::vector<int> > table_; // indexes of least keys
+  std::vector<int> stops_;		// polygons to stop in
+  const poly_list_t *polys_;		// list built for
+  int first_id_;
+  int last_id_;
+  double deceleration_;
+  double stop_deceleration_;
+};
+
+#endif // __SPEED_PROFILE_H__
@@ -33,6 +33,8 @@ StopArea::~StopArea() {};
 //
 Controller::result_t StopArea::control(pilot_command_t &pcmd)
 {
+  CYCLE_TIMER("StopArea");
+
   using art_msgs::ArtVehicle;
   float wayptdist = (course->stop_waypt_distance(true)
 		     - ArtVehicle::front_bumper_px);
@@ -63,6 +63,8 @@ StopLine::~StopLine() {};
 Controller::result_t StopLine::control(pilot_command_t &pcmd,
 				       float topspeed)
 {
+  CYCLE_TIMER("StopLine");
+
   result_t result = OK;
 
   // distance from front bumper to stop way-point
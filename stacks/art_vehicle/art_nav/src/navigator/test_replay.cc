@@ -0,0 +1,86 @@
+/*
+ *  Navigator offline replay regression test
+ *
+ *  Copyright (C) 2010 Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <ros/package.h>
+
+#include "navigator_internal.h"
+#include "replay.h"
+
+/** Drive down longhorn.rndf from way-point 10 with synthetic inputs,
+ *  like "navigator_replay --synthetic longhorn.rndf -c golden".
+ *
+ *  When a change is meant to alter the commands, regenerate the
+ *  golden file with "navigator_replay --synthetic ... -t 0 -o" and
+ *  commit it with the change.
+ */
+class ReplayTest: public testing::Test
+{
+protected:
+
+  virtual void SetUp()
+  {
+    std::string rndf = (ros::package::getPath("art_map")
+			+ "/rndf/longhorn.rndf");
+    golden_ = (ros::package::getPath("art_nav")
+	       + "/test/replay_longhorn.txt");
+    ASSERT_TRUE(replay::synthetic_inputs(rndf.c_str(), 10, inputs_));
+  }
+
+  std::vector<replay::Input> inputs_;
+  std::string golden_;
+};
+
+// the commands match the golden file
+TEST_F(ReplayTest, goldenCommands)
+{
+  std::vector<replay::Command> golden;
+  ASSERT_TRUE(replay::read_commands(golden_.c_str(), golden));
+  ASSERT_FALSE(golden.empty());
+
+  std::vector<replay::Command> commands;
+  std::vector<double> latency;
+  replay::run(inputs_, false, 0, commands, latency);
+  EXPECT_EQ(0, replay::compare(golden, commands, golden_.c_str(), 1e-4));
+}
+
+// rollout worker threads do not change the commands, and navigate()
+// stays within its cycle budget
+TEST_F(ReplayTest, threadsAndLatency)
+{
+  std::vector<replay::Command> first;
+  std::vector<double> latency;
+  replay::run(inputs_, false, 0, first, latency);
+  for (int run = 1; run < 3; ++run)
+    {
+      std::vector<replay::Command> commands;
+      replay::run(inputs_, false, 2, commands, latency);
+      EXPECT_EQ(0, replay::compare(first, commands, "threads", 1e-4));
+    }
+
+  std::sort(latency.begin(), latency.end());
+  double p50 = replay::percentile(latency, 50);
+  double p99 = replay::percentile(latency, 99);
+  RecordProperty("navigate_p50_us", (int) (p50 * 1000.0));
+  RecordProperty("navigate_p99_us", (int) (p99 * 1000.0));
+  EXPECT_LT(p99, Config::__getDefault__().cycle_budget * 1000.0)
+    << "navigate() p99 " << p99 << " ms";
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::Time::init();			// simulated time, no ROS master
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,245 @@
+/*
+ *  Navigator candidate trajectory rollout unit test
+ *
+ *  Copyright (C) 2010 Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include <art_map/RNDF.h>
+#include <art_map/Graph.h>
+#include <art_map/MapLanes.h>
+
+#include "navigator_internal.h"
+#include "course.h"
+#include "obstacle.h"
+#include "rollout.h"
+
+/** two lanes going east, a broken white line between them */
+const char *rndf_text =
+  "RNDF_name\ttest_rollout\n"
+  "num_segments\t1\n"
+  "num_zones\t0\n"
+  "segment\t1\n"
+  "num_lanes\t2\n"
+  "lane\t1.1\n"
+  "num_waypoints\t8\n"
+  "lane_width\t12\n"
+  "left_boundary\tbroken_white\n"
+  "right_boundary\tsolid_white\n"
+  "1.1.1\t30.3800000\t-97.7400000\n"
+  "1.1.2\t30.3800000\t-97.7399000\n"
+  "1.1.3\t30.3800000\t-97.7398000\n"
+  "1.1.4\t30.3800100\t-97.7397000\n"
+  "1.1.5\t30.3800300\t-97.7396000\n"
+  "1.1.6\t30.3800600\t-97.7395000\n"
+  "1.1.7\t30.3801000\t-97.7394000\n"
+  "1.1.8\t30.3801500\t-97.7393000\n"
+  "end_lane\n"
+  "lane\t1.2\n"
+  "num_waypoints\t8\n"
+  "lane_width\t12\n"
+  "left_boundary\tsolid_white\n"
+  "right_boundary\tbroken_white\n"
+  "1.2.1\t30.3800330\t-97.7400000\n"
+  "1.2.2\t30.3800330\t-97.7399000\n"
+  "1.2.3\t30.3800330\t-97.7398000\n"
+  "1.2.4\t30.3800430\t-97.7397000\n"
+  "1.2.5\t30.3800630\t-97.7396000\n"
+  "1.2.6\t30.3800930\t-97.7395000\n"
+  "1.2.7\t30.3801330\t-97.7394000\n"
+  "1.2.8\t30.3801830\t-97.7393000\n"
+  "end_lane\n"
+  "end_segment\n"
+  "end_file\n";
+
+/** navigators following lane 1.1: one steering with the rollout,
+ *  the other as before
+ */
+class RolloutTest: public testing::Test
+{
+protected:
+
+  RolloutTest(): map_lanes_(80.0) {}
+
+  virtual void SetUp()
+  {
+    char name[] = "/tmp/test_rollout_XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE(fd, 0);
+    FILE *f = fdopen(fd, "w");
+    fputs(rndf_text, f);
+    fclose(f);
+    RNDF rndf(name);
+    unlink(name);
+    ASSERT_TRUE(rndf.is_valid);
+
+    rndf.populate_graph(graph_);
+    graph_.find_mapxy();
+    ASSERT_EQ(0, map_lanes_.MapRNDF(&graph_));
+
+    nav_ = make_navigator();
+    ref_ = make_navigator();
+    ASSERT_FALSE(nav_->course->plan.empty());
+    observe(false, 80.0, 0.0);
+  }
+
+  virtual void TearDown()
+  {
+    delete nav_;
+    delete ref_;
+  }
+
+  /** @return navigator with a plan for lane 1.1 */
+  Navigator *make_navigator(void)
+  {
+    Navigator *nav = new Navigator(&odom_);
+    nav->config_ = Config::__getDefault__();
+    nav->config_.rollout_threads = 0;
+    nav->configure();
+
+    // travel lane 1.1 from its first way-point
+    for (unsigned k = 0; k < art_msgs::Order::N_WAYPTS; ++k)
+      {
+	WayPointNode &node = graph_.nodes[k];
+	nav->order.waypt[k].id = node.id.toMapID();
+	nav->order.waypt[k].mapxy.x = node.map.x;
+	nav->order.waypt[k].mapxy.y = node.map.y;
+	nav->order.waypt[k].is_stop = false;
+	nav->order.waypt[k].is_perimeter = false;
+      }
+    art_msgs::ArtLanes lanes;
+    map_lanes_.getLanes(&lanes, graph_.nodes[0].map);
+    nav->course->lanes_message(lanes);
+    nav->course->find_travel_lane(false);
+    return nav;
+  }
+
+  /** put the car near plan polygon @a i, going @a speed */
+  void place(unsigned i, float lateral, float yaw_error, float speed)
+  {
+    const poly &p = nav_->course->plan.at(i);
+    float yaw = p.heading + yaw_error;
+    geometry_msgs::Pose pose;
+    pose.position.x = p.midpoint.x - sinf(p.heading) * lateral;
+    pose.position.y = p.midpoint.y + cosf(p.heading) * lateral;
+    pose.orientation.z = sinf(yaw / 2.0);
+    pose.orientation.w = cosf(yaw / 2.0);
+    nav_->estimate.pose.pose = ref_->estimate.pose.pose = pose;
+    nav_->estimate.twist.twist.linear.x = speed;
+    ref_->estimate.twist.twist.linear.x = speed;
+  }
+
+  /** report observations, with a car @a distance ahead if @a blocked,
+   *  the adjacent lanes clear
+   */
+  void observe(bool blocked, float distance, float velocity)
+  {
+    art_msgs::ObservationArrayPtr obs(new art_msgs::ObservationArray);
+    obs->obs.resize(art_msgs::Observation::N_Observers);
+    for (unsigned k = 0; k < obs->obs.size(); ++k)
+      {
+	obs->obs[k].oid = k;
+	obs->obs[k].applicable = true;
+	obs->obs[k].clear = true;
+	obs->obs[k].distance = 80.0;
+	obs->obs[k].velocity = 0.0;
+      }
+    art_msgs::Observation &ahead =
+      obs->obs[art_msgs::Observation::Nearest_forward];
+    ahead.clear = !blocked;
+    ahead.distance = distance;
+    ahead.velocity = velocity;
+    nav_->obstacle->observers_message(obs);
+    ref_->obstacle->observers_message(obs);
+  }
+
+  nav_msgs::Odometry odom_;
+  Graph graph_;
+  MapLanes map_lanes_;
+  Navigator *nav_;			// using rollout
+  Navigator *ref_;			// using desired_heading() alone
+};
+
+// on a clear road, the command is what desired_heading() gives
+TEST_F(RolloutTest, clearRoad)
+{
+  const float laterals[] = {0.0, 0.4, -0.4, 1.0};
+  const float yaw_errors[] = {0.0, 0.1, -0.1};
+  for (unsigned i = 1; i + 4 < nav_->course->plan.size(); i += 3)
+    for (unsigned l = 0; l < sizeof(laterals) / sizeof(float); ++l)
+      for (unsigned y = 0; y < sizeof(yaw_errors) / sizeof(float); ++y)
+	{
+	  place(i, laterals[l], yaw_errors[y], 4.0);
+	  pilot_command_t expected;
+	  expected.velocity = 5.0;
+	  ref_->course->desired_heading(expected);
+
+	  pilot_command_t pcmd;
+	  pcmd.velocity = 5.0;
+	  EXPECT_TRUE(nav_->rollout->control(pcmd));
+	  EXPECT_EQ(0.0, nav_->rollout->offset_ratio());
+	  EXPECT_FLOAT_EQ(expected.velocity, pcmd.velocity)
+	    << "polygon " << i << ", lateral " << laterals[l];
+	  EXPECT_FLOAT_EQ(expected.yawRate, pcmd.yawRate)
+	    << "polygon " << i << ", lateral " << laterals[l];
+	}
+}
+
+// not moving: nothing to roll out
+TEST_F(RolloutTest, zeroSpeed)
+{
+  place(3, 0.0, 0.0, 0.0);
+  pilot_command_t pcmd;
+  pcmd.velocity = 0.0;
+  EXPECT_TRUE(nav_->rollout->control(pcmd));
+  EXPECT_EQ(0.0, pcmd.velocity);
+  EXPECT_FALSE(isnan(pcmd.yawRate));
+  EXPECT_EQ(0.0, nav_->rollout->offset_ratio());
+}
+
+// when following the lane, a car ahead never moves us out of it,
+// even with the adjacent lanes clear
+TEST_F(RolloutTest, followLaneStaysInLane)
+{
+  for (float distance = 40.0; distance > 5.0; distance -= 5.0)
+    {
+      place(2, 0.0, 0.0, 5.0);
+      observe(true, distance, -5.0);
+      pilot_command_t pcmd;
+      pcmd.velocity = 5.0;
+      if (nav_->rollout->control(pcmd))
+	{
+	  EXPECT_LE(fabsf(nav_->rollout->offset_ratio()), 1.0)
+	    << "car " << distance << " m ahead";
+	  EXPECT_LE(pcmd.velocity, 5.0);
+	}
+      else
+	EXPECT_EQ(0.0, pcmd.velocity);
+    }
+}
+
+// a car coming at us too close to stop is not feasible
+TEST_F(RolloutTest, noFeasibleTrajectory)
+{
+  place(2, 0.0, 0.0, 5.0);
+  observe(true, 8.0, -15.0);
+  pilot_command_t pcmd;
+  pcmd.velocity = 5.0;
+  EXPECT_FALSE(nav_->rollout->control(pcmd));
+  EXPECT_EQ(0.0, pcmd.velocity);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::Time::init();			// simulated time, no ROS master
+  return RUN_ALL_TESTS();
+}
@@ -278,6 +278,8 @@ bool Uturn::circle_and_line_intersect(MapXY c, float r,
 //
 Controller::result_t Uturn::control(pilot_command_t &pcmd)
 {
+  CYCLE_TIMER("Uturn");
+
   // This controller never marks a way-point officially reached.
   // Don't want run controller to get upset about that.
   course->no_waypoint_reached();
@@ -621,8 +623,8 @@ Controller::result_t Uturn::initialize(void)
   poly_list_t current_lane_polys, left_lane_polys;
 
 
-  pops->AddLanePolys(course->polygons, current_lane_polys,
-		     order->waypt[0].id);
+  pops->AddLanePolys(course->polygons, course->polygons_index,
+		     current_lane_polys, order->waypt[0].id);
 
   int uturn_exit_index = 
     pops->getClosestPoly(current_lane_polys,
@@ -634,8 +636,8 @@ Controller::result_t Uturn::initialize(void)
     {
       MapXY exit_pose;
       exit_pose = current_lane_polys.at(uturn_exit_index).midpoint;
-      pops->AddLanePolys(course->polygons, left_lane_polys,
-                         order->waypt[1].id);
+      pops->AddLanePolys(course->polygons, course->polygons_index,
+                         left_lane_polys, order->waypt[1].id);
       uturn_entry_index = pops->getClosestPoly(left_lane_polys, exit_pose);
     }
   
@@ -39,12 +39,35 @@ namespace quad_ops
   
   bool quickPointInPolyRatio(float x, float y, const Quad& p, float ratio);
 
+  // Same tests for quads.polygons[i], using geometry cached in geom
+  // when it is current for quads (and built with this ratio).
+  bool quickPointInPoly(float x, float y, const art_msgs::ArtLanes& quads,
+                        const QuadGeometry& geom, unsigned i);
+
+  bool quickPointInPolyRatio(float x, float y,
+                             const art_msgs::ArtLanes& quads,
+                             const QuadGeometry& geom, unsigned i,
+                             float ratio);
+
   art_msgs::ArtLanes filterLanes(const Quad& base_quad,
                                  const art_msgs::ArtLanes& quads,
                                  bool(*filter)(const Quad&, const Quad&));
+  // Same, replacing the contents of filtered, so its storage can be
+  // reused from one cycle to the next.
+  void filterLanes(const Quad& base_quad,
+                   const art_msgs::ArtLanes& quads,
+                   bool(*filter)(const Quad&, const Quad&),
+                   art_msgs::ArtLanes& filtered);
   art_msgs::ArtLanes filterAdjacentLanes(MapPose &pose,
                                  const art_msgs::ArtLanes& quads,
                                  const int lane);
+  // Replace in_lane with the obstacles whose midpoints are within the
+  // inner 60 percent of a lane_quads polygon.  lane_geom must be
+  // built for lane_quads.
+  void obstaclesInLane(const art_msgs::ArtLanes& obstacles,
+                       const art_msgs::ArtLanes& lane_quads,
+                       const QuadGeometry& lane_geom,
+                       art_msgs::ArtLanes& in_lane);
   // Create a comparison operator so we can use ArtQuadrilateral's in
   // std::set or std::sort
   struct quad_less
@@ -32,10 +32,8 @@ public:
   AdjacentLeft(art_observers::ObserversConfig &config);
   ~AdjacentLeft();
 
-  virtual art_msgs::Observation
-    update(const art_msgs::ArtLanes &local_map,
-           const art_msgs::ArtLanes &obstacles,
-	   MapPose pose_);
+  using Observer::update;
+  virtual art_msgs::Observation update(ObserverContext &context);
 
 private:
 
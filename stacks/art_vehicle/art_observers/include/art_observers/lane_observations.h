@@ -19,7 +19,6 @@
 #define _LANE_OBSERVATIONS_H_
 
 #include <vector>
-#include <tr1/unordered_set>
 
 #include <ros/ros.h>
 
@@ -39,6 +38,7 @@
 #include <art_observers/nearest_backward.h>
 #include <art_observers/adjacent_left.h>
 #include <art_observers/adjacent_right.h>
+#include <art_observers/local_map_grid.h>
 
 #include <art_observers/ObserversConfig.h>
 typedef art_observers::ObserversConfig Config;
@@ -69,7 +69,6 @@ private:
 
   void calcRobotPolygon();
   void filterPointsInLocalMap();
-  bool isPointInAPolygon(float x, float y);
   void processLocalMap(const art_msgs::ArtLanes::ConstPtr &msg);
   void processObstacles(void);
   void processPointCloud(const sensor_msgs::PointCloud::ConstPtr &msg);
@@ -102,14 +101,19 @@ private:
 
   PtCloud obstacles_;			///< current obstacle data
   art_msgs::ArtLanes local_map_;	///< local road map
+  observers::LocalMapGrid local_grid_;	///< local map hashed by cell
 
   /// vector of observers, in order of the observations they publish
   std::vector<observers::Observer *> observers_;
 
+  /// road map data shared by the observers each cycle
+  observers::ObserverContext context_;
+
   /// current observations from the observers
   art_msgs::ObservationArray observations_;
 
-  std::tr1::unordered_set<int> added_quads_; ///< set of obstacle quads
+  std::vector<float> points_x_;		///< obstacle x coordinates
+  std::vector<float> points_y_;		///< obstacle y coordinates
   art_msgs::ArtLanes obs_quads_;	///< vector of obstacle quads
   std::vector<art_msgs::ArtQuadrilateral>::iterator obs_it_;
   art_msgs::ArtQuadrilateral robot_polygon_; ///< robot's current polygon
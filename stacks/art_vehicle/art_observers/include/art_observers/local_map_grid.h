@@ -0,0 +1,97 @@
+/* -*- mode: C++ -*-
+ *
+ *  Copyright (C) 2011 Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  @file
+
+     ART observers local map grid interface.
+
+ */
+
+#ifndef _LOCAL_MAP_GRID_H_
+#define _LOCAL_MAP_GRID_H_
+
+#include <vector>
+
+#include <art_msgs/ArtLanes.h>
+#include <art_map/PolyOps.h>
+
+namespace observers
+{
+
+/** @brief Local road map polygons, hashed into square cells.
+ *
+ *  Each polygon is listed in every cell its bounding box overlaps,
+ *  padded for the Epsilon tolerance of the hull test, so a point
+ *  only needs testing against the few polygons listed in its own
+ *  cell.  The tests themselves are the QuadGeometry ones, so the
+ *  answers are the same as testing every polygon.
+ *
+ *  Rebuild it whenever the local map changes.
+ */
+class LocalMapGrid
+{
+public:
+
+  LocalMapGrid(): map_(NULL), min_x_(0.0), min_y_(0.0), cell_(1.0),
+    nx_(0), ny_(0) {};
+
+  /** build grid for a local map
+   *
+   * @param local_map road map lanes, which must not change until
+   *        the next build()
+   * @param cell_size preferred cell width (m), made larger if needed
+   *        to keep the number of cells proportional to the polygons
+   */
+  void build(const art_msgs::ArtLanes &local_map, float cell_size=2.0);
+
+  /** @return geometry of the local map polygons */
+  const QuadGeometry &geometry() const { return geom_; };
+
+  /** Find the local map polygons containing obstacle points.
+   *
+   *  A point is in a polygon if it is within 4 meters of its
+   *  midpoint and inside its inner 60 percent.  Polygons with the
+   *  same poly_id as one already found are skipped.
+   *
+   * @param x, y arrays of @a n point coordinates
+   * @param obs_quads polygons found are appended, in order of the
+   *        first point found in each, then by local map order
+   */
+  void findQuads(const float x[], const float y[], unsigned n,
+                 art_msgs::ArtLanes &obs_quads);
+
+private:
+
+  /** @return cell column or row containing a coordinate, -1 if
+   *          outside the grid
+   */
+  int cell(float v, float min, int n) const
+  {
+    float c = (v - min) / cell_;
+    if (!(c >= 0.0) || c >= n)		// also catches NaN
+      return -1;
+    return (int) c;
+  };
+
+  const art_msgs::ArtLanes *map_;	///< map built from
+  QuadGeometry geom_;			///< polygon geometry
+  std::vector<unsigned> start_;		///< first entry of each cell
+  std::vector<unsigned> entries_;	///< polygon indexes, by cell
+  float min_x_;
+  float min_y_;
+  float cell_;
+  int nx_;
+  int ny_;
+
+  std::vector<unsigned> slot_;		///< distinct poly_id of each polygon
+  std::vector<bool> found_;		///< poly_id bitmap, by slot
+};
+
+}; // namespace observers
+
+#endif // _LOCAL_MAP_GRID_H_
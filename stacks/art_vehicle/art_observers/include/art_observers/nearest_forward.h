@@ -30,10 +30,8 @@ public:
   NearestForward(art_observers::ObserversConfig &config);
   ~NearestForward();
 
-  virtual art_msgs::Observation
-    update(const art_msgs::ArtLanes &local_map,
-           const art_msgs::ArtLanes &obstacles,
-	   const MapPose pose_);
+  using Observer::update;
+  virtual art_msgs::Observation update(ObserverContext &context);
 
 private:
   std::vector<float> distance_;
@@ -22,6 +22,7 @@
 #include <art_msgs/Observation.h>
 #include <art_observers/ObserversConfig.h>
 #include <art_map/PolyOps.h>
+#include <art_observers/observer_context.h>
 
 namespace observers
 {
@@ -60,25 +61,32 @@ public:
    *  Called whenever there are new obstacle data, assuming the
    *  local_map is also available.
    *
-   *  @param robot_quad    quadrilateral containing the robot
+   *  @param context road map lanes, obstacles and pose for this
+   *                 cycle, shared by all the observers
+   */
+  virtual art_msgs::Observation update(ObserverContext &context) = 0;
+
+  /** Update from the local map alone.
+   *
+   *  Uses a private context, repeating work that the other observers
+   *  could have shared.
+   *
    *  @param local_map     road map lanes within range of the robot
    *  @param obstacles     local map quads currently containing obstacles
    *  @param pose          current pose of robot
-   *
-   *  @todo Make pure virtual once deprecated version is deleted. 
    */
-  virtual art_msgs::Observation
-    update(const art_msgs::ArtLanes &local_map,
-           const art_msgs::ArtLanes &obstacles,
-	   MapPose pose) = 0;
+  art_msgs::Observation update(const art_msgs::ArtLanes &local_map,
+                               const art_msgs::ArtLanes &obstacles,
+                               MapPose pose);
 
   /** Used by all observers to get obstacles in polygons of interest
    *
    *  @todo move these out of this pure virtual base class.
    */
   bool pointInLane(float x, float y, art_msgs::ArtLanes lane);
-  art_msgs::ArtLanes getObstaclesInLane(art_msgs::ArtLanes obstacles,
-                                        art_msgs::ArtLanes lane_quads);
+  static art_msgs::ArtLanes
+    getObstaclesInLane(const art_msgs::ArtLanes &obstacles,
+                       const art_msgs::ArtLanes &lane_quads);
 
 protected:
   art_msgs::Observation observation_;
@@ -0,0 +1,158 @@
+/* -*- mode: C++ -*-
+ *
+ *  Copyright (C) 2011 Austin Robot Technology
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/**  @file
+
+     ART lane observer shared context interface.
+
+ */
+
+#ifndef _OBSERVER_CONTEXT_H_
+#define _OBSERVER_CONTEXT_H_
+
+#include <utility>
+#include <vector>
+
+#include <art_msgs/ArtLanes.h>
+#include <art_map/PolyOps.h>
+
+namespace observers
+{
+
+/** @brief Road map data shared by all observers in one cycle.
+ *
+ *  Every observer needs the local map as polygons, the polygon
+ *  closest to the robot, and one lane of it with the obstacles in
+ *  that lane.  The context works each of those out the first time
+ *  an observer asks for it after reset(), then hands the same
+ *  result to the others.  Its vectors keep their storage from one
+ *  cycle to the next.
+ */
+class ObserverContext
+{
+public:
+
+  /** Road map polygons of one lane, and the obstacles in them.
+   *
+   *  The cumulative quad lengths and the poly_id index are built
+   *  once per cycle with the lane, so each observer finds the
+   *  distance to an obstacle without scanning or summing the quads.
+   */
+  struct Lane
+  {
+    art_msgs::ArtLanes quads;		///< lane polygons, nearest first
+    art_msgs::ArtLanes obstacles;	///< obstacle polygons, nearest first
+    int index;				///< quad nearest robot, or -1
+    LaneLengths lengths;		///< arc lengths along quads
+
+    /** @return position of polygon @a poly_id in quads, or -1 */
+    int position(int poly_id) const;
+
+    /** (poly_id, position) of each quad, sorted by poly_id */
+    std::vector<std::pair<int, int> > ids;
+  };
+
+  ObserverContext(): local_map_(NULL), obstacles_(NULL), valid_(0) {};
+
+  /** Start a new cycle.
+   *
+   *  @param local_map road map lanes within range of the robot
+   *  @param obstacles local map quads currently containing obstacles
+   *  @param pose      current pose of robot
+   *
+   *  The context refers to @a local_map and @a obstacles until the
+   *  next reset(), they must not change before then.
+   */
+  void reset(const art_msgs::ArtLanes &local_map,
+             const art_msgs::ArtLanes &obstacles,
+             const MapPose &pose)
+  {
+    local_map_ = &local_map;
+    obstacles_ = &obstacles;
+    pose_ = pose;
+    valid_ = 0;
+  };
+
+  const art_msgs::ArtLanes &localMap() const { return *local_map_; };
+  const art_msgs::ArtLanes &obstacles() const { return *obstacles_; };
+  const MapPose &pose() const { return pose_; };
+
+  /** @return local map converted to polygons */
+  const poly_list_t &polys();
+
+  /** @return index of local map polygon closest to the robot, -1 if
+   *          the map is empty
+   */
+  int robotIndex();
+
+  /** @return current lane ahead of the robot's polygon, in order of
+   *          increasing distance.  @a index is not used.
+   */
+  const Lane &forward();
+
+  /** @return current lane behind the robot's polygon, in order of
+   *          increasing distance.  @a index is not used.
+   */
+  const Lane &backward();
+
+  /** @return adjacent lane to the left, in road map order */
+  const Lane &left();
+
+  /** @return adjacent lane to the right, in road map order */
+  const Lane &right();
+
+private:
+
+  /** parts of the context worked out so far this cycle */
+  enum
+    {
+      POLYS = 0x01,
+      ROBOT = 0x02,
+      FORWARD = 0x04,
+      BACKWARD = 0x08,
+      LEFT = 0x10,
+      RIGHT = 0x20
+    };
+
+  /** @return true the first time @a part is needed this cycle */
+  bool needs(unsigned part)
+  {
+    if (valid_ & part)
+      return false;
+    valid_ |= part;
+    return true;
+  };
+
+  /** polygon comparison for quad_ops::filterLanes() */
+  typedef bool (*QuadFilter)(const art_msgs::ArtQuadrilateral&,
+                             const art_msgs::ArtQuadrilateral&);
+
+  void adjacentLane(Lane &lane, int direction);
+  void currentLane(Lane &lane, QuadFilter filter);
+  void indexLane(Lane &lane);
+
+  const art_msgs::ArtLanes *local_map_;
+  const art_msgs::ArtLanes *obstacles_;
+  MapPose pose_;
+  unsigned valid_;			///< parts already done
+
+  PolyOps ops_;
+  poly_list_t polys_;			///< local map polygons
+  int robot_index_;
+  Lane forward_;
+  Lane backward_;
+  Lane left_;
+  Lane right_;
+
+  poly_list_t adj_polys_;		///< adjacent lane work area
+  QuadGeometry adj_geom_;		///< adjacent lane work area
+};
+
+}; // namespace observers
+
+#endif // _OBSERVER_CONTEXT_H_
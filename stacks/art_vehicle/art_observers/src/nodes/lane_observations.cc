@@ -115,6 +115,7 @@ void LaneObservations::processPointCloud2(const sensor_msgs::PointCloud2::ConstP
 void LaneObservations::processLocalMap(const art_msgs::ArtLanes::ConstPtr &msg) 
 {
   local_map_ = *msg;
+  local_grid_.build(local_map_);
 }
 
 /** @brief process the pose of the map **/
@@ -123,17 +124,30 @@ void LaneObservations::processPose(const nav_msgs::Odometry &odom)
   pose_ = MapPose(odom.pose.pose);
 }
 
-/** @brief Filter obstacle points to those in a road map polygon. */
+/** @brief Find the road map polygons containing obstacle points.
+ *
+ *  Tests each point against the few polygons hashed to its grid
+ *  cell.  A point is in a polygon if it is within 4 meters of its
+ *  midpoint and inside its inner 60 percent.
+ *
+ *  @post @a obs_quads_ contains the polygons found, in order of the
+ *        first point found in each.
+ */
 void LaneObservations::filterPointsInLocalMap() 
 {
-  // set the exact point cloud size
   size_t npoints = obstacles_.points.size();
-  added_quads_.clear();
-  for (unsigned i = 0; i < npoints; ++i)
+  if (npoints == 0)
+    return;
+
+  points_x_.resize(npoints);
+  points_y_.resize(npoints);
+  for (unsigned j = 0; j < npoints; ++j)
     {
-      isPointInAPolygon(obstacles_.points[i].x,
-                        obstacles_.points[i].y);
+      points_x_[j] = obstacles_.points[j].x;
+      points_y_[j] = obstacles_.points[j].y;
     }
+
+  local_grid_.findQuads(&points_x_[0], &points_y_[0], npoints, obs_quads_);
 }
 
 /** @brief Transform obstacle points into the map frame of reference. */
@@ -158,52 +172,15 @@ void LaneObservations::transformPointCloud(const PtCloud &msg)
     }
 }
 
-/** Point in polygon predicate.
- *
- *  @return true if (X, Y) is within a road map polygon.
- *
- *  @post @a added_quads contains polygon ID, if found.
- *        @a obstacle_quads contains polygon, if found.
- */
-bool LaneObservations::isPointInAPolygon(float x, float y) 
-{
-  size_t num_polys = local_map_.polygons.size();
-  
-  bool inside = false;
-  std::pair<std::tr1::unordered_set<int>::iterator, bool> pib;
-  
-  for (size_t i=0; i<num_polys; i++)
-    {
-      art_msgs::ArtQuadrilateral *p= &(local_map_.polygons[i]);
-      float dist= ((p->midpoint.x-x)*(p->midpoint.x-x)
-                   + (p->midpoint.y-y)*(p->midpoint.y-y));
-
-      if (dist > 16)         // quick check: are we near the polygon?
-        continue;
-
-      inside = quad_ops::quickPointInPolyRatio(x,y,*p,0.6);
-      // Add polygon to lane if so
-      if (inside)
-        {
-          pib = added_quads_.insert(p->poly_id);
-          if (pib.second)
-            {
-              obs_quads_.polygons.push_back(*p);
-            }
-        }
-    }
-
-  return inside;
-}
-
 /** @brief Run all registered observers and publish their observations. */
 void LaneObservations::runObservers() 
 {
-  // update all the registered observers
+  // update all the registered observers, sharing what they need to
+  // know about the lanes around the robot
+  context_.reset(local_map_, obs_quads_, pose_);
   for (unsigned i = 0; i < observers_.size(); ++i)
     {
-      observations_.obs[i] =
-	observers_[i]->update(local_map_, obs_quads_, pose_);
+      observations_.obs[i] = observers_[i]->update(context_);
     }
 
   // Publish their observations
@@ -225,23 +202,20 @@ void LaneObservations::calcRobotPolygon()
   geometry_msgs::PointStamped robot_point;
   tf_listener_->transformPoint(config_.map_frame_id, laser_point, robot_point);
 
+  const QuadGeometry &local_geom = local_grid_.geometry();
   size_t numPolys = local_map_.polygons.size();
   float x = robot_point.point.x; 
   float y = robot_point.point.y;
   bool inside=false;
   for (size_t i=0; i<numPolys; i++)
     {
-      art_msgs::ArtQuadrilateral *p= &(local_map_.polygons[i]);
-      float dist = ((p->midpoint.x-x)*(p->midpoint.x-x)
-                    + (p->midpoint.y-y)*(p->midpoint.y-y));
-
-      if (dist > 16)          // quick check: we are near the polygon?
+      if (local_geom.midpointDist2(i,x,y) > 16) // are we near it?
         continue;
 
-      inside = quad_ops::quickPointInPoly(x,y,*p); 
+      inside = quad_ops::quickPointInPoly(x,y,local_map_,local_geom,i);
       if (inside)
         {
-          robot_polygon_ = *p;
+          robot_polygon_ = local_map_.polygons[i];
         }
     }
 }
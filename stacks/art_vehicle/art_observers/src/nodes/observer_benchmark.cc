@@ -0,0 +1,401 @@
+/*
+ *  utility to measure lane observer speed
+ *
+ *  Copyright (C) 2011, Austin Robot Technology
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <vector>
+#include <tr1/unordered_set>
+
+#include <art_observers/nearest_forward.h>
+#include <art_observers/nearest_backward.h>
+#include <art_observers/adjacent_left.h>
+#include <art_observers/adjacent_right.h>
+#include <art_observers/local_map_grid.h>
+
+/** @file
+
+ @brief utility to measure lane observer speed.
+
+ Makes a local map of a straight three lane road and a repeatable
+ series of cycles, each with the robot a little farther along the
+ middle lane and a random set of obstacle polygons.  Runs all four
+ lane observers for every cycle, first with each observer working
+ out the lanes for itself, then sharing one ObserverContext, like
+ the observers node does.  Checks that both give the same distances,
+ and prints the total observer time per cycle.
+
+ Then makes an obstacle point cloud, mostly off the road, with
+ clusters in some of the lane polygons.  Finds the polygons
+ containing points by testing every polygon against the whole cloud,
+ and with a LocalMapGrid, checks that both find the same polygons in
+ the same order, and prints the time for each.
+
+*/
+
+static char *pname;
+static int num_cycles = 2000;
+static int num_points = 100000;
+static int num_obstacles = 10;
+static int num_quads = 50;
+static int repeat = 3;
+static const int num_lanes = 3;
+static const float lane_width = 4.0;
+static const float quad_length = 4.0;
+
+/** @return current time in seconds */
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/** one of each lane observer, in observers node order */
+struct ObserverSet
+{
+  ObserverSet(art_observers::ObserversConfig &config):
+    forward(config), backward(config), left(config), right(config)
+  {
+    all.push_back(&forward);
+    all.push_back(&backward);
+    all.push_back(&left);
+    all.push_back(&right);
+  }
+
+  observers::NearestForward forward;
+  observers::NearestBackward backward;
+  observers::AdjacentLeft left;
+  observers::AdjacentRight right;
+  std::vector<observers::Observer *> all;
+};
+
+/** make a straight road of lanes 1 through num_lanes, numbered from
+ *  the left, all heading east, each n quads long
+ */
+static void make_road(art_msgs::ArtLanes &local_map, int n)
+{
+  poly_list_t polys(num_lanes * n);
+  for (int lane = 1; lane <= num_lanes; ++lane)
+    {
+      float y = (num_lanes + 1 - 2 * lane) * lane_width / 2;
+      for (int i = 0; i < n; ++i)
+	{
+	  poly &p = polys[(lane - 1) * n + i];
+	  float x0 = i * quad_length;
+	  float x1 = x0 + quad_length;
+	  p.p1 = MapXY(x0, y + lane_width / 2);
+	  p.p2 = MapXY(x1, y + lane_width / 2);
+	  p.p3 = MapXY(x1, y - lane_width / 2);
+	  p.p4 = MapXY(x0, y - lane_width / 2);
+	  p.midpoint = MapXY((x0 + x1) / 2, y);
+	  p.heading = 0.0;
+	  p.length = quad_length;
+	  p.poly_id = (lane - 1) * n + i;
+	  p.is_stop = false;
+	  p.is_transition = false;
+	  p.contains_way = false;
+	  p.start_way = ElementID(1, lane, i + 1);
+	  p.end_way = ElementID(1, lane, i + 2);
+	  p.left_boundary = (lane == 1? DOUBLE_YELLOW: BROKEN_WHITE);
+	  p.right_boundary = (lane == num_lanes? SOLID_WHITE: BROKEN_WHITE);
+	}
+    }
+  PolyOps pops;
+  pops.GetLanes(polys, local_map);
+  local_map.header.stamp = ros::Time::now();
+}
+
+/** make the robot pose and obstacle polygons for every cycle */
+static void make_cycles(const art_msgs::ArtLanes &local_map,
+			std::vector<MapPose> &poses,
+			std::vector<art_msgs::ArtLanes> &obstacles)
+{
+  srand(1);
+  float road_length = num_quads * quad_length;
+  poses.resize(num_cycles);
+  obstacles.resize(num_cycles);
+  for (int c = 0; c < num_cycles; ++c)
+    {
+      poses[c].map = MapXY(fmodf(c * 0.5f, road_length), 0.3f);
+      poses[c].yaw = 0.0;
+      for (int i = 0; i < num_obstacles; ++i)
+	{
+	  int q = rand() % local_map.polygons.size();
+	  obstacles[c].polygons.push_back(local_map.polygons[q]);
+	}
+    }
+}
+
+/** make an obstacle cloud of n points, one in twenty of them
+ *  clustered in num_obstacles random local map polygons, the rest
+ *  off the road
+ */
+static void make_points(const art_msgs::ArtLanes &local_map, int n,
+			std::vector<float> &x, std::vector<float> &y)
+{
+  srand(2);
+  float road_length = num_quads * quad_length;
+  float road_edge = num_lanes * lane_width / 2;
+  std::vector<int> clusters(num_obstacles);
+  for (int i = 0; i < num_obstacles; ++i)
+    clusters[i] = rand() % local_map.polygons.size();
+  x.resize(n);
+  y.resize(n);
+  for (int j = 0; j < n; ++j)
+    {
+      float r = rand() / (RAND_MAX + 1.0);
+      if (j % 20 == 0 && num_obstacles > 0)
+	{
+	  const art_msgs::ArtQuadrilateral &q =
+	    local_map.polygons[clusters[rand() % num_obstacles]];
+	  x[j] = q.midpoint.x + quad_length * (r - 0.5);
+	  y[j] = q.midpoint.y + lane_width * (rand() / (RAND_MAX + 1.0) - 0.5);
+	}
+      else
+	{
+	  x[j] = road_length * r;
+	  float off = road_edge + 20.0 * (rand() / (RAND_MAX + 1.0));
+	  y[j] = (j & 1? off: -off);
+	}
+    }
+}
+
+/** find the polygons containing points by testing every polygon
+ *  against all the points, like the observers node used to
+ */
+static void scan_points(const art_msgs::ArtLanes &local_map,
+			const QuadGeometry &geom,
+			const std::vector<float> &x,
+			const std::vector<float> &y,
+			art_msgs::ArtLanes &obs_quads)
+{
+  unsigned npoints = x.size();
+  std::vector<unsigned char> points_in(npoints);
+  std::vector<std::pair<unsigned, unsigned> > hits;
+  for (unsigned i = 0; i < geom.size(); ++i)
+    {
+      geom.pointsInside(i, true, 16, &x[0], &y[0], npoints, &points_in[0]);
+      for (unsigned j = 0; j < npoints; ++j)
+	if (points_in[j])
+	  {
+	    hits.push_back(std::make_pair(j, i));
+	    break;
+	  }
+    }
+  std::sort(hits.begin(), hits.end());
+
+  std::tr1::unordered_set<int> added_quads;
+  for (unsigned h = 0; h < hits.size(); ++h)
+    {
+      const art_msgs::ArtQuadrilateral &p = local_map.polygons[hits[h].second];
+      if (added_quads.insert(p.poly_id).second)
+	obs_quads.polygons.push_back(p);
+    }
+}
+
+/** @return true if both lists have the same polygons in order */
+static bool same_quads(const art_msgs::ArtLanes &a,
+		       const art_msgs::ArtLanes &b)
+{
+  if (a.polygons.size() != b.polygons.size())
+    return false;
+  for (unsigned i = 0; i < a.polygons.size(); ++i)
+    if (a.polygons[i].poly_id != b.polygons[i].poly_id)
+      return false;
+  return true;
+}
+
+/** parse command line arguments */
+static void parse_args(int argc, char *argv[])
+{
+  bool print_usage = false;
+  const char *options = "c:ho:p:q:r:";
+  int opt = 0;
+  int option_index = 0;
+  struct option long_options[] =
+    {
+      { "cycles", 1, 0, 'c' },
+      { "help", 0, 0, 'h' },
+      { "obstacles", 1, 0, 'o' },
+      { "points", 1, 0, 'p' },
+      { "quads", 1, 0, 'q' },
+      { "repeat", 1, 0, 'r' },
+      { 0, 0, 0, 0 }
+    };
+
+  /* basename $0 */
+  pname = strrchr(argv[0], '/');
+  if (pname == 0)
+    pname = argv[0];
+  else
+    pname++;
+
+  opterr = 0;
+  while ((opt = getopt_long(argc, argv, options,
+			    long_options, &option_index)) != EOF)
+    {
+      switch (opt)
+	{
+	case 'c':
+	  num_cycles = atoi(optarg);
+	  break;
+
+	case 'o':
+	  num_obstacles = atoi(optarg);
+	  break;
+
+	case 'p':
+	  num_points = atoi(optarg);
+	  break;
+
+	case 'q':
+	  num_quads = atoi(optarg);
+	  break;
+
+	case 'r':
+	  repeat = atoi(optarg);
+	  break;
+
+	default:
+	  fprintf(stderr, "unknown option character %c\n",
+		  optopt);
+	  /*fallthru*/
+	case 'h':
+	  print_usage = true;
+	}
+    }
+
+  if (print_usage || num_cycles <= 0 || num_obstacles < 0
+      || num_points <= 0 || num_quads <= 0 || repeat <= 0)
+    {
+      fprintf(stderr,
+	      "usage: %s [options]\n\n"
+	      "    Time the lane observers.  Possible options:\n"
+	      "\t-c, --cycles\tobserver cycles (default 2000)\n"
+	      "\t-h, --help\tprint this message\n"
+	      "\t-o, --obstacles\tobstacle polygons per cycle (default 10)\n"
+	      "\t-p, --points\tpoints in obstacle cloud (default 100000)\n"
+	      "\t-q, --quads\tquads in each lane (default 50)\n"
+	      "\t-r, --repeat\tnumber of timed runs (default 3)\n",
+	      pname);
+      exit(9);
+    }
+}
+
+/** main program */
+int main(int argc, char *argv[])
+{
+  parse_args(argc, argv);
+  ros::Time::init();
+
+  art_msgs::ArtLanes local_map;
+  make_road(local_map, num_quads);
+  std::vector<MapPose> poses;
+  std::vector<art_msgs::ArtLanes> obstacles;
+  make_cycles(local_map, poses, obstacles);
+
+  // one set of observers for each method, so their filters see the
+  // same series of distances
+  art_observers::ObserversConfig config;
+  ObserverSet set_private(config);
+  ObserverSet set_shared(config);
+  const std::vector<observers::Observer *> &obs_private = set_private.all;
+  const std::vector<observers::Observer *> &obs_shared = set_shared.all;
+  unsigned nobs = obs_private.size();
+
+  std::vector<float> distance[2];
+  distance[0].resize(num_cycles * nobs);
+  distance[1].resize(num_cycles * nobs);
+  observers::ObserverContext context;
+  int mismatches = 0;
+  double t_private = 0.0, t_shared = 0.0;
+  for (int r = 0; r < repeat; ++r)
+    {
+      double t0 = now();
+      for (int c = 0; c < num_cycles; ++c)
+	for (unsigned i = 0; i < nobs; ++i)
+	  distance[0][c * nobs + i] =
+	    obs_private[i]->update(local_map, obstacles[c], poses[c]).distance;
+      double t1 = now();
+      for (int c = 0; c < num_cycles; ++c)
+	{
+	  context.reset(local_map, obstacles[c], poses[c]);
+	  for (unsigned i = 0; i < nobs; ++i)
+	    distance[1][c * nobs + i] = obs_shared[i]->update(context).distance;
+	}
+      double t2 = now();
+      if (distance[0] != distance[1])
+	++mismatches;
+      if (r == 0 || t1 - t0 < t_private)
+	t_private = t1 - t0;
+      if (r == 0 || t2 - t1 < t_shared)
+	t_shared = t2 - t1;
+    }
+
+  printf("%d observers, %d quads, %d obstacles, %d cycles\n",
+	 nobs, (int) local_map.polygons.size(), num_obstacles, num_cycles);
+  printf("private context: %.3f s, %.1f us/cycle"
+	 "  shared context: %.3f s, %.1f us/cycle (%.1fx)\n",
+	 t_private, t_private * 1e6 / num_cycles,
+	 t_shared, t_shared * 1e6 / num_cycles, t_private / t_shared);
+
+  if (mismatches)
+    {
+      fprintf(stderr, "%s: private and shared observations differ\n", pname);
+      return 1;
+    }
+
+  // find the polygons containing obstacle points
+  std::vector<float> x, y;
+  make_points(local_map, num_points, x, y);
+  QuadGeometry geom(local_map);
+  observers::LocalMapGrid grid;
+  double t_build = 0.0, t_scan = 0.0, t_grid = 0.0;
+  art_msgs::ArtLanes scan_quads, grid_quads;
+  for (int r = 0; r < repeat; ++r)
+    {
+      scan_quads.polygons.clear();
+      grid_quads.polygons.clear();
+      double t0 = now();
+      grid.build(local_map);
+      double t1 = now();
+      scan_points(local_map, geom, x, y, scan_quads);
+      double t2 = now();
+      grid.findQuads(&x[0], &y[0], num_points, grid_quads);
+      double t3 = now();
+      if (!same_quads(scan_quads, grid_quads))
+	++mismatches;
+      if (r == 0 || t1 - t0 < t_build)
+	t_build = t1 - t0;
+      if (r == 0 || t2 - t1 < t_scan)
+	t_scan = t2 - t1;
+      if (r == 0 || t3 - t2 < t_grid)
+	t_grid = t3 - t2;
+    }
+
+  printf("%d points, %d polygons found\n",
+	 num_points, (int) grid_quads.polygons.size());
+  printf("scan all polygons: %.3f s, %.1f ns/point"
+	 "  grid: %.3f s, %.1f ns/point (%.1fx), build %.1f us\n",
+	 t_scan, t_scan * 1e9 / num_points, t_grid, t_grid * 1e9 / num_points,
+	 t_scan / t_grid, t_build * 1e6);
+
+  if (mismatches)
+    {
+      fprintf(stderr, "%s: scan and grid polygons differ\n", pname);
+      return 1;
+    }
+  return 0;
+}
@@ -25,6 +25,7 @@
 #include <tf/transform_listener.h>
 
 #include <string>
+#include <vector>
 
 #define NODE "maplanes_grid"
 
@@ -34,21 +35,14 @@ sensor_msgs::PointCloud pc;             // outgoing PointCloud message
 
 tf::TransformListener* listener;
 art_msgs::ArtLanes map;                 // local map
+poly_list_t map_polys;                  // local map polygons
+QuadGeometry map_geom;                  // cached polygon geometry
 PolyOps* pops;
 
-bool isPointInMap(float x, float y) 
-{
-  int numPolys = map.polygons.size();
-  for (int i=0; i<numPolys; i++)
-    {
-      poly p(map.polygons[i]);
-      if (pops->pointInPoly(x,y,p))
-        {
-          return true;
-        }
-    }
-  return false;
-}
+// per-point work areas, kept to avoid reallocating them every scan
+std::vector<float> points_x;
+std::vector<float> points_y;
+std::vector<unsigned char> points_in;
 
 /** \brief callback for incoming point cloud
 
@@ -78,10 +72,23 @@ void processObstacles(const sensor_msgs::PointCloud &msg)
   size_t npoints = trans.points.size();
   pc.points.resize(npoints);
   size_t count=0;
+
+  // check all the points against each polygon in turn
+  points_x.resize(npoints);
+  points_y.resize(npoints);
+  points_in.resize(npoints);
+  for (unsigned i = 0; i < npoints; ++i)
+    {
+      points_x[i] = trans.points[i].x;
+      points_y[i] = trans.points[i].y;
+    }
+  if (npoints > 0)
+    pops->pointsInPolys(&points_x[0], &points_y[0], npoints,
+                        map_polys, map_geom, &points_in[0]);
+
   for (unsigned i = 0; i < npoints; ++i)
     {
-      bool in = isPointInMap(trans.points[i].x,trans.points[i].y);
-      if (in) {
+      if (points_in[i]) {
         pc.points[count].x = trans.points[i].x;
         pc.points[count].y = trans.points[i].y;
         pc.points[count].z = trans.points[i].z;
@@ -96,6 +103,8 @@ void processObstacles(const sensor_msgs::PointCloud &msg)
 void processMap(const art_msgs::ArtLanes &msg)
 {
   map = msg;
+  pops->GetPolys(map, map_polys);
+  map_geom.build(map_polys);
 }
 
 int main(int argc, char *argv[])
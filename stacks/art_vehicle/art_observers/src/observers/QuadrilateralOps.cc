@@ -109,6 +109,22 @@ namespace quad_ops {
     return false;
   }
   
+  bool quickPointInPoly(float x, float y, const art_msgs::ArtLanes& quads,
+                        const QuadGeometry& geom, unsigned i) {
+    if (!geom.indexes(quads))
+      return quickPointInPoly(x,y,quads.polygons[i]);
+    return geom.pointInside(i,x,y);
+  }
+
+  bool quickPointInPolyRatio(float x, float y,
+                             const art_msgs::ArtLanes& quads,
+                             const QuadGeometry& geom, unsigned i,
+                             float ratio) {
+    if (!geom.indexes(quads) || geom.ratio() != ratio)
+      return quickPointInPolyRatio(x,y,quads.polygons[i],ratio);
+    return geom.pointInsideInner(i,x,y);
+  }
+  
   // This function returns an ArtLanes containing all the
   // ArtQuadrilaterals in 'quads' that are satisfied by the 'filter'
   // being passed in
@@ -117,6 +133,16 @@ namespace quad_ops {
                                  bool(*filter)(const art_msgs::ArtQuadrilateral&, const art_msgs::ArtQuadrilateral&))
   {
     art_msgs::ArtLanes filtered;
+    filterLanes(base_quad, quads, filter, filtered);
+    return filtered;
+  }
+
+  void filterLanes(const art_msgs::ArtQuadrilateral& base_quad,
+                   const art_msgs::ArtLanes& quads,
+                   bool(*filter)(const art_msgs::ArtQuadrilateral&, const art_msgs::ArtQuadrilateral&),
+                   art_msgs::ArtLanes& filtered)
+  {
+    filtered.polygons.clear();
     size_t num_quads = quads.polygons.size();
     for (size_t i=0; i<num_quads; i++) {
       const art_msgs::ArtQuadrilateral* p= &(quads.polygons[i]);
@@ -124,7 +150,6 @@ namespace quad_ops {
         filtered.polygons.push_back(*p);
       }
     }
-    return filtered;
   }
   
   // This function returns an ArtLanes containing all the 
@@ -142,4 +167,27 @@ namespace quad_ops {
     return adjacentPolys;
     
   }
+
+  // This function replaces in_lane with the obstacles located in the
+  // lane made of lane_quads
+  void obstaclesInLane(const art_msgs::ArtLanes& obstacles,
+                       const art_msgs::ArtLanes& lane_quads,
+                       const QuadGeometry& lane_geom,
+                       art_msgs::ArtLanes& in_lane)
+  {
+    in_lane.polygons.clear();
+    size_t num_polys = lane_quads.polygons.size();
+    for (size_t i=0; i<obstacles.polygons.size(); i++) {
+      float x = obstacles.polygons[i].midpoint.x;
+      float y = obstacles.polygons[i].midpoint.y;
+      for (size_t j=0; j<num_polys; j++) {
+        if (lane_geom.midpointDist2(j,x,y) > 16) // are we near the polygon?
+          continue;
+        if (quickPointInPolyRatio(x,y,lane_quads,lane_geom,j,0.6)) {
+          in_lane.polygons.push_back(obstacles.polygons[i]);
+          break;
+        }
+      }
+    }
+  }
 }
@@ -39,43 +39,29 @@ AdjacentLeft::~AdjacentLeft()
  *  left lane.
  */
 art_msgs::Observation
-  AdjacentLeft::update(const art_msgs::ArtLanes &local_map,
-			 const art_msgs::ArtLanes &obstacles,
-			 MapPose pose_)
+  AdjacentLeft::update(ObserverContext &context)
 {
-  
-  art_msgs::ArtLanes adj_lane_quads = quad_ops::filterAdjacentLanes
-					(pose_, local_map, 1);
+  // get the adjacent lane, with its polygon closest to the robot
+  const ObserverContext::Lane &lane = context.left();
+  const art_msgs::ArtLanes &adj_lane_quads = lane.quads;
+  const art_msgs::ArtLanes &adj_lane_obstacles = lane.obstacles;
+  int index_adj = lane.index;
 
-  art_msgs::ArtLanes adj_lane_obstacles = getObstaclesInLane(obstacles, adj_lane_quads);
-  
-  //Finding closest poly in left lane
-  PolyOps polyOps_left;
-  std::vector<poly> adj_polys_left;
-  int index_adj = -1;
-  polyOps_left.GetPolys(adj_lane_quads, adj_polys_left);
-  index_adj = polyOps_left.getClosestPoly(adj_polys_left, pose_.map.x, pose_.map.y);
- 
   float distance = std::numeric_limits<float>::infinity();
   if (adj_lane_obstacles.polygons.size()!=0)
     {
       // Get distance along road from robot to nearest obstacle
       int target_id = adj_lane_obstacles.polygons[0].poly_id;
-      distance = 0;
+      int i = lane.position(target_id);
       // Check to see direction of the adjacent lane
-      if(adj_lane_quads.polygons[index_adj].poly_id < adj_lane_obstacles.polygons[0].poly_id) {
-        for (size_t i = index_adj; i < adj_lane_quads.polygons.size(); i++)
-	  {
-	    distance += adj_lane_quads.polygons[i].length;
-	    if (adj_lane_quads.polygons[i].poly_id == target_id)
-	      break;
-	  }
+      if(adj_lane_quads.polygons[index_adj].poly_id < target_id) {
+        if (i < index_adj)
+          i = adj_lane_quads.polygons.size();
+        distance = lane.lengths.length(index_adj, i+1);
       } else {
-	for( size_t i = index_adj; i<adj_lane_quads.polygons.size(); i--) {
-	  distance += adj_lane_quads.polygons[i].length;
-	  if(adj_lane_quads.polygons[i].poly_id == target_id)
-	    break;
-	}
+        if (i < 0 || i > index_adj)
+          i = 0;
+        distance = lane.lengths.length(i, index_adj+1);
       }
     }
 
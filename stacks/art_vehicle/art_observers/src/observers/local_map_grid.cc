@@ -0,0 +1,153 @@
+/*
+ *  Copyright (C) 2011 UT-Austin & Austin Robot Technology
+ *  License: Modified BSD Software License
+ */
+
+/**  @file
+
+     ART observers local map grid implementation.
+
+ */
+
+#include <math.h>
+#include <algorithm>
+
+#include <art_observers/local_map_grid.h>
+
+namespace observers
+{
+
+void LocalMapGrid::build(const art_msgs::ArtLanes &local_map, float cell_size)
+{
+  map_ = &local_map;
+  geom_.build(local_map);
+  start_.clear();
+  entries_.clear();
+  slot_.clear();
+  found_.clear();
+  nx_ = ny_ = 0;
+  unsigned nquads = geom_.size();
+  if (nquads == 0)
+    return;
+
+  // number the distinct poly_ids, so the bitmap needs only one bit
+  // for each, however they are spread
+  std::vector<int> ids(nquads);
+  for (unsigned i = 0; i < nquads; ++i)
+    ids[i] = local_map.polygons[i].poly_id;
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  slot_.resize(nquads);
+  for (unsigned i = 0; i < nquads; ++i)
+    slot_[i] = (std::lower_bound(ids.begin(), ids.end(),
+                                 local_map.polygons[i].poly_id)
+                - ids.begin());
+  found_.assign(ids.size(), false);
+
+  // bounding box of each polygon, padded well beyond the relative
+  // and absolute Epsilon::float_value tolerance of the hull test
+  std::vector<float> lo_x(nquads), hi_x(nquads), lo_y(nquads), hi_y(nquads);
+  for (unsigned i = 0; i < nquads; ++i)
+    {
+      MapXY v = geom_.vertex(i, 0);
+      lo_x[i] = hi_x[i] = v.x;
+      lo_y[i] = hi_y[i] = v.y;
+      for (int k = 1; k < 4; ++k)
+        {
+          v = geom_.vertex(i, k);
+          lo_x[i] = std::min(lo_x[i], v.x);
+          hi_x[i] = std::max(hi_x[i], v.x);
+          lo_y[i] = std::min(lo_y[i], v.y);
+          hi_y[i] = std::max(hi_y[i], v.y);
+        }
+      float pad_x = 0.01 + 1e-4 * std::max(fabsf(lo_x[i]), fabsf(hi_x[i]));
+      float pad_y = 0.01 + 1e-4 * std::max(fabsf(lo_y[i]), fabsf(hi_y[i]));
+      lo_x[i] -= pad_x;
+      hi_x[i] += pad_x;
+      lo_y[i] -= pad_y;
+      hi_y[i] += pad_y;
+    }
+
+  min_x_ = *std::min_element(lo_x.begin(), lo_x.end());
+  min_y_ = *std::min_element(lo_y.begin(), lo_y.end());
+  float max_x = *std::max_element(hi_x.begin(), hi_x.end());
+  float max_y = *std::max_element(hi_y.begin(), hi_y.end());
+
+  // A local map with a stray polygon far away would otherwise need a
+  // huge, nearly empty array of cells.
+  cell_ = (cell_size > 0.0? cell_size: 1.0);
+  for (;;)
+    {
+      nx_ = (int) ((max_x - min_x_) / cell_) + 1;
+      ny_ = (int) ((max_y - min_y_) / cell_) + 1;
+      if ((double) nx_ * ny_ <= 16.0 * nquads + 64)
+        break;
+      cell_ *= 2.0;
+    }
+
+  // Counting sort of polygon indexes by the cells they overlap,
+  // keeping them in ascending order within each cell.  Any point in
+  // the box maps to a cell between those of its corners.
+  std::vector<int> cx0(nquads), cx1(nquads), cy0(nquads), cy1(nquads);
+  start_.assign(nx_ * ny_ + 1, 0);
+  for (unsigned i = 0; i < nquads; ++i)
+    {
+      cx0[i] = std::max(cell(lo_x[i], min_x_, nx_), 0);
+      cy0[i] = std::max(cell(lo_y[i], min_y_, ny_), 0);
+      cx1[i] = cell(hi_x[i], min_x_, nx_);
+      if (cx1[i] < 0)
+        cx1[i] = nx_ - 1;
+      cy1[i] = cell(hi_y[i], min_y_, ny_);
+      if (cy1[i] < 0)
+        cy1[i] = ny_ - 1;
+      for (int cy = cy0[i]; cy <= cy1[i]; ++cy)
+        for (int cx = cx0[i]; cx <= cx1[i]; ++cx)
+          ++start_[cy * nx_ + cx + 1];
+    }
+  for (unsigned c = 0; c < start_.size() - 1; ++c)
+    start_[c+1] += start_[c];
+
+  std::vector<unsigned> next(start_.begin(), start_.end() - 1);
+  entries_.resize(start_.back());
+  for (unsigned i = 0; i < nquads; ++i)
+    for (int cy = cy0[i]; cy <= cy1[i]; ++cy)
+      for (int cx = cx0[i]; cx <= cx1[i]; ++cx)
+        entries_[next[cy * nx_ + cx]++] = i;
+}
+
+void LocalMapGrid::findQuads(const float x[], const float y[], unsigned n,
+                             art_msgs::ArtLanes &obs_quads)
+{
+  if (map_ && !geom_.indexes(*map_))	// map changed since build()?
+    build(*map_, cell_);
+  if (nx_ == 0)
+    return;
+
+  unsigned nfound = 0;
+  for (unsigned j = 0; j < n && nfound < found_.size(); ++j)
+    {
+      int cx = cell(x[j], min_x_, nx_);
+      int cy = cell(y[j], min_y_, ny_);
+      if (cx < 0 || cy < 0)
+        continue;
+
+      int c = cy * nx_ + cx;
+      for (unsigned e = start_[c]; e < start_[c+1]; ++e)
+        {
+          unsigned i = entries_[e];
+          if (found_[slot_[i]])
+            continue;
+          if (geom_.midpointDist2(i, x[j], y[j]) > 16 // are we near it?
+              || !geom_.pointInsideInner(i, x[j], y[j]))
+            continue;
+          found_[slot_[i]] = true;
+          ++nfound;
+          obs_quads.polygons.push_back(map_->polygons[i]);
+        }
+    }
+
+  // leave the bitmap clear for next time
+  std::fill(found_.begin(), found_.end(), false);
+}
+
+}; // namespace observers
@@ -36,39 +36,21 @@ NearestForward::~NearestForward()
 
 // \brief Updates the message with new data received.
 art_msgs::Observation
-  NearestForward::update(const art_msgs::ArtLanes &local_map,
-			 const art_msgs::ArtLanes &obstacles,
-			 MapPose pose_)
+  NearestForward::update(ObserverContext &context)
 {
-  PolyOps polyOps;
-  std::vector<poly> map_polys;
-  int poly_index = -1;
-  polyOps.GetPolys(local_map, map_polys);
-  poly_index = polyOps.getClosestPoly(map_polys, pose_.map.x, pose_.map.y);
-
-  art_msgs::ArtQuadrilateral robot_quad1 = local_map.polygons[poly_index];
-  // get quadrilaterals ahead in the current lane
-  art_msgs::ArtLanes lane_quads =
-    quad_ops::filterLanes(robot_quad1, local_map,
-                          *quad_ops::compare_forward_seg_lane);
-
-  // get obstacles ahead in the current lane
-  art_msgs::ArtLanes lane_obstacles =
-    quad_ops::filterLanes(robot_quad1, obstacles,
-                          *quad_ops::compare_forward_seg_lane);
+  // get quadrilaterals and obstacles ahead in the current lane
+  const ObserverContext::Lane &lane = context.forward();
+  const art_msgs::ArtLanes &lane_quads = lane.quads;
+  const art_msgs::ArtLanes &lane_obstacles = lane.obstacles;
 
   float distance = std::numeric_limits<float>::infinity();
   if (lane_obstacles.polygons.size()!=0)
     {
       // Get distance along road from robot to nearest obstacle
-      int target_id = lane_obstacles.polygons[0].poly_id;
-      distance = 0;
-      for (size_t i = 0; i < lane_quads.polygons.size(); i++)
-	{
-	  distance += lane_quads.polygons[i].length;
-	  if (lane_quads.polygons[i].poly_id == target_id)
-	    break;
-	}
+      int i = lane.position(lane_obstacles.polygons[0].poly_id);
+      if (i < 0)
+        i = lane_quads.polygons.size();
+      distance = lane.lengths.length(0, i+1);
     }
 
   // Filter the distance by averaging over time
@@ -0,0 +1,144 @@
+/*
+ *  Copyright (C) 2011 UT-Austin & Austin Robot Technology
+ *  License: Modified BSD Software License
+ */
+
+/**  @file
+
+     ART lane observer shared context implementation.  Each part is
+     worked out the same way the observers used to do it for
+     themselves, so they see the same lanes and obstacles.
+
+ */
+
+#include <algorithm>
+
+#include <art_observers/QuadrilateralOps.h>
+#include <art_observers/observer_context.h>
+
+namespace observers
+{
+
+const poly_list_t &ObserverContext::polys()
+{
+  if (needs(POLYS))
+    ops_.GetPolys(*local_map_, polys_);
+  return polys_;
+}
+
+int ObserverContext::robotIndex()
+{
+  if (needs(ROBOT))
+    robot_index_ = ops_.getClosestPoly(polys(), pose_.map.x, pose_.map.y);
+  return robot_index_;
+}
+
+const ObserverContext::Lane &ObserverContext::forward()
+{
+  if (needs(FORWARD))
+    {
+      currentLane(forward_, *quad_ops::compare_forward_seg_lane);
+      indexLane(forward_);
+    }
+  return forward_;
+}
+
+const ObserverContext::Lane &ObserverContext::backward()
+{
+  if (needs(BACKWARD))
+    {
+      currentLane(backward_, *quad_ops::compare_backward_seg_lane);
+
+      // the filter leaves them in road map order, farthest first
+      std::reverse(backward_.quads.polygons.begin(),
+                   backward_.quads.polygons.end());
+      std::reverse(backward_.obstacles.polygons.begin(),
+                   backward_.obstacles.polygons.end());
+      indexLane(backward_);
+    }
+  return backward_;
+}
+
+const ObserverContext::Lane &ObserverContext::left()
+{
+  if (needs(LEFT))
+    adjacentLane(left_, 1);
+  return left_;
+}
+
+const ObserverContext::Lane &ObserverContext::right()
+{
+  if (needs(RIGHT))
+    adjacentLane(right_, -1);
+  return right_;
+}
+
+/** collect the adjacent lane polygons in @a direction (+1 for left,
+ *  -1 for right), and the obstacles in them
+ */
+void ObserverContext::adjacentLane(Lane &lane, int direction)
+{
+  ops_.getLaneDir(polys(), adj_polys_, 0, direction, pose_, robotIndex());
+  ops_.GetLanes(adj_polys_, lane.quads);
+  lane.index = ops_.getClosestPoly(adj_polys_, pose_.map.x, pose_.map.y);
+
+  adj_geom_.build(lane.quads);
+  quad_ops::obstaclesInLane(*obstacles_, lane.quads, adj_geom_,
+                            lane.obstacles);
+  indexLane(lane);
+}
+
+/** collect the polygons of the robot's lane passing @a filter, and
+ *  the obstacles in them
+ */
+void ObserverContext::currentLane(Lane &lane, QuadFilter filter)
+{
+  lane.index = -1;
+  int robot = robotIndex();
+  if (robot < 0)
+    {
+      lane.quads.polygons.clear();
+      lane.obstacles.polygons.clear();
+      return;
+    }
+
+  const art_msgs::ArtQuadrilateral &robot_quad = local_map_->polygons[robot];
+  quad_ops::filterLanes(robot_quad, *local_map_, filter, lane.quads);
+  quad_ops::filterLanes(robot_quad, *obstacles_, filter, lane.obstacles);
+}
+
+/** build the arc lengths and poly_id index of @a lane quads */
+void ObserverContext::indexLane(Lane &lane)
+{
+  const std::vector<art_msgs::ArtQuadrilateral> &quads = lane.quads.polygons;
+  lane.lengths.build(lane.quads);
+  lane.ids.resize(quads.size());
+  bool ascending = true;
+  bool descending = true;
+  for (unsigned i = 0; i < quads.size(); ++i)
+    {
+      lane.ids[i] = std::make_pair((int) quads[i].poly_id, (int) i);
+      if (i > 0)
+        {
+          ascending = ascending && (lane.ids[i-1] < lane.ids[i]);
+          descending = descending && (lane.ids[i-1].first > lane.ids[i].first);
+        }
+    }
+
+  // lanes are usually in poly_id order, one way or the other
+  if (descending)
+    std::reverse(lane.ids.begin(), lane.ids.end());
+  else if (!ascending)
+    std::sort(lane.ids.begin(), lane.ids.end());
+}
+
+int ObserverContext::Lane::position(int poly_id) const
+{
+  std::vector<std::pair<int, int> >::const_iterator it =
+    std::lower_bound(ids.begin(), ids.end(), std::make_pair(poly_id, -1));
+  if (it == ids.end() || it->first != poly_id)
+    return -1;
+  return it->second;
+}
+
+}; // namespace observers